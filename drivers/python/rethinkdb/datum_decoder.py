@@ -0,0 +1,106 @@
+# Copyright 2010-2014 RethinkDB, all rights reserved.
+
+# Decodes response payloads of the BINARY_DATUM protocol.  The format is
+# described in ql2.proto; the result has the same shape as a parsed JSON
+# response, so the rest of the driver doesn't have to care.
+
+__all__ = ['decode_response']
+
+import base64
+import struct
+
+from rethinkdb.errors import RqlDriverError
+
+_double = struct.Struct('<d')
+_offset_widths = ((0xff, 1), (0xffff, 2), (0xffffffff, 4))
+
+def _read_varint(buf, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = buf[pos]
+        pos += 1
+        result |= (byte & 0x7f) << shift
+        if byte < 0x80:
+            return result, pos
+        shift += 7
+
+def _offset_width(size):
+    for limit, width in _offset_widths:
+        if size <= limit:
+            return width
+    return 8
+
+def _read_bytes(buf, pos):
+    size, pos = _read_varint(buf, pos)
+    return buf[pos:pos + size], pos + size
+
+def _read_elements(buf, pos):
+    # Returns the number of elements and the position of the first one.
+    size, pos = _read_varint(buf, pos)
+    count, pos = _read_varint(buf, pos)
+    if count > 1:
+        pos += (count - 1) * _offset_width(size)
+    return count, pos
+
+def _read_int(buf, pos, negative):
+    # Integral numbers are sent as varints, but they're doubles on the server.
+    # The signed zero -0.0 and anything that a double can't hold exactly stay
+    # floats.
+    magnitude, pos = _read_varint(buf, pos)
+    value = -magnitude if negative else magnitude
+    as_float = -float(magnitude) if negative else float(magnitude)
+    if (negative and magnitude == 0) or int(as_float) != value:
+        return as_float, pos
+    return value, pos
+
+def _read_datum(buf, pos):
+    datum_type = buf[pos]
+    pos += 1
+    if datum_type == 2:
+        return buf[pos] != 0, pos + 1
+    elif datum_type == 3:
+        return None, pos
+    elif datum_type == 4:
+        return _double.unpack_from(bytes(buf[pos:pos + 8]))[0], pos + 8
+    elif datum_type == 6:
+        data, pos = _read_bytes(buf, pos)
+        return data.decode('utf-8'), pos
+    elif datum_type == 7 or datum_type == 8:
+        return _read_int(buf, pos, datum_type == 7)
+    elif datum_type == 9:
+        data, pos = _read_bytes(buf, pos)
+        return {'$reql_type$': 'BINARY',
+                'data': base64.b64encode(bytes(data)).decode('ascii')}, pos
+    elif datum_type == 10:
+        count, pos = _read_elements(buf, pos)
+        result = [ ]
+        for _ in range(count):
+            value, pos = _read_datum(buf, pos)
+            result.append(value)
+        return result, pos
+    elif datum_type == 11:
+        count, pos = _read_elements(buf, pos)
+        result = { }
+        for _ in range(count):
+            key, pos = _read_bytes(buf, pos)
+            result[key.decode('utf-8')], pos = _read_datum(buf, pos)
+        return result, pos
+    raise RqlDriverError("Unknown datum type %d in binary response." % datum_type)
+
+def decode_response(payload):
+    buf = bytearray(payload)
+    try:
+        response_type = struct.unpack_from('<i', bytes(buf[0:4]))[0]
+        count, pos = _read_varint(buf, 4)
+        data = [ ]
+        for _ in range(count):
+            value, pos = _read_datum(buf, pos)
+            data.append(value)
+        backtrace, pos = _read_datum(buf, pos)
+        profile, pos = _read_datum(buf, pos)
+    except (IndexError, struct.error, UnicodeDecodeError):
+        raise RqlDriverError("Malformed binary response.")
+    if pos != len(buf):
+        raise RqlDriverError("Malformed binary response.")
+    return {"t": response_type, "r": data, "b": backtrace, "p": profile}
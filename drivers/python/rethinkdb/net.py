@@ -16,6 +16,7 @@ pQuery = p.Query.QueryType
 from rethinkdb import repl # For the repl connection
 from rethinkdb.errors import *
 from rethinkdb.ast import RqlQuery, DB, recursively_convert_pseudotypes
+from rethinkdb.datum_decoder import decode_response
 
 try:
     {}.iteritems
@@ -52,10 +53,12 @@ class Query(object):
         return json.dumps(res, ensure_ascii=False, allow_nan=False)
 
 class Response(object):
-    def __init__(self, token, json_str):
-        json_str = json_str.decode('utf-8')
+    def __init__(self, token, buf, binary_datums=False):
         self.token = token
-        full_response = json.loads(json_str)
+        if binary_datums:
+            full_response = decode_response(buf)
+        else:
+            full_response = json.loads(buf.decode('utf-8'))
         self.type = full_response["t"]
         self.data = full_response["r"]
         self.backtrace = full_response.get("b", None)
@@ -118,13 +121,16 @@ class Cursor(object):
             self.conn._end_cursor(self)
 
 class Connection(object):
-    def __init__(self, host, port, db, auth_key, timeout):
+    def __init__(self, host, port, db, auth_key, timeout, binary_datums=False,
+                 response_delay=None):
         self.socket = None
         self.host = host
         self.next_token = 1
         self.db = db
         self.auth_key = auth_key.encode('ascii')
         self.timeout = timeout
+        self.binary_datums = binary_datums
+        self.response_delay = response_delay
         self.cursor_cache = { }
 
         # Try to convert the port to an integer
@@ -155,10 +161,18 @@ class Connection(object):
         try:
             # Send our initial handshake
             
+            # The response delay, in microseconds, needs V0_4
+            version = p.VersionDummy.Version.V0_3
+            delay = b""
+            if self.response_delay is not None:
+                version = p.VersionDummy.Version.V0_4
+                delay = struct.pack("<l", self.response_delay)
             self._sock_sendall(
-                struct.pack("<2L", p.VersionDummy.Version.V0_3, len(self.auth_key)) +
+                struct.pack("<2L", version, len(self.auth_key)) +
                 self.auth_key +
-                struct.pack("<L", p.VersionDummy.Protocol.JSON)
+                struct.pack("<L", p.VersionDummy.Protocol.BINARY_DATUM
+                                  if self.binary_datums else p.VersionDummy.Protocol.JSON) +
+                delay
             )
             
             # Read out the response from the server, which will be a null-terminated string
@@ -304,7 +318,7 @@ class Connection(object):
                 raise err
 
             # Construct response
-            response = Response(response_token, response_buf)
+            response = Response(response_token, response_buf, self.binary_datums)
 
             # Check that this is the response we were expecting
             if response.token == token:
@@ -372,5 +386,6 @@ class Connection(object):
 
         return value
 
-def connect(host='localhost', port=28015, db=None, auth_key="", timeout=20):
-    return Connection(host, port, db, auth_key, timeout)
+def connect(host='localhost', port=28015, db=None, auth_key="", timeout=20, binary_datums=False,
+            response_delay=None):
+    return Connection(host, port, db, auth_key, timeout, binary_datums, response_delay)
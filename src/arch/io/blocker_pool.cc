@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "arch/runtime/thread_pool.hpp"
 #include "config/args.hpp"
 #include "utils.hpp"
 
@@ -98,6 +99,17 @@ blocker_pool_t::blocker_pool_t(int nthreads, linux_event_queue_t *_queue)
         // fails.
         UNUSED int ignored_res = pthread_attr_setstacksize(&attr, COROUTINE_STACK_SIZE);
 
+#ifdef _GNU_SOURCE
+        // Otherwise we'd inherit the affinity of the thread creating us, which in
+        // thread-per-core mode is a single CPU that's busy already.  Stay on its NUMA
+        // node, close to the buffers we read into and write from.
+        cpu_set_t node_cpus;
+        if (linux_thread_pool_t::get_local_numa_node_cpus(&node_cpus)) {
+            res = pthread_attr_setaffinity_np(&attr, sizeof(node_cpus), &node_cpus);
+            guarantee_xerr(res == 0, res, "Could not set blocker-pool thread affinity.");
+        }
+#endif
+
         res = pthread_create(&threads[i], &attr,
             &blocker_pool_t::event_loop, reinterpret_cast<void*>(this));
         guarantee_xerr(res == 0, res, "Could not create blocker-pool thread.");
@@ -11,6 +11,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include "utils.hpp"
 #include <boost/bind.hpp>
@@ -96,6 +97,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(const ip_address_t &peer,
         sock(create_socket_wrapper(peer.get_address_family())),
         event_watcher(new linux_event_watcher_t(sock.get(), this)),
         read_in_progress(false), write_in_progress(false),
+        read_buffer_offset(0),
         write_handler(this),
         write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
         write_coro_pool(1, &write_queue, &write_handler),
@@ -148,6 +150,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(fd_t s) :
     sock(s),
     event_watcher(new linux_event_watcher_t(sock.get(), this)),
     read_in_progress(false), write_in_progress(false),
+    read_buffer_offset(0),
     write_handler(this),
     write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
     write_coro_pool(1, &write_queue, &write_handler),
@@ -200,6 +203,23 @@ void linux_tcp_conn_t::release_write_queue_op(write_queue_op_t *op) {
     unused_write_queue_ops.push_front(op);
 }
 
+void linux_tcp_conn_t::consume_read_buffer(size_t size) {
+    rassert(size <= read_buffer_size());
+    read_buffer_offset += size;
+    if (read_buffer_offset == read_buffer.size()) {
+        read_buffer.clear();
+        read_buffer_offset = 0;
+    }
+}
+
+void linux_tcp_conn_t::compact_read_buffer() {
+    if (read_buffer_offset > 0 && read_buffer_size() <= read_buffer_offset) {
+        memmove(read_buffer.data(), read_buffer_data(), read_buffer_size());
+        read_buffer.resize(read_buffer_size());
+        read_buffer_offset = 0;
+    }
+}
+
 size_t linux_tcp_conn_t::read_internal(void *buffer, size_t size) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
     assert_thread();
     rassert(!read_closed.is_pulsed());
@@ -247,11 +267,11 @@ size_t linux_tcp_conn_t::read_some(void *buf, size_t size, signal_t *closer) THR
     rassert(size > 0);
     read_op_wrapper_t sentry(this, closer);
 
-    if (read_buffer.size()) {
+    if (read_buffer_size() > 0) {
         /* Return the data from the peek buffer */
-        size_t read_buffer_bytes = std::min(read_buffer.size(), size);
-        memcpy(buf, read_buffer.data(), read_buffer_bytes);
-        read_buffer.erase(read_buffer.begin(), read_buffer.begin() + read_buffer_bytes);
+        size_t read_buffer_bytes = std::min(read_buffer_size(), size);
+        memcpy(buf, read_buffer_data(), read_buffer_bytes);
+        consume_read_buffer(read_buffer_bytes);
         return read_buffer_bytes;
     } else {
         /* Go to the kernel _once_. */
@@ -263,9 +283,9 @@ void linux_tcp_conn_t::read(void *buf, size_t size, signal_t *closer) THROWS_ONL
     read_op_wrapper_t sentry(this, closer);
 
     /* First, consume any data in the peek buffer */
-    int read_buffer_bytes = std::min(read_buffer.size(), size);
-    memcpy(buf, read_buffer.data(), read_buffer_bytes);
-    read_buffer.erase(read_buffer.begin(), read_buffer.begin() + read_buffer_bytes);
+    size_t read_buffer_bytes = std::min(read_buffer_size(), size);
+    memcpy(buf, read_buffer_data(), read_buffer_bytes);
+    consume_read_buffer(read_buffer_bytes);
     buf = reinterpret_cast<void *>(reinterpret_cast<char *>(buf) + read_buffer_bytes);
     size -= read_buffer_bytes;
 
@@ -281,6 +301,7 @@ void linux_tcp_conn_t::read(void *buf, size_t size, signal_t *closer) THROWS_ONL
 void linux_tcp_conn_t::read_more_buffered(signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
     read_op_wrapper_t sentry(this, closer);
 
+    compact_read_buffer();
     size_t old_size = read_buffer.size();
     read_buffer.resize(old_size + IO_BUFFER_SIZE);
     size_t delta = read_internal(read_buffer.data() + old_size, IO_BUFFER_SIZE);
@@ -293,14 +314,14 @@ const_charslice linux_tcp_conn_t::peek() const THROWS_ONLY(tcp_conn_read_closed_
     rassert(!read_in_progress);   // Is there a read already in progress?
     if (read_closed.is_pulsed()) throw tcp_conn_read_closed_exc_t();
 
-    return const_charslice(read_buffer.data(), read_buffer.data() + read_buffer.size());
+    return const_charslice(read_buffer_data(), read_buffer_data() + read_buffer_size());
 }
 
 const_charslice linux_tcp_conn_t::peek(size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
-    while (read_buffer.size() < size) {
+    while (read_buffer_size() < size) {
         read_more_buffered(closer);
     }
-    return const_charslice(read_buffer.data(), read_buffer.data() + size);
+    return const_charslice(read_buffer_data(), read_buffer_data() + size);
 }
 
 void linux_tcp_conn_t::pop(size_t len, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
@@ -309,7 +330,7 @@ void linux_tcp_conn_t::pop(size_t len, signal_t *closer) THROWS_ONLY(tcp_conn_re
     if (read_closed.is_pulsed()) throw tcp_conn_read_closed_exc_t();
 
     peek(len, closer);
-    read_buffer.erase(read_buffer.begin(), read_buffer.begin() + len);  // INEFFICIENT
+    consume_read_buffer(len);
 }
 
 void linux_tcp_conn_t::shutdown_read() {
@@ -337,19 +358,42 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != NULL) {
-        parent->perform_write(operation->buffer, operation->size);
-        if (operation->dealloc != NULL) {
-            parent->release_write_buffer(operation->dealloc);
-            parent->write_queue_limiter.unlock(operation->size);
+    /* Take along whatever else is in the write queue already, so that many small
+    writes go out with a single system call. The pool only has one coroutine, so
+    nobody else pops from the queue in the meantime. */
+    write_queue_op_t *ops[MAX_WRITEV_OPS];
+    iovec iov[MAX_WRITEV_OPS];
+    size_t num_ops = 0;
+    size_t iovcnt = 0;
+    ops[num_ops++] = operation;
+    while (num_ops < MAX_WRITEV_OPS && parent->write_queue.available->get()) {
+        ops[num_ops++] = parent->write_queue.pop();
+    }
+    for (size_t i = 0; i < num_ops; ++i) {
+        if (ops[i]->buffer != NULL && ops[i]->size > 0) {
+            iov[iovcnt].iov_base = const_cast<void *>(ops[i]->buffer);
+            iov[iovcnt].iov_len = ops[i]->size;
+            ++iovcnt;
         }
     }
 
-    if (operation->cond != NULL) {
-        operation->cond->pulse();
-    }
-    if (operation->dealloc != NULL) {
-        parent->release_write_queue_op(operation);
+    parent->perform_write(iov, iovcnt);
+
+    for (size_t i = 0; i < num_ops; ++i) {
+        write_queue_op_t *op = ops[i];
+        if (op->dealloc != NULL) {
+            parent->release_write_buffer(op->dealloc);
+            parent->write_queue_limiter.unlock(op->size);
+        }
+        /* The op may belong to whoever waits on `cond`, so we must not touch it
+        once it's pulsed. */
+        const bool owned = op->dealloc != NULL;
+        if (op->cond != NULL) {
+            op->cond->pulse();
+        }
+        if (owned) {
+            parent->release_write_queue_op(op);
+        }
     }
 }
 
@@ -376,7 +420,7 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
     write_queue.push(op);
 }
 
-void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
+void linux_tcp_conn_t::perform_write(iovec *iov, size_t iovcnt) {
     assert_thread();
 
     if (write_closed.is_pulsed()) {
@@ -386,8 +430,8 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         return;
     }
 
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    while (iovcnt > 0) {
+        ssize_t res = ::writev(sock.get(), iov, iovcnt);
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -420,15 +464,25 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         } else if (res == 0) {
             /* This should never happen either, but it's better to write an error message than to
                crash completely. */
-            logERR("Didn't expect write() to return 0.");
+            logERR("Didn't expect writev() to return 0.");
             on_shutdown_write();
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) write_perfmon->record(res);
+            /* Skip over whatever got written */
+            size_t written = res;
+            while (iovcnt > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (iovcnt > 0) {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            } else {
+                rassert(written == 0);
+            }
         }
     }
 }
@@ -460,6 +514,30 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
 }
 
+void linux_tcp_conn_t::writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    if (current_write_buffer->size > 0) internal_flush_write_buffer();
+
+    /* Enqueue all of the buffers before we block, so that the write coroutine can
+    take them in one go. Only the last one signals us; the queue is FIFO, so by then
+    the others have been written too. */
+    scoped_array_t<write_queue_op_t> ops(iovcnt);
+    cond_t to_signal_when_done;
+    for (size_t i = 0; i < iovcnt; ++i) {
+        ops[i].buffer = iov[i].iov_base;
+        ops[i].size = iov[i].iov_len;
+        ops[i].dealloc = NULL;
+        ops[i].cond = i + 1 == iovcnt ? &to_signal_when_done : NULL;
+        write_queue.push(&ops[i]);
+    }
+    if (iovcnt > 0) {
+        to_signal_when_done.wait();
+    }
+
+    if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
+}
+
 void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
 
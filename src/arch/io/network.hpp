@@ -5,6 +5,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -105,6 +106,11 @@ public:
     pipe and throws `tcp_conn_write_closed_exc_t`. */
     void write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* writev() is like calling write() on each of the `iovcnt` buffers in `iov` in
+    turn, except that it only blocks once, and the buffers go out together, with as
+    few system calls as possible. */
+    void writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -224,8 +230,17 @@ private:
     /* These are pulsed if and only if the read/write end of the connection has been closed. */
     cond_t read_closed, write_closed;
 
-    /* Holds data that we read from the socket but hasn't been consumed yet */
+    /* Holds data that we read from the socket but hasn't been consumed yet, starting
+    at `read_buffer_offset`.  Consuming data only moves the offset; the unconsumed
+    data is moved to the front of the buffer once it's no larger than the consumed
+    data in front of it, so that every byte gets moved at most once on average. */
     std::vector<char> read_buffer;
+    size_t read_buffer_offset;
+
+    size_t read_buffer_size() const { return read_buffer.size() - read_buffer_offset; }
+    const char *read_buffer_data() const { return read_buffer.data() + read_buffer_offset; }
+    void consume_read_buffer(size_t size);
+    void compact_read_buffer();
 
     /* Reads up to the given number of bytes, but not necessarily that many. Simple wrapper around
     ::read(). Returns the number of bytes read or throws tcp_conn_read_closed_exc_t. Bypasses read_buffer. */
@@ -233,6 +248,8 @@ private:
 
     static const size_t WRITE_QUEUE_MAX_SIZE = 128 * KILOBYTE;
     static const size_t WRITE_CHUNK_SIZE = 8 * KILOBYTE;
+    /* The most write queue operations that we hand to a single `::writev()` */
+    static const size_t MAX_WRITEV_OPS = 64;
 
     /* Structs to avoid over-using dynamic allocation */
     struct write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
@@ -299,8 +316,8 @@ private:
     scoped_ptr_t<write_buffer_t> current_write_buffer;
 
     /* Used to actually perform a write. If the write end of the connection is open, then writes
-    `size` bytes from `buffer` to the socket. */
-    void perform_write(const void *buffer, size_t size);
+    the `iovcnt` buffers in `iov` to the socket. Modifies `iov`. */
+    void perform_write(iovec *iov, size_t iovcnt);
 
     scoped_ptr_t<auto_drainer_t> drainer;
 };
@@ -0,0 +1,251 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/compute_pool.hpp"
+
+#include <signal.h>
+
+#include <exception>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "config/args.hpp"
+#include "utils.hpp"
+
+/* A range that a coroutine submitted.  When the last of it has been processed, the
+worker that processed it sends the job back to the coroutine's thread as a message,
+and the coroutine is woken up from there. */
+class compute_pool_t::job_t : public linux_thread_message_t {
+public:
+    job_t(size_t _remaining, size_t _grain,
+          const std::function<void(size_t, size_t)> *_fn)
+        : fn(_fn),
+          grain(_grain),
+          home_thread(linux_thread_pool_t::get_thread()),
+          waiter(coro_t::self()),
+          remaining(_remaining),
+          failed(false) { }
+
+    bool has_failed() const {
+        return __atomic_load_n(&failed, __ATOMIC_ACQUIRE);
+    }
+
+    void fail(std::exception_ptr exc) {
+        spinlock_acq_t acq(&exception_lock);
+        if (!failed) {
+            exception = exc;
+            __atomic_store_n(&failed, true, __ATOMIC_RELEASE);
+        }
+    }
+
+    // Called when `count` indices have been processed (or skipped).
+    void finish(size_t count) {
+        if (__atomic_sub_fetch(&remaining, count, __ATOMIC_SEQ_CST) == 0) {
+            home_thread->message_hub.insert_external_message(this);
+        }
+    }
+
+    void on_thread_switch() {
+        waiter->notify_sometime();
+    }
+
+    const std::function<void(size_t, size_t)> *const fn;
+    const size_t grain;
+
+    // Only read once the job has come back to the coroutine's thread.
+    std::exception_ptr exception;
+
+private:
+    linux_thread_t *const home_thread;
+    coro_t *const waiter;
+
+    size_t remaining;
+    bool failed;
+    spinlock_t exception_lock;
+
+    DISABLE_COPYING(job_t);
+};
+
+compute_pool_t::compute_pool_t(int num_workers)
+    : workers(num_workers),
+      queued_tasks(0),
+      sleeping_workers(0),
+      shutting_down(false) {
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].parent = this;
+        workers[i].index = i;
+
+        pthread_attr_t attr;
+        int res = pthread_attr_init(&attr);
+        guarantee_xerr(res == 0, res, "pthread_attr_init failed.");
+
+        // Whatever is enough for a coroutine is enough for the functions we run.
+        // Disregard failure -- we'll just use the default stack size if this
+        // somehow fails.
+        UNUSED int ignored_res = pthread_attr_setstacksize(&attr, COROUTINE_STACK_SIZE);
+
+#ifdef _GNU_SOURCE
+        // In thread-per-core mode, don't inherit the single CPU of the thread
+        // creating us.
+        cpu_set_t all_cpus;
+        if (linux_thread_pool_t::get_all_cpus(&all_cpus)) {
+            res = pthread_attr_setaffinity_np(&attr, sizeof(all_cpus), &all_cpus);
+            guarantee_xerr(res == 0, res, "Could not set compute-pool thread affinity.");
+        }
+#endif
+
+        res = pthread_create(&workers[i].thread, &attr,
+                             &compute_pool_t::worker_loop, &workers[i]);
+        guarantee_xerr(res == 0, res, "Could not create compute-pool thread.");
+
+        res = pthread_attr_destroy(&attr);
+        guarantee_xerr(res == 0, res, "pthread_attr_destroy failed.");
+    }
+}
+
+compute_pool_t::~compute_pool_t() {
+    {
+        system_mutex_t::lock_t sleep_lock(&sleep_mutex);
+        shutting_down = true;
+
+        // It is an error to shut down the compute pool while jobs are still out.
+        rassert(__atomic_load_n(&queued_tasks, __ATOMIC_SEQ_CST) == 0);
+
+        sleep_cond.broadcast();
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        int res = pthread_join(workers[i].thread, NULL);
+        guarantee_xerr(res == 0, res, "Could not join compute-pool thread.");
+    }
+}
+
+void compute_pool_t::run(size_t begin, size_t end, size_t grain,
+                         const std::function<void(size_t, size_t)> &fn) {
+    rassert(coro_t::self() != NULL);
+    rassert(grain > 0);
+    if (begin >= end) {
+        return;
+    }
+
+    job_t job(end - begin, grain, &fn);
+    task_t task;
+    task.job = &job;
+    task.begin = begin;
+    task.end = end;
+    push_task(&submitted_lock, &submitted, task);
+
+    // `job` is delivered to this thread as a message once it's done, which can't
+    // happen before we give up control here.
+    coro_t::wait();
+
+    if (job.exception) {
+        std::rethrow_exception(job.exception);
+    }
+}
+
+void *compute_pool_t::worker_loop(void *arg) {
+    worker_t *worker = static_cast<worker_t *>(arg);
+
+    // Disable signals on this thread. This ensures that signals like SIGINT are
+    // handled by one of the main threads.
+    {
+        sigset_t sigmask;
+        int res = sigfillset(&sigmask);
+        guarantee_err(res == 0, "Could not get a full sigmask");
+
+        res = pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
+        guarantee_xerr(res == 0, res, "Could not block signal");
+    }
+
+    task_t task;
+    while (worker->parent->take_task(worker, &task)) {
+        worker->parent->run_task(worker, task);
+    }
+    return NULL;
+}
+
+bool compute_pool_t::take_task(worker_t *worker, task_t *task_out) {
+    for (;;) {
+        if (try_take_task(worker, task_out)) {
+            __atomic_sub_fetch(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+            return true;
+        }
+
+        system_mutex_t::lock_t sleep_lock(&sleep_mutex);
+        // `push_task()` increments `queued_tasks` before it checks
+        // `sleeping_workers`, and we do the opposite, so either it sees us
+        // sleeping and signals us, or we see its task.
+        __atomic_add_fetch(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&queued_tasks, __ATOMIC_SEQ_CST) == 0 && !shutting_down) {
+            sleep_cond.wait(&sleep_mutex);
+        }
+        __atomic_sub_fetch(&sleeping_workers, 1, __ATOMIC_SEQ_CST);
+        if (shutting_down) {
+            return false;
+        }
+    }
+}
+
+bool compute_pool_t::try_take_task(worker_t *worker, task_t *task_out) {
+    // Our own smallest piece, which is the one most likely to still be in cache.
+    {
+        spinlock_acq_t acq(&worker->lock);
+        if (!worker->tasks.empty()) {
+            *task_out = worker->tasks.back();
+            worker->tasks.pop_back();
+            return true;
+        }
+    }
+
+    {
+        spinlock_acq_t acq(&submitted_lock);
+        if (!submitted.empty()) {
+            *task_out = submitted.front();
+            submitted.pop_front();
+            return true;
+        }
+    }
+
+    // The biggest piece anybody else has.
+    for (size_t i = 1; i < workers.size(); ++i) {
+        worker_t *victim = &workers[(worker->index + i) % workers.size()];
+        spinlock_acq_t acq(&victim->lock);
+        if (!victim->tasks.empty()) {
+            *task_out = victim->tasks.front();
+            victim->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void compute_pool_t::run_task(worker_t *worker, task_t task) {
+    job_t *job = task.job;
+    while (task.end - task.begin > job->grain) {
+        task_t second_half = task;
+        second_half.begin = task.begin + (task.end - task.begin) / 2;
+        push_task(&worker->lock, &worker->tasks, second_half);
+        task.end = second_half.begin;
+    }
+
+    if (!job->has_failed()) {
+        try {
+            (*job->fn)(task.begin, task.end);
+        } catch (...) {
+            job->fail(std::current_exception());
+        }
+    }
+    job->finish(task.end - task.begin);
+}
+
+void compute_pool_t::push_task(spinlock_t *lock, std::deque<task_t> *tasks,
+                               const task_t &task) {
+    {
+        spinlock_acq_t acq(lock);
+        tasks->push_back(task);
+    }
+    __atomic_add_fetch(&queued_tasks, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sleeping_workers, __ATOMIC_SEQ_CST) > 0) {
+        system_mutex_t::lock_t sleep_lock(&sleep_mutex);
+        sleep_cond.signal();
+    }
+}
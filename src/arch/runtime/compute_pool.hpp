@@ -0,0 +1,93 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_COMPUTE_POOL_HPP_
+#define ARCH_RUNTIME_COMPUTE_POOL_HPP_
+
+#include <pthread.h>
+
+#include <deque>
+#include <functional>
+
+#include "errors.hpp"
+#include "arch/io/concurrency.hpp"
+#include "arch/spinlock.hpp"
+#include "containers/scoped.hpp"
+
+/* `compute_pool_t` is a set of threads for CPU-bound work that can be split into
+independent pieces, such as sorting a big array.  There is one per thread pool (see
+`linux_thread_pool_t::get_compute_pool()`).  A coroutine hands it a range of indices
+and a function to apply to them, and blocks until the whole range has been processed,
+while its own thread goes on running other coroutines.
+
+Every worker has a deque of subranges.  A worker that takes a subrange splits it in
+half again and again, pushing the second halves onto the back of its own deque, until
+what's left is no longer than the grain, which it processes.  It then continues with
+the back of its deque, which has the smallest pieces.  Workers that run out of work
+take the next range submitted by a coroutine, or steal from the front of the other
+workers' deques, which has the biggest pieces.
+
+The functions run on threads without an event queue, so they must not use
+coroutines, `counted_t`s of single-threaded objects, or anything else that's tied to
+a thread. */
+class compute_pool_t {
+public:
+    explicit compute_pool_t(int num_workers);
+    ~compute_pool_t();
+
+    int num_workers() const { return workers.size(); }
+
+    // Calls `fn(b, e)` on subranges, each at most `grain` long, that together cover
+    // `[begin, end)`, and blocks the calling coroutine until all the calls have
+    // returned.  The calls can run at the same time on different threads.  If any of
+    // them throws, the subranges that haven't been started yet are skipped and the
+    // first exception is rethrown.  This can't be interrupted.
+    void run(size_t begin, size_t end, size_t grain,
+             const std::function<void(size_t, size_t)> &fn);
+
+private:
+    class job_t;
+
+    struct task_t {
+        job_t *job;
+        size_t begin;
+        size_t end;
+    };
+
+    struct worker_t {
+        compute_pool_t *parent;
+        size_t index;
+        pthread_t thread;
+        spinlock_t lock;
+        std::deque<task_t> tasks;
+    };
+
+    static void *worker_loop(void *arg);
+
+    // Blocks until there's a task for `worker`.  Returns false if the pool is
+    // shutting down.
+    bool take_task(worker_t *worker, task_t *task_out);
+    bool try_take_task(worker_t *worker, task_t *task_out);
+    void run_task(worker_t *worker, task_t task);
+
+    // Pushes `task` onto the back of `tasks`, and wakes up a worker if any are
+    // sleeping.
+    void push_task(spinlock_t *lock, std::deque<task_t> *tasks, const task_t &task);
+
+    scoped_array_t<worker_t> workers;
+
+    // The ranges submitted by coroutines, which any worker may take.
+    spinlock_t submitted_lock;
+    std::deque<task_t> submitted;
+
+    // The number of tasks in `submitted` and the workers' deques.
+    int64_t queued_tasks;
+
+    // Workers sleep on `sleep_cond` when they can't find any tasks.
+    system_mutex_t sleep_mutex;
+    system_cond_t sleep_cond;
+    int sleeping_workers;
+    bool shutting_down;
+
+    DISABLE_COPYING(compute_pool_t);
+};
+
+#endif  // ARCH_RUNTIME_COMPUTE_POOL_HPP_
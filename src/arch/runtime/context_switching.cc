@@ -40,14 +40,14 @@ bool artificial_stack_context_ref_t::is_nil() {
 
 artificial_stack_t::artificial_stack_t(void (*initial_fun)(void), size_t _stack_size)
     : stack_size(_stack_size) {
-    /* Allocate the stack */
-    stack = malloc_aligned(stack_size, getpagesize());
-
-    /* Tell the operating system that it can unmap the stack space
-    (except for the first page, which we are definitely going to need).
-    This is an optimization to keep memory consumption in check. */
+    /* Reserve address space for the stack.  The operating system only backs the
+    pages with memory once they're touched, so a coroutine that never gets deep
+    only costs us the few pages at the top.  `MAP_NORESERVE` keeps the untouched
+    part from counting against the commit limit. */
     guarantee(stack_size >= static_cast<size_t>(getpagesize()));
-    madvise(stack, stack_size - getpagesize(), MADV_DONTNEED);
+    stack = mmap(NULL, stack_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    guarantee_err(stack != MAP_FAILED, "Could not allocate a coroutine stack");
 
     /* Protect the end of the stack so that we crash when we get a stack
     overflow instead of corrupting memory. */
@@ -146,25 +146,34 @@ artificial_stack_t::~artificial_stack_t() {
 #endif
 #endif
 
-    /* Undo protections changes */
-#ifndef THREADED_COROUTINES
-    mprotect(stack, getpagesize(), PROT_READ | PROT_WRITE);
-#endif
+    /* Release the stack we allocated, protection page and all */
+    int res = munmap(stack, stack_size);
+    guarantee_err(res == 0, "Could not free a coroutine stack");
+}
 
-    /* Return the memory to the operating system right away. This makes
-    sense because we keep our own cache of coroutine stacks around and
-    don't need to rely on the allocator to optimize for the case of
-    us quickly re-allocating an object of the same size.
-    On OS X we use MADV_FREE. On Linux MADV_FREE is not available,
-    and we use MADV_DONTNEED instead. */
+void artificial_stack_t::free_unused_pages() {
+    /* If our context is nil, we're the stack that's running right now, and the
+    part below this function's frame is free.  Otherwise everything below the
+    saved context is. */
+    char dummy;
+    void *in_use = context.is_nil() ? &dummy : context.pointer;
+    rassert(address_in_stack(in_use));
+
+    /* Leave the page we're using and the one below it alone, and the protection
+    page as well. */
+    const uintptr_t page_size = getpagesize();
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(stack) + page_size;
+    const uintptr_t end =
+        floor_aligned(reinterpret_cast<uintptr_t>(in_use), page_size) - page_size;
+    if (end > begin) {
+        /* On OS X we use MADV_FREE. On Linux MADV_FREE is not available,
+        and we use MADV_DONTNEED instead. */
 #ifdef __MACH__
-    madvise(stack, stack_size, MADV_FREE);
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_FREE);
 #else
-    madvise(stack, stack_size, MADV_DONTNEED);
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_DONTNEED);
 #endif
-
-    /* Release the stack we allocated */
-    free(stack);
+    }
 }
 
 bool artificial_stack_t::address_in_stack(void *addr) {
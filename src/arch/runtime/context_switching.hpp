@@ -65,6 +65,11 @@ public:
     /* Returns the end of the stack */
     void *get_stack_bound() { return stack; }
 
+    /* Gives the memory of the pages below the part of the stack that is in use
+    back to the operating system.  They are committed again when they're touched.
+    If the stack is running, it must be the one we're running on. */
+    void free_unused_pages();
+
 private:
     void *stack;
     size_t stack_size;
@@ -177,6 +182,9 @@ public:
     /* Returns the end of the stack */
     void *get_stack_bound();
 
+    /* The stack belongs to a real thread, so there's nothing for us to do. */
+    void free_unused_pages() { }
+
 private:
     static void *internal_run(void *p);
     void get_stack_addr_size(void **stackaddr_out, size_t *stacksize_out);
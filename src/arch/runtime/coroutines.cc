@@ -14,6 +14,7 @@
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/coro_profiler.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -40,8 +41,11 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
-    intrusive_list_t<coro_t> free_coros;
+    /* The coro_t objects that are not in use.  The stacks of the "warm" ones
+    still have the memory they were using, so we take those first.  The "cold"
+    ones have given their memory back (see `coro_t::return_coro_to_free_list()`). */
+    intrusive_list_t<coro_t> warm_free_coros;
+    intrusive_list_t<coro_t> cold_free_coros;
 
 #ifndef NDEBUG
 
@@ -80,8 +84,12 @@ struct coro_globals_t {
         rassert(!current_coro);
 
         /* Destroy remaining coroutines */
-        while (coro_t *s = free_coros.head()) {
-            free_coros.remove(s);
+        while (coro_t *s = warm_free_coros.head()) {
+            warm_free_coros.remove(s);
+            delete s;
+        }
+        while (coro_t *s = cold_free_coros.head()) {
+            cold_free_coros.remove(s);
             delete s;
         }
     }
@@ -93,10 +101,25 @@ TLS_with_init(coro_globals_t *, cglobals, NULL);
 // These must be initialized after TLS_cglobals, because perfmon_multi_membership_t
 // construction depends on coro_t::coroutines_have_been_initialized() which in turn
 // depends on cglobals.
-static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines;
+static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines,
+    pm_coroutine_stack_reserved_bytes, pm_warm_free_coroutines,
+    pm_cold_free_coroutines;
 static perfmon_multi_membership_t pm_coroutines_membership(&get_global_perfmon_collection(),
     &pm_active_coroutines, "active_coroutines",
-    &pm_allocated_coroutines, "allocated_coroutines");
+    &pm_allocated_coroutines, "allocated_coroutines",
+    &pm_coroutine_stack_reserved_bytes, "coroutine_stack_reserved_bytes",
+    &pm_warm_free_coroutines, "warm_free_coroutines",
+    &pm_cold_free_coroutines, "cold_free_coroutines");
+
+// How long coroutines wait between being scheduled and running, by scheduling class.
+static perfmon_histogram_t pm_queue_delay[NUM_SCHED_CLASSES];
+static perfmon_multi_membership_t pm_queue_delay_membership(&get_global_perfmon_collection(),
+    &pm_queue_delay[static_cast<int>(sched_class_t::INTERACTIVE)], "queue_delay_interactive",
+    &pm_queue_delay[static_cast<int>(sched_class_t::BATCH)], "queue_delay_batch",
+    &pm_queue_delay[static_cast<int>(sched_class_t::BACKGROUND)], "queue_delay_background");
+
+// Counts wakeups on each thread, to pick the ones to sample.
+TLS_with_init(int, queue_delay_sample_countdown, SCHED_QUEUE_DELAY_SAMPLE_INTERVAL);
 
 coro_runtime_t::coro_runtime_t() {
     rassert(!TLS_get_cglobals(), "coro runtime initialized twice on this thread");
@@ -124,7 +147,12 @@ TLS_with_init(int64_t, coro_selfname_counter, 0);
 
 coro_t::coro_t() :
     stack(&coro_t::run, coro_stack_size),
+    stack_size(coro_stack_size),
     current_thread_(linux_thread_pool_t::get_thread_id()),
+    sched_class_(sched_class_t::BATCH),
+    resume_count_(0),
+    spawn_site_(NULL),
+    notified_at_(0),
     notified_(false),
     waiting_(false)
 #ifndef NDEBUG
@@ -139,6 +167,7 @@ coro_t::coro_t() :
 #endif
 {
     ++pm_allocated_coroutines;
+    pm_coroutine_stack_reserved_bytes += stack_size;
 
 #ifndef NDEBUG
     TLS_get_cglobals()->coro_count++;
@@ -149,14 +178,27 @@ coro_t::coro_t() :
 }
 
 void coro_t::return_coro_to_free_list(coro_t *coro) {
-    TLS_get_cglobals()->free_coros.push_back(coro);
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (cglobals->warm_free_coros.size() < COROUTINE_WARM_FREE_LIST_SIZE) {
+        cglobals->warm_free_coros.push_back(coro);
+        ++pm_warm_free_coroutines;
+    } else {
+        /* Whatever the coroutine used of its stack is garbage now.  If it ran on
+        this thread we're still on that stack, but `free_unused_pages()` only
+        frees what's below us; otherwise it has already switched out, because
+        we got here through a message it sent. */
+        coro->stack.free_unused_pages();
+        cglobals->cold_free_coros.push_back(coro);
+        ++pm_cold_free_coroutines;
+    }
 }
 
 void coro_t::maybe_evict_from_free_list() {
     coro_globals_t *cglobals = TLS_get_cglobals();
-    while (cglobals->free_coros.size() > COROUTINE_FREE_LIST_SIZE) {
-        coro_t *coro_to_delete = cglobals->free_coros.tail();
-        cglobals->free_coros.remove(coro_to_delete);
+    while (cglobals->cold_free_coros.size() > COROUTINE_FREE_LIST_SIZE) {
+        coro_t *coro_to_delete = cglobals->cold_free_coros.tail();
+        cglobals->cold_free_coros.remove(coro_to_delete);
+        --pm_cold_free_coroutines;
         delete coro_to_delete;
     }
 }
@@ -169,6 +211,7 @@ coro_t::~coro_t() {
     TLS_get_cglobals()->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    pm_coroutine_stack_reserved_bytes -= stack_size;
 }
 
 void coro_t::run() {
@@ -246,13 +289,17 @@ void coro_t::wait() {   /* class method */
     rassert(!self()->waiting_);
     self()->waiting_ = true;
 
-    PROFILER_CORO_YIELD(1);
-    if (TLS_get_cglobals()->prev_coro) {
-        context_switch(&self()->stack.context, &TLS_get_cglobals()->prev_coro->stack.context);
-    } else {
-        context_switch(&self()->stack.context, &TLS_get_cglobals()->scheduler);
+    {
+        profiler_wait_sample_t wait_sample;
+
+        PROFILER_CORO_YIELD(1);
+        if (TLS_get_cglobals()->prev_coro) {
+            context_switch(&self()->stack.context, &TLS_get_cglobals()->prev_coro->stack.context);
+        } else {
+            context_switch(&self()->stack.context, &TLS_get_cglobals()->scheduler);
+        }
+        PROFILER_CORO_RESUME;
     }
-    PROFILER_CORO_RESUME;
 
     rassert(self());
     rassert(self()->waiting_);
@@ -293,6 +340,7 @@ void coro_t::notify_now_deprecated() {
     coro_t *prev_prev_coro = TLS_get_cglobals()->prev_coro;
     TLS_get_cglobals()->prev_coro = TLS_get_cglobals()->current_coro;
     TLS_get_cglobals()->current_coro = this;
+    ++resume_count_;
 
     if (TLS_get_cglobals()->prev_coro) {
         context_switch(&TLS_get_cglobals()->prev_coro->stack.context, &this->stack.context);
@@ -316,6 +364,7 @@ void coro_t::notify_now_deprecated() {
 void coro_t::notify_sometime() {
     rassert(!notified_);
     notified_ = true;
+    maybe_sample_notify_time();
     linux_thread_pool_t::get_thread()->message_hub.store_message_sometime(
         current_thread_,
         this);
@@ -324,6 +373,7 @@ void coro_t::notify_sometime() {
 void coro_t::notify_later_ordered() {
     rassert(!notified_);
     notified_ = true;
+    maybe_sample_notify_time();
 
     /* `current_thread` is the thread that the coroutine lives on, which may or may not be the
     same as `get_thread_id()`.  (In a call to move_to_thread, it won't be.) */
@@ -344,10 +394,26 @@ void coro_t::move_to_thread(threadnum_t thread) {
     wait();
 }
 
+void coro_t::maybe_sample_notify_time() {
+    // The countdown belongs to the notifying thread, which may not be the thread the
+    // coroutine is on; that doesn't matter for picking a sample.
+    int countdown = TLS_get_queue_delay_sample_countdown() - 1;
+    if (countdown == 0) {
+        countdown = SCHED_QUEUE_DELAY_SAMPLE_INTERVAL;
+        notified_at_ = get_ticks();
+    }
+    TLS_set_queue_delay_sample_countdown(countdown);
+}
+
 void coro_t::on_thread_switch() {
     rassert(notified_);
     notified_ = false;
 
+    if (notified_at_ != 0) {
+        pm_queue_delay[static_cast<int>(sched_class_)].record(get_ticks() - notified_at_);
+        notified_at_ = 0;
+    }
+
     /* TODO: When `notify_now_deprecated()` is finally removed, just fold it
     into this function. */
     notify_now_deprecated();
@@ -377,11 +443,17 @@ coro_t * coro_t::get_coro() {
     rassert(coroutines_have_been_initialized());
     coro_t *coro;
 
-    if (TLS_get_cglobals()->free_coros.size() == 0) {
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (cglobals->warm_free_coros.size() != 0) {
+        coro = cglobals->warm_free_coros.tail();
+        cglobals->warm_free_coros.remove(coro);
+        --pm_warm_free_coroutines;
+    } else if (cglobals->cold_free_coros.size() == 0) {
         coro = new coro_t();
     } else {
-        coro = TLS_get_cglobals()->free_coros.tail();
-        TLS_get_cglobals()->free_coros.remove(coro);
+        coro = cglobals->cold_free_coros.tail();
+        cglobals->cold_free_coros.remove(coro);
+        --pm_cold_free_coroutines;
 
         /* We cannot easily delete coroutines at the time where we return
         them to the free list, because coro_t::run() requires the coro_t pointer to remain
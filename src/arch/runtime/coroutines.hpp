@@ -9,6 +9,7 @@
 #include "arch/runtime/callable_action.hpp"
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/runtime_utils.hpp"
+#include "arch/runtime/sched_class.hpp"
 #include "threading.hpp"
 #include "time.hpp"
 
@@ -143,6 +144,28 @@ public:
         return linux_thread_message_t::get_priority();
     }
 
+    /* Puts the coroutine in the given scheduling class (see `sched_class_t`), and
+    sets its priority to the class's. */
+    void set_sched_class(sched_class_t _sched_class) {
+        sched_class_ = _sched_class;
+        set_priority(sched_class_priority(_sched_class));
+    }
+    sched_class_t get_sched_class() const {
+        return sched_class_;
+    }
+
+    /* The `__PRETTY_FUNCTION__` of the `get_and_init_coro()` instantiation the
+    coroutine was spawned through, which names the type of the function it runs. */
+    const char *get_spawn_site() const {
+        return spawn_site_;
+    }
+
+    /* How many times the coroutine has been switched to.  If this hasn't changed,
+    the coroutine hasn't given up control in the meantime. */
+    uint64_t get_resume_count() const {
+        return resume_count_;
+    }
+
     /* Copies the backtrace from the time of spawning the coroutine into
     `buffer_out`, which has to be allocated before calling the function.
     `size` must contain the maximum number of entries to store.
@@ -170,16 +193,18 @@ private:
 #ifndef NDEBUG
         coro->parse_coroutine_type(__PRETTY_FUNCTION__);
 #endif
+        coro->spawn_site_ = __PRETTY_FUNCTION__;
         coro->grab_spawn_backtrace();
         coro->action_wrapper.reset(std::forward<Callable>(action));
 
         // If we were called from a coroutine, the new coroutine inherits our
-        // caller's priority.
+        // caller's scheduling class and priority.
         if (self() != NULL) {
+            coro->sched_class_ = self()->get_sched_class();
             coro->set_priority(self()->get_priority());
         } else {
             // Otherwise, just reset to the default.
-            coro->set_priority(MESSAGE_SCHEDULER_DEFAULT_PRIORITY);
+            coro->set_sched_class(sched_class_t::BATCH);
         }
 
         return coro;
@@ -198,10 +223,23 @@ private:
 
     virtual void on_thread_switch();
 
+    // Samples the time at which the coroutine was scheduled, for the queueing delay
+    // histograms.
+    void maybe_sample_notify_time();
+
     coro_stack_t stack;
+    const size_t stack_size;
 
     threadnum_t current_thread_;
 
+    sched_class_t sched_class_;
+    uint64_t resume_count_;
+    const char *spawn_site_;
+
+    // When the coroutine was last scheduled through the message hub, if that wakeup
+    // was sampled for the queueing delay histograms; otherwise 0.
+    ticks_t notified_at_;
+
     // Sanity check variables
     bool notified_;
     bool waiting_;
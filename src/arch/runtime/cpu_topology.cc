@@ -0,0 +1,146 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/cpu_topology.hpp"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "errors.hpp"
+#include "utils.hpp"
+
+#ifdef _GNU_SOURCE
+
+// Parses lists like "0-3,8-11\n", the format the kernel uses for sets of CPUs and
+// nodes.
+static bool parse_cpu_list(const std::string &list, std::vector<int> *out) {
+    out->clear();
+    size_t pos = 0;
+    while (pos < list.size() && list[pos] != '\n') {
+        size_t end = list.find_first_of(",\n", pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string range = list.substr(pos, end - pos);
+        const size_t dash = range.find('-');
+        uint64_t first, last;
+        if (dash == std::string::npos) {
+            if (!strtou64_strict(range, 10, &first)) {
+                return false;
+            }
+            last = first;
+        } else if (!strtou64_strict(range.substr(0, dash), 10, &first)
+                   || !strtou64_strict(range.substr(dash + 1), 10, &last)
+                   || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (uint64_t i = first; i <= last; ++i) {
+            out->push_back(i);
+        }
+        pos = end < list.size() && list[end] == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+static bool read_sysfs_int(const std::string &path, uint64_t *out) {
+    std::string contents;
+    if (!blocking_read_file(path.c_str(), &contents)) {
+        return false;
+    }
+    while (!contents.empty() && contents[contents.size() - 1] == '\n') {
+        contents.resize(contents.size() - 1);
+    }
+    return strtou64_strict(contents, 10, out);
+}
+
+std::vector<cpu_info_t> get_cpu_placement_order() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return std::vector<cpu_info_t>();
+    }
+
+    // Machines without NUMA support don't have `/sys/devices/system/node`; then all
+    // the CPUs are on node zero.
+    std::map<int, int> node_of_cpu;
+    std::string online_nodes;
+    std::vector<int> nodes;
+    if (blocking_read_file("/sys/devices/system/node/online", &online_nodes)
+        && parse_cpu_list(online_nodes, &nodes)) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            std::string cpu_list;
+            std::vector<int> cpus;
+            if (!blocking_read_file(
+                    strprintf("/sys/devices/system/node/node%d/cpulist",
+                              nodes[i]).c_str(),
+                    &cpu_list)
+                || !parse_cpu_list(cpu_list, &cpus)) {
+                return std::vector<cpu_info_t>();
+            }
+            for (auto cpu = cpus.begin(); cpu != cpus.end(); ++cpu) {
+                node_of_cpu[*cpu] = nodes[i];
+            }
+        }
+    }
+
+    std::vector<cpu_info_t> cpus;
+    std::map<std::pair<uint64_t, uint64_t>, int> dense_cores;
+    std::map<int, int> dense_nodes;
+    std::map<int, int> siblings_seen;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        uint64_t package, core_id;
+        if (!read_sysfs_int(strprintf("/sys/devices/system/cpu/cpu%d/topology/"
+                                      "physical_package_id", cpu), &package)
+            || !read_sysfs_int(strprintf("/sys/devices/system/cpu/cpu%d/topology/"
+                                         "core_id", cpu), &core_id)) {
+            return std::vector<cpu_info_t>();
+        }
+        cpu_info_t info;
+        info.cpu = cpu;
+        auto core = dense_cores.insert(std::make_pair(std::make_pair(package, core_id),
+                                                      dense_cores.size())).first;
+        info.core = core->second;
+        auto node = node_of_cpu.find(cpu);
+        const int raw_node = node == node_of_cpu.end() ? 0 : node->second;
+        info.numa_node = dense_nodes.insert(
+            std::make_pair(raw_node, dense_nodes.size())).first->second;
+        info.sibling_rank = siblings_seen[info.core]++;
+        cpus.push_back(info);
+    }
+
+    // Sort each node's CPUs so that the first hyperthreads of the cores come first,
+    // then deal them out one node at a time.
+    std::vector<std::vector<cpu_info_t> > by_node(dense_nodes.size());
+    for (auto it = cpus.begin(); it != cpus.end(); ++it) {
+        by_node[it->numa_node].push_back(*it);
+    }
+    for (auto it = by_node.begin(); it != by_node.end(); ++it) {
+        std::sort(it->begin(), it->end(),
+                  [](const cpu_info_t &a, const cpu_info_t &b) {
+                      return std::make_pair(a.sibling_rank, a.core)
+                          < std::make_pair(b.sibling_rank, b.core);
+                  });
+    }
+    std::vector<cpu_info_t> order;
+    for (size_t i = 0; order.size() < cpus.size(); ++i) {
+        for (auto it = by_node.begin(); it != by_node.end(); ++it) {
+            if (i < it->size()) {
+                order.push_back((*it)[i]);
+            }
+        }
+    }
+    return order;
+}
+
+#else  // _GNU_SOURCE
+
+std::vector<cpu_info_t> get_cpu_placement_order() {
+    return std::vector<cpu_info_t>();
+}
+
+#endif  // _GNU_SOURCE
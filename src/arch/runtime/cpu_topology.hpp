@@ -0,0 +1,27 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_CPU_TOPOLOGY_HPP_
+#define ARCH_RUNTIME_CPU_TOPOLOGY_HPP_
+
+#include <vector>
+
+/* Where a CPU sits in the machine, as reported by the kernel in
+`/sys/devices/system`.  `core` and `numa_node` are renumbered to be dense, starting at
+zero. */
+struct cpu_info_t {
+    int cpu;
+    // The physical core the CPU is a hyperthread of.  CPUs on the same core have the
+    // same `core`.
+    int core;
+    int numa_node;
+    // Zero for the first hyperthread of a core, one for the second, and so on.
+    int sibling_rank;
+};
+
+/* Returns the CPUs this process is allowed to run on, in the order the thread pool
+puts its threads on them in thread-per-core mode: first one hyperthread of every core,
+then the second ones.  Consecutive CPUs in the list alternate between NUMA nodes, so
+that any number of threads is spread evenly over the nodes.  Returns an empty vector
+if the topology can't be read, which is the case on anything but Linux. */
+std::vector<cpu_info_t> get_cpu_placement_order();
+
+#endif  // ARCH_RUNTIME_CPU_TOPOLOGY_HPP_
@@ -1,6 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "arch/runtime/event_queue.hpp"
 
+#include <inttypes.h>
 #include <string.h>
 
 #include "arch/runtime/thread_pool.hpp"
@@ -8,10 +9,64 @@
 #include "utils.hpp"
 #include "perfmon/perfmon.hpp"
 
+/* Reads the stats that the event queues keep for themselves, so that they don't have
+to update perfmons on every pass through their loops. */
+class perfmon_event_queue_stats_t : public perfmon_perthread_t<event_queue_stats_t> {
+private:
+    void get_thread_stat(event_queue_stats_t *stat) {
+        *stat = linux_thread_pool_t::get_thread()->queue.get_stats();
+    }
+
+    event_queue_stats_t combine_stats(const event_queue_stats_t *stats) {
+        event_queue_stats_t combined;
+        for (int i = 0; i < get_num_threads(); ++i) {
+            combined.iterations += stats[i].iterations;
+            combined.event_batches += stats[i].event_batches;
+            combined.events += stats[i].events;
+            combined.sleeps += stats[i].sleeps;
+            combined.busy_poll_hits += stats[i].busy_poll_hits;
+            combined.callback_ns += stats[i].callback_ns;
+            combined.busy_poll_ns += stats[i].busy_poll_ns;
+            combined.sleep_ns += stats[i].sleep_ns;
+        }
+        return combined;
+    }
+
+    scoped_ptr_t<perfmon_result_t> output_stat(const event_queue_stats_t &stat) {
+        scoped_ptr_t<perfmon_result_t> result = perfmon_result_t::alloc_map_result();
+        result->insert("iterations",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.iterations)));
+        result->insert("event_batches",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.event_batches)));
+        result->insert("events",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.events)));
+        result->insert("events_per_batch",
+                       new perfmon_result_t(strprintf(
+                           "%.2f", stat.event_batches == 0 ? 0.0 :
+                           static_cast<double>(stat.events) / stat.event_batches)));
+        result->insert("sleeps",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.sleeps)));
+        result->insert("busy_poll_hits",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.busy_poll_hits)));
+        result->insert("callback_ns",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.callback_ns)));
+        result->insert("busy_poll_ns",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.busy_poll_ns)));
+        result->insert("sleep_ns",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.sleep_ns)));
+        return result;
+    }
+};
+
 perfmon_duration_sampler_t *pm_eventloop_singleton_t::get() {
     static perfmon_duration_sampler_t pm_eventloop(secs_to_ticks(1));
     static perfmon_membership_t pm_eventloop_membership(
         &get_global_perfmon_collection(), &pm_eventloop, "eventloop");
+    // The event queues call this on every pass, so this gets registered as soon as
+    // there's anything to report.
+    static perfmon_event_queue_stats_t pm_eventloop_stats;
+    static perfmon_membership_t pm_eventloop_stats_membership(
+        &get_global_perfmon_collection(), &pm_eventloop_stats, "eventloop_stats");
     return &pm_eventloop;
 }
 
@@ -53,13 +53,41 @@ epoll_event_queue_t::epoll_event_queue_t(linux_queue_parent_t *_parent)
     guarantee_err(epoll_fd >= 0, "Could not create epoll fd");
 }
 
+int epoll_event_queue_t::wait_for_events() {
+    // Grab the events from the kernel!  When busy polling, we look for events and
+    // give our parent a chance to find some work of its own for a while before we go
+    // to sleep.  Otherwise we go straight to the blocking wait.
+    int res;
+    const ticks_t budget = parent->busy_poll_ns();
+    if (budget > 0) {
+        const ticks_t start = get_ticks();
+        ticks_t now = start;
+        do {
+            res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, 0);
+            if (res != 0 || parent->poll_before_sleeping()) {
+                ++stats.busy_poll_hits;
+                stats.busy_poll_ns += get_ticks() - start;
+                return res;
+            }
+            now = get_ticks();
+        } while (now - start < budget);
+        stats.busy_poll_ns += now - start;
+    }
+
+    ++stats.sleeps;
+    const ticks_t start = get_ticks();
+    res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+    stats.sleep_ns += get_ticks() - start;
+    return res;
+}
+
 void epoll_event_queue_t::run() {
     int res;
 
     // Now, start the loop
     while (!parent->should_shut_down()) {
-        // Grab the events from the kernel!
-        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        ++stats.iterations;
+        res = wait_for_events();
 
         // epoll_wait might return with EINTR in some cases (in
         // particular under GDB), we just need to retry.
@@ -75,8 +103,14 @@ void epoll_event_queue_t::run() {
         // new descriptor (which we probably can't at this point).
         guarantee_err(res != -1, "Waiting for epoll events failed");
 
+        const ticks_t callbacks_start = get_ticks();
+
         // nevents might be used by forget_resource during the loop
         nevents = res;
+        if (nevents > 0) {
+            ++stats.event_batches;
+            stats.events += nevents;
+        }
 
 #ifndef NDEBUG
         /* Sanity check: Make sure epoll() didn't give us any events we didn't ask for */
@@ -119,6 +153,8 @@ void epoll_event_queue_t::run() {
         nevents = 0;
 
         parent->pump();
+
+        stats.callback_ns += get_ticks() - callbacks_start;
     }
 }
 
@@ -25,7 +25,14 @@ public:
     void adjust_resource(fd_t resource, int events, linux_event_callback_t *cb);
     void forget_resource(fd_t resource, linux_event_callback_t *cb);
 
+    const event_queue_stats_t &get_stats() const { return stats; }
+
 private:
+    // Fills in `events`, busy polling first if our parent wants us to, and then
+    // sleeping.  Returns the number of events, or zero if our parent found something
+    // else to do instead, or -1 if `epoll_wait` failed.
+    int wait_for_events();
+
     linux_queue_parent_t *parent;
 
     fd_t epoll_fd;
@@ -36,6 +43,8 @@ private:
     epoll_event events[MAX_IO_EVENT_PROCESSING_BATCH_SIZE];
     int nevents;
 
+    event_queue_stats_t stats;
+
 #ifndef NDEBUG
     /* In debug mode, check to make sure epoll() doesn't give us events that
     we didn't ask for. The ints stored here are combinations of poll_event_in
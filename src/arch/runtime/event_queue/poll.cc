@@ -99,6 +99,10 @@ void poll_event_queue_t::run() {
 
     // Now, start the loop
     while (!parent->should_shut_down()) {
+        ++stats.iterations;
+        ++stats.sleeps;
+        const ticks_t sleep_start = get_ticks();
+
         // Grab the events from the kernel!
 #ifndef RDB_TIMER_PROVIDER
 #error "RDB_TIMER_PROVIDER not defined."
@@ -117,6 +121,13 @@ void poll_event_queue_t::run() {
         // have no way of handling, and it's probably fatal.
         guarantee_err(res != -1, "Waiting for poll events failed");
 
+        const ticks_t callbacks_start = get_ticks();
+        stats.sleep_ns += callbacks_start - sleep_start;
+        if (res > 0) {
+            ++stats.event_batches;
+            stats.events += res;
+        }
+
         block_pm_duration event_loop_timer(pm_eventloop_singleton_t::get());
 
         int count = 0;
@@ -144,6 +155,8 @@ void poll_event_queue_t::run() {
 #endif  // RDB_TIMER_PROVIDER
 
         parent->pump();
+
+        stats.callback_ns += get_ticks() - callbacks_start;
     }
 }
 
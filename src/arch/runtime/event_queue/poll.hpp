@@ -23,12 +23,17 @@ public:
     void adjust_resource(fd_t resource, int events, linux_event_callback_t *cb);
     void forget_resource(fd_t resource, linux_event_callback_t *cb);
 
+    // There's no busy polling here; the `poll()` queue is only a fallback.
+    const event_queue_stats_t &get_stats() const { return stats; }
+
 private:
     linux_queue_parent_t *parent;
 
     std::vector<pollfd> watched_fds;
     std::map<fd_t, linux_event_callback_t *> callbacks;
 
+    event_queue_stats_t stats;
+
     DISABLE_COPYING(poll_event_queue_t);
 };
 
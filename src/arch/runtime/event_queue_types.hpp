@@ -3,6 +3,9 @@
 #define ARCH_RUNTIME_EVENT_QUEUE_TYPES_HPP_
 
 #include <signal.h>
+#include <stdint.h>
+
+#include "time.hpp"
 
 // Types that are used, in particular, by poll.hpp and epoll.hpp.
 
@@ -15,9 +18,38 @@ struct linux_event_callback_t {
 struct linux_queue_parent_t {
     virtual void pump() = 0;
     virtual bool should_shut_down() = 0;
+    // Called when there are no events and the event queue busy polls (see
+    // `busy_poll_ns()`).  Returns true if it found something else to do, in which
+    // case the queue looks for events again instead of sleeping.
+    virtual bool poll_before_sleeping() { return false; }
+    // How long the event queue should keep looking for events and calling
+    // `poll_before_sleeping()` before it goes to sleep.  Spinning costs a CPU, but
+    // saves the time it takes the kernel to wake the thread up again.
+    virtual ticks_t busy_poll_ns() { return 0; }
     virtual ~linux_queue_parent_t() {}
 };
 
+// What an event queue has done since it started.  Only its own thread may touch it.
+struct event_queue_stats_t {
+    event_queue_stats_t()
+        : iterations(0), event_batches(0), events(0), sleeps(0), busy_poll_hits(0),
+          callback_ns(0), busy_poll_ns(0), sleep_ns(0) { }
+
+    // Passes through the loop.
+    int64_t iterations;
+    // Passes that found events, and the number of events they found.
+    int64_t event_batches;
+    int64_t events;
+    // The number of times the queue went to sleep in the kernel.
+    int64_t sleeps;
+    // The number of times busy polling found something to do before its time was up.
+    int64_t busy_poll_hits;
+    // The time spent handling events and running messages, spinning, and asleep.
+    int64_t callback_ns;
+    int64_t busy_poll_ns;
+    int64_t sleep_ns;
+};
+
 
 #endif  // ARCH_RUNTIME_EVENT_QUEUE_TYPES_HPP_
 
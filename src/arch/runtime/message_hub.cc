@@ -8,6 +8,7 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "logger.hpp"
+#include "time.hpp"
 #include "utils.hpp"
 
 // Set this to 1 if you would like some "unordered" messages to be unordered.
@@ -20,7 +21,10 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
                                          threadnum_t current_thread)
     : queue_(queue),
       thread_pool_(thread_pool),
+      incoming_messages_(NULL),
       is_woken_up_(false),
+      received_recently_(false),
+      pending_messages_(0),
       current_thread_(current_thread) {
 
 #ifndef NDEBUG
@@ -44,7 +48,7 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(__atomic_load_n(&incoming_messages_, __ATOMIC_SEQ_CST) == NULL);
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
@@ -91,15 +95,37 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
+    msg_list_t msgs;
+    msgs.push_back(msg);
+    push_incoming_messages(&msgs);
+}
+
+void linux_message_hub_t::push_incoming_messages(msg_list_t *msgs) {
+    // Link the messages up newest first, which is the order the stack is in.
+    linux_thread_message_t *oldest = msgs->head();
+    linux_thread_message_t *newest = NULL;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->next_incoming = newest;
+        newest = m;
     }
+    if (newest == NULL) {
+        return;
+    }
+
+    linux_thread_message_t *top = __atomic_load_n(&incoming_messages_, __ATOMIC_RELAXED);
+    do {
+        oldest->next_incoming = top;
+    } while (!__atomic_compare_exchange_n(&incoming_messages_, &top, newest,
+                                          true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
 
-    // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+    wake_up();
+}
+
+void linux_message_hub_t::wake_up() {
+    // We only need to do a wake up if we're the first people to do a wake up.
+    if (!__atomic_exchange_n(&is_woken_up_, true, __ATOMIC_SEQ_CST)) {
+        // Wakey wakey eggs and bakey
         event_.wakey_wakey();
     }
 }
@@ -119,6 +145,41 @@ void linux_message_hub_t::on_event(int events) {
     // up and so that poll-based event triggering doesn't infinite-loop.
     event_.consume_wakey_wakeys();
 
+    process_messages();
+}
+
+bool linux_message_hub_t::poll_incoming_messages(ticks_t budget) {
+    if (!received_recently_) {
+        return false;
+    }
+    // Tell the senders that we're awake.  If a wakeup is on its way already, the
+    // event queue won't actually sleep, so there's no point in polling.
+    if (__atomic_exchange_n(&is_woken_up_, true, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+
+    const ticks_t deadline = get_ticks() + budget;
+    bool found = false;
+    do {
+        found = __atomic_load_n(&incoming_messages_, __ATOMIC_ACQUIRE) != NULL;
+    } while (!found && get_ticks() < deadline);
+
+    if (!found) {
+        received_recently_ = false;
+        // From here on senders must wake us up again.  Somebody might have pushed
+        // messages after we last looked but before they saw the flag cleared, so we
+        // look once more.
+        __atomic_store_n(&is_woken_up_, false, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&incoming_messages_, __ATOMIC_SEQ_CST) == NULL) {
+            return false;
+        }
+    }
+
+    process_messages();
+    return true;
+}
+
+void linux_message_hub_t::process_messages() {
     // Sort incoming messages into the respective priority_msg_lists_
     sort_incoming_messages_by_priority();
 
@@ -168,6 +229,13 @@ void linux_message_hub_t::on_event(int events) {
         }
     }
 
+    size_t remaining_msgs = 0;
+    for (int i = 0; i < NUM_SCHEDULER_PRIORITIES; ++i) {
+        remaining_msgs += priority_msg_lists_[i].size();
+    }
+    __atomic_store_n(&pending_messages_, static_cast<int64_t>(remaining_msgs),
+                     __ATOMIC_RELAXED);
+
     // We might have left some messages unprocessed.
     // Check if that is the case, and if yes, make sure we are called again.
     for (int i = 0; i < NUM_SCHEDULER_PRIORITIES; ++i) {
@@ -175,31 +243,28 @@ void linux_message_hub_t::on_event(int events) {
             // Place wakey_wakey and then yield to the event processing.
             // It will wake us up again immediately, but can handle a few
             // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
-                event_.wakey_wakey();
-            }
+            wake_up();
             break;
         }
     }
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
-
-    // 1. Pull the messages
+    // 1. Pull the messages.  Senders that come after this have to wake us up
+    // again, so the flag is cleared first.
+    __atomic_store_n(&is_woken_up_, false, __ATOMIC_SEQ_CST);
+    linux_thread_message_t *newest =
+        __atomic_exchange_n(&incoming_messages_, NULL, __ATOMIC_SEQ_CST);
+    received_recently_ = newest != NULL;
+
+    // The stack is newest first; reversing it puts the messages back in the order
+    // they were sent.
     msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
+    while (newest != NULL) {
+        linux_thread_message_t *next = newest->next_incoming;
+        newest->next_incoming = NULL;
+        new_messages.push_front(newest);
+        newest = next;
     }
 
     // 2. Sort the messages into their respective priority queues
@@ -218,38 +283,15 @@ void linux_message_hub_t::sort_incoming_messages_by_priority() {
     }
 }
 
-bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
-}
-
-// Pushes messages collected locally global lists available to all
-// threads.
+// Pushes messages collected locally onto the incoming stacks of the threads they're
+// going to.
 void linux_message_hub_t::push_messages() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Append the local list for ith thread to that thread's global
-        // message list.
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
             // Transfer messages to the other core
-
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
-            }
+            thread_pool_->threads[i]->message_hub.push_incoming_messages(
+                &queue->msg_local_list);
         }
     }
 }
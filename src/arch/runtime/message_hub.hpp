@@ -8,7 +8,6 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
-#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 #include "threading.hpp"
@@ -24,7 +23,12 @@ class linux_thread_pool_t;
 /* There is one message hub per thread, NOT one message hub for the entire program.
 
 Each message hub stores messages that are going from that message hub's home thread to
-other threads. It keeps a separate queue for messages destined for each other thread. */
+other threads. It keeps a separate queue for messages destined for each other thread.
+
+Messages coming in from other threads are pushed onto a lock-free stack, linked through
+the messages themselves, so sending a message never takes a lock or allocates memory.
+Each sender pushes everything it has for us at once, and we take the whole stack at
+once and reverse it, which keeps the messages from any one sender in order. */
 
 class linux_message_hub_t : private linux_event_callback_t {
 public:
@@ -49,6 +53,18 @@ public:
     // (which does not have an event queue)
     void insert_external_message(linux_thread_message_t *msg);
 
+    // Called before this thread's event queue goes to sleep, when it busy polls.  If
+    // we've been getting messages from other threads lately, waits up to `budget`
+    // nanoseconds for more of them, during which the senders don't need to wake us
+    // up.  Returns true if it processed any.
+    bool poll_incoming_messages(ticks_t budget);
+
+    // The number of messages that were still waiting to be processed after this
+    // thread's last pass over its queues.  Can be called from any thread.
+    int64_t pending_message_count() const {
+        return __atomic_load_n(&pending_messages_, __ATOMIC_RELAXED);
+    }
+
     ~linux_message_hub_t();
 
 private:
@@ -60,6 +76,17 @@ private:
     // priority_msg_lists, depending on the messages' priorities.
     void sort_incoming_messages_by_priority();
 
+    // Sorts the incoming messages and processes a pass worth of them.
+    void process_messages();
+
+    // Pushes `msgs` onto the incoming stack, and wakes us up if we need waking.
+    // Can be called from any thread.
+    void push_incoming_messages(msg_list_t *msgs);
+
+    // Wakes us up through the event queue, unless somebody already did or we're
+    // awake anyway.
+    void wake_up();
+
     msg_list_t &get_priority_msg_list(int priority);
 
     linux_event_queue_t *const queue_;
@@ -74,11 +101,17 @@ private:
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
-    bool check_and_set_is_woken_up();
+    // The top of the stack of messages from other threads, linked through
+    // `linux_thread_message_t::next_incoming`, newest first.  Only accessed atomically.
+    linux_thread_message_t *incoming_messages_;
+
+    // Set while a wakeup is on its way, or while we're polling for messages, so that
+    // senders don't have to notify `event_`.  Only accessed atomically.
     bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+
+    // Whether the last pass found messages from other threads; if not, there's no
+    // point in polling for them.  Only used on our own thread.
+    bool received_recently_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -88,10 +121,13 @@ private:
     // MESSAGE_SCHEDULER_ORDERED_PRIORITY)
     msg_list_t priority_msg_lists_[NUM_SCHEDULER_PRIORITIES];
 
+    // See `pending_message_count()`.  Only written by this hub's own thread.
+    int64_t pending_messages_;
+
     void on_event(int events);
 
     // The eventfd (or pipe-based alternative) notified after the first incoming
-    // message is put onto incoming_messages_.
+    // message is put onto incoming_messages_, unless `is_woken_up_` was set.
     system_event_t event_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
@@ -2,6 +2,8 @@
 #include "arch/runtime/runtime.hpp"
 
 #include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <functional>
 
@@ -20,6 +22,32 @@ int get_num_threads() {
     return linux_thread_pool_t::get_thread_pool()->n_threads;
 }
 
+thread_load_t get_thread_load(threadnum_t thread) {
+    assert_good_thread_id(thread);
+    linux_thread_pool_t *pool = linux_thread_pool_t::get_thread_pool();
+    thread_load_t load;
+    load.run_queue_depth =
+        pool->threads[thread.threadnum]->message_hub.pending_message_count();
+    load.cpu_time_ns = 0;
+    clockid_t clock;
+    struct timespec cpu_time;
+    if (pthread_getcpuclockid(pool->pthreads[thread.threadnum], &clock) == 0 &&
+        clock_gettime(clock, &cpu_time) == 0) {
+        load.cpu_time_ns = static_cast<int64_t>(cpu_time.tv_sec) * BILLION
+            + cpu_time.tv_nsec;
+    }
+    return load;
+}
+
+int get_thread_numa_node(threadnum_t thread) {
+    assert_good_thread_id(thread);
+    return linux_thread_pool_t::get_thread_pool()->thread_numa_nodes[thread.threadnum];
+}
+
+int get_num_numa_nodes() {
+    return linux_thread_pool_t::get_thread_pool()->n_numa_nodes;
+}
+
 #ifndef NDEBUG
 void assert_good_thread_id(threadnum_t thread) {
     rassert(thread.threadnum >= 0, "(thread = %" PRIi32 ")", thread.threadnum);
@@ -63,8 +91,9 @@ private:
 };
 
 // Runs the action 'fun()' on thread zero.
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads) {
-    linux_thread_pool_t thread_pool(worker_threads, false);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool thread_per_core, ticks_t busy_poll_ns) {
+    linux_thread_pool_t thread_pool(worker_threads, thread_per_core, busy_poll_ns);
     starter_t starter(&thread_pool, fun);
     thread_pool.run_thread_pool(&starter);
 }
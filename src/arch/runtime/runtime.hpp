@@ -2,6 +2,8 @@
 #ifndef ARCH_RUNTIME_RUNTIME_HPP_
 #define ARCH_RUNTIME_RUNTIME_HPP_
 
+#include <stdint.h>
+
 #include "threading.hpp"
 
 class linux_thread_message_t;
@@ -11,6 +13,24 @@ threadnum_t get_thread_id();
 
 int get_num_threads();
 
+// A rough measure of how busy a thread is, for deciding where to put work that could
+// run on any thread.  Can be taken of any thread from any thread, and may be slightly
+// out of date.
+struct thread_load_t {
+    // The number of messages (mostly coroutines that are ready to run) that the thread
+    // couldn't get to in its last pass over its queues.
+    int64_t run_queue_depth;
+    // The total time the thread has spent on a CPU, in nanoseconds.
+    int64_t cpu_time_ns;
+};
+
+thread_load_t get_thread_load(threadnum_t thread);
+
+// In thread-per-core mode, the NUMA node the thread is pinned to, counting from zero,
+// and the number of NUMA nodes.  Otherwise they're zero and one.
+int get_thread_numa_node(threadnum_t thread);
+int get_num_numa_nodes();
+
 #ifndef NDEBUG
 void assert_good_thread_id(threadnum_t thread);
 #else
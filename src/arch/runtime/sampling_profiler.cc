@@ -0,0 +1,441 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/sampling_profiler.hpp"
+
+#include <errno.h>
+#include <execinfo.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include <map>
+#include <vector>
+
+#include "arch/io/io_utils.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
+#include "backtrace.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
+#include "utils.hpp"
+
+#ifndef __MACH__
+// This *should* be a member of sigevent exposed by glibc, who the
+// heck knows why it isn't...
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace {
+
+/* The profiler's state for one thread.  It's only touched by the thread itself, from
+coroutines and from the signal handler, so the only thing to watch out for is the
+signal handler interrupting a coroutine that's in the middle of recording a sample. */
+struct thread_state_t {
+    thread_state_t()
+        : samples(NULL), num_samples(0), num_dropped(0), session(0), recording(false),
+          wait_countdown(SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL) { }
+
+    // NULL when the thread isn't being profiled.
+    profiler_sample_t *samples;
+    size_t num_samples;
+    uint64_t num_dropped;
+    // Incremented at the end of every profile, so that waits that started during
+    // one profile don't write into the buffer of the next.
+    uint64_t session;
+    // Set while a coroutine is recording a wait sample.
+    bool recording;
+    int wait_countdown;
+#ifndef __MACH__
+    timer_t timer;
+    // The thread's own stack, which the scheduler runs on.
+    uintptr_t stack_lower;
+    uintptr_t stack_upper;
+#endif
+};
+
+cache_line_padded_t<thread_state_t> thread_states[MAX_THREADS];
+
+bool profile_in_progress = false;
+
+// Keeps the compiler from moving memory accesses across it, so that the signal
+// handler sees them in program order.
+inline void signal_fence() {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+thread_state_t *this_thread_state() {
+    const int thread = get_thread_id().threadnum;
+    return thread < 0 ? NULL : &thread_states[thread].value;
+}
+
+profiler_sample_t *reserve_sample(thread_state_t *state) {
+    if (state->num_samples == SAMPLING_PROFILER_MAX_SAMPLES_PER_THREAD) {
+        ++state->num_dropped;
+        return NULL;
+    }
+    return &state->samples[state->num_samples++];
+}
+
+const char *current_spawn_site() {
+    coro_t *coro = coro_t::self();
+    return coro == NULL ? NULL : coro->get_spawn_site();
+}
+
+#ifndef __MACH__
+
+// Stores the stack of the code the signal interrupted in `frames_out`, innermost
+// frame first, and returns the number of frames.
+int walk_interrupted_stack(const thread_state_t *state, const ucontext_t *uctx,
+                           void **frames_out) {
+#if defined(__x86_64__)
+    const uintptr_t pc = uctx->uc_mcontext.gregs[REG_RIP];
+    const uintptr_t sp = uctx->uc_mcontext.gregs[REG_RSP];
+    const uintptr_t fp = uctx->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+    const uintptr_t pc = uctx->uc_mcontext.gregs[REG_EIP];
+    const uintptr_t sp = uctx->uc_mcontext.gregs[REG_ESP];
+    const uintptr_t fp = uctx->uc_mcontext.gregs[REG_EBP];
+#else
+    (void)state;
+    (void)uctx;
+    (void)frames_out;
+    return 0;
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    frames_out[0] = reinterpret_cast<void *>(pc);
+
+    // Everything between the stack pointer and the top of the stack it points into
+    // is in use, and so can be read.
+    uintptr_t stack_upper = 0;
+    coro_t *coro = coro_t::self();
+    if (coro != NULL) {
+        coro_stack_t *stack = coro->get_stack();
+        const uintptr_t lower = reinterpret_cast<uintptr_t>(stack->get_stack_bound());
+        const uintptr_t upper = reinterpret_cast<uintptr_t>(stack->get_stack_base());
+        if (sp >= lower && sp < upper) {
+            stack_upper = upper;
+        }
+    }
+    if (stack_upper == 0 && sp >= state->stack_lower && sp < state->stack_upper) {
+        stack_upper = state->stack_upper;
+    }
+    if (stack_upper == 0) {
+        // We're in the middle of switching stacks.
+        return 1;
+    }
+    return 1 + walk_profiler_frames(fp, sp, stack_upper, frames_out + 1,
+                                    SAMPLING_PROFILER_MAX_FRAMES - 1);
+#endif
+}
+
+void sampling_profiler_signal_handler(UNUSED int signum, UNUSED siginfo_t *siginfo,
+                                      void *uctx) {
+    const int saved_errno = errno;
+    thread_state_t *state = this_thread_state();
+    if (state != NULL && state->samples != NULL) {
+        if (state->recording) {
+            ++state->num_dropped;
+        } else {
+            profiler_sample_t *sample = reserve_sample(state);
+            if (sample != NULL) {
+                sample->kind = profile_kind_t::CPU;
+                sample->spawn_site = current_spawn_site();
+                sample->weight = 1;
+                sample->first_frame = 0;
+                sample->num_frames = walk_interrupted_stack(
+                    state, static_cast<const ucontext_t *>(uctx), sample->frames);
+            }
+        }
+    }
+    errno = saved_errno;
+}
+
+void start_on_this_thread(int frequency) {
+    thread_state_t *state = this_thread_state();
+    guarantee(state->samples == NULL);
+
+    pthread_attr_t attr;
+    int res = pthread_getattr_np(pthread_self(), &attr);
+    guarantee_xerr(res == 0, res, "Could not get the thread's attributes");
+    void *stack_addr;
+    size_t stack_size;
+    res = pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+    guarantee_xerr(res == 0, res, "Could not get the thread's stack");
+    res = pthread_attr_destroy(&attr);
+    guarantee_xerr(res == 0, res, "Could not destroy the thread's attributes");
+    state->stack_lower = reinterpret_cast<uintptr_t>(stack_addr);
+    state->stack_upper = state->stack_lower + stack_size;
+
+    // The buffer's pages are only touched when samples are written to them.
+    state->samples = new profiler_sample_t[SAMPLING_PROFILER_MAX_SAMPLES_PER_THREAD];
+    state->num_samples = 0;
+    state->num_dropped = 0;
+    signal_fence();
+
+    struct sigevent evp;
+    memset(&evp, 0, sizeof(evp));
+    evp.sigev_signo = SIGPROF;
+    evp.sigev_notify = SIGEV_THREAD_ID;
+    evp.sigev_notify_thread_id = _gettid();
+    res = timer_create(CLOCK_THREAD_CPUTIME_ID, &evp, &state->timer);
+    guarantee_err(res == 0, "Could not create the profiling timer");
+
+    const int64_t interval = BILLION / frequency;
+    itimerspec spec;
+    spec.it_value.tv_sec = interval / BILLION;
+    spec.it_value.tv_nsec = interval % BILLION;
+    spec.it_interval = spec.it_value;
+    res = timer_settime(state->timer, 0, &spec, NULL);
+    guarantee_err(res == 0, "Could not arm the profiling timer");
+
+    // The thread pool's threads block all signals but `SIGSEGV`.
+    sigset_t sigmask;
+    res = sigemptyset(&sigmask);
+    guarantee_err(res == 0, "Could not get an empty sigmask");
+    res = sigaddset(&sigmask, SIGPROF);
+    guarantee_err(res == 0, "Could not add SIGPROF to sigmask");
+    res = pthread_sigmask(SIG_UNBLOCK, &sigmask, NULL);
+    guarantee_xerr(res == 0, res, "Could not unblock SIGPROF");
+}
+
+void stop_on_this_thread(profile_kind_t kind, std::vector<profiler_sample_t> *samples_out,
+                         uint64_t *num_dropped_out) {
+    thread_state_t *state = this_thread_state();
+    guarantee(state->samples != NULL);
+
+    sigset_t sigmask;
+    int res = sigemptyset(&sigmask);
+    guarantee_err(res == 0, "Could not get an empty sigmask");
+    res = sigaddset(&sigmask, SIGPROF);
+    guarantee_err(res == 0, "Could not add SIGPROF to sigmask");
+    res = pthread_sigmask(SIG_BLOCK, &sigmask, NULL);
+    guarantee_xerr(res == 0, res, "Could not block SIGPROF");
+
+    res = timer_delete(state->timer);
+    guarantee_err(res == 0, "Could not delete the profiling timer");
+
+    for (size_t i = 0; i < state->num_samples; ++i) {
+        const profiler_sample_t &sample = state->samples[i];
+        if (sample.kind == kind && sample.weight != 0) {
+            samples_out->push_back(sample);
+        }
+    }
+    *num_dropped_out = state->num_dropped;
+
+    delete[] state->samples;
+    state->samples = NULL;
+    ++state->session;
+}
+
+void install_signal_handler() {
+    struct sigaction sa = make_sa_sigaction(SA_SIGINFO | SA_ONSTACK | SA_RESTART,
+                                            &sampling_profiler_signal_handler);
+    int res = sigaction(SIGPROF, &sa, NULL);
+    guarantee_err(res == 0, "Could not install the profiling signal handler");
+}
+
+#endif  // __MACH__
+
+// Turns the `__PRETTY_FUNCTION__` of `coro_t::get_and_init_coro()` into the type of
+// the function the coroutine was spawned with.
+std::string format_spawn_site(const char *spawn_site) {
+    if (spawn_site == NULL) {
+        return "[scheduler]";
+    }
+    std::string res(spawn_site);
+    const std::string with = "[with Callable = ";
+    const size_t start = res.find(with);
+    if (start != std::string::npos) {
+        res = res.substr(start + with.size());
+        if (!res.empty() && res[res.size() - 1] == ']') {
+            res.resize(res.size() - 1);
+        }
+    }
+    return res;
+}
+
+std::string format_frame(const void *addr) {
+    backtrace_frame_t frame(addr);
+    frame.initialize_symbols();
+    try {
+        return frame.get_demangled_name();
+    } catch (const demangle_failed_exc_t &) {
+        if (!frame.get_name().empty()) {
+            return frame.get_name();
+        }
+        return strprintf("%p", addr);
+    }
+}
+
+// Semicolons separate the frames, and newlines the stacks.
+std::string sanitize_frame(std::string name) {
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (name[i] == ';' || name[i] == '\n') {
+            name[i] = ' ';
+        }
+    }
+    return name;
+}
+
+}  // namespace
+
+std::string fold_profiler_samples(const std::vector<profiler_sample_t> &samples) {
+    std::map<const void *, std::string> frame_names;
+    std::map<const char *, std::string> spawn_site_names;
+    std::map<std::string, uint64_t> weights;
+    for (const profiler_sample_t &sample : samples) {
+        auto site = spawn_site_names.find(sample.spawn_site);
+        if (site == spawn_site_names.end()) {
+            site = spawn_site_names.insert(std::make_pair(
+                sample.spawn_site,
+                sanitize_frame(format_spawn_site(sample.spawn_site)))).first;
+        }
+        std::string stack = site->second;
+        for (int i = sample.num_frames - 1; i >= sample.first_frame; --i) {
+            auto frame = frame_names.find(sample.frames[i]);
+            if (frame == frame_names.end()) {
+                frame = frame_names.insert(std::make_pair(
+                    sample.frames[i],
+                    sanitize_frame(format_frame(sample.frames[i])))).first;
+            }
+            stack += ";";
+            stack += frame->second;
+        }
+        weights[stack] += sample.weight;
+    }
+
+    std::string res;
+    for (const auto &pair : weights) {
+        res += strprintf("%s %" PRIu64 "\n", pair.first.c_str(), pair.second);
+    }
+    return res;
+}
+
+int walk_profiler_frames(uintptr_t frame_pointer,
+                         uintptr_t stack_lower, uintptr_t stack_upper,
+                         void **frames_out, int max_frames) {
+    // A frame starts with the caller's frame pointer, followed by the return address.
+    const uintptr_t frame_size = 2 * sizeof(void *);
+    int num_frames = 0;
+    uintptr_t fp = frame_pointer;
+    while (num_frames < max_frames
+           && fp >= stack_lower
+           && fp % sizeof(void *) == 0
+           && fp <= stack_upper - frame_size) {
+        void *const *frame = reinterpret_cast<void *const *>(fp);
+        if (frame[1] == NULL) {
+            break;
+        }
+        frames_out[num_frames++] = frame[1];
+        const uintptr_t caller_fp = reinterpret_cast<uintptr_t>(frame[0]);
+        if (caller_fp <= fp) {
+            break;
+        }
+        fp = caller_fp;
+    }
+    return num_frames;
+}
+
+bool sampling_profiler_is_supported() {
+#ifdef __MACH__
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool take_sampling_profile(ticks_t duration, int frequency, profile_kind_t kind,
+                           signal_t *interruptor, sampling_profile_t *profile_out)
+    THROWS_ONLY(interrupted_exc_t) {
+#ifdef __MACH__
+    (void)duration;
+    (void)frequency;
+    (void)kind;
+    (void)interruptor;
+    (void)profile_out;
+    return false;
+#else
+    guarantee(frequency > 0 && frequency <= SAMPLING_PROFILER_MAX_FREQUENCY);
+    if (__atomic_exchange_n(&profile_in_progress, true, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    install_signal_handler();
+
+    const int num_threads = get_num_threads();
+    pmap(num_threads, [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        start_on_this_thread(frequency);
+    });
+
+    bool interrupted = false;
+    try {
+        nap(duration / MILLION, interruptor);
+    } catch (const interrupted_exc_t &) {
+        interrupted = true;
+    }
+
+    std::vector<std::vector<profiler_sample_t> > samples(num_threads);
+    std::vector<uint64_t> num_dropped(num_threads);
+    pmap(num_threads, [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        stop_on_this_thread(kind, &samples[i], &num_dropped[i]);
+    });
+    __atomic_store_n(&profile_in_progress, false, __ATOMIC_SEQ_CST);
+
+    if (interrupted) {
+        throw interrupted_exc_t();
+    }
+
+    std::vector<profiler_sample_t> all_samples;
+    profile_out->num_dropped = 0;
+    for (int i = 0; i < num_threads; ++i) {
+        all_samples.insert(all_samples.end(), samples[i].begin(), samples[i].end());
+        profile_out->num_dropped += num_dropped[i];
+    }
+    profile_out->folded_stacks = fold_profiler_samples(all_samples);
+    return true;
+#endif
+}
+
+profiler_wait_sample_t::profiler_wait_sample_t()
+    : sample(NULL), thread(-1), session(0), started_at(0) {
+    thread_state_t *state = this_thread_state();
+    if (state == NULL || state->samples == NULL || --state->wait_countdown > 0) {
+        return;
+    }
+    state->wait_countdown = SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL;
+
+    state->recording = true;
+    signal_fence();
+    sample = reserve_sample(state);
+    if (sample != NULL) {
+        sample->kind = profile_kind_t::WAIT;
+        sample->spawn_site = current_spawn_site();
+        sample->weight = 0;
+        // Skip this constructor, but keep `coro_t::wait()`.
+        sample->first_frame = 1;
+        sample->num_frames = backtrace(sample->frames, SAMPLING_PROFILER_MAX_FRAMES);
+    }
+    signal_fence();
+    state->recording = false;
+
+    thread = get_thread_id().threadnum;
+    session = state->session;
+    started_at = get_ticks();
+}
+
+profiler_wait_sample_t::~profiler_wait_sample_t() {
+    if (sample == NULL) {
+        return;
+    }
+    // The coroutine may have moved to another thread, or the profile may be over,
+    // in which case the sample isn't ours to write to anymore.
+    thread_state_t *state = this_thread_state();
+    if (get_thread_id().threadnum == thread && state->session == session) {
+        sample->weight = (get_ticks() - started_at) * SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL;
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+#define ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+#include "time.hpp"
+
+class signal_t;
+
+/* The sampling profiler finds out where the server spends its time, cheaply enough to
+be used in production.  Unlike `coro_profiler_t` it doesn't have to be compiled in.  It
+is off until somebody asks for a profile (through `/ajax/profile` on the administrative
+HTTP server), and only runs for as long as that takes.
+
+While it runs, every thread of the thread pool has a timer that counts the thread's CPU
+time and interrupts it `frequency` times per second of it.  The signal handler records
+the stack of whatever was running, and the spawn site of the coroutine it was running
+in, into a buffer that belongs to the thread.  `backtrace()` isn't async-signal-safe,
+so the handler follows the frame pointers of the interrupted code instead, reading only
+the part of the stack that's in use.  Release builds omit frame pointers unless they
+are made with `NO_OMIT_FRAME_POINTER=1`; without them, CPU samples mostly just show the
+function that was interrupted.  One in
+`SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL` calls to `coro_t::wait()` also records where
+the coroutine waited, which shows which `signal_t` or lock it waited on, and for how
+long.  No locks are taken and nothing is shared between threads until the profile is
+over, when each thread's buffer is collected on its own thread.
+
+Profiles come out as folded stacks, which is what flame graph tools take: one line per
+distinct stack, with the spawn site first, then the frames from the outermost in, all
+separated by semicolons, then a space and the weight.  The weight is the number of CPU
+samples, or the number of nanoseconds spent waiting. */
+
+enum class profile_kind_t { CPU, WAIT };
+
+struct profiler_sample_t {
+    profile_kind_t kind;
+    // The `__PRETTY_FUNCTION__` of the `coro_t::get_and_init_coro()` instantiation the
+    // coroutine was spawned through, or NULL if it wasn't taken in a coroutine.
+    const char *spawn_site;
+    // 1 for a CPU sample.  For a wait sample, the time waited times
+    // `SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL`, or 0 if the coroutine was still
+    // waiting when the profile ended.
+    uint64_t weight;
+    // The stack is `frames[first_frame]` (the innermost frame) to
+    // `frames[num_frames - 1]`.
+    int first_frame;
+    int num_frames;
+    void *frames[SAMPLING_PROFILER_MAX_FRAMES];
+};
+
+struct sampling_profile_t {
+    sampling_profile_t() : num_dropped(0) { }
+
+    std::string folded_stacks;
+
+    // The number of samples that didn't fit into the buffers, or that were taken
+    // while the thread was busy recording another one.
+    uint64_t num_dropped;
+};
+
+// Returns false if the platform doesn't support the profiler.
+bool sampling_profiler_is_supported();
+
+/* Profiles every thread for `duration`, sampling each of them `frequency` times per
+second of CPU time, and fills in `profile_out` with the profile of the given kind.
+Only one profile can be taken at a time; returns false without doing anything if
+another one is being taken. */
+bool take_sampling_profile(ticks_t duration, int frequency, profile_kind_t kind,
+                           signal_t *interruptor, sampling_profile_t *profile_out)
+    THROWS_ONLY(interrupted_exc_t);
+
+/* `coro_t::wait()` keeps one of these on its stack while the coroutine waits.  If the
+thread is being profiled and the wait is picked as a sample, it records where the
+coroutine is waiting, and then for how long it waited. */
+class profiler_wait_sample_t {
+public:
+    profiler_wait_sample_t();
+    ~profiler_wait_sample_t();
+
+private:
+    // NULL if this wait isn't being sampled.
+    profiler_sample_t *sample;
+    int thread;
+    uint64_t session;
+    ticks_t started_at;
+
+    DISABLE_COPYING(profiler_wait_sample_t);
+};
+
+// Exposed for unit tests.  Turns samples into folded stacks.
+std::string fold_profiler_samples(const std::vector<profiler_sample_t> &samples);
+
+// Exposed for unit tests.  Follows the chain of frame pointers that starts at
+// `frame_pointer`, and stores up to `max_frames` return addresses in `frames_out`.
+// Only reads memory in [`stack_lower`, `stack_upper`), and only ever moves up the
+// stack, so a chain that isn't one ends the walk rather than crashing it.  Returns the
+// number of frames stored.  Async-signal-safe.
+int walk_profiler_frames(uintptr_t frame_pointer,
+                         uintptr_t stack_lower, uintptr_t stack_upper,
+                         void **frames_out, int max_frames);
+
+#endif  // ARCH_RUNTIME_SAMPLING_PROFILER_HPP_
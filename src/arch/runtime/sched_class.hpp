@@ -0,0 +1,58 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_SCHED_CLASS_HPP_
+#define ARCH_RUNTIME_SCHED_CLASS_HPP_
+
+#include <stdint.h>
+
+#include "config/args.hpp"
+#include "errors.hpp"
+#include "time.hpp"
+
+/* Every coroutine belongs to a scheduling class, which it inherits from the coroutine
+that spawned it.  The class decides the priority at which the coroutine's wakeups are
+scheduled on the message hub, and how long a query running in it may keep its thread
+before `ql::env_t::maybe_yield()` makes it give the other coroutines a turn.  It moves
+with the coroutine through `on_thread_t`, and travels with mailbox messages to the
+coroutine that handles them on the other side. */
+enum class sched_class_t : int8_t {
+    // Client queries.  They are demoted to `BATCH` when they use up a time slice
+    // without waiting for anything, so that point reads and writes don't queue
+    // behind analytical queries.
+    INTERACTIVE = 0,
+    // Anything that hasn't been classified, and expensive queries.
+    BATCH = 1,
+    // Work nobody is waiting for, such as backfills, secondary index
+    // construction and garbage collection.
+    BACKGROUND = 2
+};
+
+const int NUM_SCHED_CLASSES = 3;
+
+inline int sched_class_priority(sched_class_t sched_class) {
+    switch (sched_class) {
+    case sched_class_t::INTERACTIVE: return SCHED_INTERACTIVE_PRIORITY;
+    case sched_class_t::BATCH: return MESSAGE_SCHEDULER_DEFAULT_PRIORITY;
+    case sched_class_t::BACKGROUND: return SCHED_BACKGROUND_PRIORITY;
+    default: unreachable();
+    }
+}
+
+inline ticks_t sched_class_time_slice(sched_class_t sched_class) {
+    switch (sched_class) {
+    case sched_class_t::INTERACTIVE: return SCHED_INTERACTIVE_TIME_SLICE_NS;
+    case sched_class_t::BATCH: return SCHED_BATCH_TIME_SLICE_NS;
+    case sched_class_t::BACKGROUND: return SCHED_BACKGROUND_TIME_SLICE_NS;
+    default: unreachable();
+    }
+}
+
+inline const char *sched_class_name(sched_class_t sched_class) {
+    switch (sched_class) {
+    case sched_class_t::INTERACTIVE: return "interactive";
+    case sched_class_t::BATCH: return "batch";
+    case sched_class_t::BACKGROUND: return "background";
+    default: unreachable();
+    }
+}
+
+#endif  // ARCH_RUNTIME_SCHED_CLASS_HPP_
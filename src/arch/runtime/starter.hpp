@@ -6,10 +6,15 @@
 
 #include <functional>
 
+#include "time.hpp"
+
 /* `run_in_thread_pool()` starts a RethinkDB thread pool, runs the given
 function in a coroutine inside of it, waits for the function to return, and then
-shuts down the thread pool. */
+shuts down the thread pool.  If `thread_per_core` is true, each thread is pinned to a
+CPU of its own, and if `busy_poll_ns` isn't zero the threads spin for that long before
+they go to sleep (see `linux_thread_pool_t`). */
 
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool thread_per_core = false, ticks_t busy_poll_ns = 0);
 
 #endif  // ARCH_RUNTIME_STARTER_HPP_
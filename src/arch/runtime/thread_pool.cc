@@ -7,9 +7,12 @@
 #include <unistd.h>
 #include <sys/time.h>
 
+#include <algorithm>
+
 #include "arch/barrier.hpp"
 #include "arch/os_signal.hpp"
 #include "arch/io/timer_provider.hpp"
+#include "arch/runtime/cpu_topology.hpp"
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "errors.hpp"
@@ -43,18 +46,27 @@ NOINLINE void linux_thread_pool_t::set_thread(linux_thread_t *val) {
     thread = val;
 }
 
-linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity) :
+linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affinity,
+                                         ticks_t _busy_poll_ns) :
 #ifndef NDEBUG
       coroutine_summary(false),
 #endif
       interrupt_message(NULL),
       generic_blocker_pool(NULL),
+      compute_pool(NULL),
+      threads_pinned(false),
       n_threads(worker_threads + 1),    // we create an extra utility thread
-      do_set_affinity(_do_set_affinity)
+      do_set_affinity(_do_set_affinity),
+      busy_poll_ns(_busy_poll_ns),
+      n_numa_nodes(1)
 {
     rassert(n_threads > 1);             // we want at least one non-utility thread
     rassert(n_threads <= MAX_THREADS);
 
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        thread_numa_nodes[i] = 0;
+    }
+
     int res;
 
     res = pthread_cond_init(&shutdown_cond, NULL);
@@ -111,6 +123,7 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         tdata->thread_pool->threads[tdata->current_thread] = &local_thread;
         set_thread(&local_thread);
         blocker_pool_t *generic_blocker_pool = NULL; // Will only be instantiated by one thread
+        compute_pool_t *compute_pool = NULL; // Likewise
 
         /* Install a handler for segmentation faults that just prints a backtrace. If we're
         running under valgrind, we don't install this handler because Valgrind will print the
@@ -138,6 +151,10 @@ void *linux_thread_pool_t::start_thread(void *arg) {
             generic_blocker_pool = new blocker_pool_t(GENERIC_BLOCKER_THREAD_COUNT,
                                                       &local_thread.queue);
             tdata->thread_pool->generic_blocker_pool = generic_blocker_pool;
+
+            rassert(tdata->thread_pool->compute_pool == NULL, "compute_pool already initialized");
+            compute_pool = new compute_pool_t(tdata->thread_pool->n_threads - 1);
+            tdata->thread_pool->compute_pool = compute_pool;
         }
 
         // If one thread is allowed to run before another one has finished
@@ -168,6 +185,10 @@ void *linux_thread_pool_t::start_thread(void *arg) {
             delete generic_blocker_pool;
             tdata->thread_pool->generic_blocker_pool = NULL;
         }
+        if (compute_pool != NULL) {
+            delete compute_pool;
+            tdata->thread_pool->compute_pool = NULL;
+        }
 
         tdata->thread_pool->threads[tdata->current_thread] = NULL;
         set_thread(NULL);
@@ -177,6 +198,69 @@ void *linux_thread_pool_t::start_thread(void *arg) {
     return NULL;
 }
 
+compute_pool_t *linux_thread_pool_t::get_compute_pool() {
+    linux_thread_pool_t *pool = get_thread_pool();
+    return pool != NULL ? pool->compute_pool : NULL;
+}
+
+#ifdef _GNU_SOURCE
+bool linux_thread_pool_t::get_local_numa_node_cpus(cpu_set_t *cpus_out) {
+    linux_thread_pool_t *pool = get_thread_pool();
+    if (pool == NULL || !pool->threads_pinned || get_thread_id() < 0) {
+        return false;
+    }
+    *cpus_out = pool->numa_node_cpus[pool->thread_numa_nodes[get_thread_id()]];
+    return true;
+}
+
+bool linux_thread_pool_t::get_all_cpus(cpu_set_t *cpus_out) {
+    linux_thread_pool_t *pool = get_thread_pool();
+    if (pool == NULL || !pool->threads_pinned) {
+        return false;
+    }
+    *cpus_out = pool->all_cpus;
+    return true;
+}
+
+void linux_thread_pool_t::place_threads(cpu_set_t *thread_cpus_out) {
+    const std::vector<cpu_info_t> order = get_cpu_placement_order();
+    if (order.empty()) {
+        return;
+    }
+
+    CPU_ZERO(&all_cpus);
+    n_numa_nodes = 0;
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        CPU_SET(it->cpu, &all_cpus);
+        n_numa_nodes = std::max(n_numa_nodes, it->numa_node + 1);
+    }
+    numa_node_cpus.resize(n_numa_nodes);
+    for (auto it = numa_node_cpus.begin(); it != numa_node_cpus.end(); ++it) {
+        CPU_ZERO(&*it);
+    }
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        CPU_SET(it->cpu, &numa_node_cpus[it->numa_node]);
+    }
+
+    // The worker threads get a CPU each, until there are more threads than CPUs.  The
+    // utility thread doesn't do much, so it may go anywhere on the first node.
+    if (static_cast<size_t>(n_threads - 1) > order.size()) {
+        logWRN("There are more threads (%d) than CPUs (%zu), some CPUs will run more "
+               "than one thread.", n_threads - 1, order.size());
+    }
+    for (int i = 0; i < n_threads - 1; ++i) {
+        const cpu_info_t &cpu = order[i % order.size()];
+        CPU_ZERO(&thread_cpus_out[i]);
+        CPU_SET(cpu.cpu, &thread_cpus_out[i]);
+        thread_numa_nodes[i] = cpu.numa_node;
+    }
+    thread_cpus_out[n_threads - 1] = numa_node_cpus[order[0].numa_node];
+    thread_numa_nodes[n_threads - 1] = order[0].numa_node;
+
+    threads_pinned = true;
+}
+#endif  // _GNU_SOURCE
+
 #ifndef NDEBUG
 void linux_thread_pool_t::enable_coroutine_summary() {
     coroutine_summary = true;
@@ -186,6 +270,15 @@ void linux_thread_pool_t::enable_coroutine_summary() {
 void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_message) {
     do_shutdown = false;
 
+    // On Apple, the thread affinity API has awful documentation, so we don't even
+    // bother; `get_cpu_placement_order()` returns nothing there.
+#ifdef _GNU_SOURCE
+    cpu_set_t thread_cpus[MAX_THREADS];
+    if (do_set_affinity) {
+        place_threads(thread_cpus);
+    }
+#endif
+
     // Start child threads
     thread_barrier_t barrier(n_threads + 1);
 
@@ -197,21 +290,24 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
         // The initial message gets sent to thread zero.
         tdata->initial_message = (i == 0) ? initial_message : NULL;
 
-        int res = pthread_create(&pthreads[i], NULL, &start_thread, tdata);
-        guarantee_xerr(res == 0, res, "Could not create thread");
+        pthread_attr_t attr;
+        int res = pthread_attr_init(&attr);
+        guarantee_xerr(res == 0, res, "pthread_attr_init failed.");
 
-        if (do_set_affinity) {
-            // On Apple, the thread affinity API has awful documentation, so we don't even bother.
 #ifdef _GNU_SOURCE
-            // Distribute threads evenly among CPUs
-            int ncpus = get_cpu_count();
-            cpu_set_t mask;
-            CPU_ZERO(&mask);
-            CPU_SET(i % ncpus, &mask);
-            res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
+        // The thread has to start out on its CPU, or the memory it allocates before
+        // it gets moved there would stay on the wrong node.
+        if (threads_pinned) {
+            res = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &thread_cpus[i]);
             guarantee_xerr(res == 0, res, "Could not set thread affinity");
-#endif
         }
+#endif
+
+        res = pthread_create(&pthreads[i], &attr, &start_thread, tdata);
+        guarantee_xerr(res == 0, res, "Could not create thread");
+
+        res = pthread_attr_destroy(&attr);
+        guarantee_xerr(res == 0, res, "pthread_attr_destroy failed.");
     }
 
     // Mark the main thread (for use in assertions etc.)
@@ -375,10 +471,11 @@ linux_thread_pool_t::~linux_thread_pool_t() {
     guarantee_xerr(res == 0, res, "Could not destroy shutdown cond mutex");
 }
 
-linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
+linux_thread_t::linux_thread_t(linux_thread_pool_t *_parent_pool, int thread_id)
     : queue(this),
-      message_hub(&queue, parent_pool, threadnum_t(thread_id)),
+      message_hub(&queue, _parent_pool, threadnum_t(thread_id)),
       timer_handler(&queue),
+      parent_pool(_parent_pool),
       do_shutdown(false)
 #ifndef NDEBUG
       , coroutine_counts_at_shutdown(NULL)
@@ -409,6 +506,14 @@ void linux_thread_t::pump() {
     message_hub.push_messages();
 }
 
+bool linux_thread_t::poll_before_sleeping() {
+    return message_hub.poll_incoming_messages(parent_pool->busy_poll_ns);
+}
+
+ticks_t linux_thread_t::busy_poll_ns() {
+    return parent_pool->busy_poll_ns;
+}
+
 void linux_thread_t::on_event(int events) {
     // No-op. This is just to make sure that the event queue wakes up
     // so it can shut down.
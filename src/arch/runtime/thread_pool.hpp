@@ -4,8 +4,11 @@
 
 #include <pthread.h>
 
+#include <sched.h>
+
 #include <map>
 #include <string>
+#include <vector>
 
 #include "config/args.hpp"
 #include "arch/runtime/event_queue.hpp"
@@ -13,8 +16,10 @@
 #include "arch/runtime/message_hub.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "arch/io/blocker_pool.hpp"
+#include "arch/runtime/compute_pool.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/timer.hpp"
+#include "arch/spinlock.hpp"
 
 class linux_thread_t;
 class os_signal_cond_t;
@@ -35,11 +40,23 @@ struct coro_runtime_t {
 
 /* A thread pool represents a group of threads, each of which is associated with an
 event queue. There is one thread pool per server. It is responsible for starting up
-and shutting down the threads and event queues. */
+and shutting down the threads and event queues.
+
+In thread-per-core mode (`do_set_affinity`), each worker thread is pinned to a CPU of
+its own, taken in the order of `get_cpu_placement_order()`, and the utility thread to
+the CPUs of the first NUMA node.  Threads are started already pinned, so everything
+they allocate for themselves -- their coroutine stacks, the pages of the caches on
+them, their `one_per_thread_t` objects -- is first touched, and so placed by the
+kernel, on their own NUMA node.  Blocker pool threads run on the NUMA node of the
+thread that created the pool.
+
+If `busy_poll_ns` isn't zero, the threads spin for up to that long looking for work
+before they go to sleep. */
 
 class linux_thread_pool_t {
 public:
-    linux_thread_pool_t(int worker_threads, bool do_set_affinity);
+    linux_thread_pool_t(int worker_threads, bool do_set_affinity,
+                        ticks_t busy_poll_ns = 0);
 
     // When the process receives a SIGINT or SIGTERM, interrupt_message will be delivered to the
     // same thread that initial_message was delivered to, and interrupt_message will be set to
@@ -81,6 +98,20 @@ private:
     static const int GENERIC_BLOCKER_THREAD_COUNT = 2;
     blocker_pool_t* generic_blocker_pool;
 
+    // For CPU-bound work that can be split up; it has a thread for each of ours
+    // except the utility thread.
+    compute_pool_t *compute_pool;
+
+    // Set up by `run_thread_pool()` if the threads are pinned.  `numa_node_cpus` has
+    // the CPUs of each NUMA node that threads are on.
+    bool threads_pinned;
+#ifdef _GNU_SOURCE
+    cpu_set_t all_cpus;
+    std::vector<cpu_set_t> numa_node_cpus;
+
+    void place_threads(cpu_set_t *thread_cpus_out);
+#endif
+
 public:
     pthread_t pthreads[MAX_THREADS];
     linux_thread_t *threads[MAX_THREADS];
@@ -89,8 +120,26 @@ public:
     template <class Callable>
     static void run_in_blocker_pool(const Callable &);
 
+    // The compute pool of the thread pool we're in, or NULL if we aren't in one.
+    static compute_pool_t *get_compute_pool();
+
+#ifdef _GNU_SOURCE
+    // If the threads are pinned, gets the CPUs of the NUMA node the current thread is
+    // on, for the threads it starts to run on.  Returns false if they aren't.
+    static bool get_local_numa_node_cpus(cpu_set_t *cpus_out);
+    // If the threads are pinned, gets all the CPUs the process may run on.  Returns
+    // false if they aren't.
+    static bool get_all_cpus(cpu_set_t *cpus_out);
+#endif
+
     int n_threads;
     bool do_set_affinity;
+    ticks_t busy_poll_ns;
+
+    // The NUMA node each thread is pinned to, counting from zero; all zero if the
+    // threads aren't pinned.
+    int thread_numa_nodes[MAX_THREADS];
+    int n_numa_nodes;
 
     // Non-inlinable getters and setters for the thread local variables.
     // See thread_local.hpp for an explanation of why these must not be
@@ -170,6 +219,8 @@ public:
 
     void pump();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
+    bool poll_before_sleeping();   // Called by the event queue
+    ticks_t busy_poll_ns();   // Called by the event queue
 #ifndef NDEBUG
     void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
 #else
@@ -178,6 +229,7 @@ public:
     void on_event(int events);
 
 private:
+    linux_thread_pool_t *parent_pool;
     volatile bool do_shutdown;
     pthread_mutex_t do_shutdown_mutex;
     system_event_t shutdown_notify_event;
@@ -1,22 +1,39 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "arch/timer.hpp"
+
+#include <algorithm>
+
 #include "arch/runtime/thread_pool.hpp"
+#include "config/args.hpp"
+#include "math.hpp"
 #include "time.hpp"
 #include "utils.hpp"
 
-class timer_token_t : public intrusive_priority_queue_node_t<timer_token_t> {
+namespace {
+
+const int64_t TICK_NANOS = TIMER_TICKS_IN_MS * MILLION;
+
+// The first tick that doesn't start before `nanos`.
+int64_t tick_at_or_after(int64_t nanos) {
+    return ceil_divide(nanos, TICK_NANOS);
+}
+
+}  // namespace
+
+class timer_token_t : public intrusive_list_node_t<timer_token_t> {
     friend class timer_handler_t;
 
 private:
-    timer_token_t() : interval_nanos(-1), next_time_in_nanos(-1), callback(NULL) { }
-
-    friend bool left_is_higher_priority(const timer_token_t *left, const timer_token_t *right);
+    timer_token_t() : interval_nanos(-1), due_tick(-1), list(NULL), callback(NULL) { }
 
     // The time between rings, if a repeating timer, otherwise zero.
     int64_t interval_nanos;
 
-    // The time of the next 'ring'.
-    int64_t next_time_in_nanos;
+    // The tick at the start of which we 'ring' next.
+    int64_t due_tick;
+
+    // The slot of the wheel (or the list of ringing timers) we're in.
+    intrusive_list_t<timer_token_t> *list;
 
     // The callback we call upon each 'ring'.
     timer_callback_t *callback;
@@ -24,78 +41,195 @@ private:
     DISABLE_COPYING(timer_token_t);
 };
 
-bool left_is_higher_priority(const timer_token_t *left, const timer_token_t *right) {
-    return left->next_time_in_nanos < right->next_time_in_nanos;
-}
-
 timer_handler_t::timer_handler_t(linux_event_queue_t *queue)
     : timer_provider(queue),
-      expected_oneshot_time_in_nanos(0) {
+      expected_oneshot_time_in_nanos(0),
+      next_tick(0),
+      scheduled_tick(-1),
+      num_tokens(0) {
     // Right now, we have no tokens.  So we don't ask the timer provider to do anything for us.
 }
 
 timer_handler_t::~timer_handler_t() {
-    guarantee(token_queue.empty());
+    guarantee(num_tokens == 0);
 }
 
 void timer_handler_t::on_oneshot() {
+    // Timers added by the callbacks don't need to be scheduled one by one, because we schedule
+    // the next oneshot at the end.
+    scheduled_tick = 0;
+
     // If the timer_provider tends to return its callback a touch early, we don't want to make a
     // bunch of calls to it, returning a tad early over and over again, leading up to a ticks
-    // threshold.  So we bump the real time up to the threshold when processing the priority queue.
+    // threshold.  So we bump the real time up to the threshold when processing the wheel.
     int64_t real_ticks = get_ticks();
     int64_t ticks = std::max(real_ticks, expected_oneshot_time_in_nanos);
+    const int64_t current_tick = ticks / TICK_NANOS;
 
-    while (!token_queue.empty() && token_queue.peek()->next_time_in_nanos <= ticks) {
-        timer_token_t *token = token_queue.pop();
+    while (num_tokens > 0) {
+        const int64_t tick = next_busy_tick();
+        if (tick > current_tick) {
+            break;
+        }
+        // The ticks we skip have nothing to do.
+        next_tick = tick;
+        process_tick(tick, real_ticks);
+    }
+    next_tick = std::max(next_tick, current_tick + 1);
+
+    // We've processed young tokens.  Now schedule a new one-shot (if necessary).
+    scheduled_tick = -1;
+    if (num_tokens > 0) {
+        schedule_oneshot(next_busy_tick());
+    }
+}
 
-        // Put the repeating timer back on the queue before the callback can be called (so that it
-        // may be canceled).
-        if (token->interval_nanos != 0) {
-            token->next_time_in_nanos = real_ticks + token->interval_nanos;
-            token_queue.push(token);
+void timer_handler_t::process_tick(int64_t tick, int64_t real_ticks) {
+    rassert(tick == next_tick);
+    if ((tick & (TIMER_WHEEL_SLOTS - 1)) == 0) {
+        cascade(1, tick);
+    }
+
+    intrusive_list_t<timer_token_t> *slot = &wheel[0][tick & (TIMER_WHEEL_SLOTS - 1)];
+    while (timer_token_t *token = slot->head()) {
+        rassert(token->due_tick == tick);
+        slot->remove(token);
+        ringing.push_back(token);
+        token->list = &ringing;
+    }
+    next_tick = tick + 1;
+
+    while (timer_token_t *token = ringing.head()) {
+        ringing.remove(token);
+        const bool once = token->interval_nanos == 0;
+
+        // Put the repeating timer back into the wheel before the callback can be called (so that
+        // it may be canceled).
+        if (!once) {
+            token->due_tick = std::max(next_tick,
+                                       tick_at_or_after(real_ticks + token->interval_nanos));
+            insert(token);
+        } else {
+            token->list = NULL;
+            --num_tokens;
         }
 
         token->callback->on_timer();
 
         // Delete nonrepeating timer tokens.
-        if (token->interval_nanos == 0) {
+        if (once) {
             delete token;
         }
     }
+}
 
-    // We've processed young tokens.  Now schedule a new one-shot (if necessary).
-    if (!token_queue.empty()) {
-        timer_provider.schedule_oneshot(token_queue.peek()->next_time_in_nanos, this);
+void timer_handler_t::cascade(int level, int64_t tick) {
+    const int64_t slot_index =
+        (tick >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    // The level above made a turn first if we're starting a new one.
+    if (slot_index == 0 && level + 1 < TIMER_WHEEL_LEVELS) {
+        cascade(level + 1, tick);
     }
+
+    intrusive_list_t<timer_token_t> *slot = &wheel[level][slot_index];
+    while (timer_token_t *token = slot->head()) {
+        slot->remove(token);
+        insert(token);
+    }
+}
+
+void timer_handler_t::insert(timer_token_t *token) {
+    rassert(token->due_tick >= next_tick);
+    const int64_t delta = token->due_tick - next_tick;
+
+    // The lowest level with a turn that's long enough, so that the timer's slot won't come up
+    // before the timer is due.
+    int level = 0;
+    while (level + 1 < TIMER_WHEEL_LEVELS
+           && delta >= (int64_t(1) << (TIMER_WHEEL_LEVEL_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    int64_t slot_tick = token->due_tick;
+    const int64_t max_delta = (int64_t(1) << (TIMER_WHEEL_LEVEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > max_delta) {
+        // We'll look at it again when this slot comes up.
+        slot_tick = next_tick + max_delta;
+    }
+
+    const int64_t slot_index =
+        (slot_tick >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    token->list = &wheel[level][slot_index];
+    token->list->push_back(token);
+}
+
+int64_t timer_handler_t::next_busy_tick() const {
+    int64_t busy_tick = next_tick + TIMER_WHEEL_SLOTS;
+
+    for (int64_t tick = next_tick; tick < busy_tick; ++tick) {
+        if (!wheel[0][tick & (TIMER_WHEEL_SLOTS - 1)].empty()) {
+            busy_tick = tick;
+        }
+    }
+
+    // The higher levels need attention when their slots come up, at the start of each turn of
+    // the level below.
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+        const int shift = TIMER_WHEEL_LEVEL_BITS * level;
+        const int64_t first_turn = ceil_divide(next_tick, int64_t(1) << shift);
+        for (int64_t turn = first_turn; turn < first_turn + TIMER_WHEEL_SLOTS; ++turn) {
+            const int64_t tick = turn << shift;
+            if (tick >= busy_tick) {
+                break;
+            }
+            if (!wheel[level][turn & (TIMER_WHEEL_SLOTS - 1)].empty()) {
+                busy_tick = tick;
+            }
+        }
+    }
+
+    return busy_tick;
+}
+
+void timer_handler_t::schedule_oneshot(int64_t tick) {
+    scheduled_tick = tick;
+    expected_oneshot_time_in_nanos = tick * TICK_NANOS;
+    timer_provider.schedule_oneshot(expected_oneshot_time_in_nanos, this);
 }
 
 timer_token_t *timer_handler_t::add_timer_internal(const int64_t ms, timer_callback_t *callback, const bool once) {
     const int64_t nanos = ms * MILLION;
     rassert(nanos > 0);
 
-    const int64_t next_time_in_nanos = get_ticks() + nanos;
+    const int64_t ticks = get_ticks();
+    if (num_tokens == 0) {
+        // Nothing's due, so we can skip ahead to now, which puts the new timer on the lowest
+        // level that it can be on.
+        next_tick = std::max(next_tick, ticks / TICK_NANOS);
+    }
 
     timer_token_t *const token = new timer_token_t;
     token->interval_nanos = once ? 0 : nanos;
-    token->next_time_in_nanos = next_time_in_nanos;
+    token->due_tick = std::max(next_tick, tick_at_or_after(ticks + nanos));
     token->callback = callback;
+    insert(token);
+    ++num_tokens;
 
-    const timer_token_t *top_entry = token_queue.peek();
-    token_queue.push(token);
-
-    if (top_entry == NULL || next_time_in_nanos < top_entry->next_time_in_nanos) {
-        timer_provider.schedule_oneshot(next_time_in_nanos, this);
+    if (scheduled_tick == -1 || token->due_tick < scheduled_tick) {
+        schedule_oneshot(token->due_tick);
     }
 
     return token;
 }
 
 void timer_handler_t::cancel_timer(timer_token_t *token) {
-    token_queue.remove(token);
+    token->list->remove(token);
     delete token;
+    --num_tokens;
 
-    if (token_queue.empty()) {
+    if (num_tokens == 0 && scheduled_tick != -1) {
         timer_provider.unschedule_oneshot();
+        scheduled_tick = -1;
     }
 }
 
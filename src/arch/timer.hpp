@@ -2,7 +2,9 @@
 #ifndef ARCH_TIMER_HPP_
 #define ARCH_TIMER_HPP_
 
-#include "containers/intrusive_priority_queue.hpp"
+#include <stdint.h>
+
+#include "containers/intrusive_list.hpp"
 #include "arch/io/timer_provider.hpp"
 
 class timer_token_t;
@@ -14,7 +16,17 @@ struct timer_callback_t {
 
 /* This timer class uses the underlying OS timer provider to get one-shot timing events. It then
  * manages a list of application timers based on that lower level interface. Everyone who needs a
- * timer should use this class (through the thread pool). */
+ * timer should use this class (through the thread pool).
+ *
+ * Most timers are canceled long before they ring, so adding and canceling them has to be cheap.
+ * The timers are kept in a hierarchical timing wheel: time is divided into ticks of
+ * `TIMER_TICKS_IN_MS` milliseconds, and each level of the wheel has `TIMER_WHEEL_SLOTS` slots,
+ * each of which is a list of the timers that are due in one tick (on level 0) or in a range of
+ * ticks as long as a whole turn of the level below.  Adding or canceling a timer just puts it
+ * into or takes it out of one of those lists.  When the level below has made a full turn, the
+ * timers in the next slot of a level are spread out over the level below.  Timers ring at the
+ * start of the first tick that is no earlier than their due time, so never early, but up to a
+ * tick late. */
 class timer_handler_t : private timer_provider_callback_t {
 public:
     explicit timer_handler_t(linux_event_queue_t *queue);
@@ -24,8 +36,29 @@ public:
     void cancel_timer(timer_token_t *timer);
 
 private:
+    static const int TIMER_WHEEL_LEVEL_BITS = 8;
+    static const int64_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_LEVEL_BITS;
+    // With 1 ms ticks, four levels cover about 50 days.  Timers due later than that are
+    // kept in the last slot of the top level, and moved again when they come up.
+    static const int TIMER_WHEEL_LEVELS = 4;
+
     void on_oneshot();
 
+    // Puts `token` into the slot of the wheel for its `due_tick`.
+    void insert(timer_token_t *token);
+
+    // Rings the timers that are due at `tick`, after spreading out the timers of the
+    // higher levels whose turn has come.  Repeating timers ring again `interval_nanos`
+    // after `real_ticks`.
+    void process_tick(int64_t tick, int64_t real_ticks);
+    void cascade(int level, int64_t tick);
+
+    // The first tick at or after `next_tick` that has timers to ring or to spread out, or
+    // `next_tick + TIMER_WHEEL_SLOTS` if there are none in that range.
+    int64_t next_busy_tick() const;
+
+    void schedule_oneshot(int64_t tick);
+
     // The timer provider, a platform-dependent typedef for interfacing with the OS.
     timer_provider_t timer_provider;
 
@@ -33,8 +66,19 @@ private:
     // time, we pretend that it had arrived on time.
     int64_t expected_oneshot_time_in_nanos;
 
-    // A priority queue of timer tokens, ordered by the soonest.
-    intrusive_priority_queue_t<timer_token_t> token_queue;
+    // Every tick before this one has been processed.
+    int64_t next_tick;
+
+    // The tick the timer provider is going to wake us up at, or -1 if it isn't.
+    int64_t scheduled_tick;
+
+    // The number of timers in the wheel.
+    int64_t num_tokens;
+
+    intrusive_list_t<timer_token_t> wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+    // The timers that are ringing in the tick we're processing.
+    intrusive_list_t<timer_token_t> ringing;
 
     DISABLE_COPYING(timer_handler_t);
 };
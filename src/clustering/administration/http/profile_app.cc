@@ -0,0 +1,84 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "clustering/administration/http/profile_app.hpp"
+
+#include <inttypes.h>
+
+#include <string>
+
+#include "arch/runtime/sampling_profiler.hpp"
+#include "config/args.hpp"
+#include "utils.hpp"
+
+#define DEFAULT_PROFILE_SECONDS 5
+#define MAX_PROFILE_SECONDS 60
+
+void profile_app_t::handle(const http_req_t &req, http_res_t *result,
+                           signal_t *interruptor) {
+    if (req.method != GET) {
+        *result = http_res_t(HTTP_METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    http_req_t::resource_t::iterator it = req.resource.begin();
+    if (it == req.resource.end()) {
+        *result = http_res_t(HTTP_NOT_FOUND);
+        return;
+    }
+    profile_kind_t kind;
+    if (*it == "cpu") {
+        kind = profile_kind_t::CPU;
+    } else if (*it == "wait") {
+        kind = profile_kind_t::WAIT;
+    } else {
+        *result = http_res_t(HTTP_NOT_FOUND);
+        return;
+    }
+    ++it;
+    if (it != req.resource.end()) {
+        *result = http_res_t(HTTP_NOT_FOUND);
+        return;
+    }
+
+    uint64_t seconds = DEFAULT_PROFILE_SECONDS;
+    boost::optional<std::string> maybe_seconds = req.find_query_param("seconds");
+    if (maybe_seconds) {
+        if (!strtou64_strict(maybe_seconds.get(), 10, &seconds)
+            || seconds == 0 || seconds > MAX_PROFILE_SECONDS) {
+            *result = http_error_res("Invalid seconds value.");
+            return;
+        }
+    }
+
+    uint64_t frequency = SAMPLING_PROFILER_DEFAULT_FREQUENCY;
+    boost::optional<std::string> maybe_frequency = req.find_query_param("frequency");
+    if (maybe_frequency) {
+        if (!strtou64_strict(maybe_frequency.get(), 10, &frequency)
+            || frequency == 0 || frequency > SAMPLING_PROFILER_MAX_FREQUENCY) {
+            *result = http_error_res("Invalid frequency value.");
+            return;
+        }
+    }
+
+    if (!sampling_profiler_is_supported()) {
+        *result = http_error_res("Profiling is not supported on this platform.",
+                                 HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    sampling_profile_t profile;
+    try {
+        if (!take_sampling_profile(secs_to_ticks(seconds), frequency, kind,
+                                   interruptor, &profile)) {
+            *result = http_error_res("Another profile is being taken.");
+            return;
+        }
+    } catch (const interrupted_exc_t &) {
+        *result = http_res_t(HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    *result = http_res_t(HTTP_OK, "text/plain", profile.folded_stacks);
+    result->add_header_line("X-Dropped-Samples",
+                            strprintf("%" PRIu64, profile.num_dropped));
+    maybe_gzip_response(req, result);
+}
@@ -0,0 +1,21 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_
+
+#include "http/http.hpp"
+
+/* `profile_app_t` takes a profile of this server with the sampling profiler (see
+`take_sampling_profile()`) and sends it back as folded stacks, for flame graphs.
+`GET /ajax/profile/cpu` profiles where the CPU time goes, and `GET /ajax/profile/wait`
+where coroutines wait.  The query parameters `seconds` (default 5, at most 60) and
+`frequency` (samples per second of CPU time) control the profile. */
+class profile_app_t : public http_app_t {
+public:
+    profile_app_t() { }
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+
+private:
+    DISABLE_COPYING(profile_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_ */
@@ -7,6 +7,7 @@
 #include "clustering/administration/http/issues_app.hpp"
 #include "clustering/administration/http/last_seen_app.hpp"
 #include "clustering/administration/http/log_app.hpp"
+#include "clustering/administration/http/profile_app.hpp"
 #include "clustering/administration/http/progress_app.hpp"
 #include "clustering/administration/http/semilattice_app.hpp"
 #include "clustering/administration/http/stat_app.hpp"
@@ -58,6 +59,7 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
         _directory_metadata->subview(&get_log_mailbox),
         _directory_metadata->subview(&get_machine_id)));
     progress_app.init(new progress_app_t(_directory_metadata, mbox_manager));
+    profile_app.init(new profile_app_t);
     distribution_app.init(new distribution_app_t(metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces, _semilattice_metadata), _cluster_interface));
 
 #ifndef NDEBUG
@@ -71,6 +73,7 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     ajax_routes["last_seen"] = last_seen_app.get();
     ajax_routes["log"] = log_app.get();
     ajax_routes["progress"] = progress_app.get();
+    ajax_routes["profile"] = profile_app.get();
     ajax_routes["distribution"] = distribution_app.get();
     ajax_routes["semilattice"] = cluster_semilattice_app.get();
     ajax_routes["auth"] = auth_semilattice_app.get();
@@ -25,6 +25,7 @@ class stat_http_app_t;
 class last_seen_http_app_t;
 class log_http_app_t;
 class progress_app_t;
+class profile_app_t;
 class stat_manager_t;
 class distribution_app_t;
 class cyanide_http_app_t;
@@ -62,6 +63,7 @@ private:
     scoped_ptr_t<last_seen_http_app_t> last_seen_app;
     scoped_ptr_t<log_http_app_t> log_app;
     scoped_ptr_t<progress_app_t> progress_app;
+    scoped_ptr_t<profile_app_t> profile_app;
     scoped_ptr_t<distribution_app_t> distribution_app;
     scoped_ptr_t<combining_http_app_t> combining_app;
 #ifndef NDEBUG
@@ -32,6 +32,7 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/os_signal.hpp"
+#include "arch/runtime/cpu_topology.hpp"
 #include "arch/runtime/starter.hpp"
 #include "extproc/extproc_spawner.hpp"
 #include "clustering/administration/cli/admin_command_parser.hpp"
@@ -1053,6 +1054,20 @@ std::string get_reql_http_proxy_option(const std::map<std::string, options::valu
     return proxy.get();
 }
 
+std::set<std::string> get_read_cache_option(const std::map<std::string, options::values_t> &opts) {
+    std::set<std::string> tables;
+    const std::vector<std::string> names = all_options(opts, "--read-cache");
+    for (auto it = names.begin(); it != names.end(); ++it) {
+        const size_t dot = it->find('.');
+        if (dot == std::string::npos || dot == 0 || dot == it->size() - 1) {
+            throw std::runtime_error(strprintf("--read-cache table (%s) must be given "
+                                               "as db.table", it->c_str()));
+        }
+        tables.insert(*it);
+    }
+    return tables;
+}
+
 options::help_section_t get_web_options(std::vector<options::option_t> *options_out) {
     options::help_section_t help("Web options");
     options_out->push_back(options::option_t(options::names_t("--web-static-directory"),
@@ -1104,6 +1119,10 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              options::OPTIONAL));
     help.add("--reql-http-proxy [protocol://]host[:port]", "HTTP proxy to use for performing `r.http(...)` queries, default port is 1080");
 
+    options_out->push_back(options::option_t(options::names_t("--read-cache"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--read-cache db.table", "cache the results of point reads on the given table on this node, can be specified multiple times");
+
     options_out->push_back(options::option_t(options::names_t("--canonical-address"),
                                              options::OPTIONAL_REPEAT));
     help.add("--canonical-address addr", "address that other rethinkdb instances will use to connect to us, can be specified multiple times");
@@ -1117,6 +1136,13 @@ options::help_section_t get_cpu_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL,
                                              strprintf("%d", get_cpu_count())));
     help.add("-c [ --cores ] n", "the number of cores to use");
+    options_out->push_back(options::option_t(options::names_t("--thread-per-core"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--thread-per-core", "pin each thread to a core of its own and keep each table on one NUMA node");
+    options_out->push_back(options::option_t(options::names_t("--busy-poll-us"),
+                                             options::OPTIONAL,
+                                             "0"));
+    help.add("--busy-poll-us n", "how long each thread spins looking for work before it goes to sleep, in microseconds; trades CPU time for latency");
     return help;
 }
 
@@ -1131,6 +1157,29 @@ MUST_USE bool parse_cores_option(const std::map<std::string, options::values_t>
     return true;
 }
 
+MUST_USE bool parse_busy_poll_option(const std::map<std::string, options::values_t> &opts,
+                                     ticks_t *busy_poll_ns_out) {
+    int busy_poll_us = get_single_int(opts, "--busy-poll-us");
+    if (busy_poll_us < 0 || busy_poll_us > MAX_BUSY_POLL_US) {
+        fprintf(stderr, "ERROR: number specified for busy-poll-us must be between 0 and %d\n", static_cast<int>(MAX_BUSY_POLL_US));
+        return false;
+    }
+    *busy_poll_ns_out = static_cast<ticks_t>(busy_poll_us) * THOUSAND;
+    return true;
+}
+
+bool parse_thread_per_core_option(const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--thread-per-core")) {
+        return false;
+    }
+    if (get_cpu_placement_order().empty()) {
+        fprintf(stderr, "WARNING: could not read the CPU topology of this machine, "
+                "threads will not be pinned\n");
+        return false;
+    }
+    return true;
+}
+
 options::help_section_t get_service_options(std::vector<options::option_t> *options_out) {
     options::help_section_t help("Service options");
     options_out->push_back(options::option_t(options::names_t("--pid-file"),
@@ -1448,6 +1497,11 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        ticks_t busy_poll_ns;
+        if (!parse_busy_poll_option(opts, &busy_poll_ns)) {
+            return EXIT_FAILURE;
+        }
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
@@ -1482,6 +1536,7 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
 
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
+                                get_read_cache_option(opts),
                                 std::move(web_path),
                                 address_ports,
                                 get_optional_option(opts, "--config-file"));
@@ -1499,7 +1554,9 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      static_cast<cluster_semilattice_metadata_t*>(NULL),
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           parse_thread_per_core_option(opts),
+                           busy_poll_ns);
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
         output_named_error(ex, help);
@@ -1603,6 +1660,7 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
 
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
+                                get_read_cache_option(opts),
                                 std::move(web_path),
                                 address_ports,
                                 get_optional_option(opts, "--config-file"));
@@ -1716,6 +1774,11 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        ticks_t busy_poll_ns;
+        if (!parse_busy_poll_option(opts, &busy_poll_ns)) {
+            return EXIT_FAILURE;
+        }
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
@@ -1760,6 +1823,7 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
 
         serve_info_t serve_info(std::move(joins),
                                 get_reql_http_proxy_option(opts),
+                                get_read_cache_option(opts),
                                 std::move(web_path),
                                 address_ports,
                                 get_optional_option(opts, "--config-file"));
@@ -1777,7 +1841,9 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      &serve_info,
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           parse_thread_per_core_option(opts),
+                           busy_poll_ns);
 
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
@@ -4,6 +4,7 @@
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
+#include "arch/runtime/runtime.hpp"
 #include "clustering/immediate_consistency/branch/multistore.hpp"
 #include "clustering/reactor/reactor.hpp"
 #include "rdb_protocol/store.hpp"
@@ -123,10 +124,11 @@ file_based_svs_by_namespace_t::get_svs(
         = stores_out->stores();
     stores_out_stores->init(num_stores);
 
-    const threadnum_t serializer_thread = next_thread(num_db_threads);
+    const std::vector<threadnum_t> node_threads = next_numa_node_threads(num_db_threads);
+    const threadnum_t serializer_thread = next_thread(node_threads);
     std::vector<threadnum_t> store_threads;
     for (int i = 0; i < num_stores; ++i) {
-        store_threads.push_back(next_thread(num_db_threads));
+        store_threads.push_back(next_thread(node_threads));
     }
 
     scoped_ptr_t<serializer_t> serializer;
@@ -237,7 +239,25 @@ serializer_filepath_t file_based_svs_by_namespace_t::file_name_for(namespace_id_
     return serializer_filepath_t(base_path_, uuid_to_str(namespace_id));
 }
 
-threadnum_t file_based_svs_by_namespace_t::next_thread(int num_db_threads) {
-    thread_counter_ = (thread_counter_ + 1) % num_db_threads;
-    return threadnum_t(thread_counter_);
+std::vector<threadnum_t> file_based_svs_by_namespace_t::next_numa_node_threads(
+        int num_db_threads) {
+    const int num_nodes = get_num_numa_nodes();
+    std::vector<threadnum_t> threads;
+    // Some nodes may have no db threads, if there are fewer threads than nodes.
+    for (int i = 0; i < num_nodes && threads.empty(); ++i) {
+        numa_node_counter_ = (numa_node_counter_ + 1) % num_nodes;
+        for (int j = 0; j < num_db_threads; ++j) {
+            if (get_thread_numa_node(threadnum_t(j)) == numa_node_counter_) {
+                threads.push_back(threadnum_t(j));
+            }
+        }
+    }
+    guarantee(!threads.empty());
+    return threads;
+}
+
+threadnum_t file_based_svs_by_namespace_t::next_thread(
+        const std::vector<threadnum_t> &threads) {
+    thread_counter_ = (thread_counter_ + 1) % threads.size();
+    return threads[thread_counter_];
 }
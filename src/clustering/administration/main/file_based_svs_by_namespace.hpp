@@ -3,6 +3,7 @@
 #define CLUSTERING_ADMINISTRATION_MAIN_FILE_BASED_SVS_BY_NAMESPACE_HPP_
 
 #include <string>
+#include <vector>
 
 #include "clustering/administration/reactor_driver.hpp"
 #include "clustering/administration/issues/outdated_index.hpp"
@@ -17,7 +18,7 @@ public:
                                   const base_path_t& base_path,
                                   outdated_index_issue_client_t *_outdated_index_client)
         : io_backender_(io_backender), balancer_(balancer),
-          base_path_(base_path), thread_counter_(0),
+          base_path_(base_path), thread_counter_(0), numa_node_counter_(0),
           outdated_index_client(_outdated_index_client) { }
 
     void get_svs(perfmon_collection_t *serializers_perfmon_collection,
@@ -35,8 +36,12 @@ private:
     cache_balancer_t *balancer_;
     const base_path_t base_path_;
 
-    threadnum_t next_thread(int num_db_threads);
+    // All of a table's stores share its serializer, so they're put on the threads of
+    // a single NUMA node, taking turns between the nodes from one table to the next.
+    std::vector<threadnum_t> next_numa_node_threads(int num_db_threads);
+    threadnum_t next_thread(const std::vector<threadnum_t> &threads);
     int thread_counter_; // should only be used by `next_thread`
+    int numa_node_counter_; // should only be used by `next_numa_node_threads`
 
     outdated_index_issue_client_t *outdated_index_client;
 
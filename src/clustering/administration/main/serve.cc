@@ -247,7 +247,8 @@ bool do_serve(io_backender_t *io_backender,
                 machine_id,
                 semilattice_manager_cluster.get_root_view(),
                 directory_read_manager.get_root_view(),
-                &rdb_ctx
+                &rdb_ctx,
+                serve_info.read_cache_tables
                 );
 
         //This is an annoying chicken and egg problem here
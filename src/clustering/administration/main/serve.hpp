@@ -90,11 +90,13 @@ class serve_info_t {
 public:
     serve_info_t(std::vector<host_and_port_t> &&_joins,
                  std::string &&_reql_http_proxy,
+                 std::set<std::string> &&_read_cache_tables,
                  std::string &&_web_assets,
                  service_address_ports_t _ports,
                  boost::optional<std::string> _config_file) :
         joins(std::move(_joins)),
         reql_http_proxy(std::move(_reql_http_proxy)),
+        read_cache_tables(std::move(_read_cache_tables)),
         web_assets(std::move(_web_assets)),
         ports(_ports),
         config_file(_config_file)
@@ -107,6 +109,8 @@ public:
     const std::vector<host_and_port_t> joins;
     peer_address_set_t peers;
     std::string reql_http_proxy;
+    // The tables whose point reads get cached, as `db.table`.
+    std::set<std::string> read_cache_tables;
     std::string web_assets;
     service_address_ports_t ports;
     boost::optional<std::string> config_file;
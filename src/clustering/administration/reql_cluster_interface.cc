@@ -16,14 +16,23 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
             semilattice_readwrite_view_t<cluster_semilattice_metadata_t> > _semilattices,
         clone_ptr_t< watchable_t< change_tracking_map_t<peer_id_t,
             cluster_directory_metadata_t> > > _directory,
-        rdb_context_t *_rdb_context
+        rdb_context_t *_rdb_context,
+        const std::set<std::string> &_read_cache_tables
         ) :
     mailbox_manager(_mailbox_manager),
     my_machine_id(_my_machine_id),
     semilattice_root_view(_semilattices),
     directory_root_view(_directory),
-    cross_thread_namespace_watchables(get_num_threads()),
-    cross_thread_database_watchables(get_num_threads()),
+    namespaces_snapshot(
+        clone_ptr_t<watchable_t<cow_ptr_t<namespaces_semilattice_metadata_t> > >(
+            new semilattice_watchable_t<cow_ptr_t<namespaces_semilattice_metadata_t> >(
+                metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces,
+                               semilattice_root_view)))),
+    databases_snapshot(
+        clone_ptr_t<watchable_t<databases_semilattice_metadata_t> >(
+            new semilattice_watchable_t<databases_semilattice_metadata_t>(
+                metadata_field(&cluster_semilattice_metadata_t::databases,
+                               semilattice_root_view)))),
     rdb_context(_rdb_context),
     namespace_repo(
         mailbox_manager,
@@ -37,22 +46,9 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
     changefeed_client(mailbox_manager,
         [this](const namespace_id_t &id, signal_t *interruptor) {
             return this->namespace_repo.get_namespace_interface(id, interruptor);
-        })
-{
-    for (int thr = 0; thr < get_num_threads(); ++thr) {
-        cross_thread_namespace_watchables[thr].init(
-            new cross_thread_watchable_variable_t<cow_ptr_t<namespaces_semilattice_metadata_t> >(
-                clone_ptr_t<semilattice_watchable_t<cow_ptr_t<namespaces_semilattice_metadata_t> > >
-                    (new semilattice_watchable_t<cow_ptr_t<namespaces_semilattice_metadata_t> >(
-                        metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces, semilattice_root_view))), threadnum_t(thr)));
-
-        cross_thread_database_watchables[thr].init(
-            new cross_thread_watchable_variable_t<databases_semilattice_metadata_t>(
-                clone_ptr_t<semilattice_watchable_t<databases_semilattice_metadata_t> >
-                    (new semilattice_watchable_t<databases_semilattice_metadata_t>(
-                        metadata_field(&cluster_semilattice_metadata_t::databases, semilattice_root_view))), threadnum_t(thr)));
-    }
-}
+        }),
+    read_cache_manager(&changefeed_client, _read_cache_tables,
+                       &_rdb_context->ql_stats_collection) { }
 
 static bool check_metadata_status(metadata_search_status_t status,
                                   const char *entity_type,
@@ -168,10 +164,9 @@ bool real_reql_cluster_interface_t::db_drop(const name_string_t &name,
 bool real_reql_cluster_interface_t::db_list(
         UNUSED signal_t *interruptor, std::set<name_string_t> *names_out,
         UNUSED std::string *error_out) {
-    databases_semilattice_metadata_t db_metadata;
-    get_databases_metadata(&db_metadata);
+    counted_t<const databases_snapshot_t> db_metadata = get_databases_metadata();
     const_metadata_searcher_t<database_semilattice_metadata_t> db_searcher(
-        &db_metadata.databases);
+        &db_metadata->get().databases);
     for (auto it = db_searcher.find_next(db_searcher.begin());
               it != db_searcher.end();
               it = db_searcher.find_next(++it)) {
@@ -189,10 +184,9 @@ bool real_reql_cluster_interface_t::db_find(const name_string_t &name,
         UNUSED signal_t *interruptor, counted_t<const ql::db_t> *db_out,
         std::string *error_out) {
     /* Find the specified database */
-    databases_semilattice_metadata_t db_metadata;
-    get_databases_metadata(&db_metadata);
+    counted_t<const databases_snapshot_t> db_metadata = get_databases_metadata();
     const_metadata_searcher_t<database_semilattice_metadata_t> db_searcher(
-        &db_metadata.databases);
+        &db_metadata->get().databases);
     metadata_search_status_t status;
     auto it = db_searcher.find_uniq(name, &status);
     if (!check_metadata_status(status, "Database", name.str(), true, error_out)) {
@@ -284,14 +278,9 @@ bool real_reql_cluster_interface_t::table_create(const name_string_t &name,
         }
         /* Confirm that the namespace hasn't been deleted. If it's deleted, then
         `test_for_rdb_table_readiness` will never return `true`. */
-        bool is_deleted;
-        cross_thread_namespace_watchables[get_thread_id().threadnum]->apply_read(
-            [&](const cow_ptr_t<namespaces_semilattice_metadata_t> *ns_md) {
-                guarantee((*ns_md)->namespaces.count(namespace_id) == 1);
-                is_deleted = (*ns_md)->namespaces.at(namespace_id).is_deleted();
-            }
-            );
-        if (is_deleted) {
+        counted_t<const namespaces_snapshot_t> ns_md = get_namespaces_metadata();
+        guarantee(ns_md->get()->namespaces.count(namespace_id) == 1);
+        if (ns_md->get()->namespaces.at(namespace_id).is_deleted()) {
             break;
         }
         signal_timer_t timer;
@@ -337,9 +326,9 @@ bool real_reql_cluster_interface_t::table_list(counted_t<const ql::db_t> db,
         UNUSED signal_t *interruptor, std::set<name_string_t> *names_out,
         UNUSED std::string *error_out) {
 
-    cow_ptr_t<namespaces_semilattice_metadata_t> ns_metadata = get_namespaces_metadata();
+    counted_t<const namespaces_snapshot_t> ns_metadata = get_namespaces_metadata();
     const_metadata_searcher_t<namespace_semilattice_metadata_t> ns_searcher(
-        &ns_metadata->namespaces);
+        &ns_metadata->get()->namespaces);
     namespace_predicate_t pred(&db->id);
     for (auto it = ns_searcher.find_next(ns_searcher.begin(), pred);
               it != ns_searcher.end();
@@ -361,10 +350,10 @@ bool real_reql_cluster_interface_t::table_find(const name_string_t &name,
         scoped_ptr_t<base_table_t> *table_out, std::string *error_out) {
 
     /* Find the specified table in the semilattice metadata */
-    cow_ptr_t<namespaces_semilattice_metadata_t> namespaces_metadata
+    counted_t<const namespaces_snapshot_t> namespaces_metadata
         = get_namespaces_metadata();
     const_metadata_searcher_t<namespace_semilattice_metadata_t>
-        ns_searcher(&namespaces_metadata.get()->namespaces);
+        ns_searcher(&namespaces_metadata->get()->namespaces);
     namespace_predicate_t pred(&name, &db->id);
     metadata_search_status_t status;
     auto ns_metadata_it = ns_searcher.find_uniq(pred, &status);
@@ -373,11 +362,15 @@ bool real_reql_cluster_interface_t::table_find(const name_string_t &name,
     guarantee(!ns_metadata_it->second.is_deleted());
     guarantee(!ns_metadata_it->second.get_ref().primary_key.in_conflict());
 
+    const std::string &pkey = ns_metadata_it->second.get_ref().primary_key.get_ref();
     table_out->init(new real_table_t(
         ns_metadata_it->first,
         namespace_repo.get_namespace_interface(ns_metadata_it->first, interruptor),
-        ns_metadata_it->second.get_ref().primary_key.get_ref(),
-        &changefeed_client));
+        pkey,
+        &changefeed_client,
+        &read_cache_manager,
+        read_cache_manager.get(db->name + "." + name.str(), ns_metadata_it->first,
+                               pkey)));
 
     return true;
 }
@@ -393,43 +386,23 @@ bool is_joined(const T &multiple, const T &divisor) {
 
 void real_reql_cluster_interface_t::wait_for_metadata_to_propagate(
         const cluster_semilattice_metadata_t &metadata, signal_t *interruptor) {
-    int threadnum = get_thread_id().threadnum;
-
-    guarantee(cross_thread_namespace_watchables[threadnum].has());
-    cross_thread_namespace_watchables[threadnum]->get_watchable()->run_until_satisfied(
+    namespaces_snapshot.run_until_satisfied(
             [&] (const cow_ptr_t<namespaces_semilattice_metadata_t> &md) -> bool
                 { return is_joined(md, metadata.rdb_namespaces); },
             interruptor);
 
-    guarantee(cross_thread_database_watchables[threadnum].has());
-    cross_thread_database_watchables[threadnum]->get_watchable()->run_until_satisfied(
+    databases_snapshot.run_until_satisfied(
             [&] (const databases_semilattice_metadata_t &md) -> bool
                 { return is_joined(md, metadata.databases); },
             interruptor);
 }
 
-template <class T>
-void copy_value(const T *in, T *out) {
-    *out = *in;
-}
-
-cow_ptr_t<namespaces_semilattice_metadata_t>
+counted_t<const real_reql_cluster_interface_t::namespaces_snapshot_t>
 real_reql_cluster_interface_t::get_namespaces_metadata() {
-    int threadnum = get_thread_id().threadnum;
-    r_sanity_check(cross_thread_namespace_watchables[threadnum].has());
-    cow_ptr_t<namespaces_semilattice_metadata_t> ret;
-    cross_thread_namespace_watchables[threadnum]->apply_read(
-            std::bind(&copy_value< cow_ptr_t<namespaces_semilattice_metadata_t> >,
-                      ph::_1, &ret));
-    return ret;
+    return namespaces_snapshot.get();
 }
 
-void real_reql_cluster_interface_t::get_databases_metadata(
-        databases_semilattice_metadata_t *out) {
-    int threadnum = get_thread_id().threadnum;
-    r_sanity_check(cross_thread_database_watchables[threadnum].has());
-    cross_thread_database_watchables[threadnum]->apply_read(
-            std::bind(&copy_value<databases_semilattice_metadata_t>,
-                      ph::_1, out));
+counted_t<const real_reql_cluster_interface_t::databases_snapshot_t>
+real_reql_cluster_interface_t::get_databases_metadata() {
+    return databases_snapshot.get();
 }
-
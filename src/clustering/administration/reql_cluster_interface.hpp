@@ -7,9 +7,10 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/namespace_interface_repository.hpp"
-#include "concurrency/cross_thread_watchable.hpp"
+#include "concurrency/cross_thread_snapshot.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/context.hpp"
+#include "rdb_protocol/read_cache.hpp"
 #include "rpc/semilattice/view.hpp"
 
 /* `real_reql_cluster_interface_t` is a concrete subclass of `reql_cluster_interface_t`
@@ -27,7 +28,8 @@ public:
                 cluster_semilattice_metadata_t> > semilattices,
             clone_ptr_t< watchable_t< change_tracking_map_t<
                 peer_id_t, cluster_directory_metadata_t> > > directory,
-            rdb_context_t *rdb_context
+            rdb_context_t *rdb_context,
+            const std::set<std::string> &read_cache_tables
             );
 
     bool db_create(const name_string_t &name,
@@ -66,21 +68,28 @@ private:
         cluster_semilattice_metadata_t> > semilattice_root_view;
     clone_ptr_t< watchable_t< change_tracking_map_t<
         peer_id_t, cluster_directory_metadata_t> > > directory_root_view;
-    scoped_array_t< scoped_ptr_t< cross_thread_watchable_variable_t< cow_ptr_t<
-        namespaces_semilattice_metadata_t> > > > cross_thread_namespace_watchables;
-    scoped_array_t< scoped_ptr_t< cross_thread_watchable_variable_t<
-        databases_semilattice_metadata_t > > > cross_thread_database_watchables;
+    /* Queries look tables and databases up in these on every thread, so rather than
+    keeping a copy of the metadata per thread, every thread shares one copy. */
+    cross_thread_snapshot_t< cow_ptr_t<namespaces_semilattice_metadata_t> >
+        namespaces_snapshot;
+    cross_thread_snapshot_t<databases_semilattice_metadata_t> databases_snapshot;
     rdb_context_t *rdb_context;
 
     namespace_repo_t namespace_repo;
     ql::changefeed::client_t changefeed_client;
+    point_read_cache_manager_t read_cache_manager;
 
     void wait_for_metadata_to_propagate(const cluster_semilattice_metadata_t &metadata,
                                         signal_t *interruptor);
 
-    cow_ptr_t<namespaces_semilattice_metadata_t> get_namespaces_metadata();
-    // This could soooo be optimized if you don't want to copy the whole thing.
-    void get_databases_metadata(databases_semilattice_metadata_t *out);
+    typedef cross_thread_snapshot_t< cow_ptr_t<namespaces_semilattice_metadata_t> >
+        ::snapshot_t namespaces_snapshot_t;
+    typedef cross_thread_snapshot_t<databases_semilattice_metadata_t>::snapshot_t
+        databases_snapshot_t;
+
+    // These don't copy the metadata; hold on to the snapshot while using it.
+    counted_t<const namespaces_snapshot_t> get_namespaces_metadata();
+    counted_t<const databases_snapshot_t> get_databases_metadata();
 
     DISABLE_COPYING(real_reql_cluster_interface_t);
 };
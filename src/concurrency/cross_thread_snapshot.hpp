@@ -0,0 +1,110 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONCURRENCY_CROSS_THREAD_SNAPSHOT_HPP_
+#define CONCURRENCY_CROSS_THREAD_SNAPSHOT_HPP_
+
+#include <stdint.h>
+
+#include <functional>
+
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/pubsub.hpp"
+#include "concurrency/watchable.hpp"
+#include "containers/counted.hpp"
+#include "containers/scoped.hpp"
+
+/* `cross_thread_snapshot_t` makes the value of a `watchable_t` readable on every
+thread, for values that are read far more often than they change and are expensive to
+copy, like the cluster metadata that queries look tables up in.
+
+Unlike with one `cross_thread_watchable_variable_t` per thread, the value isn't copied
+for each thread.  When it changes, it's copied once, on the watchable's home thread,
+into an immutable, reference-counted value that all threads share.  Then a coroutine
+goes to each thread and swaps the thread's snapshot for one of the new value.  `get()`
+returns the calling thread's current snapshot, which costs a pointer load and a
+non-atomic increment; the shared value's atomic reference count is only touched when a
+thread's snapshot is replaced.  A value is freed when the last snapshot of it is.  This
+needs no locks, because each thread's snapshot only ever changes on that thread.
+
+A thread may see an older value than other threads, for as long as it takes the new
+one to get there, but it never goes back to an older value than it has seen.
+
+Create and destroy the `cross_thread_snapshot_t` on the watchable's home thread; both
+block, because they set up and tear down each thread's snapshot on its own thread. */
+
+template <class value_t>
+class cross_thread_snapshot_t : public home_thread_mixin_t {
+private:
+    class shared_value_t : public slow_atomic_countable_t<shared_value_t> {
+    public:
+        shared_value_t(const value_t &_value, uint64_t _version)
+            : value(_value), version(_version) { }
+        const value_t value;
+        const uint64_t version;
+    private:
+        DISABLE_COPYING(shared_value_t);
+    };
+
+public:
+    /* A thread's view of the value.  Snapshots may only be used, and must be
+    released, on the thread they were gotten on. */
+    class snapshot_t : public single_threaded_countable_t<snapshot_t> {
+    public:
+        explicit snapshot_t(const counted_t<const shared_value_t> &_shared)
+            : shared(_shared) { }
+
+        const value_t &get() const { return shared->value; }
+        // Values published later have higher versions.
+        uint64_t get_version() const { return shared->version; }
+
+    private:
+        const counted_t<const shared_value_t> shared;
+
+        DISABLE_COPYING(snapshot_t);
+    };
+
+    explicit cross_thread_snapshot_t(const clone_ptr_t<watchable_t<value_t> > &watchable);
+    ~cross_thread_snapshot_t();
+
+    // Returns this thread's current snapshot.  Can be called on any thread of the
+    // thread pool.
+    counted_t<const snapshot_t> get() const {
+        return thread_states[get_thread_id().threadnum]->snapshot;
+    }
+
+    // Blocks until `fn` returns true for this thread's current value.  Can be called
+    // on any thread of the thread pool.
+    void run_until_satisfied(const std::function<bool(const value_t &)> &fn,
+                             signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+private:
+    struct thread_state_t {
+        counted_t<const snapshot_t> snapshot;
+        // Publishes when `snapshot` changes.
+        publisher_controller_t<std::function<void()> > publisher;
+    };
+
+    void on_value_changed();
+    counted_t<const shared_value_t> copy_value();
+
+    // Replaces `thread`'s snapshot, unless it's already of `value` or a later one.
+    // Creates the thread's state if it doesn't exist yet.
+    void install(threadnum_t thread, const counted_t<const shared_value_t> &value);
+    void publish(threadnum_t thread, const counted_t<const shared_value_t> &value,
+                 auto_drainer_t::lock_t keepalive);
+
+    clone_ptr_t<watchable_t<value_t> > original;
+    uint64_t next_version;
+
+    // Each thread's state lives on that thread.
+    scoped_array_t<scoped_ptr_t<thread_state_t> > thread_states;
+
+    auto_drainer_t drainer;
+    typename watchable_t<value_t>::subscription_t subs;
+
+    DISABLE_COPYING(cross_thread_snapshot_t);
+};
+
+#include "concurrency/cross_thread_snapshot.tcc"
+
+#endif  // CONCURRENCY_CROSS_THREAD_SNAPSHOT_HPP_
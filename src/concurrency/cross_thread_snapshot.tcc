@@ -0,0 +1,98 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/pmap.hpp"
+
+template <class value_t>
+cross_thread_snapshot_t<value_t>::cross_thread_snapshot_t(
+        const clone_ptr_t<watchable_t<value_t> > &watchable) :
+    original(watchable),
+    next_version(0),
+    thread_states(get_num_threads()),
+    subs(std::bind(&cross_thread_snapshot_t<value_t>::on_value_changed, this))
+{
+    rassert(original->home_thread() == home_thread());
+    counted_t<const shared_value_t> value;
+    {
+        typename watchable_t<value_t>::freeze_t freeze(original);
+        value = copy_value();
+        subs.reset(original, &freeze);
+    }
+    // If the value changes while we're at this, the new value may get to some
+    // threads first; `install()` then leaves it there.
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        install(threadnum_t(i), value);
+    });
+}
+
+template <class value_t>
+cross_thread_snapshot_t<value_t>::~cross_thread_snapshot_t() {
+    assert_thread();
+    subs.reset();
+    drainer.drain();
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        thread_states[i].reset();
+    });
+}
+
+template <class value_t>
+void cross_thread_snapshot_t<value_t>::run_until_satisfied(
+        const std::function<bool(const value_t &)> &fn,
+        signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    thread_state_t *state = thread_states[get_thread_id().threadnum].get();
+    while (true) {
+        cond_t changed;
+        typename publisher_t<std::function<void()> >::subscription_t subscription(
+            [&]() { changed.pulse_if_not_already_pulsed(); },
+            state->publisher.get_publisher());
+        if (fn(state->snapshot->get())) {
+            return;
+        }
+        wait_interruptible(&changed, interruptor);
+    }
+}
+
+template <class value_t>
+counted_t<const typename cross_thread_snapshot_t<value_t>::shared_value_t>
+cross_thread_snapshot_t<value_t>::copy_value() {
+    counted_t<const shared_value_t> value;
+    original->apply_read([&](const value_t *v) {
+        value = make_counted<const shared_value_t>(*v, next_version++);
+    });
+    return value;
+}
+
+template <class value_t>
+void cross_thread_snapshot_t<value_t>::on_value_changed() {
+    const counted_t<const shared_value_t> value = copy_value();
+    for (int i = 0; i < get_num_threads(); ++i) {
+        coro_t::spawn_sometime(std::bind(&cross_thread_snapshot_t<value_t>::publish,
+                                         this, threadnum_t(i), value, drainer.lock()));
+    }
+}
+
+template <class value_t>
+void cross_thread_snapshot_t<value_t>::install(
+        threadnum_t thread, const counted_t<const shared_value_t> &value) {
+    rassert(get_thread_id() == thread);
+    if (!thread_states[thread.threadnum].has()) {
+        thread_states[thread.threadnum].init(new thread_state_t);
+    }
+    thread_state_t *state = thread_states[thread.threadnum].get();
+    // A later value may have overtaken this one on the way here.
+    if (!state->snapshot.has() || state->snapshot->get_version() < value->version) {
+        state->snapshot = make_counted<const snapshot_t>(value);
+        state->publisher.publish(&call_function);
+    }
+}
+
+template <class value_t>
+void cross_thread_snapshot_t<value_t>::publish(
+        threadnum_t thread, const counted_t<const shared_value_t> &value,
+        auto_drainer_t::lock_t) {
+    on_thread_t thread_switcher(thread);
+    install(thread, value);
+}
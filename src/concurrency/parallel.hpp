@@ -0,0 +1,105 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONCURRENCY_PARALLEL_HPP_
+#define CONCURRENCY_PARALLEL_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/thread_pool.hpp"
+
+/* These spread CPU-bound work over the thread pool's compute pool (see
+`compute_pool_t`), blocking the calling coroutine but not its thread.  Outside of a
+coroutine, or when the work is too small to be worth it, they just do the work
+themselves.  Either way the functions they're given must be safe to call from threads
+other than the caller's. */
+
+// Below this many elements, `parallel_sort()` sorts on the calling thread.
+const size_t PARALLEL_SORT_MIN_SIZE = 4096;
+
+// Calls `fn(b, e)` on subranges, each at most `grain` long, that together cover
+// `[begin, end)`.  If any of the calls throws, some of the others may not be made,
+// and the first exception is rethrown.
+template <class callable_t>
+void parallel_for(size_t begin, size_t end, size_t grain, const callable_t &fn) {
+    rassert(grain > 0);
+    compute_pool_t *pool = linux_thread_pool_t::get_compute_pool();
+    if (pool == NULL || pool->num_workers() == 0 || coro_t::self() == NULL
+        || end <= begin || end - begin <= grain) {
+        for (size_t i = begin; i < end; i += grain) {
+            fn(i, std::min(end, i + grain));
+        }
+        return;
+    }
+    pool->run(begin, end, grain, std::function<void(size_t, size_t)>(fn));
+}
+
+// Like `std::stable_sort()`.  The pieces are sorted in parallel and then merged in
+// pairs, also in parallel.
+template <class iterator_t, class less_t>
+void parallel_sort(iterator_t first, iterator_t last, const less_t &less) {
+    const size_t size = last - first;
+    compute_pool_t *pool = linux_thread_pool_t::get_compute_pool();
+    if (size < PARALLEL_SORT_MIN_SIZE || pool == NULL || pool->num_workers() < 2) {
+        std::stable_sort(first, last, less);
+        return;
+    }
+
+    const size_t num_pieces = std::min<size_t>(pool->num_workers(),
+                                               size / (PARALLEL_SORT_MIN_SIZE / 2));
+    std::vector<size_t> bounds(num_pieces + 1);
+    for (size_t i = 0; i <= num_pieces; ++i) {
+        bounds[i] = size * i / num_pieces;
+    }
+
+    parallel_for(0, num_pieces, 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            std::stable_sort(first + bounds[i], first + bounds[i + 1], less);
+        }
+    });
+
+    for (size_t width = 1; width < num_pieces; width *= 2) {
+        const size_t num_merges = (num_pieces + 2 * width - 1) / (2 * width);
+        parallel_for(0, num_merges, 1, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                const size_t lo = i * 2 * width;
+                const size_t mid = std::min(lo + width, num_pieces);
+                const size_t hi = std::min(lo + 2 * width, num_pieces);
+                std::inplace_merge(first + bounds[lo], first + bounds[mid],
+                                   first + bounds[hi], less);
+            }
+        });
+    }
+}
+
+// Splits `[begin, end)` into subranges at most `grain` long, computes
+// `map_range(b, e)` for each of them in parallel, and folds the results in order,
+// starting with `init`, using `combine(acc, result)`.
+template <class result_t, class map_range_t, class combine_t>
+result_t parallel_reduce(size_t begin, size_t end, size_t grain, result_t init,
+                         const map_range_t &map_range, const combine_t &combine) {
+    // The results are written from different threads, which `std::vector<bool>`
+    // doesn't allow.
+    static_assert(!std::is_same<result_t, bool>::value,
+                  "parallel_reduce() can't produce bools");
+    if (end <= begin) {
+        return init;
+    }
+    const size_t num_pieces = (end - begin + grain - 1) / grain;
+    std::vector<result_t> results(num_pieces);
+    parallel_for(0, num_pieces, 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            results[i] = map_range(begin + i * grain,
+                                   std::min(end, begin + (i + 1) * grain));
+        }
+    });
+    for (size_t i = 0; i < num_pieces; ++i) {
+        init = combine(std::move(init), std::move(results[i]));
+    }
+    return init;
+}
+
+#endif  // CONCURRENCY_PARALLEL_HPP_
@@ -36,7 +36,11 @@
 // Defines the maximum size of the batch of IO events to process on
 // each loop iteration. A larger number will increase throughput but
 // decrease concurrency
-#define MAX_IO_EVENT_PROCESSING_BATCH_SIZE        50
+#define MAX_IO_EVENT_PROCESSING_BATCH_SIZE        256
+
+// The longest an event loop may be told to busy poll before it goes to sleep
+// (`--busy-poll-us`).
+#define MAX_BUSY_POLL_US                          (10 * THOUSAND)
 
 // The io batch factor ensures a minimum number of i/o operations
 // which are picked from any specific i/o account consecutively.
@@ -101,8 +105,9 @@
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
 
-// Ticks (in milliseconds) the internal timed tasks are performed at
-#define TIMER_TICKS_IN_MS                         5
+// Ticks (in milliseconds) the internal timed tasks are performed at.  Timers ring at
+// the start of the first tick that isn't before they're due.
+#define TIMER_TICKS_IN_MS                         1
 
 // How many milliseconds to allow changes to sit in memory before flushing to disk
 #define DEFAULT_FLUSH_TIMER_MS                    1000
@@ -164,6 +169,31 @@
 // freed. This value is per thread.
 #define COROUTINE_FREE_LIST_SIZE                  64
 
+// How many of the unused coroutine stacks per thread keep the memory they were
+// using, so that coroutines that are spawned right after others finish don't have
+// to fault their pages back in.  The rest of the unused stacks give their memory
+// back to the operating system, and don't count towards COROUTINE_FREE_LIST_SIZE.
+#define COROUTINE_WARM_FREE_LIST_SIZE             16
+
+// How much memory each thread's object pool (see `containers/object_pool.hpp`) keeps
+// in free blocks of each size class, before giving freed blocks back to the heap.
+#define OBJECT_POOL_MAX_CACHED_BYTES              (256 * KILOBYTE)
+
+// The sampling profiler (see `take_sampling_profile()`) keeps up to this many samples
+// per thread, of up to this many stack frames each.  The buffers are only allocated
+// while a profile is being taken.
+#define SAMPLING_PROFILER_MAX_SAMPLES_PER_THREAD  8192
+#define SAMPLING_PROFILER_MAX_FRAMES              32
+
+// How often the sampling profiler samples each thread, per second of CPU time, unless
+// it's asked to sample more or less often, and the most it can be asked for.
+// `SamplingProfilerTest.OverheadBenchmark` measures what the default costs.
+#define SAMPLING_PROFILER_DEFAULT_FREQUENCY       100
+#define SAMPLING_PROFILER_MAX_FREQUENCY           1000
+
+// One in this many waits is recorded by the sampling profiler.
+#define SAMPLING_PROFILER_WAIT_SAMPLE_INTERVAL    64
+
 #define MAX_COROS_PER_THREAD                      10000
 
 
@@ -203,14 +233,26 @@
 // 2^(MESSAGE_SCHEDULER_MAX_PRIORITY - MESSAGE_SCHEDULER_MIN_PRIORITY + 1)
 #define MESSAGE_SCHEDULER_GRANULARITY           32
 
-// Priorities for specific tasks
-#define CORO_PRIORITY_SINDEX_CONSTRUCTION       (-2)
-#define CORO_PRIORITY_BACKFILL_SENDER           (-2)
-#define CORO_PRIORITY_BACKFILL_RECEIVER         (-2)
-#define CORO_PRIORITY_RESET_DATA                (-2)
+// Priorities for specific tasks.  Backfills, secondary index construction, resetting
+// data and LBA GC run in the background scheduling class instead (see `sched_class_t`).
 #define CORO_PRIORITY_REACTOR                   (-1)
 #define CORO_PRIORITY_DIRECTORY_CHANGES         (-2)
-#define CORO_PRIORITY_LBA_GC                    (-2)
+
+// The message hub priorities of the interactive and background scheduling classes.
+// The batch class runs at MESSAGE_SCHEDULER_DEFAULT_PRIORITY.
+#define SCHED_INTERACTIVE_PRIORITY              1
+#define SCHED_BACKGROUND_PRIORITY               (-2)
+
+// How long (in nanoseconds) a query in each scheduling class may keep its thread busy
+// before `ql::env_t::maybe_yield()` makes it yield.  An interactive query that uses up
+// its slice is demoted to the batch class.
+#define SCHED_INTERACTIVE_TIME_SLICE_NS         (2 * MILLION)
+#define SCHED_BATCH_TIME_SLICE_NS               (500 * THOUSAND)
+#define SCHED_BACKGROUND_TIME_SLICE_NS          (200 * THOUSAND)
+
+// One in this many coroutine wakeups has its queueing delay measured for the
+// per-class queueing delay histograms.
+#define SCHED_QUEUE_DELAY_SAMPLE_INTERVAL       16
 
 
 #endif  // CONFIG_ARGS_HPP_
@@ -9,6 +9,7 @@
 
 #include "containers/printf_buffer.hpp"
 #include "containers/intrusive_list.hpp"
+#include "containers/object_pool.hpp"
 #include "version.hpp"
 #include "valgrind.hpp"
 
@@ -91,7 +92,7 @@ private:
     DISABLE_COPYING(write_stream_t);
 };
 
-class write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
+class write_buffer_t : public intrusive_list_node_t<write_buffer_t>, public pool_allocated_t {
 public:
     write_buffer_t() : size(0) { }
 
@@ -0,0 +1,141 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "containers/arena.hpp"
+
+#include <stdlib.h>
+
+#include "arch/runtime/runtime.hpp"
+#include "thread_local.hpp"
+#include "utils.hpp"
+
+class arena_chunk_t {
+public:
+    // The number of objects still living in the chunk, plus `ARENA_BIAS` for as
+    // long as the arena allocates from it.  Objects can be freed on any thread.
+    intptr_t live_count;
+};
+
+namespace {
+
+// Every allocation is preceded by a pointer to its chunk (or NULL if it comes from
+// the heap), padded so that the object stays suitably aligned.
+const size_t HEADER_SIZE = 16;
+
+// Keeps `live_count` from dropping to zero while the arena still allocates from
+// the chunk, without having to count allocations atomically.
+const intptr_t ARENA_BIAS = INTPTR_MAX / 2;
+
+size_t round_up(size_t size) {
+    return (size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1);
+}
+
+arena_chunk_t **header_of(void *ptr) {
+    return reinterpret_cast<arena_chunk_t **>(static_cast<char *>(ptr) - HEADER_SIZE);
+}
+
+void *allocate_from_heap(size_t size) {
+    char *raw = static_cast<char *>(rmalloc(HEADER_SIZE + size));
+    *reinterpret_cast<arena_chunk_t **>(raw) = NULL;
+    return raw + HEADER_SIZE;
+}
+
+void release_chunk(arena_chunk_t *chunk, intptr_t count) {
+    if (__sync_sub_and_fetch(&chunk->live_count, count) == 0) {
+        free(chunk);
+    }
+}
+
+}  // namespace
+
+TLS_with_init(arena_t *, current_arena, NULL);
+
+arena_t::arena_t(size_t _chunk_size)
+    : chunk_size(_chunk_size),
+      current_chunk(NULL),
+      next(NULL),
+      end(NULL),
+      current_chunk_allocations(0),
+      scope_depth(0),
+      enabled(true),
+      allocation_count_(0),
+      chunk_count_(0) {
+    guarantee(chunk_size >= 4 * HEADER_SIZE + round_up(sizeof(arena_chunk_t)));
+}
+
+arena_t::~arena_t() {
+    assert_thread();
+    guarantee(scope_depth == 0);
+    retire_current_chunk();
+}
+
+void *arena_t::allocate(size_t size) {
+    assert_thread();
+    if (!enabled) {
+        ++allocation_count_;
+        return allocate_from_heap(size);
+    }
+    const size_t needed = HEADER_SIZE + round_up(size);
+    // Large objects would waste most of a chunk.
+    if (needed > chunk_size / 4) {
+        return allocate_from_heap(size);
+    }
+    if (current_chunk == NULL || static_cast<size_t>(end - next) < needed) {
+        retire_current_chunk();
+        char *raw = static_cast<char *>(rmalloc(chunk_size));
+        current_chunk = reinterpret_cast<arena_chunk_t *>(raw);
+        current_chunk->live_count = ARENA_BIAS;
+        next = raw + round_up(sizeof(arena_chunk_t));
+        end = raw + chunk_size;
+        ++chunk_count_;
+    }
+    char *header = next;
+    next += needed;
+    *reinterpret_cast<arena_chunk_t **>(header) = current_chunk;
+    ++current_chunk_allocations;
+    ++allocation_count_;
+    return header + HEADER_SIZE;
+}
+
+void arena_t::deallocate(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    arena_chunk_t **header = header_of(ptr);
+    if (*header == NULL) {
+        free(header);
+    } else {
+        release_chunk(*header, 1);
+    }
+}
+
+void *arena_t::allocate_from_current(size_t size) {
+    arena_t *arena = TLS_get_current_arena();
+    return arena != NULL ? arena->allocate(size) : allocate_from_heap(size);
+}
+
+void arena_t::retire_current_chunk() {
+    if (current_chunk != NULL) {
+        // Trades the bias for the number of objects we put into the chunk.
+        release_chunk(current_chunk, ARENA_BIAS - current_chunk_allocations);
+        current_chunk = NULL;
+        next = NULL;
+        end = NULL;
+        current_chunk_allocations = 0;
+    }
+}
+
+arena_scope_t::arena_scope_t(arena_t *_arena)
+    : arena(_arena->home_thread() == get_thread_id() ? _arena : NULL) {
+    if (arena != NULL) {
+        ++arena->scope_depth;
+        TLS_set_current_arena(arena);
+    }
+}
+
+arena_scope_t::~arena_scope_t() {
+    if (arena != NULL) {
+        --arena->scope_depth;
+        if (arena->scope_depth == 0 && TLS_get_current_arena() == arena) {
+            TLS_set_current_arena(NULL);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_ARENA_HPP_
+#define CONTAINERS_ARENA_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config/args.hpp"
+#include "errors.hpp"
+#include "threading.hpp"
+
+class arena_chunk_t;
+
+/* `arena_t` is a bump allocator for small objects that are created and destroyed
+at a high rate, like the `val_t`s produced while evaluating a query.  Memory is
+handed out sequentially from fixed-size chunks, so allocating is a pointer bump and
+objects allocated together end up next to each other.
+
+Unlike a classic arena, objects may outlive the `arena_t` they were allocated from,
+and may be freed on any thread: every chunk counts the objects still living in it
+and goes away with the last of them (or with the arena, whichever is later).  So
+nothing has to be copied out of the arena when it escapes; the price is that a
+single escaped object keeps its whole chunk alive, which is why the chunks are
+small.
+
+Allocation itself must happen on the arena's home thread; an `arena_scope_t` on any
+other thread has no effect. */
+class arena_t : public home_thread_mixin_t {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 16 * KILOBYTE;
+
+    explicit arena_t(size_t _chunk_size = DEFAULT_CHUNK_SIZE);
+    ~arena_t();
+
+    void *allocate(size_t size);
+
+    // Frees memory from any `arena_t`, or from `allocate_from_current`.
+    static void deallocate(void *ptr);
+
+    // Allocates from the arena of the innermost `arena_scope_t` active on this
+    // thread, or from the heap if there is none.
+    static void *allocate_from_current(size_t size);
+
+    // For comparing the arena to the heap: while the arena is disabled, `allocate`
+    // takes every object from the heap.  They are still counted.
+    void set_enabled(bool _enabled) { enabled = _enabled; }
+
+    // For instrumentation.
+    uint64_t allocation_count() const { return allocation_count_; }
+    uint64_t chunk_count() const { return chunk_count_; }
+
+private:
+    friend class arena_scope_t;
+
+    void retire_current_chunk();
+
+    const size_t chunk_size;
+
+    arena_chunk_t *current_chunk;
+    // The next free byte and the end of `current_chunk`.
+    char *next;
+    char *end;
+    // The number of objects allocated from `current_chunk`.
+    intptr_t current_chunk_allocations;
+
+    // The number of `arena_scope_t`s currently using this arena.
+    int scope_depth;
+
+    bool enabled;
+
+    uint64_t allocation_count_;
+    uint64_t chunk_count_;
+
+    DISABLE_COPYING(arena_t);
+};
+
+/* While an `arena_scope_t` exists, `arena_t::allocate_from_current` allocates from
+its arena on this thread.  Scopes belonging to different coroutines can interleave,
+in which case a coroutine may briefly allocate from another coroutine's arena.
+That's harmless, since every chunk keeps track of its own objects, and a thread's
+current arena is always one that still has an active scope. */
+class arena_scope_t {
+public:
+    explicit arena_scope_t(arena_t *_arena);
+    ~arena_scope_t();
+
+private:
+    arena_t *const arena;
+
+    DISABLE_COPYING(arena_scope_t);
+};
+
+#endif  // CONTAINERS_ARENA_HPP_
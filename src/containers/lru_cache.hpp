@@ -81,6 +81,20 @@ public:
             return cache_list_.end();
         }
     }
+    // Returns the number of entries erased.
+    size_t erase(const K &key) {
+        auto search = cache_map_.find(key);
+        if (search == cache_map_.end()) {
+            return 0;
+        }
+        cache_list_.erase(search->second);
+        cache_map_.erase(search);
+        return 1;
+    }
+    void clear() {
+        cache_map_.clear();
+        cache_list_.clear();
+    }
 private:
     V &insert(const K &key) {
         cache_list_.push_front(std::make_pair(key, V()));
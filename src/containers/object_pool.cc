@@ -0,0 +1,220 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "containers/object_pool.hpp"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Every block starts with a header, padded so that the object stays suitably
+// aligned.
+const size_t HEADER_SIZE = 16;
+
+struct block_header_t {
+    // The thread whose pool the block belongs to, or -1 if it's from the heap.
+    int32_t thread;
+    int32_t size_class;
+};
+
+// Free blocks are linked through the memory the object used to occupy.
+struct free_block_t {
+    free_block_t *next;
+};
+
+/* Up to 256 bytes, the size classes are 16 bytes apart.  Above that, every doubling
+in size is split into four size classes, up to the largest class of 16 KB. */
+const size_t SMALL_CLASS_STEP = 16;
+const int NUM_SMALL_CLASSES = 16;
+const int SMALL_CLASS_LIMIT_LOG2 = 8;
+const int MAX_POOLED_SIZE_LOG2 = 14;
+const int CLASSES_PER_DOUBLING = 4;
+const int NUM_SIZE_CLASSES = NUM_SMALL_CLASSES
+    + (MAX_POOLED_SIZE_LOG2 - SMALL_CLASS_LIMIT_LOG2) * CLASSES_PER_DOUBLING;
+const size_t MAX_POOLED_SIZE = size_t(1) << MAX_POOLED_SIZE_LOG2;
+
+int size_class_of(size_t size) {
+    if (size <= NUM_SMALL_CLASSES * SMALL_CLASS_STEP) {
+        return size == 0 ? 0 : (size - 1) / SMALL_CLASS_STEP;
+    }
+    // `size` is in (2^log2, 2^(log2 + 1)].
+    const int log2 = 63 - __builtin_clzll(size - 1);
+    const size_t step = size_t(1) << (log2 - 2);
+    const size_t quarter = (size - (size_t(1) << log2) + step - 1) / step;
+    return NUM_SMALL_CLASSES + (log2 - SMALL_CLASS_LIMIT_LOG2) * CLASSES_PER_DOUBLING
+        + quarter - 1;
+}
+
+size_t size_of_class(int size_class) {
+    if (size_class < NUM_SMALL_CLASSES) {
+        return (size_class + 1) * SMALL_CLASS_STEP;
+    }
+    const int log2 = SMALL_CLASS_LIMIT_LOG2
+        + (size_class - NUM_SMALL_CLASSES) / CLASSES_PER_DOUBLING;
+    const size_t quarter = (size_class - NUM_SMALL_CLASSES) % CLASSES_PER_DOUBLING + 1;
+    return (size_t(1) << log2) + quarter * (size_t(1) << (log2 - 2));
+}
+
+block_header_t *header_of(void *ptr) {
+    return reinterpret_cast<block_header_t *>(static_cast<char *>(ptr) - HEADER_SIZE);
+}
+
+class thread_object_pool_t {
+public:
+    thread_object_pool_t() {
+        std::fill(free_lists, free_lists + NUM_SIZE_CLASSES,
+                  static_cast<free_block_t *>(NULL));
+        std::fill(free_counts, free_counts + NUM_SIZE_CLASSES, 0);
+    }
+
+    free_block_t *free_lists[NUM_SIZE_CLASSES];
+    size_t free_counts[NUM_SIZE_CLASSES];
+    object_pool_stats_t stats;
+};
+
+// Only ever touched by their own threads.
+cache_line_padded_t<thread_object_pool_t> thread_pools[MAX_THREADS];
+
+// The blocks of each thread that other threads have freed.  Other threads push onto
+// these; the thread itself only ever takes the whole list, so there's no ABA problem.
+cache_line_padded_t<free_block_t *> remote_frees[MAX_THREADS];
+
+// Returns the calling thread's index into `thread_pools`, or -1 if it doesn't have a
+// pool.  Only the thread pool's own threads have pools; the main thread, and the
+// blocker and compute pools' threads, don't.
+int pool_thread() {
+    if (linux_thread_pool_t::get_thread_pool() == NULL) {
+        return -1;
+    }
+    const int thread = linux_thread_pool_t::get_thread_id();
+    rassert(thread < MAX_THREADS);
+    return thread;
+}
+
+void *allocate_from_heap(size_t size, int thread, int size_class) {
+    char *raw = static_cast<char *>(rmalloc(HEADER_SIZE + size));
+    block_header_t *header = reinterpret_cast<block_header_t *>(raw);
+    header->thread = thread;
+    header->size_class = size_class;
+    return raw + HEADER_SIZE;
+}
+
+void return_block(thread_object_pool_t *pool, free_block_t *block) {
+    const int size_class = header_of(block)->size_class;
+    const size_t max_cached = std::max<size_t>(
+        1, OBJECT_POOL_MAX_CACHED_BYTES / size_of_class(size_class));
+    if (pool->free_counts[size_class] >= max_cached) {
+        free(header_of(block));
+    } else {
+        block->next = pool->free_lists[size_class];
+        pool->free_lists[size_class] = block;
+        ++pool->free_counts[size_class];
+    }
+}
+
+void reclaim_remote_frees(int thread) {
+    free_block_t **head = &remote_frees[thread].value;
+    if (__atomic_load_n(head, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+    free_block_t *block = __atomic_exchange_n(head, static_cast<free_block_t *>(NULL),
+                                              __ATOMIC_ACQUIRE);
+    while (block != NULL) {
+        free_block_t *next = block->next;
+        return_block(&thread_pools[thread].value, block);
+        block = next;
+    }
+}
+
+}  // namespace
+
+void *object_pool_allocate(size_t size) {
+    const int thread = pool_thread();
+    if (thread < 0 || size > MAX_POOLED_SIZE) {
+        return allocate_from_heap(size, -1, -1);
+    }
+    const int size_class = size_class_of(size);
+    thread_object_pool_t *pool = &thread_pools[thread].value;
+    if (pool->free_lists[size_class] == NULL) {
+        reclaim_remote_frees(thread);
+    }
+    free_block_t *block = pool->free_lists[size_class];
+    if (block == NULL) {
+        ++pool->stats.heap_allocations;
+        return allocate_from_heap(size_of_class(size_class), thread, size_class);
+    }
+    pool->free_lists[size_class] = block->next;
+    --pool->free_counts[size_class];
+    ++pool->stats.pool_allocations;
+    return block;
+}
+
+void object_pool_deallocate(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    block_header_t *header = header_of(ptr);
+    if (header->thread < 0) {
+        free(header);
+        return;
+    }
+    free_block_t *block = static_cast<free_block_t *>(ptr);
+    const int thread = pool_thread();
+    if (header->thread == thread) {
+        return_block(&thread_pools[thread].value, block);
+    } else {
+        if (thread >= 0) {
+            ++thread_pools[thread].value.stats.remote_frees;
+        }
+        free_block_t **head = &remote_frees[header->thread].value;
+        block->next = __atomic_load_n(head, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(head, &block->next, block, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) { }
+    }
+}
+
+object_pool_stats_t get_object_pool_stats() {
+    const int thread = pool_thread();
+    return thread >= 0 ? thread_pools[thread].value.stats : object_pool_stats_t();
+}
+
+class perfmon_object_pool_stats_t : public perfmon_perthread_t<object_pool_stats_t> {
+private:
+    void get_thread_stat(object_pool_stats_t *stat) {
+        *stat = get_object_pool_stats();
+    }
+
+    object_pool_stats_t combine_stats(const object_pool_stats_t *stats) {
+        object_pool_stats_t combined;
+        for (int i = 0; i < get_num_threads(); ++i) {
+            combined.pool_allocations += stats[i].pool_allocations;
+            combined.heap_allocations += stats[i].heap_allocations;
+            combined.remote_frees += stats[i].remote_frees;
+        }
+        return combined;
+    }
+
+    scoped_ptr_t<perfmon_result_t> output_stat(const object_pool_stats_t &stat) {
+        scoped_ptr_t<perfmon_result_t> result = perfmon_result_t::alloc_map_result();
+        result->insert("pool_allocations",
+                       new perfmon_result_t(strprintf("%" PRIi64,
+                                                      stat.pool_allocations)));
+        result->insert("heap_allocations",
+                       new perfmon_result_t(strprintf("%" PRIi64,
+                                                      stat.heap_allocations)));
+        result->insert("remote_frees",
+                       new perfmon_result_t(strprintf("%" PRIi64, stat.remote_frees)));
+        return result;
+    }
+};
+
+static perfmon_object_pool_stats_t pm_object_pools;
+static perfmon_membership_t pm_object_pools_membership(
+    &get_global_perfmon_collection(), &pm_object_pools, "object_pools");
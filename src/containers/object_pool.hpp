@@ -0,0 +1,72 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_OBJECT_POOL_HPP_
+#define CONTAINERS_OBJECT_POOL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "errors.hpp"
+
+/* The object pools keep freed memory around on each thread, for the small objects
+that the runtime creates and destroys many times over for every query.
+
+The pooling is provisional.  Nobody has profiled allocations under a real workload
+yet, so only two classes use it: messages between threads (`thread_doer_t`) and
+serialization buffers (`write_buffer_t`).  By construction these are allocated on
+every cross-thread round trip and every response.  Before adding classes, or keeping
+these, compare the "object_pools" stat and query latency under a real workload with
+and without the pools.
+
+Blocks are sorted into size classes, and every thread of the thread pool has a free
+list per size class.  A block goes back to the free list of the thread that allocated
+it.  If it's freed on another thread, it's handed back through a lock-free list that
+its thread takes over the next time it runs out of blocks of that size.  Each thread
+keeps up to `OBJECT_POOL_MAX_CACHED_BYTES` of free blocks per size class and gives the
+rest back to the heap.
+
+Objects bigger than the largest size class, and objects allocated outside of the
+thread pool's threads, come straight from the heap. */
+
+void *object_pool_allocate(size_t size);
+
+// Frees memory from `object_pool_allocate()`, on any thread.
+void object_pool_deallocate(void *ptr);
+
+struct object_pool_stats_t {
+    object_pool_stats_t()
+        : pool_allocations(0), heap_allocations(0), remote_frees(0) { }
+
+    // Allocations that reused a free block.
+    int64_t pool_allocations;
+    // Allocations that had to go to the heap.
+    int64_t heap_allocations;
+    // Blocks that were freed on another thread than they were allocated on.
+    int64_t remote_frees;
+};
+
+// The stats of this thread's pool.
+object_pool_stats_t get_object_pool_stats();
+
+/* Deriving from `pool_allocated_t` makes `new` and `delete` use the object pools for
+a class and everything derived from it. */
+class pool_allocated_t {
+public:
+    static void *operator new(size_t size) {
+        return object_pool_allocate(size);
+    }
+    static void operator delete(void *ptr) {
+        object_pool_deallocate(ptr);
+    }
+
+    // Declaring the above hides the placement forms.
+    static void *operator new(size_t, void *ptr) {
+        return ptr;
+    }
+    static void operator delete(void *, void *) { }
+
+protected:
+    pool_allocated_t() { }
+    ~pool_allocated_t() { }
+};
+
+#endif  // CONTAINERS_OBJECT_POOL_HPP_
@@ -1,6 +1,8 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "http/json.hpp"
 
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <set>
@@ -164,6 +166,44 @@ std::string cJSON_print_unformatted_std_string(cJSON *json) THROWS_NOTHING {
     return res;
 }
 
+void json_append_string(const char *str, size_t size, std::string *out) {
+    out->push_back('"');
+    const char *run = str;
+    const char *const end = str + size;
+    for (const char *ptr = str; ptr != end; ++ptr) {
+        const unsigned char c = *ptr;
+        if (c > 31 && c != '"' && c != '\\') {
+            continue;
+        }
+        out->append(run, ptr - run);
+        run = ptr + 1;
+        switch (c) {
+        case '\\': out->append("\\\\"); break;
+        case '"': out->append("\\\""); break;
+        case '\b': out->append("\\b"); break;
+        case '\f': out->append("\\f"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default: {
+            char buf[7];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out->append(buf, 6);
+        }
+        }
+    }
+    out->append(run, end - run);
+    out->push_back('"');
+}
+
+void json_append_number(double d, std::string *out) {
+    guarantee(isfinite(d));
+    char buf[64];
+    int res = snprintf(buf, sizeof(buf), "%.20g", d);
+    guarantee(res > 0 && static_cast<size_t>(res) < sizeof(buf));
+    out->append(buf, res);
+}
+
 void project(cJSON *json, std::set<std::string> keys) {
     guarantee(json);
     guarantee(json->type == cJSON_Object);
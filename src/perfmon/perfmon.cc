@@ -289,6 +289,53 @@ scoped_ptr_t<perfmon_result_t> perfmon_rate_monitor_t::output_stat(const double
     return make_scoped<perfmon_result_t>(strprintf("%.8f", stat / ticks_to_secs(length)));
 }
 
+/* perfmon_histogram_t */
+
+perfmon_histogram_t::perfmon_histogram_t()
+    : perfmon_perthread_t<buckets_t>(),
+      thread_data(new cache_line_padded_t<buckets_t>[MAX_THREADS]) { }
+
+perfmon_histogram_t::~perfmon_histogram_t() {
+    delete[] thread_data;
+}
+
+void perfmon_histogram_t::record(ticks_t duration) {
+    const uint64_t micros = duration / THOUSAND;
+    // Values in [2^(i-1), 2^i) microseconds go into bucket `i`.
+    int bucket = micros == 0 ? 0 : 64 - __builtin_clzll(micros);
+    bucket = std::min(bucket, perfmon_histogram::NUM_BUCKETS - 1);
+    rassert(get_thread_id().threadnum >= 0);
+    ++thread_data[get_thread_id().threadnum].value.counts[bucket];
+}
+
+void perfmon_histogram_t::get_thread_stat(buckets_t *stat) {
+    rassert(get_thread_id().threadnum >= 0);
+    *stat = thread_data[get_thread_id().threadnum].value;
+}
+
+perfmon_histogram::buckets_t perfmon_histogram_t::combine_stats(const buckets_t *stats) {
+    buckets_t combined;
+    for (int i = 0; i < get_num_threads(); i++) {
+        for (int b = 0; b < perfmon_histogram::NUM_BUCKETS; b++) {
+            combined.counts[b] += stats[i].counts[b];
+        }
+    }
+    return combined;
+}
+
+scoped_ptr_t<perfmon_result_t> perfmon_histogram_t::output_stat(const buckets_t &stat_data) {
+    scoped_ptr_t<perfmon_result_t> stat = perfmon_result_t::alloc_map_result();
+    // The bounds are zero-padded so that the buckets come out in order.
+    for (int b = 0; b < perfmon_histogram::NUM_BUCKETS - 1; b++) {
+        stat->insert(strprintf("lt_%07" PRIi64 "us", static_cast<int64_t>(1) << b),
+                     new perfmon_result_t(strprintf("%" PRIi64, stat_data.counts[b])));
+    }
+    stat->insert("lt_inf",
+                 new perfmon_result_t(strprintf("%" PRIi64, stat_data.counts[
+                                                    perfmon_histogram::NUM_BUCKETS - 1])));
+    return stat;
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
     : stat(), active(), total(), recent(length, true),
       active_membership(&stat, &active, "active_count"),
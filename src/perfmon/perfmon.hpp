@@ -204,6 +204,37 @@ public:
     void record(double value = 1.0);
 };
 
+/* `perfmon_histogram_t` counts durations in buckets whose bounds are powers of two
+ * microseconds, from under 1us up to 2^20us (about a second), and one bucket for
+ * anything longer. The counts are kept since startup, so that the difference between
+ * two readings gives the histogram for the time in between.
+ */
+namespace perfmon_histogram {
+
+const int NUM_BUCKETS = 22;
+
+struct buckets_t {
+    buckets_t() {
+        std::fill(counts, counts + NUM_BUCKETS, 0);
+    }
+    int64_t counts[NUM_BUCKETS];
+};
+
+}   /* namespace perfmon_histogram */
+
+class perfmon_histogram_t : public perfmon_perthread_t<perfmon_histogram::buckets_t> {
+    typedef perfmon_histogram::buckets_t buckets_t;
+    cache_line_padded_t<buckets_t> *thread_data;
+
+    void get_thread_stat(buckets_t *);
+    buckets_t combine_stats(const buckets_t *);
+    scoped_ptr_t<perfmon_result_t> output_stat(const buckets_t &);
+public:
+    perfmon_histogram_t();
+    virtual ~perfmon_histogram_t();
+    void record(ticks_t duration);
+};
+
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
  * starting and ending time. When something starts, call begin(); when
  * something ends, call end() with the same value as begin. It will produce
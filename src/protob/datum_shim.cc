@@ -0,0 +1,100 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "protob/datum_shim.hpp"
+
+#include <vector>
+
+#include "containers/archive/string_stream.hpp"
+#include "containers/archive/varint.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/serialize_datum.hpp"
+
+namespace datum_shim {
+
+void append_datum(const ql::datum_t &datum, std::string *out) {
+    write_message_t wm;
+    ql::datum_serialize(&wm, datum, ql::check_datum_serialization_errors_t::NO);
+    string_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    out->append(stream.str());
+}
+
+void append_varint(uint64_t value, std::string *out) {
+    uint8_t buf[16];
+    size_t size = serialize_varint_uint64_into_buf(value, buf);
+    out->append(reinterpret_cast<const char *>(buf), size);
+}
+
+void append_response_datum(const Datum &d, std::string *out) {
+    if (d.type() == Datum::R_SERIALIZED) {
+        out->append(d.r_str());
+    } else if (d.type() == Datum::R_STR) {
+        append_datum(ql::datum_t(datum_string_t(d.r_str())), out);
+    } else {
+        unreachable();
+    }
+}
+
+void write_datum_pb(const Response &r, std::string *out) THROWS_NOTHING {
+    const size_t start = out->size();
+    try {
+        size_t size_estimate = 64;
+        for (int i = 0; i < r.response_size(); ++i) {
+            size_estimate += r.response(i).r_str().size();
+        }
+        out->reserve(start + size_estimate);
+
+        const int32_t type = r.type();
+        out->append(reinterpret_cast<const char *>(&type), sizeof(type));
+        append_varint(r.response_size(), out);
+        for (int i = 0; i < r.response_size(); ++i) {
+            append_response_datum(r.response(i), out);
+        }
+
+        if (r.has_backtrace()) {
+            std::vector<ql::datum_t> frames;
+            const Backtrace *bt = &r.backtrace();
+            for (int i = 0; i < bt->frames_size(); ++i) {
+                const Frame *f = &bt->frames(i);
+                switch (f->type()) {
+                case Frame::POS:
+                    frames.push_back(ql::datum_t(static_cast<double>(f->pos())));
+                    break;
+                case Frame::OPT:
+                    frames.push_back(ql::datum_t(datum_string_t(f->opt())));
+                    break;
+                default:
+                    unreachable();
+                }
+            }
+            append_datum(ql::datum_t(std::move(frames),
+                                     ql::configured_limits_t::unlimited),
+                         out);
+        } else {
+            append_datum(ql::datum_t::null(), out);
+        }
+
+        if (r.has_profile()) {
+            append_response_datum(r.profile(), out);
+        } else {
+            append_datum(ql::datum_t::null(), out);
+        }
+    } catch (...) {
+#ifndef NDEBUG
+        throw;
+#else
+        out->resize(start);
+        const int32_t type = Response::RUNTIME_ERROR;
+        out->append(reinterpret_cast<const char *>(&type), sizeof(type));
+        append_varint(1, out);
+        append_datum(
+            ql::datum_t("Internal error in `write_datum_pb`, please report this."),
+            out);
+        append_datum(ql::datum_t::null(), out);
+        append_datum(ql::datum_t::null(), out);
+#endif // NDEBUG
+    }
+}
+
+}  // namespace datum_shim
@@ -0,0 +1,18 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef PROTOB_DATUM_SHIM_HPP_
+#define PROTOB_DATUM_SHIM_HPP_
+
+#include <string>
+
+#include "utils.hpp"
+
+class Response;
+
+namespace datum_shim {
+// Appends the payload of a response for the `BINARY_DATUM` protocol to `out`.  The
+// format is described in ql2.proto.  The response's datums must be `R_SERIALIZED`
+// (or `R_STR`, which error responses use).
+void write_datum_pb(const Response &r, std::string *out) THROWS_NOTHING;
+}  // namespace datum_shim
+
+#endif  // PROTOB_DATUM_SHIM_HPP_
@@ -1,10 +1,17 @@
 #include "protob/json_shim.hpp"
 
 #include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
 
 #include "debug.hpp"
 #include "http/json.hpp"
+#include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/ql2_extensions.pb.h"
 #include "utils.hpp"
 
 std::map<std::string, int32_t> resolver;
@@ -18,170 +25,373 @@ public:
     const char *what() const throw () { return "json_shim::exc_t"; }
 };
 
-template<class T>
-typename std::enable_if<!((std::is_enum<T>::value || std::is_fundamental<T>::value)
-                          && !std::is_same<T, bool>::value)>::type
-extract(cJSON *, T *);
-
-template<class T>
-typename std::enable_if<(std::is_enum<T>::value || std::is_fundamental<T>::value)
-                        && !std::is_same<T, bool>::value>::type
-extract(cJSON *field, T *dest) {
-    if (field->type != cJSON_Number) throw exc_t();
-    T t = static_cast<T>(field->valuedouble);
-    if (static_cast<double>(t) != field->valuedouble) throw exc_t();
-    *dest = t;
-}
+// Reads a query in the JSON wire format straight into a `Query`, in a single pass
+// over the buffer and without building a cJSON tree first.  Drivers send every
+// object and array in a query as a `MAKE_OBJ` or `MAKE_ARRAY` term, even when all
+// they contain is literal values (as do the documents passed to `insert`).  Such
+// terms are collapsed into a single `DATUM` term while parsing, so that they are
+// compiled into one `datum_term_t` instead of a term per field.  They're marked with
+// the `collapsed_literal` extension, so that `datum_term_t` checks the sizes of their
+// arrays against the query's `array_limit`, as `make_array` would have.
+class query_parser_t {
+public:
+    explicit query_parser_t(const char *str) : pos(str) { }
 
-template<class T>
-void safe_extract(cJSON *json, T *t) {
-    if (json != NULL && t != NULL) {
-        extract(json, t);
+    void parse_query(Query *q) {
+        // [type, term, global_optargs]
+        expect('[');
+        if (!consume(']')) {
+            q->set_type(parse_enum<Query::QueryType>());
+            if (consume(',')) {
+                parse_term(q->mutable_query());
+                if (consume(',')) {
+                    parse_optargs(q, &Query::add_global_optargs);
+                    skip_remaining_elements();
+                } else {
+                    expect(']');
+                }
+            } else {
+                expect(']');
+            }
+        }
+        q->set_accepts_r_json(true);
+        skip_whitespace();
+        if (*pos != '\0') throw exc_t();
     }
-}
 
-template<class T, class U>
-void transfer(cJSON *json, T *dest, void (T::*setter)(U)) {
-    U tmp;
-    if (json != NULL) {
-        safe_extract(json, &tmp);
-        (dest->*setter)(std::move(tmp));
+private:
+    void parse_term(Term *t) {
+        skip_whitespace();
+        switch (*pos) {
+        case '[': parse_term_array(t); break;
+        case '{': parse_make_obj(t); break;
+        default:
+            t->set_type(Term::DATUM);
+            parse_scalar(t->mutable_datum());
+        }
     }
-}
 
-template<class T, class U>
-void transfer(cJSON *json, T *dest, U *(T::*mut)()) {
-    if (json != NULL) {
-        safe_extract(json, (dest->*mut)());
+    // [type, args, optargs]
+    void parse_term_array(Term *t) {
+        expect('[');
+        if (consume(']')) return;
+        t->set_type(parse_enum<Term::TermType>());
+        if (consume(',')) {
+            parse_args(t);
+            if (consume(',')) {
+                parse_optargs(t, &Term::add_optargs);
+                skip_remaining_elements();
+            } else {
+                expect(']');
+            }
+        } else {
+            expect(']');
+        }
+        if (t->type() == Term::MAKE_ARRAY) {
+            maybe_collapse_make_array(t);
+        }
     }
-}
 
-template<class T, class U>
-void transfer_arr(cJSON *arr, T *dest, U *(T::*adder)()) {
-    if (arr != NULL) {
-        if (arr->type != cJSON_Object && arr->type != cJSON_Array) throw exc_t();
-        for (cJSON *item = arr->head; item != NULL; item = item->next) {
-            safe_extract(item, (dest->*adder)());
+    void parse_args(Term *t) {
+        skip_whitespace();
+        if (*pos == '{') {
+            // Tolerated for compatibility; the keys are ignored.
+            parse_members([this, t](std::string &&) { parse_term(t->add_args()); });
+        } else {
+            expect('[');
+            if (consume(']')) return;
+            do {
+                parse_term(t->add_args());
+            } while (consume(','));
+            expect(']');
         }
     }
-}
-
-template<>
-void extract(cJSON *field, std::string *s) {
-    if (field->type != cJSON_String) throw exc_t();
-    *s = field->valuestring;
-}
 
-template<>
-void extract(cJSON *field, bool *dest) {
-    if (field->type == cJSON_False) {
-        *dest = false;
-    } else if (field->type == cJSON_True) {
-        *dest = true;
-    } else {
-        throw exc_t();
+    template<class T, class U>
+    void parse_optargs(T *t, U *(T::*adder)()) {
+        skip_whitespace();
+        if (*pos == '[') {
+            // An array has no keys, so it's only acceptable if it's empty.
+            expect('[');
+            expect(']');
+        } else {
+            parse_members([this, t, adder](std::string &&key) {
+                U *ap = (t->*adder)();
+                ap->mutable_key()->swap(key);
+                parse_term(ap->mutable_val());
+            });
+        }
     }
-}
 
-template<>
-void extract(cJSON *json, Term *t) {
-    if (json->type == cJSON_Array) {
-        // It's ok to use the slow functions here, because the indexes are small
-        transfer(cJSON_slow_GetArrayItem(json, 0), t, &Term::set_type);
-        transfer_arr(cJSON_slow_GetArrayItem(json, 1), t, &Term::add_args);
-        transfer_arr(cJSON_slow_GetArrayItem(json, 2), t, &Term::add_optargs);
-    } else if (json->type == cJSON_Object) {
+    void parse_make_obj(Term *t) {
         t->set_type(Term::MAKE_OBJ);
-        transfer_arr(json, t, &Term::add_optargs);
-    } else {
-        t->set_type(Term::DATUM);
-        transfer(json, t, &Term::mutable_datum);
+        parse_members([this, t](std::string &&key) {
+            Term::AssocPair *ap = t->add_optargs();
+            ap->mutable_key()->swap(key);
+            parse_term(ap->mutable_val());
+        });
+        maybe_collapse_make_obj(t);
+    }
+
+    // Parses a JSON object, calling `on_member` with each key when the parser is at
+    // the corresponding value.
+    template<class callable_t>
+    void parse_members(const callable_t &on_member) {
+        expect('{');
+        if (consume('}')) return;
+        do {
+            skip_whitespace();
+            std::string key;
+            parse_string(&key);
+            expect(':');
+            on_member(std::move(key));
+        } while (consume(','));
+        expect('}');
+    }
+
+    void parse_scalar(Datum *d) {
+        switch (*pos) {
+        case '"':
+            d->set_type(Datum::R_STR);
+            parse_string(d->mutable_r_str());
+            break;
+        case 't':
+            expect_word("true");
+            d->set_type(Datum::R_BOOL);
+            d->set_r_bool(true);
+            break;
+        case 'f':
+            expect_word("false");
+            d->set_type(Datum::R_BOOL);
+            d->set_r_bool(false);
+            break;
+        case 'n':
+            expect_word("null");
+            d->set_type(Datum::R_NULL);
+            break;
+        default:
+            d->set_type(Datum::R_NUM);
+            d->set_r_num(parse_number());
+        }
+    }
+
+    // Enum values must be integers.
+    template<class T>
+    T parse_enum() {
+        skip_whitespace();
+        double d = parse_number();
+        T t = static_cast<T>(d);
+        if (static_cast<double>(t) != d) throw exc_t();
+        return t;
+    }
+
+    double parse_number() {
+        const char *start = pos;
+        if (*pos == '-') ++pos;
+        if (*pos < '0' || *pos > '9') throw exc_t();
+        while ((*pos >= '0' && *pos <= '9') || *pos == '.' || *pos == 'e'
+               || *pos == 'E' || *pos == '+' || *pos == '-') {
+            ++pos;
+        }
+        char *end;
+        double d = strtod(start, &end);
+        // Rejects hexadecimal floats, among other things.
+        if (end != pos) throw exc_t();
+        return d;
     }
-}
 
-template<>
-void extract(cJSON *json, Datum *d) {
-    switch (json->type) {
-    case cJSON_False:
-        d->set_type(Datum::R_BOOL);
-        d->set_r_bool(false);
-        break;
-    case cJSON_True:
-        d->set_type(Datum::R_BOOL);
-        d->set_r_bool(true);
-        break;
-    case cJSON_NULL:
-        d->set_type(Datum::R_NULL);
-        break;
-    case cJSON_Number:
-        d->set_type(Datum::R_NUM);
-        d->set_r_num(json->valuedouble);
-        break;
-    case cJSON_String:
-        d->set_type(Datum::R_STR);
-        d->set_r_str(json->valuestring);
-        break;
-    case cJSON_Array:
-        {
-            d->set_type(Datum::R_ARRAY);
-            for (cJSON *item = json->head; item != NULL; item = item->next) {
-                extract(item, d->add_r_array());
+    void parse_string(std::string *out) {
+        if (*pos != '"') throw exc_t();
+        ++pos;
+        for (;;) {
+            const char *run = pos;
+            while (*pos != '"' && *pos != '\\' && *pos != '\0') ++pos;
+            out->append(run, pos - run);
+            if (*pos == '"') {
+                ++pos;
+                return;
+            } else if (*pos == '\0') {
+                throw exc_t();
+            }
+            ++pos;
+            switch (*pos) {
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u': parse_unicode_escape(out); continue;
+            case '\0': throw exc_t();
+            // Like cJSON, we take any other escaped character literally.
+            default: out->push_back(*pos); break;
             }
+            ++pos;
+        }
+    }
+
+    // Transcodes a \uXXXX escape (or a pair of them) from UTF-16 to UTF-8.  Like
+    // our cJSON, we reject NULL characters and invalid surrogates.
+    void parse_unicode_escape(std::string *out) {
+        ++pos;
+        uint32_t uc = parse_hex4();
+        if (uc == 0 || (uc >= 0xDC00 && uc <= 0xDFFF)) throw exc_t();
+        if (uc >= 0xD800 && uc <= 0xDBFF) {
+            if (pos[0] != '\\' || pos[1] != 'u') throw exc_t();
+            pos += 2;
+            uint32_t uc2 = parse_hex4();
+            if (uc2 < 0xDC00 || uc2 > 0xDFFF) throw exc_t();
+            uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+        }
+        if (uc < 0x80) {
+            out->push_back(uc);
+        } else if (uc < 0x800) {
+            out->push_back(0xC0 | (uc >> 6));
+            out->push_back(0x80 | (uc & 0x3F));
+        } else if (uc < 0x10000) {
+            out->push_back(0xE0 | (uc >> 12));
+            out->push_back(0x80 | ((uc >> 6) & 0x3F));
+            out->push_back(0x80 | (uc & 0x3F));
+        } else {
+            out->push_back(0xF0 | (uc >> 18));
+            out->push_back(0x80 | ((uc >> 12) & 0x3F));
+            out->push_back(0x80 | ((uc >> 6) & 0x3F));
+            out->push_back(0x80 | (uc & 0x3F));
         }
-        break;
-    case cJSON_Object:
-        {
-            d->set_type(Datum::R_OBJECT);
-            for (cJSON *item = json->head; item != NULL; item = item->next) {
-                Datum::AssocPair *ap = d->add_r_object();
-                ap->set_key(item->string);
-                extract(item, ap->mutable_val());
+    }
+
+    uint32_t parse_hex4() {
+        uint32_t h = 0;
+        for (int i = 0; i < 4; ++i, ++pos) {
+            h <<= 4;
+            if (*pos >= '0' && *pos <= '9') {
+                h += *pos - '0';
+            } else if (*pos >= 'A' && *pos <= 'F') {
+                h += 10 + *pos - 'A';
+            } else if (*pos >= 'a' && *pos <= 'f') {
+                h += 10 + *pos - 'a';
+            } else {
+                throw exc_t();
             }
         }
-        break;
-    default:
-        unreachable();
+        return h;
     }
-}
 
-template<>
-void extract(cJSON *json, Query::AssocPair *ap) {
-    if (json->string == NULL) throw exc_t();
-    ap->set_key(json->string);
-    extract(json, ap->mutable_val());
-}
+    // Elements past the ones we know about have always been ignored.
+    void skip_remaining_elements() {
+        while (consume(',')) {
+            skip_value();
+        }
+        expect(']');
+    }
 
-template<>
-void extract(cJSON *json, Term::AssocPair *ap) {
-    if (json->string == NULL) throw exc_t();
-    ap->set_key(json->string);
-    extract(json, ap->mutable_val());
-}
+    void skip_value() {
+        skip_whitespace();
+        switch (*pos) {
+        case '[':
+            ++pos;
+            if (consume(']')) return;
+            do {
+                skip_value();
+            } while (consume(','));
+            expect(']');
+            break;
+        case '{':
+            parse_members([this](std::string &&) { skip_value(); });
+            break;
+        default: {
+            Datum ignored;
+            parse_scalar(&ignored);
+        }
+        }
+    }
 
-template<>
-void extract(cJSON *json, Datum::AssocPair *ap) {
-    if (json->string == NULL) throw exc_t();
-    ap->set_key(json->string);
-    extract(json, ap->mutable_val());
-}
+    static void maybe_collapse_make_array(Term *t) {
+        if (t->optargs_size() != 0) return;
+        for (int i = 0; i < t->args_size(); ++i) {
+            if (t->args(i).type() != Term::DATUM) return;
+        }
+        Datum d;
+        d.set_type(Datum::R_ARRAY);
+        d.mutable_r_array()->Reserve(t->args_size());
+        for (int i = 0; i < t->args_size(); ++i) {
+            d.add_r_array()->Swap(t->mutable_args(i)->mutable_datum());
+        }
+        t->Clear();
+        t->set_type(Term::DATUM);
+        t->mutable_datum()->Swap(&d);
+        t->SetExtension(ql2::extension::collapsed_literal, true);
+    }
 
-template<>
-void extract(cJSON *json, Query *q) {
-    // It's ok to use the slow functions here, because the indexes are small
-    transfer(cJSON_slow_GetArrayItem(json, 0), q, &Query::set_type);
-    transfer(cJSON_slow_GetArrayItem(json, 1), q, &Query::mutable_query);
-    q->set_accepts_r_json(true);
-    transfer_arr(cJSON_slow_GetArrayItem(json, 2), q, &Query::add_global_optargs);
-}
+    // Objects with duplicate keys or a `$reql_type$` are left alone, so that their
+    // errors and pseudotype conversions stay the same.
+    static void maybe_collapse_make_obj(Term *t) {
+        const datum_string_t &reql_type = ql::datum_t::reql_type_string;
+        std::vector<const std::string *> keys;
+        keys.reserve(t->optargs_size());
+        for (int i = 0; i < t->optargs_size(); ++i) {
+            const Term::AssocPair &ap = t->optargs(i);
+            if (ap.val().type() != Term::DATUM) return;
+            if (ap.key().size() == reql_type.size()
+                && memcmp(ap.key().data(), reql_type.data(), reql_type.size()) == 0) {
+                return;
+            }
+            keys.push_back(&ap.key());
+        }
+        std::sort(keys.begin(), keys.end(),
+                  [](const std::string *a, const std::string *b) { return *a < *b; });
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (*keys[i - 1] == *keys[i]) return;
+        }
+
+        Datum d;
+        d.set_type(Datum::R_OBJECT);
+        d.mutable_r_object()->Reserve(t->optargs_size());
+        for (int i = 0; i < t->optargs_size(); ++i) {
+            Term::AssocPair *ap = t->mutable_optargs(i);
+            Datum::AssocPair *dap = d.add_r_object();
+            dap->mutable_key()->swap(*ap->mutable_key());
+            dap->mutable_val()->Swap(ap->mutable_val()->mutable_datum());
+        }
+        t->Clear();
+        t->set_type(Term::DATUM);
+        t->mutable_datum()->Swap(&d);
+        t->SetExtension(ql2::extension::collapsed_literal, true);
+    }
+
+    void skip_whitespace() {
+        while (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t') ++pos;
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (*pos == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) throw exc_t();
+    }
+
+    void expect_word(const char *word) {
+        const size_t len = strlen(word);
+        if (strncmp(pos, word, len) != 0) throw exc_t();
+        pos += len;
+    }
+
+    const char *pos;
+
+    DISABLE_COPYING(query_parser_t);
+};
 
 bool parse_json_pb(Query *q, int64_t token, const char *str) THROWS_NOTHING {
     try {
         q->Clear();
         q->set_token(token);
-        scoped_cJSON_t json_holder(cJSON_Parse(str));
-        cJSON *json = json_holder.get();
-        if (json == NULL) return false;
-        extract(json, q);
+        query_parser_t parser(str);
+        parser.parse_query(q);
         return true;
     } catch (const exc_t &) {
         // This happens if the user provides bad JSON.  TODO: Give the user a
@@ -203,7 +413,17 @@ bool parse_json_pb(Query *q, int64_t token, const char *str) THROWS_NOTHING {
 }
 
 void write_json_pb(const Response &r, std::string *s) THROWS_NOTHING {
+    const size_t start = s->size();
     try {
+        size_t size_estimate = 64;
+        for (int i = 0; i < r.response_size(); ++i) {
+            size_estimate += r.response(i).r_str().size() + 1;
+        }
+        if (r.has_profile()) {
+            size_estimate += r.profile().r_str().size();
+        }
+        s->reserve(start + size_estimate);
+
         *s += strprintf("{\"t\":%d,\"r\":[", r.type());
         for (int i = 0; i < r.response_size(); ++i) {
             *s += (i == 0) ? "" : ",";
@@ -211,8 +431,7 @@ void write_json_pb(const Response &r, std::string *s) THROWS_NOTHING {
             if (d->type() == Datum::R_JSON) {
                 *s += d->r_str();
             } else if (d->type() == Datum::R_STR) {
-                scoped_cJSON_t tmp(cJSON_CreateString(d->r_str().c_str()));
-                *s += tmp.PrintUnformatted();
+                json_append_string(d->r_str().data(), d->r_str().size(), s);
             } else {
                 unreachable();
             }
@@ -220,23 +439,23 @@ void write_json_pb(const Response &r, std::string *s) THROWS_NOTHING {
         *s += "]";
 
         if (r.has_backtrace()) {
-            *s += ",\"b\":";
+            *s += ",\"b\":[";
             const Backtrace *bt = &r.backtrace();
-            scoped_cJSON_t arr(cJSON_CreateArray());
             for (int i = 0; i < bt->frames_size(); ++i) {
+                *s += (i == 0) ? "" : ",";
                 const Frame *f = &bt->frames(i);
                 switch (f->type()) {
                 case Frame::POS:
-                    arr.AddItemToArray(cJSON_CreateNumber(f->pos()));
+                    json_append_number(f->pos(), s);
                     break;
                 case Frame::OPT:
-                    arr.AddItemToArray(cJSON_CreateString(f->opt().c_str()));
+                    json_append_string(f->opt().data(), f->opt().size(), s);
                     break;
                 default:
                     unreachable();
                 }
             }
-            *s += arr.PrintUnformatted();
+            *s += "]";
         }
 
         if (r.has_profile()) {
@@ -251,9 +470,10 @@ void write_json_pb(const Response &r, std::string *s) THROWS_NOTHING {
 #ifndef NDEBUG
         throw;
 #else
-        *s = strprintf("{\"t\":%d,\"r\":[\"%s\"]}",
-                       Response::RUNTIME_ERROR,
-                       "Internal error in `write_json_pb`, please report this.");
+        s->resize(start);
+        *s += strprintf("{\"t\":%d,\"r\":[\"%s\"]}",
+                        Response::RUNTIME_ERROR,
+                        "Internal error in `write_json_pb`, please report this.");
 #endif // NDEBUG
     }
 }
@@ -12,6 +12,7 @@ class scoped_array_t;
 
 namespace json_shim {
 MUST_USE bool parse_json_pb(Query *q, int64_t token, const char *str) THROWS_NOTHING;
+// Appends the JSON for `r` to `out`.
 void write_json_pb(const Response &r, std::string *out) THROWS_NOTHING;
 }  // namespace json_shim
 
@@ -1,8 +1,12 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "protob/protob.hpp"
 
+#include <inttypes.h>
+
 #include <google/protobuf/stubs/common.h>
 
+#include <exception>
+#include <map>
 #include <set>
 #include <string>
 #include <limits>
@@ -14,8 +18,15 @@
 #include "arch/io/network.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "concurrency/new_semaphore.hpp"
+#include "concurrency/wait_any.hpp"
+#include "concurrency/watchable.hpp"
 #include "containers/auth_key.hpp"
+#include "protob/datum_shim.hpp"
 #include "protob/json_shim.hpp"
+#include "protob/response_coalescer.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rpc/semilattice/joins/vclock.hpp"
 #include "rpc/semilattice/view.hpp"
@@ -35,10 +46,16 @@ private:
 
 const uint32_t MAX_QUERY_SIZE = 64 * MEGABYTE;
 const size_t MAX_RESPONSE_SIZE = std::numeric_limits<uint32_t>::max();
+const int64_t MAX_CONCURRENT_QUERIES_PER_CONNECTION = 1024;
 
-class json_protocol_t {
+// Queries in the JSON-based protocols are the token, the size and the JSON of the
+// query.  Responses are the token, the size and a payload rendered by
+// `write_payload`, which is what sets the protocols apart.
+template <class protocol_t>
+class json_framing_t {
 public:
     static bool parse_query(tcp_conn_t *conn,
+                            response_coalescer_t *responses,
                             signal_t *interruptor,
                             query_handler_t *handler,
                             ql::protob_t<Query> *query_out) {
@@ -52,7 +69,7 @@ public:
             handler->unparseable_query(token, &error_response,
                                        strprintf("Payload size (%" PRIu32 ") greater than maximum (%" PRIu32 ").",
                                                  size, MAX_QUERY_SIZE));
-            send_response(error_response, handler, conn, interruptor);
+            send_response(error_response, handler, responses, interruptor);
             throw tcp_conn_read_closed_exc_t();
         } else {
             scoped_array_t<char> data(size + 1);
@@ -63,7 +80,7 @@ public:
                 Response error_response;
                 handler->unparseable_query(token, &error_response,
                                            "Client is buggy (failed to deserialize query).");
-                send_response(error_response, handler, conn, interruptor);
+                send_response(error_response, handler, responses, interruptor);
                 return false;
             }
         }
@@ -72,32 +89,75 @@ public:
 
     static void send_response(const Response &response,
                               query_handler_t *handler,
-                              tcp_conn_t *conn,
+                              response_coalescer_t *responses,
                               signal_t *interruptor) {
-        int64_t token = response.token();
-        uint32_t size;
-        std::string str;
-
-        json_shim::write_json_pb(response, &str);
-        if (str.size() > MAX_RESPONSE_SIZE) {
+        std::string message;
+        if (!serialize_response(response, &message)) {
             Response error_response;
-            handler->unparseable_query(token, &error_response,
+            handler->unparseable_query(response.token(), &error_response,
                 strprintf("Response size (%zu) is greater than maximum (%zu).",
-                          str.size(), MAX_RESPONSE_SIZE));
-            send_response(error_response, handler, conn, interruptor);
-            return;
+                          message.size() - sizeof(int64_t) - sizeof(uint32_t),
+                          MAX_RESPONSE_SIZE));
+            message.clear();
+            bool res = serialize_response(error_response, &message);
+            guarantee(res);
+        }
+        responses->send(std::move(message), interruptor);
+    }
+
+private:
+    // Appends the token, the size and the payload of `response` to `message_out`.
+    // The payload is rendered in place, and the size filled in afterwards.
+    static bool serialize_response(const Response &response, std::string *message_out) {
+        int64_t token = response.token();
+        message_out->append(reinterpret_cast<const char *>(&token), sizeof(token));
+        const size_t size_offset = message_out->size();
+        message_out->append(sizeof(uint32_t), '\0');
+
+        protocol_t::write_payload(response, message_out);
+        const size_t size = message_out->size() - size_offset - sizeof(uint32_t);
+        if (size > MAX_RESPONSE_SIZE) {
+            return false;
+        }
+        const uint32_t size32 = size;
+        memcpy(&(*message_out)[size_offset], &size32, sizeof(size32));
+        return true;
+    }
+};
+
+class json_protocol_t : public json_framing_t<json_protocol_t> {
+public:
+    static void write_payload(const Response &response, std::string *out) {
+        json_shim::write_json_pb(response, out);
+    }
+};
+
+// Like the JSON protocol, except that result datums are sent in the binary datum
+// format, which saves us (and the client) the conversion to and from JSON.
+class binary_datum_protocol_t : public json_framing_t<binary_datum_protocol_t> {
+public:
+    static bool parse_query(tcp_conn_t *conn,
+                            response_coalescer_t *responses,
+                            signal_t *interruptor,
+                            query_handler_t *handler,
+                            ql::protob_t<Query> *query_out) {
+        if (!json_framing_t<binary_datum_protocol_t>::parse_query(
+                conn, responses, interruptor, handler, query_out)) {
+            return false;
         }
-        size = str.size();
+        query_out->get()->set_accepts_r_serialized(true);
+        return true;
+    }
 
-        conn->write(&token, sizeof(token), interruptor);
-        conn->write(&size, sizeof(size), interruptor);
-        conn->write(str.data(), size, interruptor);
+    static void write_payload(const Response &response, std::string *out) {
+        datum_shim::write_datum_pb(response, out);
     }
 };
 
 class protobuf_protocol_t {
 public:
     static bool parse_query(tcp_conn_t *conn,
+                            response_coalescer_t *responses,
                             signal_t *interruptor,
                             query_handler_t *handler,
                             ql::protob_t<Query> *query_out) {
@@ -109,7 +169,7 @@ public:
             handler->unparseable_query(0, &error_response,
                                        strprintf("Payload size (%" PRIu32 ") greater than maximum (%" PRIu32 ").",
                                                  size, MAX_QUERY_SIZE));
-            send_response(error_response, handler, conn, interruptor);
+            send_response(error_response, handler, responses, interruptor);
             return false;
         } else {
             scoped_array_t<char> data(size);
@@ -120,7 +180,7 @@ public:
                 int64_t token = query_out->get()->has_token() ? query_out->get()->token() : 0;
                 handler->unparseable_query(token, &error_response,
                                            "Client is buggy (failed to deserialize query).");
-                send_response(error_response, handler, conn, interruptor);
+                send_response(error_response, handler, responses, interruptor);
                 return false;
             }
         }
@@ -129,26 +189,21 @@ public:
 
     static void send_response(const Response &response,
                               query_handler_t *handler,
-                              tcp_conn_t *conn,
+                              response_coalescer_t *responses,
                               signal_t *interruptor) {
-        scoped_array_t<char> scoped_array;
-        const char *data;
-        uint32_t size;
-
         if (static_cast<uint64_t>(response.ByteSize()) > MAX_RESPONSE_SIZE) {
             Response error_response;
             handler->unparseable_query(response.token(), &error_response,
                 strprintf("Response size (%d) is greater than maximum (%zu).",
                           response.ByteSize(), MAX_RESPONSE_SIZE));
-            send_response(error_response, handler, conn, interruptor);
+            send_response(error_response, handler, responses, interruptor);
             return;
         }
-        size = response.ByteSize();
-        scoped_array.init(size);
-        response.SerializeToArray(scoped_array.data(), size);
-        data = scoped_array.data();
-        conn->write(&size, sizeof(size), interruptor);
-        conn->write(data, size, interruptor);
+        uint32_t size = response.ByteSize();
+        std::string message(sizeof(size) + size, '\0');
+        memcpy(&message[0], &size, sizeof(size));
+        response.SerializeToArray(&message[sizeof(size)], size);
+        responses->send(std::move(message), interruptor);
     }
 };
 
@@ -162,7 +217,7 @@ query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
         auth_metadata(_auth_metadata),
         shutting_down_conds(),
         pulse_sdc_on_shutdown(&main_shutting_down_cond),
-        next_thread(0)
+        load_balancer(&rdb_ctx->ql_stats_collection)
 {
     rassert(rdb_ctx != NULL);
     for (int i = 0; i < get_num_threads(); ++i) {
@@ -217,29 +272,45 @@ auth_key_t query_server_t::read_auth_key(tcp_conn_t *conn,
     return ret;
 }
 
+int64_t query_server_t::read_response_delay(tcp_conn_t *conn, signal_t *interruptor) {
+    int32_t response_delay;
+    conn->read(&response_delay, sizeof(response_delay), interruptor);
+    if (response_delay < 0 || response_delay > MAX_RESPONSE_DELAY_US) {
+        throw protob_server_exc_t(
+            strprintf("Client asked for a response delay of %" PRIi32 " microseconds, "
+                      "it must be between 0 and %" PRIi64 ".",
+                      response_delay, MAX_RESPONSE_DELAY_US));
+    }
+    return response_delay;
+}
+
 void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                                  auto_drainer_t::lock_t keepalive) {
     // This must be read here because of home threads and stuff
     const vclock_t<auth_key_t> auth_vclock = auth_metadata->get().auth_key;
 
-    threadnum_t chosen_thread = threadnum_t(next_thread);
-    next_thread = (next_thread + 1) % get_num_db_threads();
+    threadnum_t chosen_thread = load_balancer.choose_thread();
 
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
+    query_load_balancer_t::connection_t connection_load(&load_balancer);
 
     scoped_ptr_t<tcp_conn_t> conn;
     nconn->make_overcomplicated(&conn);
     conn->enable_keepalive();
 
+    wait_any_t server_interruptor(shutdown_signal(), &ct_keepalive);
 #ifdef __linux
     linux_event_watcher_t *ew = conn->get_event_watcher();
     linux_event_watcher_t::watch_t conn_interrupted(ew, poll_event_rdhup);
-    wait_any_t interruptor(&conn_interrupted, shutdown_signal(), &ct_keepalive);
 #else
-    wait_any_t interruptor(shutdown_signal(), &ct_keepalive);
+    cond_t conn_interrupted;
 #endif  // __linux
-    client_context_t client_ctx(rdb_ctx, ql::reject_cfeeds_t::NO, &interruptor);
+    wait_any_t interruptor(&conn_interrupted, &server_interruptor);
+    // The `noreply` queries aren't interrupted when the client closes its end of the
+    // connection, since it relies on them finishing.  `connection_loop` interrupts
+    // the others itself.
+    client_context_t client_ctx(rdb_ctx, ql::reject_cfeeds_t::NO, &server_interruptor);
 
     std::string init_error;
 
@@ -260,7 +331,8 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                     "Authorization required but client does not support it.");
             }
         } else if (client_magic_number == VersionDummy::V0_2 ||
-                   client_magic_number == VersionDummy::V0_3) {
+                   client_magic_number == VersionDummy::V0_3 ||
+                   client_magic_number == VersionDummy::V0_4) {
             auth_key_t provided_auth = read_auth_key(conn.get(), &interruptor);
             if (!timing_sensitive_equals(provided_auth, auth_vclock.get())) {
                 throw protob_server_exc_t("Incorrect authorization key.");
@@ -273,16 +345,29 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                                       "client driver version not match the server?");
         }
 
-        // With version 0_3, the client driver specifies which protocol to use
+        // With version 0_3 and up, the client driver specifies which protocol to use
         int32_t wire_protocol = VersionDummy::PROTOBUF;
-        if (client_magic_number == VersionDummy::V0_3) {
+        if (client_magic_number == VersionDummy::V0_3 ||
+            client_magic_number == VersionDummy::V0_4) {
             conn->read(&wire_protocol, sizeof(wire_protocol), &interruptor);
         }
 
+        // With version 0_4, the client driver also says how long its responses may
+        // wait to be written together
+        int64_t response_delay_us = DEFAULT_RESPONSE_DELAY_US;
+        if (client_magic_number == VersionDummy::V0_4) {
+            response_delay_us = read_response_delay(conn.get(), &interruptor);
+        }
+
         if (wire_protocol == VersionDummy::JSON) {
-            connection_loop<json_protocol_t>(conn.get(), &client_ctx);
+            connection_loop<json_protocol_t>(conn.get(), response_delay_us,
+                                             &conn_interrupted, &client_ctx);
+        } else if (wire_protocol == VersionDummy::BINARY_DATUM) {
+            connection_loop<binary_datum_protocol_t>(conn.get(), response_delay_us,
+                                                     &conn_interrupted, &client_ctx);
         } else if (wire_protocol == VersionDummy::PROTOBUF) {
-            connection_loop<protobuf_protocol_t>(conn.get(), &client_ctx);
+            connection_loop<protobuf_protocol_t>(conn.get(), response_delay_us,
+                                                 &conn_interrupted, &client_ctx);
         } else {
             throw protob_server_exc_t(strprintf("Unrecognized protocol specified: '%d'",
                                                 wire_protocol));
@@ -306,24 +391,10 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 }
 
-template <class protocol_t>
-void query_server_t::connection_loop(tcp_conn_t *conn,
-                                     client_context_t *client_ctx) {
-    for (;;) {
-        ql::protob_t<Query> query(ql::make_counted_query());
-
-        if (protocol_t::parse_query(conn, client_ctx->interruptor, handler, &query)) {
-            Response response;
-            if (handler->run_query(query, &response, client_ctx)) {
-                protocol_t::send_response(response, handler, conn, client_ctx->interruptor);
-            }
-        }
-    }
-}
-
 // Used in protob_server_t::handle(...) below to combine the interruptor from the
 // http_conn_cache_t with the interruptor from the http_server_t in an exception-safe
-// manner, and return it to how it was once handle(...) is complete.
+// manner, and return it to how it was once handle(...) is complete.  Also used by
+// query_dispatcher_t to interrupt the queries running on a connection.
 class interruptor_mixer_t {
 public:
     interruptor_mixer_t(client_context_t *_client_ctx, signal_t *new_interruptor) :
@@ -343,6 +414,246 @@ private:
     wait_any_t combined_interruptor;
 };
 
+// Runs the queries received on one client connection.  Every query runs in its own
+// coroutine and its response is sent as soon as it's ready, so a slow query or a
+// changefeed waiting for changes doesn't hold up the other queries on the
+// connection.  Clients that send one query at a time see no difference, and to keep
+// it that way for pipelining clients, queries with the same token still run one at a
+// time in the order they were received.  The exception is `STOP`, which would
+// otherwise wait for the `CONTINUE` it's meant to cancel.  Clients can't tell when a
+// `noreply` query is done, so they rely on it having run before whatever they send
+// next: a query doesn't start until all the `noreply` queries received before it are
+// done.  That also keeps `noreply` writes in order, and makes `NOREPLY_WAIT` wait
+// for them.  For the same reason, when the client closes its end of the connection,
+// only the queries whose responses nobody will read are interrupted.
+template <class protocol_t>
+class query_dispatcher_t {
+public:
+    query_dispatcher_t(tcp_conn_t *_conn,
+                       client_context_t *_client_ctx,
+                       query_handler_t *_handler,
+                       query_load_balancer_t *_load_balancer,
+                       int64_t response_delay_us,
+                       signal_t *client_closed)
+        : conn(_conn),
+          client_ctx(_client_ctx),
+          handler(_handler),
+          load_balancer(_load_balancer),
+          interruptor_mixer(client_ctx, &stop_queries),
+          reply_interruptor(client_ctx->interruptor, client_closed, &replies_unwanted),
+          responses(conn, response_delay_us),
+          running_queries(MAX_CONCURRENT_QUERIES_PER_CONNECTION),
+          noreply_dispatched(0),
+          noreply_finished(0) { }
+
+    // Waits for the queries that are queued or running to finish.  Call `stop()` or
+    // `stop_replies()` first to interrupt them instead.
+    ~query_dispatcher_t() { }
+
+    // Interrupts the queries that are queued or running.
+    void stop() {
+        stop_queries.pulse_if_not_already_pulsed();
+    }
+
+    // Interrupts the queries that are queued or running, except for the `noreply`
+    // ones.
+    void stop_replies() {
+        replies_unwanted.pulse_if_not_already_pulsed();
+    }
+
+    response_coalescer_t *get_responses() {
+        return &responses;
+    }
+
+    // Starts running `query`, unless too many queries are running on the connection
+    // already, in which case it blocks until one of them finishes.
+    void dispatch(const ql::protob_t<Query> &query) {
+        scoped_ptr_t<slot_t> slot(new slot_t(&running_queries));
+        wait_interruptible(slot->running.acquisition_signal(), client_ctx->interruptor);
+
+        slot->noreply_before = noreply_dispatched;
+        slot->is_noreply = is_noreply(query);
+        if (slot->is_noreply) {
+            ++noreply_dispatched;
+        }
+
+        // Getting in line here, rather than in the coroutine, is what makes queries
+        // with the same token run in the order they were received.
+        slot->token = query->token();
+        if (query->type() != Query::STOP) {
+            scoped_ptr_t<token_queue_t> &queue = token_queues[slot->token];
+            if (!queue.has()) {
+                queue.init(new token_queue_t());
+            }
+            ++queue->num_queries;
+            slot->token_line.init(new new_mutex_in_line_t(&queue->mutex));
+        }
+
+        coro_t::spawn_sometime(std::bind(&query_dispatcher_t::run_query,
+                                         this,
+                                         query,
+                                         slot.release(),
+                                         auto_drainer_t::lock_t(&drainer)));
+    }
+
+private:
+    // The resources a single query holds while it's queued or running.
+    class slot_t {
+    public:
+        explicit slot_t(new_semaphore_t *running_queries)
+            : running(running_queries, 1),
+              noreply_before(0),
+              is_noreply(false),
+              token(0) { }
+        new_semaphore_acq_t running;
+        // How many `noreply` queries were received before this one.
+        uint64_t noreply_before;
+        bool is_noreply;
+        int64_t token;
+        scoped_ptr_t<new_mutex_in_line_t> token_line;
+    private:
+        DISABLE_COPYING(slot_t);
+    };
+
+    class token_queue_t {
+    public:
+        token_queue_t() : num_queries(0) { }
+        new_mutex_t mutex;
+        int64_t num_queries;
+    private:
+        DISABLE_COPYING(token_queue_t);
+    };
+
+    static bool is_noreply(const ql::protob_t<Query> &query) {
+        ql::datum_t noreply = static_optarg("noreply", query);
+        return noreply.has() &&
+            noreply.get_type() == ql::datum_t::type_t::R_BOOL &&
+            noreply.as_bool();
+    }
+
+    void run_query(const ql::protob_t<Query> &query,
+                   slot_t *raw_slot,
+                   auto_drainer_t::lock_t) {
+        scoped_ptr_t<slot_t> slot(raw_slot);
+        const bool in_line = slot->token_line.has();
+        signal_t *const interruptor = slot->is_noreply
+            ? client_ctx->interruptor
+            : &reply_interruptor;
+        try {
+            const uint64_t noreply_before = slot->noreply_before;
+            noreply_finished.get_watchable()->run_until_satisfied(
+                [noreply_before](uint64_t finished) {
+                    return finished >= noreply_before;
+                },
+                interruptor);
+            if (in_line) {
+                wait_interruptible(slot->token_line->acq_signal(), interruptor);
+            }
+            Response response;
+            bool response_needed;
+            {
+                query_load_balancer_t::query_t query_load(load_balancer);
+                response_needed = handler->run_query(query, &response, client_ctx,
+                                                     interruptor);
+            }
+            if (response_needed) {
+                protocol_t::send_response(response, handler, &responses, interruptor);
+            }
+        } catch (const interrupted_exc_t &) {
+            // The connection is going away.
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            // Nobody can get the responses anymore, so there's no point in running
+            // the other queries.  This also stops `connection_loop` reading.
+            stop();
+        }
+
+        // `noreply` queries wait for the ones before them, so they finish in order.
+        if (slot->is_noreply) {
+            noreply_finished.apply_atomic_op([](uint64_t *finished) {
+                    ++*finished;
+                    return true;
+                });
+        }
+
+        if (in_line) {
+            slot->token_line.reset();
+            auto it = token_queues.find(slot->token);
+            guarantee(it != token_queues.end());
+            if (--it->second->num_queries == 0) {
+                token_queues.erase(it);
+            }
+        }
+    }
+
+    tcp_conn_t *const conn;
+    client_context_t *const client_ctx;
+    query_handler_t *const handler;
+    query_load_balancer_t *const load_balancer;
+
+    cond_t stop_queries;
+    interruptor_mixer_t interruptor_mixer;
+    // Pulsed when reading from the client hits EOF, which `client_closed` may notice
+    // sooner.  Everything but the `noreply` queries runs with `reply_interruptor`.
+    cond_t replies_unwanted;
+    wait_any_t reply_interruptor;
+
+    response_coalescer_t responses;
+    new_semaphore_t running_queries;
+    uint64_t noreply_dispatched;
+    watchable_variable_t<uint64_t> noreply_finished;
+    std::map<int64_t, scoped_ptr_t<token_queue_t> > token_queues;
+
+    // Must be destroyed first, so that the queries are done with the other fields.
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(query_dispatcher_t);
+};
+
+template <class protocol_t>
+void query_server_t::connection_loop(tcp_conn_t *conn,
+                                     int64_t response_delay_us,
+                                     signal_t *client_closed,
+                                     client_context_t *client_ctx) {
+    std::exception_ptr exc;
+    {
+        query_dispatcher_t<protocol_t> dispatcher(conn, client_ctx, handler,
+                                                  &load_balancer, response_delay_us,
+                                                  client_closed);
+        bool stop_queries = false;
+        bool stop_replies = false;
+        try {
+            for (;;) {
+                ql::protob_t<Query> query(ql::make_counted_query());
+
+                if (protocol_t::parse_query(conn, dispatcher.get_responses(),
+                                            client_ctx->interruptor, handler, &query)) {
+                    dispatcher.dispatch(query);
+                }
+            }
+        } catch (const tcp_conn_read_closed_exc_t &) {
+            // The client closed its end of the connection.  Its `noreply` queries
+            // still run, since it relies on them finishing, but nobody will read the
+            // responses to the others.  If the connection failed altogether
+            // (`POLLHUP` or `POLLERR`), the write half is closed as well and nothing
+            // is left running.  We can't wait for the queries inside the `catch`
+            // statement, since that involves switching coroutines.
+            exc = std::current_exception();
+            stop_replies = true;
+            stop_queries = !conn->is_write_open();
+        } catch (...) {
+            // We're shutting down, or we can't write responses anymore.
+            exc = std::current_exception();
+            stop_queries = true;
+        }
+        if (stop_queries) {
+            dispatcher.stop();
+        } else if (stop_replies) {
+            dispatcher.stop_replies();
+        }
+    }
+    std::rethrow_exception(exc);
+}
+
 class conn_acq_t {
 public:
     conn_acq_t() : conn(NULL) { }
@@ -449,25 +760,19 @@ void query_server_t::handle(const http_req_t &req,
 
             client_context_t *client_ctx = conn->get_ctx();
             interruptor_mixer_t interruptor_mixer(client_ctx, interruptor);
-            response_needed = handler->run_query(query, &response, client_ctx);
+            response_needed = handler->run_query(query, &response, client_ctx,
+                                                 client_ctx->interruptor);
             rassert(response_needed);
         }
     }
 
-    uint32_t size;
-    std::string str;
-
-    json_shim::write_json_pb(response, &str);
-    size = str.size();
-
-    char header_buffer[sizeof(token) + sizeof(size)];
-    memcpy(&header_buffer[0], &token, sizeof(token));
-    memcpy(&header_buffer[sizeof(token)], &size, sizeof(size));
-
+    // The same framing as the JSON protocol, with the size filled in afterwards.
     std::string body_data;
-    body_data.reserve(sizeof(header_buffer) + str.length());
-    body_data.append(&header_buffer[0], sizeof(header_buffer));
-    body_data.append(str);
+    body_data.append(reinterpret_cast<const char *>(&token), sizeof(token));
+    body_data.append(sizeof(uint32_t), '\0');
+    json_shim::write_json_pb(response, &body_data);
+    const uint32_t size = body_data.size() - sizeof(token) - sizeof(uint32_t);
+    memcpy(&body_data[sizeof(token)], &size, sizeof(size));
     result->set_body("application/octet-stream", body_data);
     result->code = HTTP_OK;
 }
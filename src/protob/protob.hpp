@@ -17,6 +17,7 @@
 #include "concurrency/cross_thread_signal.hpp"
 #include "containers/archive/archive.hpp"
 #include "http/http.hpp"
+#include "protob/query_load.hpp"
 
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/counted_term.hpp"
@@ -129,9 +130,12 @@ class query_handler_t {
 public:
     virtual ~query_handler_t() { }
 
+    // Runs `query` with `interruptor` rather than `client_ctx->interruptor`, since
+    // the queries on a connection don't all get interrupted at the same time.
     virtual MUST_USE bool run_query(const ql::protob_t<Query> &query,
                                     Response *response_out,
-                                    client_context_t *client_ctx) = 0;
+                                    client_context_t *client_ctx,
+                                    signal_t *interruptor) = 0;
 
     virtual void unparseable_query(int64_t token,
                                    Response *response_out,
@@ -155,6 +159,7 @@ private:
                                          const std::string &length_error_msg,
                                          signal_t *interruptor);
     static auth_key_t read_auth_key(tcp_conn_t *conn, signal_t *interruptor);
+    static int64_t read_response_delay(tcp_conn_t *conn, signal_t *interruptor);
 
     // For the client driver socket
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
@@ -163,6 +168,8 @@ private:
     // This is templatized based on the wire protocol requested by the client
     template<class protocol_t>
     void connection_loop(tcp_conn_t *conn,
+                         int64_t response_delay_us,
+                         signal_t *client_closed,
                          client_context_t *client_ctx);
 
     // For HTTP server
@@ -195,9 +202,9 @@ private:
 
     http_conn_cache_t http_conn_cache;
 
-    scoped_ptr_t<tcp_listener_t> tcp_listener;
+    query_load_balancer_t load_balancer;
 
-    int next_thread;
+    scoped_ptr_t<tcp_listener_t> tcp_listener;
 };
 
 #endif /* PROTOB_PROTOB_HPP_ */
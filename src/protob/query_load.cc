@@ -0,0 +1,135 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "protob/query_load.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#include "arch/runtime/runtime.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// A thread whose CPU was busy all of the last interval counts as much as this many
+// running queries, and an idle connection as much as this fraction of a query.
+const double QUERIES_PER_BUSY_CPU = 4.0;
+const double QUERIES_PER_CONNECTION = 0.125;
+
+const int64_t CPU_SAMPLE_INTERVAL_MS = 100;
+
+int64_t load_counter(const int64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void add_to_counter(int64_t *counter, int64_t delta) {
+    __sync_fetch_and_add(counter, delta);
+}
+
+}  // namespace
+
+query_load_balancer_t::query_load_balancer_t(perfmon_collection_t *stats_collection)
+    : last_sample_ticks(get_ticks()),
+      next_thread(0),
+      stats(this),
+      stats_membership(stats_collection, &stats, "query_load") {
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        counts[i].value.connections = 0;
+        counts[i].value.queries = 0;
+        counts[i].value.cpu_permille = 0;
+        last_cpu_time_ns[i] = 0;
+    }
+    for (int i = 0; i < get_num_threads(); ++i) {
+        last_cpu_time_ns[i] = get_thread_load(threadnum_t(i)).cpu_time_ns;
+    }
+}
+
+threadnum_t query_load_balancer_t::choose_thread() {
+    assert_thread();
+    maybe_sample_cpu();
+
+    const int num_threads = get_num_db_threads();
+    int best = next_thread % num_threads;
+    double best_load = load_of(threadnum_t(best));
+    for (int i = 1; i < num_threads; ++i) {
+        const int candidate = (next_thread + i) % num_threads;
+        const double load = load_of(threadnum_t(candidate));
+        if (load < best_load) {
+            best = candidate;
+            best_load = load;
+        }
+    }
+    next_thread = (best + 1) % num_threads;
+    return threadnum_t(best);
+}
+
+void query_load_balancer_t::maybe_sample_cpu() {
+    const ticks_t now = get_ticks();
+    const int64_t elapsed = now - last_sample_ticks;
+    if (elapsed < CPU_SAMPLE_INTERVAL_MS * MILLION) {
+        return;
+    }
+    for (int i = 0; i < get_num_threads(); ++i) {
+        const int64_t cpu_time_ns = get_thread_load(threadnum_t(i)).cpu_time_ns;
+        const int64_t permille = std::min<int64_t>(
+            1000, (cpu_time_ns - last_cpu_time_ns[i]) * 1000 / elapsed);
+        __atomic_store_n(&counts[i].value.cpu_permille, std::max<int64_t>(0, permille),
+                         __ATOMIC_RELAXED);
+        last_cpu_time_ns[i] = cpu_time_ns;
+    }
+    last_sample_ticks = now;
+}
+
+double query_load_balancer_t::load_of(threadnum_t thread) {
+    const thread_counts_t &c = counts[thread.threadnum].value;
+    return load_counter(&c.queries)
+        + get_thread_load(thread).run_queue_depth
+        + QUERIES_PER_BUSY_CPU * load_counter(&c.cpu_permille) / 1000.0
+        + QUERIES_PER_CONNECTION * load_counter(&c.connections);
+}
+
+query_load_balancer_t::connection_t::connection_t(query_load_balancer_t *_parent)
+    : parent(_parent), thread(get_thread_id()) {
+    add_to_counter(&parent->counts[thread.threadnum].value.connections, 1);
+}
+
+query_load_balancer_t::connection_t::~connection_t() {
+    rassert(get_thread_id() == thread);
+    add_to_counter(&parent->counts[thread.threadnum].value.connections, -1);
+}
+
+query_load_balancer_t::query_t::query_t(query_load_balancer_t *_parent)
+    : parent(_parent), thread(get_thread_id()) {
+    add_to_counter(&parent->counts[thread.threadnum].value.queries, 1);
+}
+
+query_load_balancer_t::query_t::~query_t() {
+    rassert(get_thread_id() == thread);
+    add_to_counter(&parent->counts[thread.threadnum].value.queries, -1);
+}
+
+void *query_load_balancer_t::stats_t::begin_stats() {
+    return NULL;
+}
+
+void query_load_balancer_t::stats_t::visit_stats(void *) {
+    /* Do nothing; the counts can be read from any thread */
+}
+
+scoped_ptr_t<perfmon_result_t> query_load_balancer_t::stats_t::end_stats(void *) {
+    scoped_ptr_t<perfmon_result_t> result = perfmon_result_t::alloc_map_result();
+    for (int i = 0; i < get_num_db_threads(); ++i) {
+        const thread_counts_t &c = parent->counts[i].value;
+        scoped_ptr_t<perfmon_result_t> thread_result =
+            perfmon_result_t::alloc_map_result();
+        thread_result->insert("connections", new perfmon_result_t(
+            strprintf("%" PRIi64, load_counter(&c.connections))));
+        thread_result->insert("queries_running", new perfmon_result_t(
+            strprintf("%" PRIi64, load_counter(&c.queries))));
+        thread_result->insert("run_queue_depth", new perfmon_result_t(
+            strprintf("%" PRIi64, get_thread_load(threadnum_t(i)).run_queue_depth)));
+        thread_result->insert("cpu_utilization", new perfmon_result_t(
+            strprintf("%.3f", load_counter(&c.cpu_permille) / 1000.0)));
+        result->insert(strprintf("thread_%d", i), thread_result.release());
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef PROTOB_QUERY_LOAD_HPP_
+#define PROTOB_QUERY_LOAD_HPP_
+
+#include <stdint.h>
+
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+/* `query_load_balancer_t` decides which thread a new client connection goes to.  A
+connection's queries all run on its thread, so handing connections out round-robin
+lets a few heavy connections keep some threads busy while others sit idle.  Instead
+we put every new connection on the thread with the least load, where the load counts
+the queries already running on the thread, the messages waiting in its queue, how
+much CPU it has been using lately and, to spread out idle connections, the
+connections it already has.
+
+Only new connections are balanced: a running query, or an open cursor, stays on its
+connection's thread until it's done.  Moving one between batches would mean moving
+everything it is tied to along with it: the connection's socket and event watcher, its
+interruptor, its stream cache, and the home threads of the query's streams and
+environment.  A connection whose thread gets busy later keeps running there.
+
+The per-thread numbers also show up in the stats, under `query_load`. */
+class query_load_balancer_t : public home_thread_mixin_t {
+public:
+    explicit query_load_balancer_t(perfmon_collection_t *stats);
+
+    // Picks the thread for a new connection.  Only considers the db threads.
+    threadnum_t choose_thread();
+
+    // Counts a connection, or a running query, against the thread it's constructed
+    // on.  Must be destroyed on the same thread.
+    class connection_t {
+    public:
+        explicit connection_t(query_load_balancer_t *parent);
+        ~connection_t();
+    private:
+        query_load_balancer_t *parent;
+        threadnum_t thread;
+        DISABLE_COPYING(connection_t);
+    };
+
+    class query_t {
+    public:
+        explicit query_t(query_load_balancer_t *parent);
+        ~query_t();
+    private:
+        query_load_balancer_t *parent;
+        threadnum_t thread;
+        DISABLE_COPYING(query_t);
+    };
+
+private:
+    // Recomputes `cpu_permille` if the last sample is old enough.
+    void maybe_sample_cpu();
+    double load_of(threadnum_t thread);
+
+    class stats_t : public perfmon_t {
+    public:
+        explicit stats_t(query_load_balancer_t *_parent) : parent(_parent) { }
+        void *begin_stats();
+        void visit_stats(void *);
+        scoped_ptr_t<perfmon_result_t> end_stats(void *);
+    private:
+        query_load_balancer_t *parent;
+    };
+
+    // Each thread only changes its own entry, but `choose_thread()` and the stats
+    // read all of them.
+    struct thread_counts_t {
+        int64_t connections;
+        int64_t queries;
+        // The share of the last sampling interval the thread spent on a CPU.
+        int64_t cpu_permille;
+    };
+    cache_line_padded_t<thread_counts_t> counts[MAX_THREADS];
+
+    int64_t last_cpu_time_ns[MAX_THREADS];
+    ticks_t last_sample_ticks;
+
+    // Where `choose_thread()` starts looking, so that ties go round-robin.
+    int next_thread;
+
+    stats_t stats;
+    perfmon_membership_t stats_membership;
+
+    DISABLE_COPYING(query_load_balancer_t);
+};
+
+#endif  // PROTOB_QUERY_LOAD_HPP_
@@ -0,0 +1,74 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "protob/response_coalescer.hpp"
+
+#include <functional>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/interruptor.hpp"
+
+namespace {
+
+// Once this much is waiting, there's nothing to gain from waiting for more.
+const size_t MAX_BATCH_SIZE = 64 * KILOBYTE;
+
+}  // namespace
+
+response_coalescer_t::response_coalescer_t(tcp_conn_t *_conn, int64_t _delay_us)
+    : conn(_conn), delay_us(_delay_us), writing(false) { }
+
+void response_coalescer_t::send(std::string &&message, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, tcp_conn_write_closed_exc_t) {
+    assert_thread();
+    if (!pending.has()) {
+        pending = make_counted<batch_t>();
+    }
+    counted_t<batch_t> batch = pending;
+    batch->size += message.size();
+    batch->messages.push_back(std::move(message));
+
+    // Only one coroutine may write to `conn` at a time.
+    if (!writing) {
+        writing = true;
+        coro_t::spawn_sometime(std::bind(&response_coalescer_t::write_batches,
+                                         this,
+                                         auto_drainer_t::lock_t(&drainer)));
+    }
+
+    wait_interruptible(&batch->done, interruptor);
+    if (batch->write_closed) {
+        throw tcp_conn_write_closed_exc_t();
+    }
+}
+
+void response_coalescer_t::write_batches(auto_drainer_t::lock_t keepalive) {
+    while (pending.has()) {
+        wait_for_more(pending.get());
+        counted_t<batch_t> batch;
+        batch.swap(pending);
+
+        std::vector<iovec> iov(batch->messages.size());
+        for (size_t i = 0; i < batch->messages.size(); ++i) {
+            iov[i].iov_base = const_cast<char *>(batch->messages[i].data());
+            iov[i].iov_len = batch->messages[i].size();
+        }
+        try {
+            conn->writev(iov.data(), iov.size(), keepalive.get_drain_signal());
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            batch->write_closed = true;
+        }
+        batch->done.pulse();
+    }
+    writing = false;
+}
+
+void response_coalescer_t::wait_for_more(const batch_t *batch) {
+    const ticks_t deadline = batch->started + delay_us * THOUSAND;
+    size_t num_messages;
+    do {
+        // Lets the coroutines that are ready to run before us add their responses.
+        num_messages = batch->messages.size();
+        coro_t::yield();
+    } while (batch->messages.size() > num_messages
+             && batch->size < MAX_BATCH_SIZE
+             && get_ticks() < deadline);
+}
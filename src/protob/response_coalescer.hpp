@@ -0,0 +1,67 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef PROTOB_RESPONSE_COALESCER_HPP_
+#define PROTOB_RESPONSE_COALESCER_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/counted.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+// How long, in microseconds, responses may wait for each other on connections whose
+// client doesn't say, and the most that a client may ask for.
+const int64_t DEFAULT_RESPONSE_DELAY_US = 50;
+const int64_t MAX_RESPONSE_DELAY_US = 100000;
+
+/* `response_coalescer_t` writes the responses to the queries on one client
+connection.  When a client keeps many small queries running at once, writing every
+response with its own system call costs more than running the queries, so responses
+that are ready at about the same time are written together, with a single
+`writev()`.
+
+A response always waits for the other queries that are ready to run on the thread to
+get a chance to finish.  After that it waits for more of them for at most `delay_us`
+microseconds, and only as long as new responses keep arriving, so a client sending
+one query at a time doesn't wait at all. */
+class response_coalescer_t : public home_thread_mixin_t {
+public:
+    response_coalescer_t(tcp_conn_t *conn, int64_t delay_us);
+
+    // Blocks until `message` has been written.  If `interruptor` is pulsed, `message`
+    // may still be written, but as a whole.
+    void send(std::string &&message, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, tcp_conn_write_closed_exc_t);
+
+private:
+    class batch_t : public single_threaded_countable_t<batch_t> {
+    public:
+        batch_t() : started(get_ticks()), size(0), write_closed(false) { }
+        const ticks_t started;
+        std::vector<std::string> messages;
+        size_t size;
+        bool write_closed;
+        cond_t done;
+    };
+
+    void write_batches(auto_drainer_t::lock_t keepalive);
+    void wait_for_more(const batch_t *batch);
+
+    tcp_conn_t *const conn;
+    const int64_t delay_us;
+
+    // The responses waiting for the next write.
+    counted_t<batch_t> pending;
+    bool writing;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(response_coalescer_t);
+};
+
+#endif  // PROTOB_RESPONSE_COALESCER_HPP_
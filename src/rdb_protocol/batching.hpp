@@ -42,7 +42,9 @@ public:
         seen_one_el = true;
         els_left -= 1;
         min_els_left -= 1;
-        size_left -= serialized_size<cluster_version_t::CLUSTER>(t);
+        // Documents remember their size, so this doesn't make us walk through
+        // every large document once per batch.
+        size_left -= datum_serialized_size(t);
         return should_send_batch();
     }
     bool should_send_batch() const;
@@ -258,7 +258,7 @@ void store_t::receive_backfill(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
-    with_priority_t p(CORO_PRIORITY_BACKFILL_RECEIVER);
+    with_sched_class_t sched_class(sched_class_t::BACKGROUND);
 
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
@@ -336,7 +336,7 @@ void store_t::reset_data(
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
-    with_priority_t p(CORO_PRIORITY_RESET_DATA);
+    with_sched_class_t sched_class(sched_class_t::BACKGROUND);
 
     // Check if secondary indexes should be dropped - if the store is not hosting data
     // for any ranges.
@@ -891,6 +891,7 @@ public:
 class range_sub_t;
 class point_sub_t;
 class limit_sub_t;
+class listener_sub_t;
 
 class feed_t : public home_thread_mixin_t, public slow_atomic_countable_t<feed_t> {
 public:
@@ -911,6 +912,10 @@ public:
     void add_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
     void del_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
 
+    // Returns false if the feed has already been stopped.
+    bool add_listener_sub(listener_sub_t *sub) THROWS_NOTHING;
+    void del_listener_sub(listener_sub_t *sub) THROWS_NOTHING;
+
     void each_range_sub(const std::function<void(range_sub_t *)> &f) THROWS_NOTHING;
     void each_point_sub(const std::function<void(point_sub_t *)> &f) THROWS_NOTHING;
     void each_sub(const std::function<void(flat_sub_t *)> &f) THROWS_NOTHING;
@@ -918,7 +923,9 @@ public:
         datum_t key, const std::function<void(point_sub_t *)> &f) THROWS_NOTHING;
     void on_limit_sub(
         const uuid_u &uuid, const std::function<void(limit_sub_t *)> &f) THROWS_NOTHING;
-
+    void each_listener_sub(
+        const std::function<void(listener_sub_t *)> &f) THROWS_NOTHING;
+    void stop_listener_subs(detach_t detach) THROWS_NOTHING;
 
     bool can_be_removed();
     client_t::addr_t get_addr() const;
@@ -978,8 +985,14 @@ private:
     std::map<uuid_u, std::vector<std::set<limit_sub_t *> > > limit_subs;
     rwlock_t limit_subs_lock;
 
+    std::vector<std::set<listener_sub_t *> > listener_subs;
+    rwlock_t listener_subs_lock;
+
     int64_t num_subs;
     bool detached;
+    // Set once the servers tell us they've stopped, so that new listeners don't
+    // wait for changes that will never come.
+    bool stopped;
     auto_drainer_t drainer;
 };
 
@@ -1113,6 +1126,49 @@ private:
     keyspec_t::range_t spec;
 };
 
+// Tells a `key_listener_t` about every change.  Listeners never read from the
+// subscription the way streams do, so there are never any elements.
+class listener_sub_t : public subscription_t {
+public:
+    listener_sub_t(feed_t *feed, key_listener_t *_listener)
+        : subscription_t(feed), listener(_listener), stopped(false) {
+        live = feed->add_listener_sub(this);
+    }
+    virtual ~listener_sub_t() {
+        destructor_cleanup(std::bind(&feed_t::del_listener_sub, feed, this));
+    }
+    virtual void start(env_t *, std::string, namespace_interface_t *,
+                       client_t::addr_t *) {
+        // We don't need start stamps because hearing about a change from before
+        // we subscribed is harmless.
+    }
+    bool is_live() const { return live; }
+    void note_change(const datum_t &pkey) {
+        assert_thread();
+        if (!stopped) {
+            listener->on_change(pkey);
+        }
+    }
+    void stop_listener(detach_t detach) {
+        assert_thread();
+        stop(std::make_exception_ptr(
+                 datum_exc_t(base_exc_t::GENERIC,
+                             "Changefeed aborted (table unavailable).")),
+             detach);
+        if (!stopped) {
+            stopped = true;
+            listener->on_stop();
+        }
+    }
+private:
+    virtual bool has_el() { return false; }
+    virtual datum_t pop_el() { unreachable(); }
+
+    key_listener_t *listener;
+    bool live;
+    bool stopped;
+};
+
 class limit_sub_t : public subscription_t {
 public:
     // Throws QL exceptions.
@@ -1408,6 +1464,8 @@ public:
                       stamp,
                       new_val,
                       default_limits));
+        feed->each_listener_sub(
+            std::bind(&listener_sub_t::note_change, ph::_1, std::cref(pkey_val)));
     }
     void operator()(const msg_t::stop_t &) const {
         const char *msg = "Changefeed aborted (table unavailable).";
@@ -1416,6 +1474,7 @@ public:
                                  std::make_exception_ptr(
                                      datum_exc_t(base_exc_t::GENERIC, msg)),
                                  detach_t::NO));
+        feed->stop_listener_subs(detach_t::NO);
     }
 private:
     feed_t *feed;
@@ -1684,6 +1743,36 @@ void feed_t::each_sub_in_vec_cb(const std::function<void(Sub *)> &f,
     }
 }
 
+// If this throws we might leak the increment to `num_subs`.
+bool feed_t::add_listener_sub(listener_sub_t *sub) THROWS_NOTHING {
+    bool live;
+    add_sub_with_lock(&listener_subs_lock, [this, sub, &live]() {
+            listener_subs[sub->home_thread().threadnum].insert(sub);
+            live = !stopped;
+        });
+    return live;
+}
+
+// Can't throw because it's called in a destructor.
+void feed_t::del_listener_sub(listener_sub_t *sub) THROWS_NOTHING {
+    del_sub_with_lock(&listener_subs_lock, [this, sub]() {
+            return listener_subs[sub->home_thread().threadnum].erase(sub);
+        });
+}
+
+void feed_t::each_listener_sub(
+    const std::function<void(listener_sub_t *)> &f) THROWS_NOTHING {
+    assert_thread();
+    rwlock_in_line_t spot(&listener_subs_lock, access_t::read);
+    each_sub_in_vec(listener_subs, &spot, f);
+}
+
+void feed_t::stop_listener_subs(detach_t detach) THROWS_NOTHING {
+    assert_thread();
+    stopped = true;
+    each_listener_sub(std::bind(&listener_sub_t::stop_listener, ph::_1, detach));
+}
+
 void feed_t::each_range_sub(
     const std::function<void(range_sub_t *)> &f) THROWS_NOTHING {
     assert_thread();
@@ -1808,8 +1897,10 @@ feed_t::feed_t(client_t *_client,
          reql_version_t::LATEST is appropriate. */
       point_subs(optional_datum_less_t(reql_version_t::LATEST)),
       range_subs(get_num_threads()),
+      listener_subs(get_num_threads()),
       num_subs(0),
-      detached(false) {
+      detached(false),
+      stopped(false) {
     try {
         read_t read(changefeed_subscribe_t(mailbox.get_address()),
                     profile_bool_t::DONT_PROFILE);
@@ -1885,6 +1976,7 @@ void feed_t::constructor_cb() {
                                std::make_exception_ptr(
                                    datum_exc_t(base_exc_t::GENERIC, msg)),
                                detach_t::YES));
+            stop_listener_subs(detach_t::YES);
             num_subs = 0;
         } else {
             // We only get here if we were removed before we were detached.
@@ -1915,6 +2007,36 @@ client_t::client_t(
 }
 client_t::~client_t() { }
 
+void client_t::with_feed(const namespace_id_t &uuid,
+                         const std::string &pkey,
+                         signal_t *interruptor,
+                         const std::function<void(feed_t *)> &f) {
+    threadnum_t old_thread = get_thread_id();
+    cross_thread_signal_t ct_interruptor(interruptor, home_thread());
+    on_thread_t th(home_thread());
+    auto_drainer_t::lock_t lock(&drainer);
+    rwlock_in_line_t spot(&feeds_lock, access_t::write);
+    spot.read_signal()->wait_lazily_unordered();
+    auto feed_it = feeds.find(uuid);
+    if (feed_it == feeds.end()) {
+        spot.write_signal()->wait_lazily_unordered();
+        namespace_interface_access_t access =
+                namespace_source(uuid, &ct_interruptor);
+        // Even though we have the user's feed here, multiple
+        // users may share a feed_t, and this code path will
+        // only be run for the first one.  Rather than mess
+        // about, just use the defaults.
+        auto val = make_scoped<feed_t>(
+            this, manager, access.get(), uuid, pkey, &ct_interruptor);
+        feed_it = feeds.insert(std::make_pair(uuid, std::move(val))).first;
+    }
+
+    // We need to do this while holding `feeds_lock` to make sure the
+    // feed isn't destroyed before we subscribe to it.
+    on_thread_t th2(old_thread);
+    f(feed_it->second.get());
+}
+
 counted_t<datum_stream_t>
 client_t::new_feed(env_t *env,
                    const namespace_id_t &uuid,
@@ -1924,33 +2046,8 @@ client_t::new_feed(env_t *env,
                    const keyspec_t &keyspec) {
     try {
         scoped_ptr_t<subscription_t> sub;
-        boost::variant<scoped_ptr_t<range_sub_t>, scoped_ptr_t<point_sub_t> > presub;
         addr_t addr;
-        {
-            threadnum_t old_thread = get_thread_id();
-            cross_thread_signal_t interruptor(env->interruptor, home_thread());
-            on_thread_t th(home_thread());
-            auto_drainer_t::lock_t lock(&drainer);
-            rwlock_in_line_t spot(&feeds_lock, access_t::write);
-            spot.read_signal()->wait_lazily_unordered();
-            auto feed_it = feeds.find(uuid);
-            if (feed_it == feeds.end()) {
-                spot.write_signal()->wait_lazily_unordered();
-                namespace_interface_access_t access =
-                        namespace_source(uuid, &interruptor);
-                // Even though we have the user's feed here, multiple
-                // users may share a feed_t, and this code path will
-                // only be run for the first one.  Rather than mess
-                // about, just use the defaults.
-                auto val = make_scoped<feed_t>(
-                    this, manager, access.get(), uuid, pkey, &interruptor);
-                feed_it = feeds.insert(std::make_pair(uuid, std::move(val))).first;
-            }
-
-            // We need to do this while holding `feeds_lock` to make sure the
-            // feed isn't destroyed before we subscribe to it.
-            on_thread_t th2(old_thread);
-            feed_t *feed = feed_it->second.get();
+        with_feed(uuid, pkey, env->interruptor, [&](feed_t *feed) {
             addr = feed->get_addr();
 
             struct keyspec_visitor_t : public boost::static_visitor<subscription_t *> {
@@ -1967,7 +2064,7 @@ client_t::new_feed(env_t *env,
                 feed_t *feed;
             };
             sub.init(boost::apply_visitor(keyspec_visitor_t(feed), keyspec.spec));
-        }
+        });
         namespace_interface_access_t access = namespace_source(uuid, env->interruptor);
         sub->start(env, table_name, access.get(), &addr);
         return make_counted<stream_t>(std::move(sub), bt);
@@ -2013,5 +2110,34 @@ scoped_ptr_t<feed_t> client_t::detach_feed(const uuid_u &uuid) {
     return ret;
 }
 
+key_listener_t::key_listener_t() { }
+
+key_listener_t::~key_listener_t() {
+    assert_thread();
+    guarantee(!sub.has());
+}
+
+bool key_listener_t::subscribe(client_t *client,
+                               const namespace_id_t &table,
+                               const std::string &pkey,
+                               signal_t *interruptor) {
+    assert_thread();
+    sub.reset();
+    scoped_ptr_t<listener_sub_t> new_sub;
+    client->with_feed(table, pkey, interruptor, [&](feed_t *feed) {
+            new_sub.init(new listener_sub_t(feed, this));
+        });
+    if (!new_sub->is_live()) {
+        return false;
+    }
+    sub = std::move(new_sub);
+    return true;
+}
+
+void key_listener_t::unsubscribe() {
+    assert_thread();
+    sub.reset();
+}
+
 } // namespace changefeed
 } // namespace ql
@@ -191,6 +191,14 @@ public:
     scoped_ptr_t<feed_t> detach_feed(const namespace_id_t &uuid);
 private:
     friend class subscription_t;
+    friend class key_listener_t;
+    // Finds the feed for `table`, creating it if there isn't one yet, and calls `f`
+    // with it on the calling thread while the feed can't be removed.  Throws
+    // `cannot_perform_query_exc_t` and `interrupted_exc_t`.
+    void with_feed(const namespace_id_t &table,
+                   const std::string &pkey,
+                   signal_t *interruptor,
+                   const std::function<void(feed_t *)> &f);
     mailbox_manager_t *const manager;
     std::function<
         namespace_interface_access_t(
@@ -213,6 +221,41 @@ private:
     auto_drainer_t drainer;
 };
 
+class listener_sub_t;
+
+// A `key_listener_t` hears about every write to a table, through the same `feed_t`
+// as the changefeeds on this machine, but all it gets is the primary key of the
+// changed row.  It's used to keep local caches of the table's rows up to date.
+// Subclasses are called on their home thread.
+class key_listener_t : public home_thread_mixin_t {
+public:
+    virtual ~key_listener_t();
+protected:
+    key_listener_t();
+    // Drops the old subscription, if any, and subscribes to `table`.  Returns
+    // false if the table's feed has already been stopped, in which case we stay
+    // unsubscribed.  Throws `cannot_perform_query_exc_t` and `interrupted_exc_t`.
+    bool subscribe(client_t *client,
+                   const namespace_id_t &table,
+                   const std::string &pkey,
+                   signal_t *interruptor);
+    // Subclasses must call this in their destructor, because the feed can call them
+    // until it returns.
+    void unsubscribe();
+private:
+    friend class listener_sub_t;
+    // Called for every row written after `subscribe()` returns, and maybe for some
+    // that were written before.
+    virtual void on_change(const datum_t &pkey) = 0;
+    // Called when we stop hearing about writes, e.g. because the table became
+    // unavailable.  There are no more calls to `on_change()` until the next
+    // `subscribe()`.
+    virtual void on_stop() = 0;
+
+    scoped_ptr_t<listener_sub_t> sub;
+    DISABLE_COPYING(key_listener_t);
+};
+
 typedef mailbox_addr_t<void(client_addr_t)> server_addr_t;
 
 template<class Id, class Key, class Val, class Gt>
@@ -0,0 +1,399 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/compiled_func.hpp"
+
+#include <algorithm>
+
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/term.hpp"
+#include "utils.hpp"
+
+namespace ql {
+
+class compiled_eval_ctx_t {
+public:
+    compiled_eval_ctx_t(reql_version_t _reql_version,
+                        const std::vector<datum_t> *_args)
+        : reql_version(_reql_version), args(_args) { }
+    const reql_version_t reql_version;
+    const std::vector<datum_t> *const args;
+};
+
+class compiled_node_t {
+public:
+    virtual ~compiled_node_t() { }
+
+    // Returns an empty `datum_t` whenever the interpreter has to take over.
+    virtual datum_t eval(const compiled_eval_ctx_t *ctx) const = 0;
+
+    // Returns the value of the node if it doesn't depend on the arguments (and
+    // doesn't depend on the reql_version either), an empty `datum_t` otherwise.
+    virtual datum_t constant() const { return datum_t(); }
+};
+
+namespace {
+
+typedef std::vector<scoped_ptr_t<const compiled_node_t> > compiled_args_t;
+
+class constant_node_t : public compiled_node_t {
+public:
+    explicit constant_node_t(datum_t _value) : value(std::move(_value)) {
+        guarantee(value.has());
+    }
+    datum_t eval(const compiled_eval_ctx_t *) const { return value; }
+    datum_t constant() const { return value; }
+private:
+    const datum_t value;
+};
+
+class arg_node_t : public compiled_node_t {
+public:
+    explicit arg_node_t(size_t _index) : index(_index) { }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        if (index >= ctx->args->size()) {
+            return datum_t();
+        }
+        return (*ctx->args)[index];
+    }
+private:
+    const size_t index;
+};
+
+class get_field_node_t : public compiled_node_t {
+public:
+    get_field_node_t(scoped_ptr_t<const compiled_node_t> &&_obj,
+                     datum_string_t _key)
+        : obj(std::move(_obj)), key(std::move(_key)) { }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        datum_t d = obj->eval(ctx);
+        // Sequences, arrays (which `get_field` maps over) and pseudo-types (which
+        // may or may not be accessible depending on the reql_version) are left to
+        // the interpreter.
+        if (!d.has() || d.get_type() != datum_t::R_OBJECT || d.is_ptype()) {
+            return datum_t();
+        }
+        return d.get_field(key, NOTHROW);
+    }
+private:
+    const scoped_ptr_t<const compiled_node_t> obj;
+    const datum_string_t key;
+};
+
+class predicate_node_t : public compiled_node_t {
+public:
+    predicate_node_t(Term::TermType _type, compiled_args_t &&_args)
+        : type(_type), args(std::move(_args)) {
+        guarantee(args.size() >= 2);
+    }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        datum_t lhs = args[0]->eval(ctx);
+        if (!lhs.has()) { return datum_t(); }
+        for (size_t i = 1; i < args.size(); ++i) {
+            datum_t rhs = args[i]->eval(ctx);
+            if (!rhs.has()) { return datum_t(); }
+            if (!holds(ctx->reql_version, lhs, rhs)) {
+                return datum_t::boolean(type == Term::NE);
+            }
+            lhs = std::move(rhs);
+        }
+        return datum_t::boolean(type != Term::NE);
+    }
+private:
+    bool holds(reql_version_t reql_version,
+               const datum_t &lhs, const datum_t &rhs) const {
+        if (type == Term::EQ || type == Term::NE) {
+            return lhs == rhs;
+        } else if (type == Term::LT) {
+            return lhs.cmp(reql_version, rhs) < 0;
+        } else if (type == Term::LE) {
+            return lhs.cmp(reql_version, rhs) <= 0;
+        } else if (type == Term::GT) {
+            return lhs.cmp(reql_version, rhs) > 0;
+        } else if (type == Term::GE) {
+            return lhs.cmp(reql_version, rhs) >= 0;
+        } else {
+            unreachable();
+        }
+    }
+
+    const Term::TermType type;
+    const compiled_args_t args;
+};
+
+class arith_node_t : public compiled_node_t {
+public:
+    arith_node_t(Term::TermType _type, compiled_args_t &&_args)
+        : type(_type), args(std::move(_args)) {
+        guarantee(!args.empty());
+    }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        datum_t acc = args[0]->eval(ctx);
+        for (size_t i = 1; i < args.size() && acc.has(); ++i) {
+            datum_t rhs = args[i]->eval(ctx);
+            if (!rhs.has()) { return datum_t(); }
+            acc = apply(acc, rhs);
+        }
+        return acc;
+    }
+private:
+    datum_t apply(const datum_t &lhs, const datum_t &rhs) const {
+        if (lhs.get_type() == datum_t::R_STR && rhs.get_type() == datum_t::R_STR) {
+            return type == Term::ADD
+                ? datum_t(concat(lhs.as_str(), rhs.as_str()))
+                : datum_t();
+        }
+        // Times, arrays and type errors go through the interpreter.
+        if (lhs.get_type() != datum_t::R_NUM || rhs.get_type() != datum_t::R_NUM) {
+            return datum_t();
+        }
+        const double l = lhs.as_num();
+        const double r = rhs.as_num();
+        double res;
+        if (type == Term::ADD) {
+            res = l + r;
+        } else if (type == Term::SUB) {
+            res = l - r;
+        } else if (type == Term::MUL) {
+            res = l * r;
+        } else if (type == Term::DIV) {
+            if (r == 0) { return datum_t(); }
+            res = l / r;
+        } else {
+            unreachable();
+        }
+        return risfinite(res) ? datum_t(res) : datum_t();
+    }
+
+    const Term::TermType type;
+    const compiled_args_t args;
+};
+
+// `ALL` returns the first falsey value or the last value, `ANY` returns the first
+// truthy value or `false`, just like `all_term_t` and `any_term_t`.
+class logic_node_t : public compiled_node_t {
+public:
+    logic_node_t(Term::TermType _type, compiled_args_t &&_args)
+        : type(_type), args(std::move(_args)) {
+        guarantee(!args.empty());
+    }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        for (size_t i = 0; i < args.size(); ++i) {
+            datum_t d = args[i]->eval(ctx);
+            if (!d.has()) { return datum_t(); }
+            if (type == Term::ALL
+                ? (!d.as_bool() || i == args.size() - 1)
+                : d.as_bool()) {
+                return d;
+            }
+        }
+        return datum_t::boolean(false);
+    }
+private:
+    const Term::TermType type;
+    const compiled_args_t args;
+};
+
+class not_node_t : public compiled_node_t {
+public:
+    explicit not_node_t(scoped_ptr_t<const compiled_node_t> &&_arg)
+        : arg(std::move(_arg)) { }
+    datum_t eval(const compiled_eval_ctx_t *ctx) const {
+        datum_t d = arg->eval(ctx);
+        return d.has() ? datum_t::boolean(!d.as_bool()) : datum_t();
+    }
+private:
+    const scoped_ptr_t<const compiled_node_t> arg;
+};
+
+class func_compiler_t {
+public:
+    explicit func_compiler_t(const std::vector<sym_t> &_arg_names)
+        : arg_names(_arg_names), array_size(0) { }
+
+    // Returns an empty pointer if `t` can't be compiled.
+    scoped_ptr_t<const compiled_node_t> compile(const Term &t) {
+        // No term in the supported subset takes optional arguments.
+        if (t.optargs_size() != 0) {
+            return scoped_ptr_t<const compiled_node_t>();
+        }
+        const Term::TermType type = t.type();
+        if (type == Term::DATUM) {
+            if (!t.has_datum()) { return scoped_ptr_t<const compiled_node_t>(); }
+            datum_t value = to_datum(&t.datum(), configured_limits_t::unlimited);
+            array_size = std::max(array_size, collapsed_array_size(t, value));
+            return make_scoped<constant_node_t>(value);
+        } else if (type == Term::VAR) {
+            return compile_var(t);
+        } else if (type == Term::IMPLICIT_VAR) {
+            // The implicit variable is only accessible inside of the function if the
+            // function itself emits it, in which case it's the first argument.
+            if (!function_emits_implicit_variable(arg_names)) {
+                return scoped_ptr_t<const compiled_node_t>();
+            }
+            return make_scoped<arg_node_t>(0);
+        } else if (type == Term::GET_FIELD || type == Term::BRACKET) {
+            return compile_get_field(t);
+        } else if (type == Term::EQ || type == Term::NE || type == Term::LT
+                   || type == Term::LE || type == Term::GT || type == Term::GE) {
+            compiled_args_t args;
+            if (t.args_size() < 2 || !compile_args(t, &args)) {
+                return scoped_ptr_t<const compiled_node_t>();
+            }
+            const bool foldable = all_constant(args, !(type == Term::EQ
+                                                       || type == Term::NE));
+            return fold(make_scoped<predicate_node_t>(type, std::move(args)),
+                        foldable);
+        } else if (type == Term::ADD || type == Term::SUB || type == Term::MUL
+                   || type == Term::DIV) {
+            compiled_args_t args;
+            if (t.args_size() < 1 || !compile_args(t, &args)) {
+                return scoped_ptr_t<const compiled_node_t>();
+            }
+            const bool foldable = all_constant(args, false);
+            return fold(make_scoped<arith_node_t>(type, std::move(args)),
+                        foldable);
+        } else if (type == Term::ALL || type == Term::ANY) {
+            compiled_args_t args;
+            if (t.args_size() < 1 || !compile_args(t, &args)) {
+                return scoped_ptr_t<const compiled_node_t>();
+            }
+            const bool foldable = all_constant(args, false);
+            return fold(make_scoped<logic_node_t>(type, std::move(args)),
+                        foldable);
+        } else if (type == Term::NOT) {
+            compiled_args_t args;
+            if (t.args_size() != 1 || !compile_args(t, &args)) {
+                return scoped_ptr_t<const compiled_node_t>();
+            }
+            const bool foldable = all_constant(args, false);
+            return fold(make_scoped<not_node_t>(std::move(args[0])), foldable);
+        } else {
+            return scoped_ptr_t<const compiled_node_t>();
+        }
+    }
+
+    // The size of the largest array in any of the collapsed literals compiled so far.
+    size_t largest_literal_array_size() const { return array_size; }
+
+private:
+    scoped_ptr_t<const compiled_node_t> compile_var(const Term &t) {
+        if (t.args_size() != 1
+            || t.args(0).type() != Term::DATUM
+            || t.args(0).datum().type() != Datum::R_NUM) {
+            return scoped_ptr_t<const compiled_node_t>();
+        }
+        const double num = t.args(0).datum().r_num();
+        for (size_t i = 0; i < arg_names.size(); ++i) {
+            if (static_cast<double>(arg_names[i].value) == num) {
+                return make_scoped<arg_node_t>(i);
+            }
+        }
+        // A variable captured from an enclosing scope.  The compiled form is shared
+        // between all scopes, so we don't handle these.
+        return scoped_ptr_t<const compiled_node_t>();
+    }
+
+    scoped_ptr_t<const compiled_node_t> compile_get_field(const Term &t) {
+        if (t.args_size() != 2
+            || t.args(1).type() != Term::DATUM
+            || t.args(1).datum().type() != Datum::R_STR) {
+            return scoped_ptr_t<const compiled_node_t>();
+        }
+        scoped_ptr_t<const compiled_node_t> obj = compile(t.args(0));
+        if (!obj.has()) {
+            return scoped_ptr_t<const compiled_node_t>();
+        }
+        return make_scoped<get_field_node_t>(
+            std::move(obj), datum_string_t(t.args(1).datum().r_str()));
+    }
+
+    bool compile_args(const Term &t, compiled_args_t *out) {
+        out->reserve(t.args_size());
+        for (int i = 0; i < t.args_size(); ++i) {
+            scoped_ptr_t<const compiled_node_t> arg = compile(t.args(i));
+            if (!arg.has()) {
+                return false;
+            }
+            out->push_back(std::move(arg));
+        }
+        return true;
+    }
+
+    // Ordering comparisons depend on the reql_version, so those are only folded
+    // when all of their arguments are numbers.
+    static bool all_constant(const compiled_args_t &args, bool numbers_only) {
+        for (auto it = args.begin(); it != args.end(); ++it) {
+            datum_t value = (*it)->constant();
+            if (!value.has()
+                || (numbers_only && value.get_type() != datum_t::R_NUM)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Replaces `node` by its value if it can be computed at compile time.
+    static scoped_ptr_t<const compiled_node_t> fold(
+            scoped_ptr_t<const compiled_node_t> &&node, bool foldable) {
+        if (!foldable) {
+            return std::move(node);
+        }
+        std::vector<datum_t> no_args;
+        compiled_eval_ctx_t ctx(reql_version_t::LATEST, &no_args);
+        datum_t value;
+        try {
+            value = node->eval(&ctx);
+        } catch (const base_exc_t &) {
+            // Leave the error to the interpreter.
+        }
+        if (!value.has()) {
+            return std::move(node);
+        }
+        return make_scoped<constant_node_t>(value);
+    }
+
+    const std::vector<sym_t> &arg_names;
+    size_t array_size;
+};
+
+}  // namespace
+
+counted_t<const compiled_func_t> compiled_func_t::compile(
+        const std::vector<sym_t> &arg_names,
+        const protob_t<const Term> &body) {
+    func_compiler_t compiler(arg_names);
+    scoped_ptr_t<const compiled_node_t> root = compiler.compile(*body);
+    if (!root.has()) {
+        return counted_t<const compiled_func_t>();
+    }
+    return counted_t<const compiled_func_t>(
+        new compiled_func_t(std::move(root), compiler.largest_literal_array_size()));
+}
+
+compiled_func_t::compiled_func_t(scoped_ptr_t<const compiled_node_t> &&_root,
+                                 size_t _array_size)
+    : root(std::move(_root)), array_size(_array_size) { }
+
+compiled_func_t::~compiled_func_t() { }
+
+datum_t compiled_func_t::eval(env_t *env, const std::vector<datum_t> &args) const {
+    // `datum_term_t` enforces the array size limit on literals; let the interpreter
+    // raise that error.
+    if (array_size > env->limits().array_size_limit()) {
+        return datum_t();
+    }
+    compiled_eval_ctx_t ctx(env->reql_version(), &args);
+    try {
+        return root->eval(&ctx);
+    } catch (const base_exc_t &) {
+        // E.g. comparisons between pseudo-types; the interpreter will report it.
+        return datum_t();
+    }
+}
+
+bool compiled_func_t::is_constant() const {
+    return root->constant().has();
+}
+
+}  // namespace ql
@@ -0,0 +1,59 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_COMPILED_FUNC_HPP_
+#define RDB_PROTOCOL_COMPILED_FUNC_HPP_
+
+#include <vector>
+
+#include "containers/counted.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/sym.hpp"
+
+namespace ql {
+
+class compiled_node_t;
+class env_t;
+
+/* A `compiled_func_t` is a closure tree built from the body of a `reql_func_t`
+ * that evaluates directly on `datum_t`s, without going through `term_t::eval`,
+ * `scope_env_t` or `val_t`.  Only a small, side-effect free subset of ReQL is
+ * supported: literals, variables bound by the function itself, field access with a
+ * literal key, comparisons, arithmetic on numbers (and `+` on strings), and the
+ * boolean operators.  Subtrees made only of literals are folded at compile time.
+ *
+ * Anything out of the ordinary at evaluation time (a missing field, a type
+ * mismatch, a division by zero, ...) makes `eval` return an empty `datum_t`.  The
+ * caller is then expected to re-run the interpreted body, which produces exactly
+ * the same error (and backtrace) it always did.  This is safe because the subset
+ * has no side effects. */
+class compiled_func_t : public slow_atomic_countable_t<compiled_func_t> {
+public:
+    // Returns an empty pointer if `body` uses anything outside of the supported
+    // subset.
+    static counted_t<const compiled_func_t> compile(
+        const std::vector<sym_t> &arg_names,
+        const protob_t<const Term> &body);
+
+    ~compiled_func_t();
+
+    // Returns an empty `datum_t` if the interpreter must be used instead.
+    datum_t eval(env_t *env, const std::vector<datum_t> &args) const;
+
+    // True if the whole body got folded into a single value.
+    bool is_constant() const;
+
+private:
+    compiled_func_t(scoped_ptr_t<const compiled_node_t> &&root, size_t array_size);
+
+    scoped_ptr_t<const compiled_node_t> root;
+    // The size of the largest array in a collapsed literal in the body (see
+    // `collapsed_array_size()`), checked against the array size limit on every `eval`.
+    const size_t array_size;
+
+    DISABLE_COPYING(compiled_func_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_COMPILED_FUNC_HPP_
@@ -64,6 +64,11 @@ public:
 
     virtual ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated) = 0;
+    /* Like `read_row`, but only the given top-level fields of the row are read
+    back from the shard. */
+    virtual ql::datum_t read_row_fields(ql::env_t *env,
+        ql::datum_t pval, bool use_outdated,
+        const std::vector<std::string> &fields) = 0;
     virtual counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
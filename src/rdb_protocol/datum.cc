@@ -13,6 +13,7 @@
 #include <boost/detail/endian.hpp>
 
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/string_stream.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
@@ -88,12 +89,12 @@ datum_t::data_wrapper_t::data_wrapper_t(const char *cstr) :
     r_str(cstr), internal_type(internal_type_t::R_STR) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(std::vector<datum_t> &&array) :
-    r_array(new countable_wrapper_t<std::vector<datum_t> >(std::move(array))),
+    r_array(new datum_storage_t<std::vector<datum_t> >(std::move(array))),
     internal_type(internal_type_t::R_ARRAY) { }
 
 datum_t::data_wrapper_t::data_wrapper_t(
         std::vector<std::pair<datum_string_t, datum_t> > &&object) :
-    r_object(new countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > >(
+    r_object(new datum_storage_t<std::vector<std::pair<datum_string_t, datum_t> > >(
         std::move(object))),
     internal_type(internal_type_t::R_OBJECT) {
 
@@ -178,10 +179,10 @@ void datum_t::data_wrapper_t::destruct() {
         r_str.~datum_string_t();
     } break;
     case internal_type_t::R_ARRAY: {
-        r_array.~counted_t<countable_wrapper_t<std::vector<datum_t> > >();
+        r_array.~counted_t<datum_storage_t<std::vector<datum_t> > >();
     } break;
     case internal_type_t::R_OBJECT: {
-        r_object.~counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >();
+        r_object.~counted_t<datum_storage_t<std::vector<std::pair<datum_string_t, datum_t> > > >();
     } break;
     case internal_type_t::BUF_R_ARRAY: // fallthru
     case internal_type_t::BUF_R_OBJECT: {
@@ -207,10 +208,10 @@ void datum_t::data_wrapper_t::assign_copy(const datum_t::data_wrapper_t &copyee)
         new(&r_str) datum_string_t(copyee.r_str);
     } break;
     case internal_type_t::R_ARRAY: {
-        new(&r_array) counted_t<countable_wrapper_t<std::vector<datum_t> > >(copyee.r_array);
+        new(&r_array) counted_t<datum_storage_t<std::vector<datum_t> > >(copyee.r_array);
     } break;
     case internal_type_t::R_OBJECT: {
-        new(&r_object) counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
+        new(&r_object) counted_t<datum_storage_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
             copyee.r_object);
     } break;
     case internal_type_t::BUF_R_ARRAY: // fallthru
@@ -237,11 +238,11 @@ void datum_t::data_wrapper_t::assign_move(datum_t::data_wrapper_t &&movee) noexc
         new(&r_str) datum_string_t(std::move(movee.r_str));
     } break;
     case internal_type_t::R_ARRAY: {
-        new(&r_array) counted_t<countable_wrapper_t<std::vector<datum_t> > >(
+        new(&r_array) counted_t<datum_storage_t<std::vector<datum_t> > >(
             std::move(movee.r_array));
     } break;
     case internal_type_t::R_OBJECT: {
-        new(&r_object) counted_t<countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
+        new(&r_object) counted_t<datum_storage_t<std::vector<std::pair<datum_string_t, datum_t> > > >(
             std::move(movee.r_object));
     } break;
     case internal_type_t::BUF_R_ARRAY: // fallthru
@@ -439,6 +440,24 @@ const shared_buf_ref_t<char> *datum_t::get_buf_ref() const {
     }
 }
 
+size_t datum_t::get_cached_serialized_size() const {
+    if (data.get_internal_type() == internal_type_t::R_ARRAY) {
+        return data.r_array->serialized_size.load(std::memory_order_relaxed);
+    } else if (data.get_internal_type() == internal_type_t::R_OBJECT) {
+        return data.r_object->serialized_size.load(std::memory_order_relaxed);
+    } else {
+        return 0;
+    }
+}
+
+void datum_t::cache_serialized_size(size_t size) const {
+    if (data.get_internal_type() == internal_type_t::R_ARRAY) {
+        data.r_array->serialized_size.store(size, std::memory_order_relaxed);
+    } else if (data.get_internal_type() == internal_type_t::R_OBJECT) {
+        data.r_object->serialized_size.store(size, std::memory_order_relaxed);
+    }
+}
+
 datum_t::type_t datum_t::get_type() const { return data.get_type(); }
 
 bool datum_t::is_ptype() const {
@@ -1220,6 +1239,45 @@ scoped_cJSON_t datum_t::as_json() const {
     return scoped_cJSON_t(as_json_raw());
 }
 
+void datum_t::write_json(std::string *out) const {
+    switch (get_type()) {
+    case R_NULL: out->append("null"); break;
+    case R_BINARY: {
+        out->append(pseudo::encode_base64_ptype(as_binary()).PrintUnformatted());
+    } break;
+    case R_BOOL: out->append(as_bool() ? "true" : "false"); break;
+    case R_NUM: json_append_number(as_num(), out); break;
+    case R_STR: json_append_string(as_str().data(), as_str().size(), out); break;
+    case R_ARRAY: {
+        out->push_back('[');
+        const size_t sz = arr_size();
+        for (size_t i = 0; i < sz; ++i) {
+            if (i != 0) {
+                out->push_back(',');
+            }
+            unchecked_get(i).write_json(out);
+        }
+        out->push_back(']');
+    } break;
+    case R_OBJECT: {
+        out->push_back('{');
+        const size_t sz = obj_size();
+        for (size_t i = 0; i < sz; ++i) {
+            if (i != 0) {
+                out->push_back(',');
+            }
+            auto pair = get_pair(i);
+            json_append_string(pair.first.data(), pair.first.size(), out);
+            out->push_back(':');
+            pair.second.write_json(out);
+        }
+        out->push_back('}');
+    } break;
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
 // TODO: make BINARY, STR, and OBJECT convertible to sequence?
 counted_t<datum_stream_t>
 datum_t::as_datum_stream(const protob_t<const Backtrace> &backtrace) const {
@@ -1473,6 +1531,21 @@ void datum_t::runtime_fail(base_exc_t::type_t exc_type,
     ql::runtime_fail(exc_type, test, file, line, msg);
 }
 
+size_t largest_array_size(const datum_t &d) {
+    size_t largest = 0;
+    if (d.get_type() == datum_t::R_ARRAY) {
+        largest = d.arr_size();
+        for (size_t i = 0; i < d.arr_size(); ++i) {
+            largest = std::max(largest, largest_array_size(d.get(i)));
+        }
+    } else if (d.get_type() == datum_t::R_OBJECT) {
+        for (size_t i = 0; i < d.obj_size(); ++i) {
+            largest = std::max(largest, largest_array_size(d.get_pair(i).second));
+        }
+    }
+    return largest;
+}
+
 datum_t to_datum(const Datum *d, const configured_limits_t &limits) {
     switch (d->type()) {
     case Datum::R_NULL: {
@@ -1491,6 +1564,12 @@ datum_t to_datum(const Datum *d, const configured_limits_t &limits) {
         scoped_cJSON_t cjson(cJSON_Parse(d->r_str().c_str()));
         return to_datum(cjson.get(), limits);
     } break;
+    case Datum::R_SERIALIZED: {
+        // We don't trust clients with the binary format, which we don't validate
+        // as thoroughly as JSON.
+        rfail_datum(base_exc_t::GENERIC,
+                    "R_SERIALIZED datums can only be sent by the server.");
+    } break;
     case Datum::R_ARRAY: {
         datum_array_builder_t out(limits);
         out.reserve(d->r_array_size());
@@ -1586,7 +1665,17 @@ void datum_t::write_to_protobuf(Datum *d, use_json_t use_json) const {
     } break;
     case use_json_t::YES: {
         d->set_type(Datum::R_JSON);
-        d->set_r_str(as_json().PrintUnformatted());
+        write_json(d->mutable_r_str());
+    } break;
+    case use_json_t::SERIALIZED: {
+        d->set_type(Datum::R_SERIALIZED);
+        write_message_t wm;
+        // Buffer-backed arrays and objects are copied over as they are.
+        datum_serialize(&wm, *this, check_datum_serialization_errors_t::NO);
+        string_stream_t stream;
+        int res = send_write_message(&stream, &wm);
+        guarantee(res == 0);
+        d->mutable_r_str()->swap(stream.str());
     } break;
     default: unreachable();
     }
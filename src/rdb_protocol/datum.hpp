@@ -4,6 +4,7 @@
 
 #include <float.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <set>
@@ -64,7 +65,9 @@ enum throw_bool_t { NOTHROW = 0, THROW = 1 };
 // CLOBBER: Overwrite existing values.
 enum clobber_bool_t { NOCLOBBER = 0, CLOBBER = 1 };
 
-enum class use_json_t { NO = 0, YES = 1 };
+// How datums are written into protobuf responses: as `Datum` messages, as JSON
+// text (`R_JSON`), or in the binary datum encoding (`R_SERIALIZED`).
+enum class use_json_t { NO = 0, YES = 1, SERIALIZED = 2 };
 
 class grouped_data_t;
 
@@ -74,6 +77,23 @@ struct components_t {
     boost::optional<uint64_t> tag_num;
 };
 
+// The shared storage of an in-memory array or object.  It also holds the
+// serialized size of the datum, which gets computed at most once and is then
+// reused every time the datum is batched or sent somewhere.
+template <class T>
+class datum_storage_t : public T,
+                        public slow_atomic_countable_t<datum_storage_t<T> > {
+public:
+    template <class... Args>
+    explicit datum_storage_t(Args &&... args)
+        : T(std::forward<Args>(args)...), serialized_size(0) { }
+
+    // Zero until it's been computed.  The contents never change, so threads that
+    // happen to compute it at the same time all store the same value, and relaxed
+    // loads and stores are enough.
+    mutable std::atomic<size_t> serialized_size;
+};
+
 // A `datum_t` is basically a JSON value, with some special handling for
 // ReQL pseudo-types.
 class datum_t {
@@ -252,6 +272,10 @@ public:
 
     cJSON *as_json_raw() const;
     scoped_cJSON_t as_json() const;
+    // Appends the same JSON that `as_json().PrintUnformatted()` returns to `out`,
+    // without building a cJSON tree.  Buffer-backed arrays and objects are rendered
+    // one element at a time, straight from their serialized form.
+    void write_json(std::string *out) const;
     counted_t<datum_stream_t> as_datum_stream(
             const protob_t<const Backtrace> &backtrace) const;
 
@@ -307,6 +331,12 @@ public:
     // the datum is currently backed by one, or NULL otherwise.
     const shared_buf_ref_t<char> *get_buf_ref() const;
 
+    // Used by serialization code. In-memory arrays and objects remember their
+    // serialized size once it's been computed; this returns 0 until then, and for
+    // all other datums.
+    size_t get_cached_serialized_size() const;
+    void cache_serialized_size(size_t size) const;
+
 private:
     friend void pseudo::sanitize_time(datum_t *time);
     // Must only be used during pseudo type sanitization.
@@ -369,8 +399,8 @@ private:
             bool r_bool;
             double r_num;
             datum_string_t r_str;
-            counted_t<countable_wrapper_t<std::vector<datum_t> > > r_array;
-            counted_t<countable_wrapper_t<std::vector< //NOLINT(whitespace/operators)
+            counted_t<datum_storage_t<std::vector<datum_t> > > r_array;
+            counted_t<datum_storage_t<std::vector< //NOLINT(whitespace/operators)
                 std::pair<datum_string_t, datum_t> > > > r_object;
             shared_buf_ref_t<char> buf_ref;
         };
@@ -420,6 +450,11 @@ RDB_SERIALIZE_OUTSIDE(datum_range_t);
 datum_t to_datum(const Datum *d, const configured_limits_t &);
 datum_t to_datum(cJSON *json, const configured_limits_t &);
 
+// Returns the size of the largest array in `d`, however deeply it's nested.  Literals
+// are converted without a size limit when the query is compiled, and this is what
+// they're checked against the query's `array_limit` with later.
+size_t largest_array_size(const datum_t &d);
+
 // This should only be used to send responses to the client.
 datum_t to_datum_for_client_serialization(grouped_data_t &&gd,
                                           reql_version_t reql_version,
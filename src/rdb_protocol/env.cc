@@ -106,6 +106,11 @@ void env_t::do_eval_callback() {
     }
 }
 
+const datum_t &env_t::query_param(size_t index) const {
+    r_sanity_check(index < query_params_.size());
+    return query_params_[index];
+}
+
 profile_bool_t env_t::profile() const {
     return trace != nullptr ? profile_bool_t::PROFILE : profile_bool_t::DONT_PROFILE;
 }
@@ -153,6 +158,8 @@ env_t::env_t(rdb_context_t *ctx,
       interruptor(_interruptor),
       trace(_trace),
       evals_since_yield_(0),
+      slice_resume_count_(0),
+      slice_started_at_(0),
       rdb_ctx_(ctx),
       eval_callback_(NULL) {
     rassert(ctx != NULL);
@@ -168,6 +175,8 @@ env_t::env_t(signal_t *_interruptor, reql_version_t reql_version)
       interruptor(_interruptor),
       trace(NULL),
       evals_since_yield_(0),
+      slice_resume_count_(0),
+      slice_started_at_(0),
       rdb_ctx_(NULL),
       eval_callback_(NULL) {
     rassert(interruptor != NULL);
@@ -187,8 +196,28 @@ profile_bool_t profile_bool_optarg(const protob_t<Query> &query) {
 env_t::~env_t() { }
 
 void env_t::maybe_yield() {
-    if (++evals_since_yield_ > EVALS_BEFORE_YIELD) {
-        evals_since_yield_ = 0;
+    if (++evals_since_yield_ < EVALS_BETWEEN_CLOCK_CHECKS) {
+        return;
+    }
+    evals_since_yield_ = 0;
+
+    coro_t *self = coro_t::self();
+    const ticks_t now = get_ticks();
+    if (self->get_resume_count() != slice_resume_count_) {
+        // The coroutine has given up control since the slice started (or this is the
+        // first check), so it gets a new one.
+        slice_resume_count_ = self->get_resume_count();
+        slice_started_at_ = now;
+        return;
+    }
+
+    const sched_class_t sched_class = self->get_sched_class();
+    if (now - slice_started_at_ >= sched_class_time_slice(sched_class)) {
+        if (sched_class == sched_class_t::INTERACTIVE) {
+            // Queries that compute for this long without waiting for anything aren't
+            // the ones that need low latency.
+            self->set_sched_class(sched_class_t::BATCH);
+        }
         coro_t::yield();
     }
 }
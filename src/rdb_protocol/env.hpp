@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "concurrency/one_per_thread.hpp"
+#include "containers/arena.hpp"
 #include "containers/counted.hpp"
 #include "containers/lru_cache.hpp"
 #include "extproc/js_runner.hpp"
@@ -55,6 +56,56 @@ scoped_ptr_t<profile::trace_t> maybe_make_profile_trace(profile_bool_t profile);
 struct query_cache_t {
     explicit query_cache_t(size_t cache_size) : regex_cache(cache_size) {}
     lru_cache_t<std::string, std::shared_ptr<re2::RE2> > regex_cache;
+    // The secondary index statuses of the tables that `filter` looked for an index
+    // on, by table name (see `choose_index_plan()`).
+    std::map<std::string, std::map<std::string, datum_t> > sindex_statuses;
+};
+
+// How many compiled queries each thread's `plan_cache_t` keeps.
+const size_t PLAN_CACHE_SIZE = 256;
+
+class plan_cache_stats_t {
+public:
+    explicit plan_cache_stats_t(perfmon_collection_t *parent);
+
+    perfmon_collection_t collection;
+    perfmon_membership_t collection_membership;
+    perfmon_rate_monitor_t pm_hits, pm_misses;
+    perfmon_counter_t pm_total_hits, pm_total_misses;
+    perfmon_multi_membership_t pm_membership;
+};
+
+/* `plan_cache_t` remembers the compiled term trees of recent queries, so that a client
+that keeps sending the same query with different values doesn't pay for compiling it
+every time.  Queries are looked up by their shape: the query with the literal values in
+some positions (the operands of comparisons and arithmetic, and the keys and counts of
+`get()`, `get_all()`, `between()`, `limit()` and `nth()`) replaced by parameters.
+The compiled tree reads those values from `env_t::query_param()` when it's evaluated.
+
+Values anywhere inside functions are never parameters, because compiling a function
+looks at the literals in its body (for example to pick a secondary index, or to send
+the function to the shards), and neither are values anywhere below terms that are
+compiled by rewriting their arguments into a new term, like `skip()`.  Literals that
+the JSON parser collapsed aren't parameters either, since their arrays are checked
+against the query's `array_limit` (see `collapsed_array_size()`); they're part of the
+shape, apart from the same literals sent as `DATUM` terms.
+
+The cache isn't thread safe; there is one per thread. */
+class plan_cache_t {
+public:
+    explicit plan_cache_t(plan_cache_stats_t *stats);
+    ~plan_cache_t();
+
+    // Compiles `query`, or finds it in the cache, and fills in `params_out` with the
+    // values the compiled tree should be evaluated with.
+    counted_t<const term_t> compile(const protob_t<const Term> &query,
+                                    std::vector<datum_t> *params_out);
+
+private:
+    plan_cache_stats_t *const stats;
+    lru_cache_t<std::string, counted_t<const term_t> > plans;
+
+    DISABLE_COPYING(plan_cache_t);
 };
 
 class env_t : public home_thread_mixin_t {
@@ -73,7 +124,9 @@ public:
 
     ~env_t();
 
-    // Will yield after EVALS_BEFORE_YIELD calls
+    // Yields if the query has used up the time slice of its coroutine's scheduling
+    // class (see `sched_class_t`) since it last gave up control.  The clock is only
+    // read every EVALS_BETWEEN_CLOCK_CHECKS calls.
     void maybe_yield();
 
     extproc_pool_t *get_extproc_pool();
@@ -109,6 +162,14 @@ public:
 
     query_cache_t & query_cache() { return cache_; }
 
+    // The values of the query's parameters, see `plan_cache_t`.
+    void set_query_params(std::vector<datum_t> &&params) {
+        query_params_ = std::move(params);
+    }
+    const datum_t &query_param(size_t index) const;
+
+    arena_t *arena() { return &arena_; }
+
     reql_version_t reql_version() const { return reql_version_; }
 
 private:
@@ -127,6 +188,11 @@ private:
     // query specific cache parameters; for example match regexes.
     query_cache_t cache_;
 
+    std::vector<datum_t> query_params_;
+
+    // Short-lived objects created during evaluation are allocated from here.
+    arena_t arena_;
+
 public:
     // The interruptor signal while a query evaluates.
     signal_t *const interruptor;
@@ -137,8 +203,10 @@ public:
     profile_bool_t profile() const;
 
 private:
-    static const uint32_t EVALS_BEFORE_YIELD = 256;
+    static const uint32_t EVALS_BETWEEN_CLOCK_CHECKS = 64;
     uint32_t evals_since_yield_;
+    uint64_t slice_resume_count_;
+    ticks_t slice_started_at_;
 
     rdb_context_t *const rdb_ctx_;
 
@@ -154,8 +222,14 @@ private:
 class compile_env_t {
 public:
     explicit compile_env_t(var_visibility_t &&_visibility)
-        : visibility(std::move(_visibility)) { }
+        : visibility(std::move(_visibility)), params(NULL) { }
+    // Used by `plan_cache_t`; `DATUM` terms in `_params` are compiled into reads of
+    // the corresponding query parameter.
+    compile_env_t(var_visibility_t &&_visibility,
+                  const std::map<const Term *, size_t> *_params)
+        : visibility(std::move(_visibility)), params(_params) { }
     var_visibility_t visibility;
+    const std::map<const Term *, size_t> *const params;
 };
 
 // This is an environment for evaluating things that use variables in scope.  It
@@ -41,15 +41,49 @@ void func_t::assert_deterministic(const char *extra_msg) const {
 reql_func_t::reql_func_t(const protob_t<const Backtrace> backtrace,
                          const var_scope_t &_captured_scope,
                          std::vector<sym_t> _arg_names,
-                         counted_t<const term_t> _body)
+                         counted_t<const term_t> _body,
+                         counted_t<const compiled_func_t> _compiled_body)
     : func_t(backtrace), captured_scope(_captured_scope),
-      arg_names(std::move(_arg_names)), body(std::move(_body)) { }
+      arg_names(std::move(_arg_names)), body(std::move(_body)),
+      compiled_body(std::move(_compiled_body)) { }
 
 reql_func_t::~reql_func_t() { }
 
 scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                                       const std::vector<datum_t> &args,
                                       eval_flags_t eval_flags) const {
+    datum_t d = maybe_call_compiled(env, args);
+    if (d.has()) {
+        return make_scoped<val_t>(d, body->backtrace());
+    }
+    return call_interpreted(env, args, eval_flags);
+}
+
+datum_t reql_func_t::maybe_call_compiled(env_t *env,
+                                         const std::vector<datum_t> &args) const {
+    // When profiling we go through the interpreter, so that every term still shows
+    // up in the trace.
+    if (!compiled_body.has() || env->trace != NULL
+        || (arg_names.size() != args.size() && arg_names.size() != 0)) {
+        return datum_t();
+    }
+    datum_t d = compiled_body->eval(env, args);
+    // This is what `term_t::eval` would have done for the body.  If the compiled form
+    // declines, the interpreter evaluates the body and does it instead, so that it
+    // only happens once.
+    if (d.has()) {
+        DEBUG_ONLY_CODE(env->do_eval_callback());
+        if (env->interruptor->is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        env->maybe_yield();
+    }
+    return d;
+}
+
+scoped_ptr_t<val_t> reql_func_t::call_interpreted(env_t *env,
+                                                  const std::vector<datum_t> &args,
+                                                  eval_flags_t eval_flags) const {
     try {
         // We allow arg_names.size() == 0 to specifically permit users (Ruby users
         // especially) to use zero-arity functions without the drivers to know anything
@@ -189,11 +223,11 @@ func_term_t::func_term_t(compile_env_t *env, const protob_t<const Term> &t)
     compile_env_t body_env(std::move(varname_visibility));
 
     protob_t<const Term> body_source = t.make_child(&t->args(1));
-    counted_t<const term_t> compiled_body = compile_term(&body_env, body_source);
-    r_sanity_check(compiled_body.has());
+    counted_t<const term_t> compiled_term = compile_term(&body_env, body_source);
+    r_sanity_check(compiled_term.has());
 
     var_captures_t captures;
-    compiled_body->accumulate_captures(&captures);
+    compiled_term->accumulate_captures(&captures);
     for (auto it = args.begin(); it != args.end(); ++it) {
         captures.vars_captured.erase(*it);
     }
@@ -202,7 +236,8 @@ func_term_t::func_term_t(compile_env_t *env, const protob_t<const Term> &t)
     }
 
     arg_names = std::move(args);
-    body = std::move(compiled_body);
+    body = std::move(compiled_term);
+    compiled_body = compiled_func_t::compile(arg_names, body_source);
     external_captures = std::move(captures);
 }
 
@@ -220,7 +255,7 @@ scoped_ptr_t<val_t> func_term_t::term_eval(scope_env_t *env,
 counted_t<const func_t> func_term_t::eval_to_func(const var_scope_t &env_scope) const {
     return make_counted<reql_func_t>(get_backtrace(get_src()),
                                      env_scope.filtered_by_captures(external_captures),
-                                     arg_names, body);
+                                     arg_names, body, compiled_body);
 }
 
 bool func_term_t::is_deterministic() const {
@@ -253,7 +288,11 @@ bool filter_match(datum_t predicate, datum_t value,
 }
 
 bool reql_func_t::filter_helper(env_t *env, datum_t arg) const {
-    datum_t d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
+    std::vector<datum_t> args = make_vector(arg);
+    datum_t d = maybe_call_compiled(env, args);
+    if (!d.has()) {
+        d = call_interpreted(env, args, NO_FLAGS)->as_datum();
+    }
     if (d.get_type() == datum_t::R_OBJECT &&
         (body->get_src()->type() == Term::MAKE_OBJ ||
          body->get_src()->type() == Term::DATUM)) {
@@ -13,6 +13,7 @@
 
 #include "containers/counted.hpp"
 #include "containers/uuid.hpp"
+#include "rdb_protocol/compiled_func.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/sym.hpp"
@@ -70,10 +71,12 @@ private:
 
 class reql_func_t : public func_t {
 public:
+    // `compiled_body` may be empty, in which case `body` is always interpreted.
     reql_func_t(const protob_t<const Backtrace> backtrace,  // for pb_rcheckable_t
                 const var_scope_t &captured_scope,
                 std::vector<sym_t> arg_names,
-                counted_t<const term_t> body);
+                counted_t<const term_t> body,
+                counted_t<const compiled_func_t> compiled_body);
     ~reql_func_t();
 
     scoped_ptr_t<val_t> call(
@@ -89,10 +92,20 @@ public:
 
     void visit(func_visitor_t *visitor) const;
 
+    // Used to recognize simple index functions.
+    const std::vector<sym_t> &get_arg_names() const { return arg_names; }
+    protob_t<const Term> get_body_src() const { return body->get_src(); }
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
 
+    // Returns an empty `datum_t` if the call has to be interpreted.
+    datum_t maybe_call_compiled(env_t *env, const std::vector<datum_t> &args) const;
+    scoped_ptr_t<val_t> call_interpreted(env_t *env,
+                                         const std::vector<datum_t> &args,
+                                         eval_flags_t eval_flags) const;
+
     // Only contains the parts of the scope that `body` uses.
     var_scope_t captured_scope;
 
@@ -102,6 +115,10 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // A faster form of `body`, if it only uses the subset of ReQL that
+    // `compiled_func_t` supports.
+    counted_t<const compiled_func_t> compiled_body;
+
     DISABLE_COPYING(reql_func_t);
 };
 
@@ -206,6 +223,7 @@ private:
 
     std::vector<sym_t> arg_names;
     counted_t<const term_t> body;
+    counted_t<const compiled_func_t> compiled_body;
 
     var_captures_t external_captures;
 };
@@ -0,0 +1,451 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/index_selection.hpp"
+
+#include <string.h>
+
+#include <map>
+#include <set>
+
+#include "rdb_protocol/btree.hpp"
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/real_table.hpp"
+#include "rdb_protocol/val.hpp"
+
+namespace ql {
+
+index_condition_t::index_condition_t(std::string _field, datum_t value)
+    : field(std::move(_field)), is_equality(true),
+      left_bound(value), right_bound(value), left_open(false), right_open(false) { }
+
+index_condition_t::index_condition_t(std::string _field,
+                                     datum_t _left_bound, bool _left_open,
+                                     datum_t _right_bound, bool _right_open)
+    : field(std::move(_field)), is_equality(false),
+      left_bound(std::move(_left_bound)), right_bound(std::move(_right_bound)),
+      left_open(_left_open), right_open(_right_open) { }
+
+datum_range_t index_condition_t::to_range() const {
+    if (is_equality) {
+        return datum_range_t(left_bound);
+    }
+    return datum_range_t(
+        left_bound, left_open ? key_range_t::open : key_range_t::closed,
+        right_bound, right_open ? key_range_t::open : key_range_t::closed);
+}
+
+std::string index_condition_t::print() const {
+    if (is_equality) {
+        return strprintf("get_all(%s)", left_bound.print().c_str());
+    }
+    return strprintf("between(%s, %s, left_bound=\"%s\", right_bound=\"%s\")",
+                     left_bound.print().c_str(),
+                     right_bound.print().c_str(),
+                     left_open ? "open" : "closed",
+                     right_open ? "open" : "closed");
+}
+
+std::string index_plan_t::print() const {
+    return strprintf("Filter using %s index `%s`: %s.",
+                     is_primary ? "primary" : "secondary",
+                     index.c_str(),
+                     condition.print().c_str());
+}
+
+namespace {
+
+// Only these can be compared to index keys without worrying about rows that the
+// index doesn't contain (objects and `null` are never indexed).
+bool is_indexable_literal(const datum_t &d) {
+    return d.get_type() == datum_t::R_NUM
+        || d.get_type() == datum_t::R_STR
+        || d.get_type() == datum_t::R_BOOL;
+}
+
+bool get_literal(const Term &t, datum_t *out) {
+    if (t.type() != Term::DATUM || !t.has_datum() || t.optargs_size() != 0) {
+        return false;
+    }
+    *out = to_datum(&t.datum(), configured_limits_t::unlimited);
+    return is_indexable_literal(*out);
+}
+
+// Parses the argument list of a `FUNC` term.
+bool get_func_args(const Term &func, std::vector<sym_t> *args_out) {
+    if (func.type() != Term::FUNC
+        || func.args_size() != 2
+        || func.optargs_size() != 0) {
+        return false;
+    }
+    const Term &vars = func.args(0);
+    if (vars.type() == Term::DATUM) {
+        const Datum &d = vars.datum();
+        if (d.type() != Datum::R_ARRAY) {
+            return false;
+        }
+        for (int i = 0; i < d.r_array_size(); ++i) {
+            if (d.r_array(i).type() != Datum::R_NUM) {
+                return false;
+            }
+            args_out->push_back(sym_t(d.r_array(i).r_num()));
+        }
+    } else if (vars.type() == Term::MAKE_ARRAY) {
+        for (int i = 0; i < vars.args_size(); ++i) {
+            const Term &var = vars.args(i);
+            if (var.type() != Term::DATUM || var.datum().type() != Datum::R_NUM) {
+                return false;
+            }
+            args_out->push_back(sym_t(var.datum().r_num()));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Checks whether `t` is `x(field)` or `x[field]`, where `x` is the only argument
+// of the function whose argument names are `arg_names`.
+bool is_row_field(const Term &t,
+                  const std::vector<sym_t> &arg_names,
+                  std::string *field_out) {
+    if ((t.type() != Term::GET_FIELD && t.type() != Term::BRACKET)
+        || t.args_size() != 2
+        || t.optargs_size() != 0
+        || arg_names.size() != 1) {
+        return false;
+    }
+    const Term &row = t.args(0);
+    const Term &key = t.args(1);
+    if (key.type() != Term::DATUM || key.datum().type() != Datum::R_STR) {
+        return false;
+    }
+    if (row.type() == Term::IMPLICIT_VAR) {
+        if (!function_emits_implicit_variable(arg_names)) {
+            return false;
+        }
+    } else if (row.type() == Term::VAR) {
+        if (row.args_size() != 1
+            || row.args(0).type() != Term::DATUM
+            || row.args(0).datum().type() != Datum::R_NUM
+            || static_cast<double>(arg_names[0].value) != row.args(0).datum().r_num()) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    *field_out = key.datum().r_str();
+    return true;
+}
+
+// A bound on a single field, as found in the predicate.
+class field_bound_t {
+public:
+    enum kind_t { EQUAL, LOWER, UPPER };
+    field_bound_t(std::string _field, kind_t _kind, datum_t _value, bool _open)
+        : field(std::move(_field)), kind(_kind), value(std::move(_value)),
+          open(_open) { }
+    std::string field;
+    kind_t kind;
+    datum_t value;
+    bool open;
+};
+
+// `between` has to special-case these too, as they don't make valid key ranges.
+bool is_empty_range(const field_bound_t &lower, const field_bound_t &upper) {
+    return lower.value.compare_gt(reql_version_t::LATEST, upper.value)
+        || ((lower.open || upper.open) && lower.value == upper.value);
+}
+
+class condition_finder_t {
+public:
+    condition_finder_t() { }
+
+    void find_in_predicate(const Term &predicate) {
+        if (predicate.type() == Term::FUNC) {
+            if (!get_func_args(predicate, &arg_names) || arg_names.size() != 1) {
+                return;
+            }
+            const Term &body = predicate.args(1);
+            // `filter_helper` treats these just like a literal object predicate.
+            if (body.type() == Term::MAKE_OBJ || body.type() == Term::DATUM) {
+                find_in_object(body);
+            } else {
+                find_in_expr(body);
+            }
+        } else {
+            find_in_object(predicate);
+        }
+    }
+
+    std::vector<index_condition_t> to_conditions() const {
+        std::vector<index_condition_t> ret;
+        std::set<std::string> seen;
+        for (auto it = bounds.begin(); it != bounds.end(); ++it) {
+            if (it->kind == field_bound_t::EQUAL && seen.insert(it->field).second) {
+                ret.push_back(index_condition_t(it->field, it->value));
+            }
+        }
+        // A range is only safe if both ends have the same type, because otherwise
+        // it could contain values of types that are never indexed.
+        for (auto it = bounds.begin(); it != bounds.end(); ++it) {
+            if (it->kind != field_bound_t::LOWER || seen.count(it->field) != 0) {
+                continue;
+            }
+            for (auto jt = bounds.begin(); jt != bounds.end(); ++jt) {
+                if (jt->kind == field_bound_t::UPPER
+                    && jt->field == it->field
+                    && jt->value.get_type() == it->value.get_type()
+                    && it->value.get_type() != datum_t::R_BOOL
+                    && !is_empty_range(*it, *jt)) {
+                    seen.insert(it->field);
+                    ret.push_back(index_condition_t(it->field,
+                                                    it->value, it->open,
+                                                    jt->value, jt->open));
+                    break;
+                }
+            }
+        }
+        return ret;
+    }
+
+private:
+    // An object predicate accepts a row if each field of the row equals the
+    // corresponding field of the object (see `filter_match`).
+    void find_in_object(const Term &t) {
+        if (t.type() == Term::MAKE_OBJ) {
+            if (t.args_size() != 0) {
+                return;
+            }
+            for (int i = 0; i < t.optargs_size(); ++i) {
+                datum_t value;
+                if (get_literal(t.optargs(i).val(), &value)) {
+                    bounds.push_back(field_bound_t(t.optargs(i).key(),
+                                                   field_bound_t::EQUAL,
+                                                   value, false));
+                }
+            }
+        } else if (t.type() == Term::DATUM && t.has_datum()) {
+            datum_t obj = to_datum(&t.datum(), configured_limits_t::unlimited);
+            if (obj.get_type() != datum_t::R_OBJECT || obj.is_ptype()) {
+                return;
+            }
+            for (size_t i = 0; i < obj.obj_size(); ++i) {
+                std::pair<datum_string_t, datum_t> pair = obj.get_pair(i);
+                if (is_indexable_literal(pair.second)) {
+                    bounds.push_back(field_bound_t(pair.first.to_std(),
+                                                   field_bound_t::EQUAL,
+                                                   pair.second, false));
+                }
+            }
+        }
+    }
+
+    void find_in_expr(const Term &t) {
+        if (t.optargs_size() != 0) {
+            return;
+        }
+        const Term::TermType type = t.type();
+        if (type == Term::ALL) {
+            for (int i = 0; i < t.args_size(); ++i) {
+                find_in_expr(t.args(i));
+            }
+        } else if (type == Term::EQ || type == Term::LT || type == Term::LE
+                   || type == Term::GT || type == Term::GE) {
+            if (t.args_size() != 2) {
+                return;
+            }
+            std::string field;
+            datum_t value;
+            bool flipped;
+            if (is_row_field(t.args(0), arg_names, &field)
+                && get_literal(t.args(1), &value)) {
+                flipped = false;
+            } else if (is_row_field(t.args(1), arg_names, &field)
+                       && get_literal(t.args(0), &value)) {
+                flipped = true;
+            } else {
+                return;
+            }
+            if (t.type() == Term::EQ) {
+                bounds.push_back(
+                    field_bound_t(field, field_bound_t::EQUAL, value, false));
+            } else {
+                // `5 < x(field)` is the same as `x(field) > 5`.
+                const bool greater = (t.type() == Term::GT || t.type() == Term::GE);
+                const bool open = (t.type() == Term::GT || t.type() == Term::LT);
+                bounds.push_back(
+                    field_bound_t(field,
+                                  greater != flipped
+                                      ? field_bound_t::LOWER
+                                      : field_bound_t::UPPER,
+                                  value, open));
+            }
+        }
+    }
+
+    std::vector<sym_t> arg_names;
+    std::vector<field_bound_t> bounds;
+
+    DISABLE_COPYING(condition_finder_t);
+};
+
+// Checks whether an index function is `function(x) { return x(field); }`.
+class field_mapping_visitor_t : public func_visitor_t {
+public:
+    explicit field_mapping_visitor_t(const std::string &_field)
+        : field(_field), matches(false) { }
+
+    void on_reql_func(const reql_func_t *reql_func) {
+        std::string mapped_field;
+        matches = is_row_field(*reql_func->get_body_src(),
+                               reql_func->get_arg_names(),
+                               &mapped_field)
+            && mapped_field == field;
+    }
+    void on_js_func(const js_func_t *) {
+        matches = false;
+    }
+
+    const std::string &field;
+    bool matches;
+};
+
+bool status_flag(const datum_t &status, const char *name) {
+    datum_t flag = status.get_field(name, NOTHROW);
+    return flag.has() && flag.get_type() == datum_t::R_BOOL && flag.as_bool();
+}
+
+// `status` is what `base_table_t::sindex_status` reports for one index.
+bool index_maps_field(const datum_t &status, const std::string &field) {
+    if (!status_flag(status, "ready")
+        || status_flag(status, "outdated")
+        || status_flag(status, "multi")
+        || status_flag(status, "geo")) {
+        return false;
+    }
+    datum_t function = status.get_field("function", NOTHROW);
+    if (!function.has() || function.get_type() != datum_t::R_BINARY) {
+        return false;
+    }
+    const datum_string_t &blob = function.as_binary();
+    const size_t prefix_size = strlen(sindex_blob_prefix);
+    if (blob.size() < prefix_size
+        || memcmp(blob.data(), sindex_blob_prefix, prefix_size) != 0) {
+        return false;
+    }
+    std::vector<char> data(blob.data() + prefix_size, blob.data() + blob.size());
+    sindex_disk_info_t sindex_info;
+    try {
+        deserialize_sindex_info(data, &sindex_info);
+    } catch (const archive_exc_t &) {
+        return false;
+    }
+    field_mapping_visitor_t visitor(field);
+    sindex_info.mapping.compile_wire_func()->visit(&visitor);
+    return visitor.matches;
+}
+
+// Reads through `source`, but reports the change spec of a scan of the whole table.
+// The index is only a shortcut for finding the rows `filter` keeps, so
+// `table.filter(...).changes()` must still watch the whole table, however the
+// selection reached `changes()`.
+class index_plan_datum_stream_t : public datum_stream_t {
+public:
+    explicit index_plan_datum_stream_t(counted_t<datum_stream_t> _source)
+        : datum_stream_t(_source->backtrace()), source(std::move(_source)) { }
+
+    virtual bool is_array() { return source->is_array(); }
+    virtual datum_t as_array(env_t *env) { return source->as_array(env); }
+    virtual bool is_exhausted() const {
+        return source->is_exhausted() && batch_cache_exhausted();
+    }
+    virtual bool is_cfeed() const { return source->is_cfeed(); }
+
+private:
+    virtual changefeed::keyspec_t get_change_spec() {
+        return changefeed::keyspec_t(changefeed::keyspec_t::range_t(
+            boost::none, sorting_t::UNORDERED, datum_range_t::universe()));
+    }
+    virtual void add_transformation(transform_variant_t &&tv,
+                                    const protob_t<const Backtrace> &bt) {
+        source->add_transformation(std::move(tv), bt);
+    }
+    virtual void accumulate(
+        env_t *env, eager_acc_t *acc, const terminal_variant_t &tv) {
+        source->accumulate(env, acc, tv);
+    }
+    virtual void accumulate_all(env_t *env, eager_acc_t *acc) {
+        source->accumulate_all(env, acc);
+    }
+    virtual std::vector<datum_t>
+    next_batch_impl(env_t *env, const batchspec_t &batchspec) {
+        return source->next_batch(env, batchspec);
+    }
+
+    const counted_t<datum_stream_t> source;
+};
+
+}  // namespace
+
+std::vector<index_condition_t> find_index_conditions(const Term &predicate) {
+    condition_finder_t finder;
+    finder.find_in_predicate(predicate);
+    return finder.to_conditions();
+}
+
+boost::optional<index_plan_t> choose_index_plan(
+        env_t *env, table_t *table, const std::vector<index_condition_t> &conditions) {
+    if (conditions.empty()) {
+        return boost::none;
+    }
+    const std::string &pkey = table->get_pkey();
+    for (auto it = conditions.begin(); it != conditions.end(); ++it) {
+        if (it->field == pkey) {
+            return index_plan_t(pkey, true, *it);
+        }
+    }
+
+    // The status read always goes to the primaries, which a query that reads
+    // outdated data shouldn't depend on.
+    if (table->uses_outdated()) {
+        return boost::none;
+    }
+    // A filter can be evaluated many times in a query, for example in a subquery of
+    // a `map`, so the status is only read once per table and query.
+    std::map<std::string, std::map<std::string, datum_t> > *cache
+        = &env->query_cache().sindex_statuses;
+    auto cached = cache->find(table->display_name());
+    if (cached == cache->end()) {
+        std::map<std::string, datum_t> statuses;
+        try {
+            // An empty set means all of the indexes.
+            statuses = table->tbl->sindex_status(env, std::set<std::string>());
+        } catch (const base_exc_t &) {
+            // The table scan will report the problem, if there still is one.  We
+            // remember that there's no usable index for the rest of the query.
+        }
+        cached = cache->insert(std::make_pair(table->display_name(),
+                                              std::move(statuses))).first;
+    }
+    const std::map<std::string, datum_t> &statuses = cached->second;
+    for (auto it = conditions.begin(); it != conditions.end(); ++it) {
+        for (auto jt = statuses.begin(); jt != statuses.end(); ++jt) {
+            if (index_maps_field(jt->second, it->field)) {
+                return index_plan_t(jt->first, false, *it);
+            }
+        }
+    }
+    return boost::none;
+}
+
+counted_t<datum_stream_t> read_with_index_plan(
+        env_t *env, table_t *table, const index_plan_t &plan,
+        const protob_t<const Backtrace> &bt) {
+    return make_counted<index_plan_datum_stream_t>(
+        table->as_seq(env, plan.index, bt, plan.condition.to_range(),
+                      sorting_t::UNORDERED));
+}
+
+}  // namespace ql
@@ -0,0 +1,84 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_INDEX_SELECTION_HPP_
+#define RDB_PROTOCOL_INDEX_SELECTION_HPP_
+
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/optional.hpp>
+
+#include "containers/counted.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum.hpp"
+
+class Term;
+
+namespace ql {
+
+class datum_stream_t;
+class env_t;
+class table_t;
+
+/* `filter` on a whole table normally scans every row.  If its predicate can only
+ * be true when a top-level field of the row equals a literal (or lies between two
+ * literals of the same type), and that field is the primary key or has a ready
+ * secondary index defined as just `row(field)`, we read the matching part of the
+ * index instead, like `get_all` or `between` would.  The predicate is still
+ * applied to every row we read, so the index only has to return a superset of the
+ * rows the scan would have returned. */
+
+// A condition that every row accepted by a `filter` predicate satisfies.
+class index_condition_t {
+public:
+    index_condition_t(std::string _field, datum_t value);
+    index_condition_t(std::string _field,
+                      datum_t _left_bound, bool _left_open,
+                      datum_t _right_bound, bool _right_open);
+
+    std::string field;
+    bool is_equality;
+    datum_t left_bound, right_bound;
+    bool left_open, right_open;
+
+    datum_range_t to_range() const;
+
+    // E.g. `get_all("open")` or `between(1, 10, right_bound="open")`.
+    std::string print() const;
+};
+
+// Returns the conditions implied by the predicate of a `filter` term, the most
+// selective ones first.  The predicate can be an object literal or a function of
+// one argument.  Returns an empty vector if nothing useful could be found.
+std::vector<index_condition_t> find_index_conditions(const Term &predicate);
+
+// The access path chosen for a particular `filter`.
+class index_plan_t {
+public:
+    index_plan_t(std::string _index, bool _is_primary, index_condition_t _condition)
+        : index(std::move(_index)), is_primary(_is_primary),
+          condition(std::move(_condition)) { }
+
+    std::string index;
+    bool is_primary;
+    index_condition_t condition;
+
+    // Shows up in the profile of the query.
+    std::string print() const;
+};
+
+// Picks the first condition that can be served by an index of `table`.  Secondary
+// indexes are looked up through the index status reported by the store, which
+// tells us whether they are ready and how they are defined.
+boost::optional<index_plan_t> choose_index_plan(
+    env_t *env, table_t *table, const std::vector<index_condition_t> &conditions);
+
+// Reads the rows of `table` that satisfy `plan.condition` from the chosen index.
+// `changes()` on the result still watches the whole table.
+counted_t<datum_stream_t> read_with_index_plan(
+    env_t *env, table_t *table, const index_plan_t &plan,
+    const protob_t<const Backtrace> &bt);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_INDEX_SELECTION_HPP_
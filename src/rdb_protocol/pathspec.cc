@@ -187,6 +187,21 @@ datum_t project(datum_t datum,
     }
 }
 
+datum_t project_fields(datum_t datum, const std::vector<std::string> &fields) {
+    if (datum.get_type() != datum_t::R_OBJECT) {
+        return datum;
+    }
+    datum_object_builder_t res;
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        datum_string_t str(*it);
+        const datum_t val = datum.get_field(str, NOTHROW);
+        if (val.has()) {
+            res.overwrite(std::move(str), val);
+        }
+    }
+    return std::move(res).to_datum();
+}
+
 void unproject_helper(datum_object_builder_t *datum,
                       const pathspec_t &pathspec,
                       recurse_flag_t recurse,
@@ -88,6 +88,9 @@ enum recurse_flag_t {
 datum_t project(datum_t datum,
                 const pathspec_t &pathspec, recurse_flag_t recurse,
                 const configured_limits_t &limits);
+/* Like `project` with a pathspec made of top-level field names.  Non-objects are
+returned unchanged.  This is what shards apply to point reads with a projection. */
+datum_t project_fields(datum_t datum, const std::vector<std::string> &fields);
 /* Limit the datum to only the paths not specified by the pathspec. */
 datum_t unproject(datum_t datum,
                   const pathspec_t &pathspec, recurse_flag_t recurse,
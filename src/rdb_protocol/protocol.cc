@@ -7,6 +7,7 @@
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "containers/cow_ptr.hpp"
 #include "containers/disk_backed_queue.hpp"
 #include "rdb_protocol/btree.hpp"
@@ -69,7 +70,7 @@ void bring_sindexes_up_to_date(
         buf_lock_t *sindex_block)
     THROWS_NOTHING
 {
-    with_priority_t p(CORO_PRIORITY_SINDEX_CONSTRUCTION);
+    with_sched_class_t sched_class(sched_class_t::BACKGROUND);
 
     /* We register our modification queue here.
      * We must register it before calling post_construct_and_drain_queue to
@@ -1179,7 +1180,7 @@ RDB_IMPL_ME_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_point_stamp_response_t, stamp, initial_val);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_response_t, response, event_log, n_shards);
 
-RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_read_t, key);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(point_read_t, key, projection);
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(sindex_rangespec_t, id, region, original_range);
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
@@ -298,8 +298,13 @@ class point_read_t {
 public:
     point_read_t() { }
     explicit point_read_t(const store_key_t& _key) : key(_key) { }
+    point_read_t(const store_key_t& _key, std::vector<std::string> _projection)
+        : key(_key), projection(std::move(_projection)) { }
 
     store_key_t key;
+    // If set, the shard only returns these top-level fields of the row (like
+    // `pluck` would), so that the rest of the row isn't sent over the network.
+    boost::optional<std::vector<std::string> > projection;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(point_read_t);
 
@@ -12,6 +12,8 @@
 rdb_query_server_t::rdb_query_server_t(const std::set<ip_address_t> &local_addresses,
                                        int port,
                                        rdb_context_t *_rdb_ctx) :
+    plan_cache_stats(&_rdb_ctx->ql_stats_collection),
+    plan_caches(&plan_cache_stats),
     server(_rdb_ctx, local_addresses, port, this, _rdb_ctx->auth_metadata),
     rdb_ctx(_rdb_ctx),
     thread_counters(0)
@@ -33,6 +35,7 @@ namespace ql {
              rdb_context_t *ctx,
              signal_t *interruptor,
              stream_cache_t *stream_cache,
+             plan_cache_t *plan_cache,
              Response *response_out);
 }
 
@@ -52,8 +55,9 @@ private:
 
 bool rdb_query_server_t::run_query(const ql::protob_t<Query> &query,
                                    Response *response_out,
-                                   client_context_t *client_ctx) {
-    guarantee(client_ctx->interruptor != NULL);
+                                   client_context_t *client_ctx,
+                                   signal_t *interruptor) {
+    guarantee(interruptor != NULL);
     response_out->set_token(query->token());
 
     ql::datum_t noreply = static_optarg("noreply", query);
@@ -66,8 +70,9 @@ bool rdb_query_server_t::run_query(const ql::protob_t<Query> &query,
         // `ql::run` will set the status code
         ql::run(query,
                 rdb_ctx,
-                client_ctx->interruptor,
+                interruptor,
                 &client_ctx->stream_cache,
+                plan_caches.get(),
                 response_out);
     } catch (const ql::exc_t &e) {
         fill_error(response_out, Response::COMPILE_ERROR, e.what(), e.backtrace());
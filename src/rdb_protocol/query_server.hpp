@@ -8,6 +8,7 @@
 #include "arch/address.hpp"
 #include "protob/protob.hpp"
 #include "concurrency/one_per_thread.hpp"
+#include "rdb_protocol/env.hpp"
 #include "rdb_protocol/ql2.pb.h"
 #include "rdb_protocol/stream_cache.hpp"
 
@@ -28,12 +29,18 @@ public:
 
     MUST_USE bool run_query(const ql::protob_t<Query> &query,
                             Response *response_out,
-                            client_context_t *client_ctx);
+                            client_context_t *client_ctx,
+                            signal_t *interruptor);
 
     void unparseable_query(int64_t token,
                            Response *response_out,
                            const std::string &info);
 public:
+    // These come before `server`, which may start running queries as soon as it's
+    // constructed.
+    ql::plan_cache_stats_t plan_cache_stats;
+    one_per_thread_t<ql::plan_cache_t> plan_caches;
+
     query_server_t server;
     rdb_context_t *rdb_ctx;
     one_per_thread_t<int> thread_counters;
@@ -0,0 +1,207 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "rdb_protocol/read_cache.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/pmap.hpp"
+#include "protocol_api.hpp"
+
+point_read_cache_stats_t::point_read_cache_stats_t(perfmon_collection_t *parent,
+                                                   const std::string &table_name)
+    : collection(),
+      collection_membership(parent, &collection, table_name),
+      pm_hits(secs_to_ticks(1)),
+      pm_misses(secs_to_ticks(1)),
+      pm_membership(&collection,
+          &pm_hits, "hits",
+          &pm_total_hits, "total_hits",
+          &pm_misses, "misses",
+          &pm_total_misses, "total_misses") { }
+
+point_read_cache_t::point_read_cache_t(ql::changefeed::client_t *_changefeed_client,
+                                       namespace_id_t _table,
+                                       std::string _pkey,
+                                       point_read_cache_stats_t *_stats)
+    : changefeed_client(_changefeed_client),
+      table(_table),
+      pkey(std::move(_pkey)),
+      stats(_stats),
+      state(state_t::UNSUBSCRIBED),
+      rows(POINT_READ_CACHE_SIZE),
+      next_version(1),
+      served_since_ring(false),
+      idle_timer(new repeating_timer_t(POINT_READ_CACHE_IDLE_MS, this)) { }
+
+point_read_cache_t::~point_read_cache_t() {
+    idle_timer.reset();
+    drainer.drain();
+    unsubscribe();
+}
+
+ql::datum_t point_read_cache_t::read(const store_key_t &key,
+                                     signal_t *interruptor,
+                                     const std::function<ql::datum_t()> &read_row) {
+    assert_thread();
+    if (!maybe_subscribe(interruptor)) {
+        return read_row();
+    }
+
+    auto it = rows.find(key);
+    if (it != rows.end() && it->second.row.has()) {
+        stats->pm_hits.record();
+        ++stats->pm_total_hits;
+        served_since_ring = true;
+        return it->second.row;
+    }
+    stats->pm_misses.record();
+    ++stats->pm_total_misses;
+
+    // If another read of the row is already in flight, we take over its placeholder,
+    // so only the last one to start fills it.
+    const uint64_t version = next_version++;
+    rows[key].version = version;
+
+    ql::datum_t row = read_row();
+
+    // `on_change()`, `on_stop()` or `invalidate()` may have evicted the placeholder
+    // while we were reading.
+    it = rows.find(key);
+    if (it != rows.end() && it->second.version == version) {
+        it->second.row = row;
+    }
+    return row;
+}
+
+ql::datum_t point_read_cache_t::cached_row(const store_key_t &key) {
+    assert_thread();
+    auto it = rows.find(key);
+    if (state != state_t::SUBSCRIBED || it == rows.end() || !it->second.row.has()) {
+        stats->pm_misses.record();
+        ++stats->pm_total_misses;
+        return ql::datum_t();
+    }
+    stats->pm_hits.record();
+    ++stats->pm_total_hits;
+    served_since_ring = true;
+    return it->second.row;
+}
+
+void point_read_cache_t::invalidate(const std::vector<store_key_t> &keys) {
+    assert_thread();
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+        rows.erase(*it);
+    }
+}
+
+void point_read_cache_t::on_change(const ql::datum_t &pkey_val) {
+    assert_thread();
+    rows.erase(store_key_t(pkey_val.print_primary()));
+}
+
+void point_read_cache_t::on_stop() {
+    assert_thread();
+    rows.clear();
+    // The next read tries again.
+    state = state_t::UNSUBSCRIBED;
+    coro_t::spawn_sometime(std::bind(&point_read_cache_t::drop_subscription,
+                                     this,
+                                     auto_drainer_t::lock_t(&drainer)));
+}
+
+void point_read_cache_t::on_ring() {
+    assert_thread();
+    if (state == state_t::SUBSCRIBED && !served_since_ring) {
+        rows.clear();
+        state = state_t::UNSUBSCRIBED;
+        coro_t::spawn_sometime(std::bind(&point_read_cache_t::drop_subscription,
+                                         this,
+                                         auto_drainer_t::lock_t(&drainer)));
+    }
+    served_since_ring = false;
+}
+
+void point_read_cache_t::drop_subscription(auto_drainer_t::lock_t keepalive) {
+    // If a read has started subscribing again in the meantime, it has already
+    // dropped the old subscription, and we mustn't drop the new one.
+    if (!keepalive.get_drain_signal()->is_pulsed() && state == state_t::UNSUBSCRIBED) {
+        unsubscribe();
+    }
+}
+
+bool point_read_cache_t::subscribe_to_changes(signal_t *interruptor) {
+    return subscribe(changefeed_client, table, pkey, interruptor);
+}
+
+bool point_read_cache_t::maybe_subscribe(signal_t *interruptor) {
+    switch (state) {
+    case state_t::SUBSCRIBED:
+        return true;
+    case state_t::SUBSCRIBING:
+        // Another read is subscribing; this one goes to the shards.
+        return false;
+    case state_t::UNSUBSCRIBED: {
+        state = state_t::SUBSCRIBING;
+        bool subscribed = false;
+        try {
+            subscribed = subscribe_to_changes(interruptor);
+        } catch (const cannot_perform_query_exc_t &) {
+            // The read will most likely fail the same way, and report it.
+        } catch (const interrupted_exc_t &) {
+            state = state_t::UNSUBSCRIBED;
+            throw;
+        }
+        // Anything cached before `on_stop()` may be out of date.
+        rows.clear();
+        state = subscribed ? state_t::SUBSCRIBED : state_t::UNSUBSCRIBED;
+        // A new subscription gets until the next ring but one to serve a row.
+        served_since_ring = true;
+        return subscribed;
+    }
+    default:
+        unreachable();
+    }
+}
+
+point_read_cache_manager_t::point_read_cache_manager_t(
+        ql::changefeed::client_t *_changefeed_client,
+        const std::set<std::string> &table_names,
+        perfmon_collection_t *parent)
+    : changefeed_client(_changefeed_client),
+      collection(),
+      collection_membership(parent, &collection, "read_cache") {
+    for (auto it = table_names.begin(); it != table_names.end(); ++it) {
+        stats.insert(std::make_pair(
+            *it, make_scoped<point_read_cache_stats_t>(&collection, *it)));
+    }
+}
+
+point_read_cache_t *point_read_cache_manager_t::get(const std::string &table_name,
+                                                    const namespace_id_t &table,
+                                                    const std::string &pkey) {
+    auto stats_it = stats.find(table_name);
+    if (stats_it == stats.end()) {
+        return NULL;
+    }
+    std::map<namespace_id_t, scoped_ptr_t<point_read_cache_t> > *thread_caches =
+        caches.get();
+    auto it = thread_caches->find(table);
+    if (it == thread_caches->end()) {
+        it = thread_caches->insert(std::make_pair(
+            table, make_scoped<point_read_cache_t>(
+                changefeed_client, table, pkey, stats_it->second.get()))).first;
+    }
+    return it->second.get();
+}
+
+void point_read_cache_manager_t::invalidate(const namespace_id_t &table,
+                                            const std::vector<store_key_t> &keys) {
+    pmap(get_num_threads(), [&](int i) {
+            on_thread_t thread_switcher((threadnum_t(i)));
+            std::map<namespace_id_t, scoped_ptr_t<point_read_cache_t> >
+                *thread_caches = caches.get();
+            auto it = thread_caches->find(table);
+            if (it != thread_caches->end()) {
+                it->second->invalidate(keys);
+            }
+        });
+}
@@ -0,0 +1,162 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_READ_CACHE_HPP_
+#define RDB_PROTOCOL_READ_CACHE_HPP_
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "btree/keys.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "containers/lru_cache.hpp"
+#include "containers/uuid.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/changefeed.hpp"
+
+// How many rows each thread keeps for each cached table.
+const size_t POINT_READ_CACHE_SIZE = 1024;
+
+// How often each thread checks whether its caches are still being read.
+const int64_t POINT_READ_CACHE_IDLE_MS = 30 * 1000;
+
+class point_read_cache_stats_t {
+public:
+    point_read_cache_stats_t(perfmon_collection_t *parent,
+                             const std::string &table_name);
+
+    perfmon_collection_t collection;
+    perfmon_membership_t collection_membership;
+    perfmon_rate_monitor_t pm_hits, pm_misses;
+    perfmon_counter_t pm_total_hits, pm_total_misses;
+    perfmon_multi_membership_t pm_membership;
+};
+
+/* `point_read_cache_t` remembers the results of recent point reads (`get()` and
+`get_all()` on the primary key) of one table, so that reads of hot keys don't have to
+go to the shards.  There is one per thread, so that looking a row up never needs a lock
+or a thread switch.
+
+The cache keeps itself up to date by listening to the table's changefeed: every write
+the shards report evicts its row.  If we stop hearing from the shards, we drop all the
+rows and don't cache anything until we manage to subscribe again.  A change can reach
+us after the write was acknowledged, so writes made through this machine also evict
+their rows from the caches on every thread before they return; that way a client
+always reads its own writes.  Writes made through other machines only show once their
+changes arrive.
+
+If no row has been served from the cache for a while (between one and two
+`POINT_READ_CACHE_IDLE_MS`), we drop the rows and the subscription, so that tables that
+aren't being read don't keep their feeds alive.  The next read subscribes again.
+Evicting rows doesn't drop the subscription: setting a feed up costs much more than a
+read, and a hot row that keeps being written would otherwise pay for it every time.
+
+A read that misses leaves a placeholder with a new version number behind.  If the row
+changes while the read is in flight the placeholder gets evicted, and the result of the
+read isn't cached. */
+class point_read_cache_t : public ql::changefeed::key_listener_t,
+                           public repeating_timer_callback_t {
+public:
+    point_read_cache_t(ql::changefeed::client_t *changefeed_client,
+                       namespace_id_t table,
+                       std::string pkey,
+                       point_read_cache_stats_t *stats);
+    ~point_read_cache_t();
+
+    // Returns the cached row for `key`, or calls `read_row` and caches its result.
+    ql::datum_t read(const store_key_t &key,
+                     signal_t *interruptor,
+                     const std::function<ql::datum_t()> &read_row);
+
+    // Returns the cached row for `key`, or an empty datum if it isn't cached.  Unlike
+    // `read`, this doesn't cache anything; it's for reads that only need part of the
+    // row.
+    ql::datum_t cached_row(const store_key_t &key);
+
+    // Evicts the rows for `keys`.
+    void invalidate(const std::vector<store_key_t> &keys);
+
+protected:
+    // Subscribes to the table's changes, like `key_listener_t::subscribe()`.  Tests
+    // override it so that they can stand in for the changefeed.
+    virtual bool subscribe_to_changes(signal_t *interruptor);
+
+    void on_change(const ql::datum_t &pkey);
+    void on_stop();
+
+    // Drops the subscription if no row has been served since the last time.
+    void on_ring();
+
+private:
+    // Returns true if we're subscribed to the table's changes, trying to subscribe
+    // if we aren't.
+    bool maybe_subscribe(signal_t *interruptor);
+
+    // The feed can't drop subscriptions while it calls us, and timers can't block,
+    // so the subscription is dropped in another coroutine.
+    void drop_subscription(auto_drainer_t::lock_t keepalive);
+
+    ql::changefeed::client_t *const changefeed_client;
+    const namespace_id_t table;
+    const std::string pkey;
+    point_read_cache_stats_t *const stats;
+
+    enum class state_t { UNSUBSCRIBED, SUBSCRIBING, SUBSCRIBED };
+    state_t state;
+
+    struct entry_t {
+        entry_t() : version(0) { }
+        uint64_t version;
+        // Empty while the read that will fill it is in flight.
+        ql::datum_t row;
+    };
+    lru_cache_t<store_key_t, entry_t> rows;
+    uint64_t next_version;
+
+    // Whether a row has been served since `idle_timer` last rang.
+    bool served_since_ring;
+    // Reset before draining, so that it doesn't spawn anything while we drain.
+    scoped_ptr_t<repeating_timer_t> idle_timer;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(point_read_cache_t);
+};
+
+/* `point_read_cache_manager_t` owns the point read caches of the tables that were
+named with `--read-cache` on the command line, and their stats, which show up under
+`read_cache`. */
+class point_read_cache_manager_t {
+public:
+    point_read_cache_manager_t(ql::changefeed::client_t *changefeed_client,
+                               const std::set<std::string> &table_names,
+                               perfmon_collection_t *parent);
+
+    // Returns the calling thread's cache for the table called `table_name` (as
+    // `db.table`), or `NULL` if it isn't cached.
+    point_read_cache_t *get(const std::string &table_name,
+                            const namespace_id_t &table,
+                            const std::string &pkey);
+
+    // Evicts the rows for `keys` from every thread's cache of `table`.  Called after
+    // writes made through this machine.
+    void invalidate(const namespace_id_t &table, const std::vector<store_key_t> &keys);
+
+private:
+    ql::changefeed::client_t *const changefeed_client;
+
+    perfmon_collection_t collection;
+    perfmon_membership_t collection_membership;
+    // This doesn't change after construction, so every thread can read it.
+    std::map<std::string, scoped_ptr_t<point_read_cache_stats_t> > stats;
+
+    one_per_thread_t<std::map<namespace_id_t, scoped_ptr_t<point_read_cache_t> > >
+        caches;
+
+    DISABLE_COPYING(point_read_cache_manager_t);
+};
+
+#endif  // RDB_PROTOCOL_READ_CACHE_HPP_
@@ -1,13 +1,32 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved
 #include "rdb_protocol/real_table.hpp"
 
+#include <exception>
+
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/distances.hpp"
 #include "rdb_protocol/context.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/math_utils.hpp"
+#include "rdb_protocol/pathspec.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/read_cache.hpp"
+
+namespace {
+
+// Profiled reads have to go to the shards to say what they did there.  Outdated reads
+// can see rows that are older than the ones we cache, so they neither use nor fill the
+// cache.
+bool can_use_read_cache(point_read_cache_t *read_cache,
+                        ql::env_t *env,
+                        bool use_outdated) {
+    return read_cache != NULL
+        && env->profile() == profile_bool_t::DONT_PROFILE
+        && !use_outdated;
+}
+
+}  // namespace
 
 namespace_interface_access_t::namespace_interface_access_t() :
     nif(NULL), ref_tracker(NULL), thread(INVALID_THREAD)
@@ -69,7 +88,39 @@ const std::string &real_table_t::get_pkey() {
 
 ql::datum_t real_table_t::read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated) {
-    read_t read(point_read_t(store_key_t(pval.print_primary())), env->profile());
+    store_key_t key(pval.print_primary());
+    if (can_use_read_cache(read_cache, env, use_outdated)) {
+        return read_cache->read(key, env->interruptor, [&]() {
+                return read_row_uncached(env, key, use_outdated);
+            });
+    }
+    return read_row_uncached(env, key, use_outdated);
+}
+
+ql::datum_t real_table_t::read_row_uncached(ql::env_t *env,
+        const store_key_t &key, bool use_outdated) {
+    read_t read(point_read_t(key), env->profile());
+    read_response_t res;
+    read_with_profile(env, read, &res, use_outdated);
+    point_read_response_t *p_res = boost::get<point_read_response_t>(&res.response);
+    r_sanity_check(p_res);
+    return p_res->data;
+}
+
+ql::datum_t real_table_t::read_row_fields(ql::env_t *env,
+        ql::datum_t pval, bool use_outdated,
+        const std::vector<std::string> &fields) {
+    store_key_t key(pval.print_primary());
+    // If we have the whole row, we pick the fields out of it ourselves.  Otherwise
+    // the shards send just the fields, and since that's not the whole row, it isn't
+    // cached.
+    if (can_use_read_cache(read_cache, env, use_outdated)) {
+        ql::datum_t row = read_cache->cached_row(key);
+        if (row.has()) {
+            return ql::project_fields(row, fields);
+        }
+    }
+    read_t read(point_read_t(key, fields), env->profile());
     read_response_t res;
     read_with_profile(env, read, &res, use_outdated);
     point_read_response_t *p_res = boost::get<point_read_response_t>(&res.response);
@@ -210,11 +261,15 @@ ql::datum_t real_table_t::write_batched_replace(ql::env_t *env,
     for (auto it = keys.begin(); it != keys.end(); it++) {
         store_keys.push_back(store_key_t((*it).print_primary()));
     }
+    std::vector<store_key_t> written_keys;
+    if (read_cache != NULL) {
+        written_keys = store_keys;
+    }
     batched_replace_t write(std::move(store_keys), pkey, func,
             env->get_all_optargs(), return_changes);
     write_t w(std::move(write), durability, env->profile(), env->limits());
     write_response_t response;
-    write_with_profile(env, &w, &response);
+    write_and_invalidate(env, &w, &response, written_keys);
     auto dp = boost::get<ql::datum_t>(&response.response);
     r_sanity_check(dp != NULL);
     return *dp;
@@ -224,11 +279,25 @@ ql::datum_t real_table_t::write_batched_insert(ql::env_t *env,
         std::vector<ql::datum_t> &&inserts,
         conflict_behavior_t conflict_behavior, return_changes_t return_changes,
         durability_requirement_t durability) {
+    std::vector<store_key_t> written_keys;
+    if (read_cache != NULL) {
+        written_keys.reserve(inserts.size());
+        for (auto it = inserts.begin(); it != inserts.end(); ++it) {
+            ql::datum_t pval = it->get_field(datum_string_t(pkey), ql::NOTHROW);
+            try {
+                if (pval.has()) {
+                    written_keys.push_back(store_key_t(pval.print_primary()));
+                }
+            } catch (const ql::base_exc_t &) {
+                // The shard will reject the row, so it can't be cached either.
+            }
+        }
+    }
     batched_insert_t write(std::move(inserts), pkey, conflict_behavior, env->limits(),
         return_changes);
     write_t w(std::move(write), durability, env->profile(), env->limits());
     write_response_t response;
-    write_with_profile(env, &w, &response);
+    write_and_invalidate(env, &w, &response, written_keys);
     auto dp = boost::get<ql::datum_t>(&response.response);
     r_sanity_check(dp != NULL);
     return *dp;
@@ -354,6 +423,26 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
     splitter.give_splits(response->n_shards, response->event_log);
 }
 
+void real_table_t::write_and_invalidate(ql::env_t *env, write_t *write,
+        write_response_t *response, const std::vector<store_key_t> &written_keys) {
+    if (read_cache == NULL) {
+        write_with_profile(env, write, response);
+        return;
+    }
+    std::exception_ptr exc;
+    try {
+        write_with_profile(env, write, response);
+    } catch (...) {
+        exc = std::current_exception();
+    }
+    // We evict the rows even if the write failed, because it may have happened
+    // anyway.  We can't do it in the `catch` statement, since it switches threads.
+    read_cache_manager->invalidate(uuid, written_keys);
+    if (exc) {
+        std::rethrow_exception(exc);
+    }
+}
+
 void real_table_t::write_with_profile(ql::env_t *env, write_t *write,
         write_response_t *response) {
     profile::starter_t starter("Perform write", env->trace);
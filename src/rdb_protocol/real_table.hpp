@@ -12,6 +12,9 @@
 
 const char *const sindex_blob_prefix = "$reql_index_function$";
 
+class point_read_cache_manager_t;
+class point_read_cache_t;
+
 namespace ql {
 class datum_range_t;
 namespace changefeed {
@@ -21,7 +24,9 @@ class client_t;
 
 /* `real_table_t` is a concrete subclass of `base_table_t` that routes its queries across
 the network via the clustering logic to a B-tree. The administration logic is responsible
-for constructing and returning them from `reql_cluster_interface_t::table_find()`. */
+for constructing and returning them from `reql_cluster_interface_t::table_find()`.
+If the table has a `point_read_cache_t`, point reads go through it, and plucked point
+reads of rows it holds are served from it. */
 
 /* `namespace_interface_access_t` is like a smart pointer to a `namespace_interface_t`.
 This is the format in which `real_table_t` expects to receive its
@@ -59,14 +64,20 @@ public:
             namespace_id_t _uuid,
             namespace_interface_access_t _namespace_access,
             const std::string &_pkey,
-            ql::changefeed::client_t *_changefeed_client) :
+            ql::changefeed::client_t *_changefeed_client,
+            point_read_cache_manager_t *_read_cache_manager,
+            point_read_cache_t *_read_cache) :
         uuid(_uuid), namespace_access(_namespace_access), pkey(_pkey),
-        changefeed_client(_changefeed_client) { }
+        changefeed_client(_changefeed_client),
+        read_cache_manager(_read_cache_manager), read_cache(_read_cache) { }
 
     const std::string &get_pkey();
 
     ql::datum_t read_row(ql::env_t *env,
         ql::datum_t pval, bool use_outdated);
+    ql::datum_t read_row_fields(ql::env_t *env,
+        ql::datum_t pval, bool use_outdated,
+        const std::vector<std::string> &fields);
     counted_t<ql::datum_stream_t> read_all(
         ql::env_t *env,
         const std::string &sindex,
@@ -145,10 +156,20 @@ public:
     void write_with_profile(ql::env_t *env, write_t *, write_response_t *response);
 
 private:
+    ql::datum_t read_row_uncached(ql::env_t *env,
+        const store_key_t &key, bool use_outdated);
+    // Like `write_with_profile()`, but if the table is cached, it also evicts
+    // `written_keys` from the caches on every thread before returning.
+    void write_and_invalidate(ql::env_t *env, write_t *write,
+        write_response_t *response, const std::vector<store_key_t> &written_keys);
+
     namespace_id_t uuid;
     namespace_interface_access_t namespace_access;
     std::string pkey;
     ql::changefeed::client_t *changefeed_client;
+    point_read_cache_manager_t *read_cache_manager;
+    // `NULL` unless the table is cached.  Only used on the thread it was made for.
+    point_read_cache_t *read_cache;
 };
 
 #endif /* RDB_PROTOCOL_REAL_TABLE_HPP_ */
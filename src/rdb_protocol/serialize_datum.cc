@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/serialize_datum.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -235,6 +236,24 @@ size_t datum_array_serialized_size(const datum_t &datum,
         // We don't initialize element_sizes_out, but that's ok. We don't need it
         // if there already is a serialization.
         sz += read_inner_serialized_size_from_buf(*existing_buf_ref);
+    } else if (element_sizes_out == NULL
+               && check_errors == check_datum_serialization_errors_t::NO) {
+        // Only the size is needed, so we don't build a size tree and let every
+        // element remember its own size.
+        const size_t cached_sz = datum.get_cached_serialized_size();
+        if (cached_sz != 0) {
+            return cached_sz;
+        }
+        size_t elem_sz = 0;
+        for (size_t i = 0; i < datum.arr_size(); ++i) {
+            elem_sz += datum_serialized_size(datum.get(i), check_errors, NULL);
+        }
+        datum_offset_size_t offset_size;
+        sz += elem_sz + offset_table_serialized_size(datum.arr_size(), elem_sz,
+                                                     &offset_size);
+        sz += varint_uint64_serialized_size(sz);
+        datum.cache_serialized_size(sz);
+        return sz;
     } else {
         std::vector<size_tree_node_t> elem_sizes;
         elem_sizes.reserve(datum.arr_size());
@@ -256,6 +275,7 @@ size_t datum_array_serialized_size(const datum_t &datum,
     // The inner serialized size
     sz += varint_uint64_serialized_size(sz);
 
+    datum.cache_serialized_size(sz);
     return sz;
 }
 
@@ -336,6 +356,25 @@ size_t datum_object_serialized_size(const datum_t &datum,
         // We don't initialize element_sizes_out, but that's ok. We don't need it
         // if there already is a serialization.
         sz += read_inner_serialized_size_from_buf(*existing_buf_ref);
+    } else if (child_sizes_out == NULL
+               && check_errors == check_datum_serialization_errors_t::NO) {
+        // See datum_array_serialized_size.
+        const size_t cached_sz = datum.get_cached_serialized_size();
+        if (cached_sz != 0) {
+            return cached_sz;
+        }
+        size_t elem_sz = 0;
+        for (size_t i = 0; i < datum.obj_size(); ++i) {
+            auto pair = datum.get_pair(i);
+            elem_sz += datum_serialized_size(pair.first);
+            elem_sz += datum_serialized_size(pair.second, check_errors, NULL);
+        }
+        datum_offset_size_t offset_size;
+        sz += elem_sz + offset_table_serialized_size(datum.obj_size(), elem_sz,
+                                                     &offset_size);
+        sz += varint_uint64_serialized_size(sz);
+        datum.cache_serialized_size(sz);
+        return sz;
     } else {
         std::vector<size_tree_node_t> child_sizes;
         child_sizes.reserve(datum.obj_size() * 2);
@@ -360,6 +399,7 @@ size_t datum_object_serialized_size(const datum_t &datum,
     // The inner serialized size
     sz += varint_uint64_serialized_size(sz);
 
+    datum.cache_serialized_size(sz);
     return sz;
 }
 
@@ -439,6 +479,12 @@ size_t datum_serialized_size(const datum_t &datum,
     return datum_serialized_size(datum, check_errors, NULL);
 }
 
+size_t datum_serialized_size(const datum_t &datum) {
+    // Computing the exact size memoizes it in the datum, so the document is only
+    // walked once no matter how often it gets batched.
+    return datum_serialized_size(datum, check_datum_serialization_errors_t::NO);
+}
+
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors,
                              std::vector<size_tree_node_t> *child_sizes_out) {
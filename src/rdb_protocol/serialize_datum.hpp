@@ -51,6 +51,10 @@ enum class check_datum_serialization_errors_t { YES, NO };
 // the FAQ at the end of this file.
 size_t datum_serialized_size(const datum_t &datum,
                              check_datum_serialization_errors_t check_errors);
+// The exact size, without checking for errors.  Batching uses this, so that batches
+// never go over their size limit; arrays and objects remember their size, so
+// measuring the same document again is cheap.
+size_t datum_serialized_size(const datum_t &datum);
 serialization_result_t datum_serialize(write_message_t *wm, const datum_t &datum,
                                        check_datum_serialization_errors_t check_errors);
 archive_result_t datum_deserialize(read_stream_t *s, datum_t *datum);
@@ -12,6 +12,7 @@
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/pathspec.hpp"
 #include "rdb_protocol/shards.hpp"
 
 void store_t::note_reshard() {
@@ -342,6 +343,9 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         point_read_response_t *res =
             boost::get<point_read_response_t>(&response->response);
         rdb_get(get.key, btree, superblock, res, trace);
+        if (get.projection) {
+            res->data = ql::project_fields(res->data, *get.projection);
+        }
     }
 
     void operator()(const intersecting_geo_read_t &geo_read) {
@@ -974,7 +978,7 @@ void store_t::protocol_send_backfill(const region_map_t<state_timestamp_t> &star
                                      traversal_progress_combiner_t *progress,
                                      signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t) {
-    with_priority_t p(CORO_PRIORITY_BACKFILL_SENDER);
+    with_sched_class_t sched_class(sched_class_t::BACKGROUND);
     rdb_backfill_callback_impl_t callback(chunk_fun_cb);
     std::vector<std::pair<region_t, state_timestamp_t> > regions(start_point.begin(), start_point.end());
     refcount_superblock_t refcount_wrapper(superblock, regions.size());
@@ -1,7 +1,13 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/stream_cache.hpp"
 
+#include <functional>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/interruptor.hpp"
+#include "concurrency/wait_any.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 
 #include "debug.hpp"
 
@@ -11,6 +17,13 @@ bool stream_cache_t::contains(int64_t key) {
     return streams.find(key) != streams.end();
 }
 
+bool stream_cache_t::has_prefetched_batch(int64_t key) {
+    std::map<int64_t, scoped_ptr_t<entry_t> >::iterator it = streams.find(key);
+    return it != streams.end()
+        && it->second->prefetch.has()
+        && it->second->prefetch->done.is_pulsed();
+}
+
 void stream_cache_t::insert(int64_t key,
                             use_json_t use_json,
                             std::map<std::string, wire_func_t> global_optargs,
@@ -28,8 +41,15 @@ void stream_cache_t::insert(int64_t key,
 }
 
 void stream_cache_t::erase(int64_t key) {
-    size_t num_erased = streams.erase(key);
-    guarantee(num_erased == 1);
+    std::map<int64_t, scoped_ptr_t<entry_t> >::iterator it = streams.find(key);
+    guarantee(it != streams.end());
+    // Destroying the entry waits for its prefetch to stop, so we take it out of the
+    // map first; other queries on the connection may use the map in the meantime.
+    scoped_ptr_t<entry_t> entry(std::move(it->second));
+    streams.erase(it);
+    if (entry->prefetch.has() && entry->prefetch->done.is_pulsed()) {
+        prefetched_bytes -= entry->prefetch->size;
+    }
 }
 
 bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
@@ -41,28 +61,24 @@ bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
     entry->last_activity = time(0);
 
     std::exception_ptr exc;
-    try {
-        scoped_ptr_t<profile::trace_t> trace = maybe_make_profile_trace(entry->profile);
-
-        env_t env(rdb_ctx, interruptor, entry->global_optargs, trace.get_or_null());
-
-        batch_type_t batch_type = entry->has_sent_batch
-                                      ? batch_type_t::NORMAL
-                                      : batch_type_t::NORMAL_FIRST;
-        std::vector<datum_t> ds
-            = entry->stream->next_batch(
-                &env,
-                batchspec_t::user(batch_type, &env));
-        entry->has_sent_batch = true;
-        for (auto d = ds.begin(); d != ds.end(); ++d) {
-            d->write_to_protobuf(res->add_response(), entry->use_json);
-        }
-        if (trace.has()) {
-            trace->as_datum().write_to_protobuf(
-                res->mutable_profile(), entry->use_json);
+    bool stopped;
+    {
+        // A `STOP` for the cursor may erase it while we wait for the batch, which
+        // interrupts us and waits for us to let go of the entry.
+        auto_drainer_t::lock_t entry_keepalive(&entry->drainer);
+        wait_any_t serve_interruptor(interruptor, entry_keepalive.get_drain_signal());
+        try {
+            serve_batch(entry, res, &serve_interruptor);
+        } catch (const std::exception &e) {
+            exc = std::current_exception();
         }
-    } catch (const std::exception &e) {
-        exc = std::current_exception();
+        stopped = entry_keepalive.get_drain_signal()->is_pulsed();
+    }
+    if (stopped) {
+        res->clear_response();
+        res->clear_profile();
+        res->set_type(Response::SUCCESS_SEQUENCE);
+        return true;
     }
     if (exc) {
         // We can't do this in the `catch` statement because erase may trigger
@@ -82,14 +98,92 @@ bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
         res->set_type(Response::SUCCESS_SEQUENCE);
     } else {
         res->set_type(cfeed ? Response::SUCCESS_FEED : Response::SUCCESS_PARTIAL);
+        maybe_start_prefetch(entry);
     }
     return true;
 }
 
+void stream_cache_t::serve_batch(entry_t *entry, Response *res, signal_t *interruptor) {
+    scoped_ptr_t<profile::trace_t> trace = maybe_make_profile_trace(entry->profile);
+
+    std::vector<datum_t> ds;
+    if (!take_prefetch(entry, &ds, interruptor)) {
+        env_t env(rdb_ctx, interruptor, entry->global_optargs, trace.get_or_null());
+
+        batch_type_t batch_type = entry->has_sent_batch
+                                      ? batch_type_t::NORMAL
+                                      : batch_type_t::NORMAL_FIRST;
+        ds = entry->stream->next_batch(
+            &env,
+            batchspec_t::user(batch_type, &env));
+    }
+    entry->has_sent_batch = true;
+    for (auto d = ds.begin(); d != ds.end(); ++d) {
+        d->write_to_protobuf(res->add_response(), entry->use_json);
+    }
+    if (trace.has()) {
+        trace->as_datum().write_to_protobuf(
+            res->mutable_profile(), entry->use_json);
+    }
+}
+
 void stream_cache_t::maybe_evict() {
     // We never evict right now.
 }
 
+void stream_cache_t::maybe_start_prefetch(entry_t *entry) {
+    // Changefeeds wait for changes rather than read ahead, and profiles are
+    // collected batch by batch.
+    if (entry->prefetch.has()
+        || entry->stream->is_cfeed()
+        || entry->profile == profile_bool_t::PROFILE
+        || prefetched_bytes >= MAX_PREFETCHED_BYTES) {
+        return;
+    }
+    entry->prefetch.init(new prefetch_t());
+    coro_t::spawn_sometime(std::bind(&stream_cache_t::do_prefetch,
+                                     this,
+                                     entry,
+                                     auto_drainer_t::lock_t(&entry->drainer)));
+}
+
+void stream_cache_t::do_prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive) {
+    prefetch_t *prefetch = entry->prefetch.get();
+    try {
+        env_t env(rdb_ctx, keepalive.get_drain_signal(), entry->global_optargs, NULL);
+        prefetch->batch = entry->stream->next_batch(
+            &env,
+            batchspec_t::user(batch_type_t::NORMAL, &env));
+    } catch (const std::exception &) {
+        // `serve` will rethrow it when the client asks for the batch.
+        prefetch->exc = std::current_exception();
+    }
+    // If the entry is going away, nobody will account for the batch.
+    if (!keepalive.get_drain_signal()->is_pulsed()) {
+        for (auto d = prefetch->batch.begin(); d != prefetch->batch.end(); ++d) {
+            prefetch->size += datum_serialized_size(*d);
+        }
+        prefetched_bytes += prefetch->size;
+    }
+    prefetch->done.pulse();
+}
+
+bool stream_cache_t::take_prefetch(entry_t *entry,
+                                   std::vector<datum_t> *batch_out,
+                                   signal_t *interruptor) {
+    if (!entry->prefetch.has()) {
+        return false;
+    }
+    wait_interruptible(&entry->prefetch->done, interruptor);
+    scoped_ptr_t<prefetch_t> prefetch(std::move(entry->prefetch));
+    prefetched_bytes -= prefetch->size;
+    if (prefetch->exc) {
+        std::rethrow_exception(prefetch->exc);
+    }
+    *batch_out = std::move(prefetch->batch);
+    return true;
+}
+
 stream_cache_t::entry_t::entry_t(time_t _last_activity,
                                  use_json_t _use_json,
                                  std::map<std::string, wire_func_t> _global_optargs,
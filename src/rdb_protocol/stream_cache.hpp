@@ -4,9 +4,13 @@
 
 #include <time.h>
 
+#include <exception>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/signal.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/datum_stream.hpp"
@@ -19,25 +23,58 @@ class env_t;
 namespace ql {
 
 enum class reject_cfeeds_t { NO, YES };
+
+/* Holds the streams of a connection's open cursors.  Once a batch of a cursor has
+been served, the next batch is computed in the background, so that it's ready (or
+at least on its way) when the client asks for it.  Batches that have been computed
+but not yet asked for take up at most `MAX_PREFETCHED_BYTES` per connection. */
 class stream_cache_t {
 public:
+    static const size_t MAX_PREFETCHED_BYTES = 8 * MEGABYTE;
+
     stream_cache_t(rdb_context_t *_rdb_ctx,
                    reject_cfeeds_t _reject_cfeeds)
         : rdb_ctx(_rdb_ctx),
-          reject_cfeeds(_reject_cfeeds) {
+          reject_cfeeds(_reject_cfeeds),
+          prefetched_bytes(0) {
         rassert(rdb_ctx != NULL);
     }
     MUST_USE bool contains(int64_t key);
+    // Whether the next batch of the cursor has been computed and is waiting to be
+    // served.
+    MUST_USE bool has_prefetched_batch(int64_t key);
     void insert(int64_t key,
                 use_json_t use_json,
                 std::map<std::string, wire_func_t> global_optargs,
                 profile_bool_t profile_requested,
                 counted_t<datum_stream_t> val_stream);
+    // Also interrupts a `serve` of the cursor that's in progress, which then sends
+    // an empty `SUCCESS_SEQUENCE`.
     void erase(int64_t key);
     MUST_USE bool serve(int64_t key, Response *res, signal_t *interruptor);
 private:
     void maybe_evict();
 
+    // A batch that is being, or has been, computed ahead of time.
+    struct prefetch_t {
+        prefetch_t() : size(0) { }
+        cond_t done;
+        std::vector<datum_t> batch;
+        std::exception_ptr exc;
+        // The serialized size of `batch`.
+        size_t size;
+    };
+
+    struct entry_t;
+    // Adds the cursor's next batch to `res`.
+    void serve_batch(entry_t *entry, Response *res, signal_t *interruptor);
+    void maybe_start_prefetch(entry_t *entry);
+    void do_prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive);
+    // Waits for the entry's prefetch, if any, and takes over its result.
+    MUST_USE bool take_prefetch(entry_t *entry,
+                                std::vector<datum_t> *batch_out,
+                                signal_t *interruptor);
+
     struct entry_t {
         ~entry_t();
         static const time_t DEFAULT_MAX_AGE = 0; // 0 = never evict
@@ -53,12 +90,18 @@ private:
         counted_t<datum_stream_t> stream;
         time_t max_age;
         bool has_sent_batch;
+        scoped_ptr_t<prefetch_t> prefetch;
+        // Interrupts and waits for the prefetch when the entry goes away, so it
+        // must come last.
+        auto_drainer_t drainer;
     private:
         DISABLE_COPYING(entry_t);
     };
 
     rdb_context_t *const rdb_ctx;
     const reject_cfeeds_t reject_cfeeds;
+    // The total size of the prefetched batches that haven't been served yet.
+    size_t prefetched_bytes;
     std::map<int64_t, scoped_ptr_t<entry_t> > streams;
     DISABLE_COPYING(stream_cache_t);
 };
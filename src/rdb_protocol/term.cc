@@ -7,6 +7,7 @@
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/ql2_extensions.pb.h"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rdb_protocol/term_walker.hpp"
 #include "rdb_protocol/validate.hpp"
@@ -18,6 +19,12 @@ namespace ql {
 counted_t<const term_t> compile_term(compile_env_t *env, protob_t<const Term> t) {
     // HACK: per @srh, use unlimited array size at compile time
     ql::configured_limits_t limits = ql::configured_limits_t::unlimited;
+    if (t->type() == Term::DATUM && env->params != NULL) {
+        auto it = env->params->find(t.get());
+        if (it != env->params->end()) {
+            return make_param_term(t, it->second);
+        }
+    }
     switch (t->type()) {
     case Term::DATUM:              return make_datum_term(t, limits);
     case Term::MAKE_ARRAY:         return make_make_array_term(env, t);
@@ -192,11 +199,144 @@ counted_t<const term_t> compile_term(compile_env_t *env, protob_t<const Term> t)
     unreachable();
 }
 
+size_t collapsed_array_size(const Term &t, const datum_t &d) {
+    return t.GetExtension(ql2::extension::collapsed_literal) ? largest_array_size(d) : 0;
+}
+
+namespace {
+
+// Bigger queries aren't cached, so that the cache doesn't keep big documents alive.
+const int PLAN_CACHE_MAX_QUERY_SIZE = 16 * KILOBYTE;
+
+// Returns the first argument of a `type` term that may be a parameter, or -1 if none
+// of them may.
+int first_param_arg(Term::TermType type) {
+    if (type == Term::EQ || type == Term::NE || type == Term::LT || type == Term::LE
+        || type == Term::GT || type == Term::GE || type == Term::ADD
+        || type == Term::SUB || type == Term::MUL || type == Term::DIV
+        || type == Term::MOD) {
+        return 0;
+    } else if (type == Term::GET || type == Term::GET_ALL || type == Term::BETWEEN
+               || type == Term::LIMIT || type == Term::NTH) {
+        return 1;
+    } else {
+        return -1;
+    }
+}
+
+// Whether compiling a `type` term may copy its arguments into a new term (see
+// rewrites.cc), or look at the literals in them.  Such copies wouldn't be found in
+// the parameter map, and neither would anything below them.
+bool keeps_literals(Term::TermType type) {
+    return type == Term::FUNC || type == Term::SKIP || type == Term::INNER_JOIN
+        || type == Term::OUTER_JOIN || type == Term::EQ_JOIN || type == Term::UPDATE
+        || type == Term::DELETE || type == Term::DIFFERENCE
+        || type == Term::WITH_FIELDS;
+}
+
+void append_length_prefixed(const std::string &s, std::string *shape) {
+    shape->append(strprintf("%zu:", s.size()));
+    shape->append(s);
+}
+
+// Appends the shape of `t` to `shape`, and the `DATUM` terms that are parameters to
+// `params_out`.  No term below a `keeps_literals()` term (in particular, nothing in
+// a function body) is a parameter, which `params_allowed` says.
+void append_shape(const Term &t, bool may_be_param, bool params_allowed,
+                  std::string *shape, std::vector<const Term *> *params_out) {
+    if (t.type() == Term::DATUM) {
+        const bool collapsed = t.GetExtension(ql2::extension::collapsed_literal);
+        if (may_be_param && params_allowed && !collapsed) {
+            shape->push_back('?');
+            params_out->push_back(&t);
+        } else {
+            shape->push_back(collapsed ? 'C' : 'D');
+            append_length_prefixed(t.datum().SerializeAsString(), shape);
+        }
+        return;
+    }
+    shape->append(strprintf("T%d,%d,%d(",
+                            static_cast<int>(t.type()),
+                            t.args_size(),
+                            t.optargs_size()));
+    const bool args_params_allowed = params_allowed && !keeps_literals(t.type());
+    const int first_param = first_param_arg(t.type());
+    for (int i = 0; i < t.args_size(); ++i) {
+        append_shape(t.args(i), first_param != -1 && i >= first_param,
+                     args_params_allowed, shape, params_out);
+    }
+    // Optargs are never parameters, because `op_term_t` may turn them into functions
+    // by copying them.
+    for (int i = 0; i < t.optargs_size(); ++i) {
+        append_length_prefixed(t.optargs(i).key(), shape);
+        append_shape(t.optargs(i).val(), false, false, shape, params_out);
+    }
+    shape->push_back(')');
+}
+
+}  // namespace
+
+plan_cache_stats_t::plan_cache_stats_t(perfmon_collection_t *parent)
+    : collection(),
+      collection_membership(parent, &collection, "plan_cache"),
+      pm_hits(secs_to_ticks(1)),
+      pm_misses(secs_to_ticks(1)),
+      pm_membership(&collection,
+          &pm_hits, "hits",
+          &pm_total_hits, "total_hits",
+          &pm_misses, "misses",
+          &pm_total_misses, "total_misses") { }
+
+plan_cache_t::plan_cache_t(plan_cache_stats_t *_stats)
+    : stats(_stats), plans(PLAN_CACHE_SIZE) { }
+
+plan_cache_t::~plan_cache_t() { }
+
+counted_t<const term_t> plan_cache_t::compile(const protob_t<const Term> &query,
+                                              std::vector<datum_t> *params_out) {
+    params_out->clear();
+    if (query->ByteSize() > PLAN_CACHE_MAX_QUERY_SIZE) {
+        compile_env_t compile_env((var_visibility_t()));
+        return compile_term(&compile_env, query);
+    }
+
+    std::string shape;
+    std::vector<const Term *> params;
+    append_shape(*query, false, true, &shape, &params);
+    params_out->reserve(params.size());
+    for (auto it = params.begin(); it != params.end(); ++it) {
+        params_out->push_back(
+            to_datum(&(*it)->datum(), configured_limits_t::unlimited));
+    }
+
+    auto it = plans.find(shape);
+    if (it != plans.end()) {
+        stats->pm_hits.record();
+        ++stats->pm_total_hits;
+        return it->second;
+    }
+    stats->pm_misses.record();
+    ++stats->pm_total_misses;
+
+    std::map<const Term *, size_t> param_indexes;
+    for (size_t i = 0; i < params.size(); ++i) {
+        param_indexes[params[i]] = i;
+    }
+    compile_env_t compile_env(var_visibility_t(), &param_indexes);
+    counted_t<const term_t> plan = compile_term(&compile_env, query);
+    plans[shape] = plan;
+    return plan;
+}
+
 void run(protob_t<Query> q,
          rdb_context_t *ctx,
          signal_t *interruptor,
          stream_cache_t *stream_cache,
+         plan_cache_t *plan_cache,
          Response *res) {
+    // Client queries start out interactive, see `env_t::maybe_yield()`.
+    with_sched_class_t sched_class(sched_class_t::INTERACTIVE);
+
     try {
         validate_pb(*q);
     } catch (const base_exc_t &e) {
@@ -208,7 +348,9 @@ void run(protob_t<Query> q,
 #endif // INSTRUMENT
 
     int64_t token = q->token();
-    use_json_t use_json = q->accepts_r_json() ? use_json_t::YES : use_json_t::NO;
+    use_json_t use_json = q->accepts_r_serialized()
+        ? use_json_t::SERIALIZED
+        : (q->accepts_r_json() ? use_json_t::YES : use_json_t::NO);
 
     switch (q->type()) {
     case Query_QueryType_START: {
@@ -219,8 +361,14 @@ void run(protob_t<Query> q,
         counted_t<const term_t> root_term;
         try {
             Term *t = q->mutable_query();
-            compile_env_t compile_env((var_visibility_t()));
-            root_term = compile_term(&compile_env, q.make_child(t));
+            if (plan_cache != NULL) {
+                std::vector<datum_t> params;
+                root_term = plan_cache->compile(q.make_child(t), &params);
+                env.set_query_params(std::move(params));
+            } else {
+                compile_env_t compile_env((var_visibility_t()));
+                root_term = compile_term(&compile_env, q.make_child(t));
+            }
         } catch (const exc_t &e) {
             fill_error(res, Response::COMPILE_ERROR, e.what(), e.backtrace());
             return;
@@ -336,9 +484,9 @@ void run(protob_t<Query> q,
         }
 
         // NOREPLY_WAIT is just a no-op.
-        // This works because we only evaluate one Query at a time
-        // on the connection level. Once we get to the NOREPLY_WAIT Query
-        // we know that all previous Queries have completed processing.
+        // This works because the connection doesn't start a Query before
+        // the noreply Queries received before it have completed. Once we
+        // get to the NOREPLY_WAIT Query we know that they all have.
 
         // Send back a WAIT_COMPLETE response.
         res->set_type(Response::WAIT_COMPLETE);
@@ -380,13 +528,17 @@ void term_t::prop_bt(Term *t) const {
 
 scoped_ptr_t<val_t> term_t::eval(scope_env_t *env, eval_flags_t eval_flags) const {
     // This is basically a hook for unit tests to change things mid-query
-    profile::starter_t starter(strprintf("Evaluating %s.", name()), env->env->trace);
+    profile::starter_t starter(env->env->trace != NULL
+                                   ? strprintf("Evaluating %s.", name())
+                                   : std::string(),
+                               env->env->trace);
     DEBUG_ONLY_CODE(env->env->do_eval_callback());
     DBG("EVALUATING %s (%d):\n", name(), is_deterministic());
     if (env->env->interruptor->is_pulsed()) {
         throw interrupted_exc_t();
     }
     env->env->maybe_yield();
+    arena_scope_t arena_scope(env->env->arena());
     INC_DEPTH;
 
 #ifdef INSTRUMENT
@@ -59,6 +59,13 @@ private:
 
 counted_t<const term_t> compile_term(compile_env_t *env, protob_t<const Term> t);
 
+// The size of the largest array in `d`, the value of the `DATUM` term `t`, if the JSON
+// parser collapsed `t` from literal `MAKE_ARRAY` and `MAKE_OBJ` terms; 0 otherwise.
+// Those terms would have checked their arrays against the query's `array_limit`, so
+// the literal has to be checked when it's evaluated instead.  Clients that send
+// arrays as `DATUM` terms themselves never got that check.
+size_t collapsed_array_size(const Term &t, const datum_t &d);
+
 } // namespace ql
 
 #endif // RDB_PROTOCOL_TERM_HPP_
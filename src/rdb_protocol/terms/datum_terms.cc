@@ -7,18 +7,44 @@
 
 namespace ql {
 
+// `DATUM` terms are compiled without a size limit, because the query's `array_limit`
+// isn't known yet, but they may hold arrays that the client sent as `MAKE_ARRAY`
+// terms (see json_shim.cc).  The size of the largest array in those is found when
+// they're compiled, and compared with the limit when they're evaluated, which is
+// where `make_array` would have failed.
 class datum_term_t : public term_t {
 public:
     datum_term_t(protob_t<const Term> t, const configured_limits_t &limits)
-        : term_t(t), datum(to_datum(&t->datum(), limits)) { }
+        : term_t(t), datum(to_datum(&t->datum(), limits)),
+          array_size(collapsed_array_size(*t, datum)) { }
 private:
     virtual void accumulate_captures(var_captures_t *) const { /* do nothing */ }
     virtual bool is_deterministic() const { return true; }
-    virtual scoped_ptr_t<val_t> term_eval(scope_env_t *, eval_flags_t) const {
+    virtual scoped_ptr_t<val_t> term_eval(scope_env_t *env, eval_flags_t) const {
+        const size_t limit = env->env->limits().array_size_limit();
+        rcheck(array_size <= limit, base_exc_t::GENERIC,
+               strprintf("Array over size limit `%zu`.", limit));
         return new_val(datum);
     }
     virtual const char *name() const { return "datum"; }
     datum_t datum;
+    const size_t array_size;
+};
+
+// A `DATUM` term whose value is one of the query's parameters, see `plan_cache_t`.
+// Collapsed literals are never parameters, so there's no array size to check.
+class param_term_t : public term_t {
+public:
+    param_term_t(protob_t<const Term> t, size_t _index)
+        : term_t(t), index(_index) { }
+private:
+    virtual void accumulate_captures(var_captures_t *) const { /* do nothing */ }
+    virtual bool is_deterministic() const { return true; }
+    virtual scoped_ptr_t<val_t> term_eval(scope_env_t *env, eval_flags_t) const {
+        return new_val(env->env->query_param(index));
+    }
+    virtual const char *name() const { return "datum"; }
+    const size_t index;
 };
 
 class constant_term_t : public op_term_t {
@@ -130,6 +156,9 @@ counted_t<term_t> make_datum_term(const protob_t<const Term> &term,
                                   const configured_limits_t &limits) {
     return make_counted<datum_term_t>(term, limits);
 }
+counted_t<term_t> make_param_term(const protob_t<const Term> &term, size_t index) {
+    return make_counted<param_term_t>(term, index);
+}
 counted_t<term_t> make_constant_term(compile_env_t *env, const protob_t<const Term> &term,
                                      double constant, const char *name) {
     return make_counted<constant_term_t>(env, term, constant, name);
@@ -130,6 +130,12 @@ obj_or_seq_op_term_t::obj_or_seq_op_term_t(compile_env_t *env, protob_t<const Te
 scoped_ptr_t<val_t> obj_or_seq_op_term_t::eval_impl(scope_env_t *env, args_t *args,
                                                     eval_flags_t) const {
     scoped_ptr_t<val_t> v0 = args->arg(env, 0);
+    const std::vector<std::string> *fields = fields_needed();
+    if (fields != NULL
+        && v0->get_type().is_convertible(val_t::type_t::SINGLE_SELECTION)) {
+        v0 = make_scoped<val_t>(v0->as_single_selection()->get_fields(*fields),
+                                v0->backtrace());
+    }
     return impl.eval_impl_dereferenced(this, env, args, v0,
                                        [&]{ return this->obj_eval(env, args, v0); });
 }
@@ -137,8 +143,25 @@ scoped_ptr_t<val_t> obj_or_seq_op_term_t::eval_impl(scope_env_t *env, args_t *ar
 class pluck_term_t : public obj_or_seq_op_term_t {
 public:
     pluck_term_t(compile_env_t *env, const protob_t<const Term> &term) :
-        obj_or_seq_op_term_t(env, term, MAP, argspec_t(1, -1)) { }
+        obj_or_seq_op_term_t(env, term, MAP, argspec_t(1, -1)) {
+        // `get(...).pluck('a', 'b')` only needs to read `a` and `b` from the shard,
+        // which we can tell at compile time if the paths are literal strings.
+        literal_fields.reserve(term->args_size());
+        for (int i = 1; i < term->args_size(); ++i) {
+            const Term &arg = term->args(i);
+            if (arg.type() != Term::DATUM || arg.datum().type() != Datum::R_STR) {
+                all_fields_literal = false;
+                return;
+            }
+            literal_fields.push_back(arg.datum().r_str());
+        }
+        all_fields_literal = true;
+    }
 private:
+    virtual const std::vector<std::string> *fields_needed() const {
+        return all_fields_literal ? &literal_fields : NULL;
+    }
+
     virtual scoped_ptr_t<val_t> obj_eval(scope_env_t *env, args_t *args, const scoped_ptr_t<val_t> &v0) const {
         datum_t obj = v0->as_datum();
         r_sanity_check(obj.get_type() == datum_t::R_OBJECT);
@@ -153,6 +176,9 @@ private:
         return new_val(project(obj, pathspec, DONT_RECURSE, env->env->limits()));
     }
     virtual const char *name() const { return "pluck"; }
+
+    bool all_fields_literal;
+    std::vector<std::string> literal_fields;
 };
 
 class without_term_t : public obj_or_seq_op_term_t {
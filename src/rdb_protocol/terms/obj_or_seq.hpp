@@ -56,6 +56,11 @@ private:
                                          args_t *args,
                                          const scoped_ptr_t<val_t> &v0) const = 0;
 
+    // Terms whose `obj_eval` only looks at some known top-level fields of the
+    // object return them here, so that only those fields of a single selection
+    // get read from the table.
+    virtual const std::vector<std::string> *fields_needed() const { return NULL; }
+
     virtual scoped_ptr_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const;
 
     obj_or_seq_op_impl_t impl;
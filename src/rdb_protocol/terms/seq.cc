@@ -7,6 +7,7 @@
 
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/index_selection.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/math_utils.hpp"
 
@@ -263,7 +264,11 @@ class filter_term_t : public grouped_seq_op_term_t {
 public:
     filter_term_t(compile_env_t *env, const protob_t<const Term> &term)
         : grouped_seq_op_term_t(env, term, argspec_t(2), optargspec_t({"default"})),
-          default_filter_term(lazy_literal_optarg(env, "default")) { }
+          default_filter_term(lazy_literal_optarg(env, "default")) {
+        if (term->args_size() == 2) {
+            index_conditions = find_index_conditions(term->args(1));
+        }
+    }
 
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
@@ -276,6 +281,25 @@ private:
             defval = wire_func_t(default_filter_term->eval_to_func(env->scope));
         }
 
+        // With a `default` the scan can return rows that no index contains.
+        if (v0->get_type().get_raw_type() == val_t::type_t::TABLE
+            && !index_conditions.empty()
+            && !default_filter_term.has()) {
+            counted_t<table_t> table = v0->as_table();
+            boost::optional<index_plan_t> plan
+                = choose_index_plan(env->env, table.get(), index_conditions);
+            if (plan) {
+                profile::starter_t starter(plan->print(), env->env->trace);
+                counted_t<datum_stream_t> stream
+                    = read_with_index_plan(env->env, table.get(), *plan, backtrace());
+                stream->add_transformation(filter_wire_func_t(f, defval), backtrace());
+                return new_val(make_counted<selection_t>(table, stream));
+            } else {
+                profile::starter_t starter("Filter using a table scan, no usable index.",
+                                           env->env->trace);
+            }
+        }
+
         if (v0->get_type().is_convertible(val_t::type_t::SELECTION)) {
             counted_t<selection_t> ts = v0->as_selection(env->env);
             ts->seq->add_transformation(filter_wire_func_t(f, defval), backtrace());
@@ -291,6 +315,8 @@ private:
     virtual const char *name() const { return "filter"; }
 
     counted_t<func_term_t> default_filter_term;
+    // Used to read the rows through an index rather than scan the whole table.
+    std::vector<index_condition_t> index_conditions;
 };
 
 class reduce_term_t : public grouped_seq_op_term_t {
@@ -328,6 +354,7 @@ public:
     changes_term_t(compile_env_t *env, const protob_t<const Term> &term)
         : op_term_t(env, term, argspec_t(1)) { }
 private:
+
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
         scoped_ptr_t<val_t> v = args->arg(env, 0);
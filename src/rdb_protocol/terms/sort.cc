@@ -7,6 +7,7 @@
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
+#include "concurrency/parallel.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
@@ -85,27 +86,97 @@ private:
                     }
                 }
 
-                if (!lval.has() && !rval.has()) {
-                    continue;
+                const int cmp = compare_keys(env->reql_version(), it->first,
+                                             lval, rval);
+                if (cmp != 0) {
+                    return cmp < 0;
                 }
-                if (!lval.has()) {
-                    return true != (it->first == DESC);
-                }
-                if (!rval.has()) {
-                    return false != (it->first == DESC);
-                }
-                // TODO(2014-08): use datum_t::cmp instead to be faster
-                if (lval == rval) {
-                    continue;
-                }
-                return lval.compare_lt(env->reql_version(), rval) !=
-                    (it->first == DESC);
             }
 
             return false;
         }
 
+        // Sorts `data` like `std::stable_sort()` with this comparator would, but
+        // evaluates each element's sort keys only once.  Big arrays are then sorted
+        // on the compute pool.
+        void sort(env_t *env,
+                  profile::sampler_t *sampler,
+                  std::vector<datum_t> *data) const {
+            if (data->size() < PARALLEL_SORT_MIN_SIZE) {
+                std::stable_sort(data->begin(), data->end(),
+                                 boost::bind(*this, env, sampler, _1, _2));
+                return;
+            }
+
+            // An empty key means the element doesn't have that field.
+            std::vector<std::vector<datum_t> > keys(data->size());
+            for (size_t i = 0; i < data->size(); ++i) {
+                sampler->new_sample();
+                keys[i].reserve(comparisons.size());
+                for (auto it = comparisons.begin(); it != comparisons.end(); ++it) {
+                    datum_t key;
+                    try {
+                        key = it->second->call(env, (*data)[i])->as_datum();
+                    } catch (const base_exc_t &e) {
+                        if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+                            throw;
+                        }
+                    }
+                    keys[i].push_back(std::move(key));
+                }
+            }
+
+            std::vector<order_direction_t> directions;
+            for (auto it = comparisons.begin(); it != comparisons.end(); ++it) {
+                directions.push_back(it->first);
+            }
+            const reql_version_t reql_version = env->reql_version();
+            std::vector<size_t> order(data->size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            parallel_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+                for (size_t c = 0; c < directions.size(); ++c) {
+                    const int cmp = compare_keys(reql_version, directions[c],
+                                                 keys[l][c], keys[r][c]);
+                    if (cmp != 0) {
+                        return cmp < 0;
+                    }
+                }
+                return false;
+            });
+
+            std::vector<datum_t> sorted;
+            sorted.reserve(data->size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                sorted.push_back(std::move((*data)[order[i]]));
+            }
+            data->swap(sorted);
+        }
+
     private:
+        // Negative if `l` sorts before `r`, positive if after, and zero if neither.
+        // Missing values sort before everything else.
+        static int compare_keys(reql_version_t reql_version,
+                                order_direction_t direction,
+                                const datum_t &l,
+                                const datum_t &r) {
+            int cmp;
+            if (!l.has() && !r.has()) {
+                return 0;
+            } else if (!l.has()) {
+                cmp = -1;
+            } else if (!r.has()) {
+                cmp = 1;
+            } else if (l == r) {
+                // TODO(2014-08): use datum_t::cmp instead to be faster
+                return 0;
+            } else {
+                cmp = l.compare_lt(reql_version, r) ? -1 : 1;
+            }
+            return direction == DESC ? -cmp : cmp;
+        }
+
         const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
             comparisons;
     };
@@ -189,8 +260,7 @@ private:
                 rcheck_array_size(to_sort, env->env->limits(), base_exc_t::GENERIC);
             }
             profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
-            auto fn = boost::bind(lt_cmp, env->env, &sampler, _1, _2);
-            std::stable_sort(to_sort.begin(), to_sort.end(), fn);
+            lt_cmp.sort(env->env, &sampler, &to_sort);
             seq = make_counted<array_datum_stream_t>(
                 datum_t(std::move(to_sort), env->env->limits()),
                 backtrace());
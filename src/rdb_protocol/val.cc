@@ -27,6 +27,9 @@ public:
     virtual datum_t get() {
         return row.has() ? row : tbl->get_row(env, key);
     }
+    virtual datum_t get_fields(const std::vector<std::string> &fields) {
+        return row.has() ? row : tbl->get_row_fields(env, key, fields);
+    }
     virtual counted_t<datum_stream_t> read_changes() {
         return tbl->tbl->read_row_changes(env, key, bt, tbl->display_name());
     }
@@ -362,6 +365,11 @@ datum_t table_t::get_row(env_t *env, datum_t pval) {
     return tbl->read_row(env, pval, use_outdated);
 }
 
+datum_t table_t::get_row_fields(env_t *env, datum_t pval,
+                                const std::vector<std::string> &fields) {
+    return tbl->read_row_fields(env, pval, use_outdated, fields);
+}
+
 counted_t<datum_stream_t> table_t::get_all(
         env_t *env,
         datum_t value,
@@ -462,6 +470,14 @@ const char *val_t::type_t::name() const {
     }
 }
 
+void *val_t::operator new(size_t size) {
+    return arena_t::allocate_from_current(size);
+}
+
+void val_t::operator delete(void *ptr) {
+    arena_t::deallocate(ptr);
+}
+
 val_t::val_t(datum_t _datum, protob_t<const Backtrace> backtrace)
     : pb_rcheckable_t(backtrace),
       type(type_t::DATUM),
@@ -7,6 +7,7 @@
 #include <utility>
 #include <vector>
 
+#include "containers/arena.hpp"
 #include "containers/counted.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/datum_string.hpp"
@@ -36,6 +37,9 @@ public:
             bool use_outdated, const protob_t<const Backtrace> &src);
     const std::string &get_pkey();
     datum_t get_row(env_t *env, datum_t pval);
+    // Only reads the given top-level fields of the row.
+    datum_t get_row_fields(env_t *env, datum_t pval,
+                           const std::vector<std::string> &fields);
     counted_t<datum_stream_t> get_all(
             env_t *env,
             datum_t value,
@@ -103,6 +107,8 @@ public:
 
     scoped_ptr_t<base_table_t> tbl;
 
+    bool uses_outdated() const { return use_outdated; }
+
 private:
     friend class distinct_term_t;
 
@@ -161,6 +167,9 @@ public:
     virtual ~single_selection_t() { }
 
     virtual datum_t get() = 0;
+    // Returns at least the given top-level fields of the row, and possibly others.
+    // Used to push `pluck` down to the shards.
+    virtual datum_t get_fields(const std::vector<std::string> &) { return get(); }
     virtual counted_t<datum_stream_t> read_changes() = 0;
     virtual datum_t replace(
         counted_t<const func_t> f, bool nondet_ok,
@@ -229,6 +238,11 @@ public:
     val_t(counted_t<const func_t> _func, protob_t<const Backtrace> bt);
     ~val_t();
 
+    // Every term evaluation produces a `val_t`, so they come from the arena of the
+    // query being evaluated (see `term_t::eval`).
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
     counted_t<const db_t> as_db() const;
     counted_t<table_t> as_table();
     counted_t<table_t> get_underlying_table() const;
@@ -4,6 +4,7 @@
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
 #include "containers/archive/archive.hpp"
+#include "rdb_protocol/compiled_func.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -21,7 +22,9 @@ wire_func_t::wire_func_t(const counted_t<const func_t> &f) : func(f) {
 wire_func_t::wire_func_t(protob_t<const Term> body, std::vector<sym_t> arg_names,
                          protob_t<const Backtrace> backtrace) {
     compile_env_t env(var_visibility_t().with_func_arg_name_list(arg_names));
-    func = make_counted<reql_func_t>(backtrace, var_scope_t(), arg_names, compile_term(&env, body));
+    func = make_counted<reql_func_t>(backtrace, var_scope_t(), arg_names,
+                                     compile_term(&env, body),
+                                     compiled_func_t::compile(arg_names, body));
 }
 
 wire_func_t::wire_func_t(const wire_func_t &copyee)
@@ -115,7 +118,8 @@ archive_result_t wire_func_t::rdb_deserialize(read_stream_t *s) {
         compile_env_t env(
             scope.compute_visibility().with_func_arg_name_list(arg_names));
         func = make_counted<reql_func_t>(
-            backtrace, scope, arg_names, compile_term(&env, body));
+            backtrace, scope, arg_names, compile_term(&env, body),
+            compiled_func_t::compile(arg_names, body));
         return res;
     } break;
     case wire_func_type_t::JS: {
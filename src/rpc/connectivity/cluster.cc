@@ -26,11 +26,15 @@
 // Number of messages after which the message handling loop yields
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           8
 
-// The cluster communication protocol version.
+// The cluster communication protocol version.  "1.15.1" serializes everything the
+// way `v1_15` does, except for the messages listed below, so it doesn't talk to
+// "1.15" peers:
+//  - point reads carry a projection;
+//  - mailbox message headers carry the sender's scheduling class.
 static_assert(cluster_version_t::CLUSTER == cluster_version_t::v1_15_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
-#define CLUSTER_VERSION_STRING "1.15"
+#define CLUSTER_VERSION_STRING "1.15.1"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
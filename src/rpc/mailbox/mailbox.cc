@@ -68,9 +68,10 @@ class raw_mailbox_writer_t :
 {
 public:
     raw_mailbox_writer_t(int32_t _dest_thread, raw_mailbox_t::id_t _dest_mailbox_id,
-            mailbox_write_callback_t *_subwriter) :
+            sched_class_t _sched_class, mailbox_write_callback_t *_subwriter) :
         dest_thread(_dest_thread),
         dest_mailbox_id(_dest_mailbox_id),
+        sched_class(_sched_class),
         subwriter(_subwriter) { }
     virtual ~raw_mailbox_writer_t() { }
 
@@ -80,9 +81,11 @@ public:
         // way irrespective of version. (Serialization methods for primitive types
         // all behave the same way anyway -- this is just for performance, avoiding
         // unnecessary branching on cluster_version.)  See read_mailbox_header for
-        // the deserialization.
+        // the deserialization.  The scheduling class is what sets the header apart
+        // from the one "1.15" peers send, see CLUSTER_VERSION_STRING.
         serialize_universal(&wm, dest_thread);
         serialize_universal(&wm, dest_mailbox_id);
+        serialize_universal(&wm, static_cast<int8_t>(sched_class));
         uint64_t prefix_length = static_cast<uint64_t>(wm.size());
 
         subwriter->write(cluster_version_t::CLUSTER, &wm);
@@ -102,6 +105,7 @@ public:
 private:
     int32_t dest_thread;
     raw_mailbox_t::id_t dest_mailbox_id;
+    sched_class_t sched_class;
     mailbox_write_callback_t *subwriter;
 };
 
@@ -117,7 +121,9 @@ void send(mailbox_manager_t *src, raw_mailbox_t::address_t dest,
             dest.peer, &connection_keepalive))) {
         return;
     }
-    raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id, callback);
+    // The message is handled in the sender's scheduling class.
+    raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id,
+                                coro_t::self()->get_sched_class(), callback);
     src->get_connectivity_cluster()->send_message(connection, connection_keepalive,
         src->get_message_tag(), &writer);
 }
@@ -159,6 +165,7 @@ struct mailbox_header_t {
     uint64_t data_length;
     int32_t dest_thread;
     raw_mailbox_t::id_t dest_mailbox_id;
+    sched_class_t sched_class;
 };
 
 // Helper function for on_local_message and on_message
@@ -177,6 +184,14 @@ void read_mailbox_header(read_stream_t *stream,
     if (bad(res)) { throw fake_archive_exc_t(); }
     res = deserialize_universal(stream, &header_out->dest_mailbox_id);
     if (bad(res)) { throw fake_archive_exc_t(); }
+    int8_t sched_class;
+    res = deserialize_universal(stream, &sched_class);
+    if (bad(res)
+        || sched_class < static_cast<int8_t>(sched_class_t::INTERACTIVE)
+        || sched_class > static_cast<int8_t>(sched_class_t::BACKGROUND)) {
+        throw fake_archive_exc_t();
+    }
+    header_out->sched_class = static_cast<sched_class_t>(sched_class);
 }
 
 void mailbox_manager_t::on_local_message(
@@ -205,6 +220,7 @@ void mailbox_manager_t::on_local_message(
     coro_t::spawn_now_dangerously(
         [this, connection, connection_keepalive /* important to capture */,
                 mbox_header, &stream_data, stream_data_offset]() {
+            coro_t::self()->set_sched_class(mbox_header.sched_class);
             mailbox_read_coroutine(connection, connection_keepalive,
                 threadnum_t(mbox_header.dest_thread), mbox_header.dest_mailbox_id,
                 &stream_data, stream_data_offset, FORCE_YIELD);
@@ -232,6 +248,7 @@ void mailbox_manager_t::on_message(connectivity_cluster_t::connection_t *connect
     coro_t::spawn_now_dangerously(
         [this, connection, connection_keepalive /* important to capture */,
                 mbox_header, &stream_data]() {
+            coro_t::self()->set_sched_class(mbox_header.sched_class);
             mailbox_read_coroutine(connection, connection_keepalive,
                 threadnum_t(mbox_header.dest_thread), mbox_header.dest_mailbox_id,
                 &stream_data, 0, MAYBE_YIELD);
@@ -294,7 +294,7 @@ void lba_list_t::consider_gc() {
             gc_active[i] = true;
             coro_t *gc_coro = coro_t::spawn_sometime(std::bind(&lba_list_t::gc,
                     this, i, auto_drainer_t::lock_t(gc_drainer.get())));
-            gc_coro->set_priority(CORO_PRIORITY_LBA_GC);
+            gc_coro->set_sched_class(sched_class_t::BACKGROUND);
         }
     }
 }
@@ -0,0 +1,167 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
+#include "containers/arena.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(ArenaTest, AllocationsOutliveArena) {
+    std::vector<char *> ptrs;
+    {
+        arena_t arena(1024);
+        for (size_t i = 0; i < 100; ++i) {
+            char *ptr = static_cast<char *>(arena.allocate(i + 1));
+            memset(ptr, static_cast<int>(i), i + 1);
+            ptrs.push_back(ptr);
+        }
+        EXPECT_EQ(100u, arena.allocation_count());
+        EXPECT_GT(arena.chunk_count(), 1u);
+    }
+    // Free every other object, then check that the rest is untouched.
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        arena_t::deallocate(ptrs[i]);
+    }
+    for (size_t i = 1; i < ptrs.size(); i += 2) {
+        for (size_t j = 0; j <= i; ++j) {
+            ASSERT_EQ(static_cast<char>(i), ptrs[i][j]);
+        }
+        arena_t::deallocate(ptrs[i]);
+    }
+}
+
+TPTEST(ArenaTest, LargeAllocations) {
+    arena_t arena(1024);
+    void *ptr = arena.allocate(4096);
+    memset(ptr, 0, 4096);
+    // Large objects come from the heap and don't use up a chunk.
+    EXPECT_EQ(0u, arena.chunk_count());
+    arena_t::deallocate(ptr);
+}
+
+TPTEST(ArenaTest, Scopes) {
+    arena_t outer_arena;
+    arena_t inner_arena;
+    void *ptr;
+    {
+        arena_scope_t outer_scope(&outer_arena);
+        {
+            arena_scope_t inner_scope(&inner_arena);
+            ptr = arena_t::allocate_from_current(8);
+            arena_t::deallocate(ptr);
+        }
+        EXPECT_EQ(1u, inner_arena.allocation_count());
+        EXPECT_EQ(0u, outer_arena.allocation_count());
+    }
+    // Outside of any scope, memory comes from the heap.
+    ptr = arena_t::allocate_from_current(8);
+    arena_t::deallocate(ptr);
+    EXPECT_EQ(1u, inner_arena.allocation_count());
+    EXPECT_EQ(0u, outer_arena.allocation_count());
+}
+
+// Compares the arena to the heap for objects about the size of a `val_t`.
+TPTEST(ArenaTest, Benchmark) {
+    const size_t rounds = 1000;
+    const size_t objects = 1000;
+    const size_t object_size = 96;
+    std::vector<void *> ptrs(objects);
+
+    const ticks_t heap_start = get_ticks();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < objects; ++i) {
+            ptrs[i] = malloc(object_size);
+        }
+        for (size_t i = 0; i < objects; ++i) {
+            free(ptrs[i]);
+        }
+    }
+    const ticks_t heap_ticks = get_ticks() - heap_start;
+
+    arena_t arena;
+    const ticks_t arena_start = get_ticks();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < objects; ++i) {
+            ptrs[i] = arena.allocate(object_size);
+        }
+        for (size_t i = 0; i < objects; ++i) {
+            arena_t::deallocate(ptrs[i]);
+        }
+    }
+    const ticks_t arena_ticks = get_ticks() - arena_start;
+
+    printf("%zu allocations: heap %.3fs, arena %.3fs (%" PRIu64 " chunks)\n",
+           rounds * objects,
+           ticks_to_secs(heap_ticks),
+           ticks_to_secs(arena_ticks),
+           arena.chunk_count());
+}
+
+// Runs a `filter()` and a `map()` over an array, with the values produced along the
+// way taken from the arena or from the heap.  Returns how many values were produced
+// and how long it took.
+static void run_filter_map(bool use_arena,
+                           uint64_t *allocations_out,
+                           double *secs_out) {
+    const size_t num_rows = 10000;
+    std::vector<ql::datum_t> rows;
+    for (size_t i = 0; i < num_rows; ++i) {
+        rows.push_back(ql::datum_t(static_cast<double>(i)));
+    }
+    const ql::datum_t array(std::move(rows), ql::configured_limits_t::unlimited);
+
+    const ql::pb::dummy_var_t x = ql::pb::dummy_var_t::IGNORED;
+    ql::protob_t<const Term> query =
+        ql::r::expr(array)
+            .filter(ql::r::fun(x, ql::r::var(x) >= ql::r::expr(num_rows / 2.0)))
+            .map(ql::r::fun(x, ql::r::var(x) + ql::r::expr(1.0)))
+            .coerce_to(ql::r::expr(std::string("ARRAY")))
+            .release_counted();
+    ql::compile_env_t compile_env((ql::var_visibility_t()));
+    counted_t<const ql::term_t> term = ql::compile_term(&compile_env, query);
+
+    const int rounds = 20;
+    *allocations_out = 0;
+    const ticks_t start = get_ticks();
+    for (int i = 0; i < rounds; ++i) {
+        cond_t interruptor;
+        ql::env_t env(&interruptor, reql_version_t::LATEST);
+        env.arena()->set_enabled(use_arena);
+        ql::scope_env_t scope_env(&env, ql::var_scope_t());
+        const ql::datum_t result = term->eval(&scope_env)->as_datum();
+        ASSERT_EQ(num_rows / 2, result.arr_size());
+        ASSERT_EQ(ql::datum_t(num_rows / 2.0 + 1.0), result.get(0));
+        *allocations_out += env.arena()->allocation_count();
+    }
+    *secs_out = ticks_to_secs(get_ticks() - start);
+
+    // Both functions are compiled (see `compiled_func_t`), so the filter doesn't
+    // produce any values, and the map produces one for each row that passes the
+    // filter.  Evaluating the terms around them adds a few per round.
+    EXPECT_LE(rounds * num_rows / 2, *allocations_out);
+    EXPECT_GT(rounds * (num_rows / 2 + 100), *allocations_out);
+}
+
+TPTEST(ArenaTest, FilterMapBenchmark) {
+    uint64_t heap_allocations;
+    double heap_secs;
+    run_filter_map(false, &heap_allocations, &heap_secs);
+    uint64_t arena_allocations;
+    double arena_secs;
+    run_filter_map(true, &arena_allocations, &arena_secs);
+
+    printf("filter/map: %" PRIu64 " values from the heap in %.3fs, "
+           "%" PRIu64 " from the arena in %.3fs\n",
+           heap_allocations, heap_secs, arena_allocations, arena_secs);
+    // The arena changes where the values come from, not how many there are.
+    EXPECT_EQ(heap_allocations, arena_allocations);
+}
+
+}  // namespace unittest
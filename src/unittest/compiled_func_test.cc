@@ -0,0 +1,185 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "rdb_protocol/compiled_func.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term.hpp"
+#include "stl_utils.hpp"
+#include "time.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Evaluates `body` with the interpreter and with its compiled form on every row,
+// checking that both agree.  The compiled form may decline to evaluate a row, but
+// only if the interpreter fails on it.
+static void check_compiled_matches_interpreter(ql::protob_t<const Term> body,
+                                               const std::vector<ql::datum_t> &rows,
+                                               size_t *compiled_count_out) {
+    const ql::sym_t arg(1);
+    const std::vector<ql::sym_t> arg_names = make_vector(arg);
+
+    counted_t<const ql::compiled_func_t> compiled
+        = ql::compiled_func_t::compile(arg_names, body);
+    ASSERT_TRUE(compiled.has());
+
+    ql::compile_env_t compile_env(
+        ql::var_visibility_t().with_func_arg_name_list(arg_names));
+    counted_t<const ql::term_t> term = ql::compile_term(&compile_env, body);
+
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+
+    *compiled_count_out = 0;
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        const std::vector<ql::datum_t> args = make_vector(*it);
+        ql::datum_t compiled_res = compiled->eval(&env, args);
+
+        ql::datum_t interpreted_res;
+        try {
+            ql::scope_env_t scope_env(
+                &env, ql::var_scope_t().with_func_arg_list(arg_names, args));
+            interpreted_res = term->eval(&scope_env)->as_datum();
+        } catch (const ql::base_exc_t &) {
+            ASSERT_FALSE(compiled_res.has()) << it->print();
+            continue;
+        }
+        if (compiled_res.has()) {
+            ++*compiled_count_out;
+            ASSERT_EQ(interpreted_res, compiled_res) << it->print();
+        }
+    }
+}
+
+static std::vector<ql::datum_t> make_rows(size_t count) {
+    std::vector<ql::datum_t> rows;
+    for (size_t i = 0; i < count; ++i) {
+        ql::datum_object_builder_t row;
+        row.overwrite("id", ql::datum_t(static_cast<double>(i)));
+        row.overwrite("status", ql::datum_t(i % 3 == 0 ? "open" : "closed"));
+        row.overwrite("score", ql::datum_t(static_cast<double>(i % 100) / 4));
+        if (i % 7 != 0) {
+            // Every seventh row is missing a field.
+            row.overwrite("count", ql::datum_t(static_cast<double>(i % 10)));
+        } else if (i % 14 == 0) {
+            // ... and some of those have it with the wrong type.
+            row.overwrite("count", ql::datum_t("ten"));
+        }
+        rows.push_back(std::move(row).to_datum());
+    }
+    return rows;
+}
+
+TPTEST(CompiledFuncTest, MatchesInterpreter) {
+    const ql::sym_t arg(1);
+    std::vector<ql::datum_t> rows = make_rows(200);
+    size_t compiled_count;
+
+    check_compiled_matches_interpreter(
+        (ql::r::var(arg)["status"] == ql::r::expr(std::string("open")))
+            .release_counted(),
+        rows, &compiled_count);
+    EXPECT_EQ(rows.size(), compiled_count);
+
+    check_compiled_matches_interpreter(
+        ((ql::r::var(arg)["score"] > ql::r::expr(10.0))
+         && (ql::r::var(arg)["count"] <= ql::r::expr(5.0))).release_counted(),
+        rows, &compiled_count);
+    EXPECT_GT(compiled_count, 0u);
+
+    check_compiled_matches_interpreter(
+        ((ql::r::var(arg)["count"] + ql::r::expr(1.0)) / ql::r::var(arg)["score"])
+            .release_counted(),
+        rows, &compiled_count);
+    EXPECT_GT(compiled_count, 0u);
+
+    check_compiled_matches_interpreter(
+        (!(ql::r::var(arg)["status"] + ql::r::expr(std::string("!"))
+           == ql::r::expr(std::string("closed!")))).release_counted(),
+        rows, &compiled_count);
+    EXPECT_EQ(rows.size(), compiled_count);
+}
+
+TPTEST(CompiledFuncTest, ConstantFolding) {
+    const ql::sym_t arg(1);
+    counted_t<const ql::compiled_func_t> folded = ql::compiled_func_t::compile(
+        make_vector(arg),
+        ((ql::r::expr(2.0) + ql::r::expr(3.0)) < ql::r::expr(6.0)).release_counted());
+    ASSERT_TRUE(folded.has());
+    EXPECT_TRUE(folded->is_constant());
+
+    // Errors are left to the interpreter.
+    counted_t<const ql::compiled_func_t> div_by_zero = ql::compiled_func_t::compile(
+        make_vector(arg),
+        (ql::r::expr(2.0) / ql::r::expr(0.0)).release_counted());
+    ASSERT_TRUE(div_by_zero.has());
+    EXPECT_FALSE(div_by_zero->is_constant());
+
+    counted_t<const ql::compiled_func_t> not_folded = ql::compiled_func_t::compile(
+        make_vector(arg),
+        (ql::r::var(arg)["id"] + (ql::r::expr(2.0) + ql::r::expr(3.0)))
+            .release_counted());
+    ASSERT_TRUE(not_folded.has());
+    EXPECT_FALSE(not_folded->is_constant());
+}
+
+TPTEST(CompiledFuncTest, UnsupportedTerms) {
+    const ql::sym_t arg(1);
+    const ql::sym_t captured(2);
+    // Variables from an enclosing scope.
+    EXPECT_FALSE(ql::compiled_func_t::compile(
+        make_vector(arg),
+        (ql::r::var(captured) == ql::r::expr(1.0)).release_counted()).has());
+    // Terms outside of the supported subset.
+    EXPECT_FALSE(ql::compiled_func_t::compile(
+        make_vector(arg),
+        ql::r::var(arg).pluck(ql::r::expr(std::string("id"))).release_counted()).has());
+}
+
+// Compares the time it takes to evaluate a typical `filter` predicate with the
+// interpreter and with the compiled form.
+TPTEST(CompiledFuncTest, Benchmark) {
+    const ql::sym_t arg(1);
+    const std::vector<ql::sym_t> arg_names = make_vector(arg);
+    const std::vector<ql::datum_t> rows = make_rows(100000);
+
+    ql::protob_t<const Term> body =
+        ((ql::r::var(arg)["status"] == ql::r::expr(std::string("open")))
+         && (ql::r::var(arg)["score"] / ql::r::expr(0.5) > ql::r::expr(20.0)))
+        .release_counted();
+
+    ql::compile_env_t compile_env(
+        ql::var_visibility_t().with_func_arg_name_list(arg_names));
+    counted_t<const ql::term_t> term = ql::compile_term(&compile_env, body);
+    counted_t<const ql::compiled_func_t> compiled
+        = ql::compiled_func_t::compile(arg_names, body);
+    ASSERT_TRUE(compiled.has());
+
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+
+    size_t interpreted_matches = 0;
+    const ticks_t interpreted_start = get_ticks();
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        ql::scope_env_t scope_env(
+            &env, ql::var_scope_t().with_func_arg_list(arg_names, make_vector(*it)));
+        interpreted_matches += term->eval(&scope_env)->as_bool() ? 1 : 0;
+    }
+    const ticks_t interpreted_ticks = get_ticks() - interpreted_start;
+
+    size_t compiled_matches = 0;
+    const ticks_t compiled_start = get_ticks();
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        compiled_matches += compiled->eval(&env, make_vector(*it)).as_bool() ? 1 : 0;
+    }
+    const ticks_t compiled_ticks = get_ticks() - compiled_start;
+
+    EXPECT_EQ(interpreted_matches, compiled_matches);
+    printf("%zu rows: interpreted %.3fs, compiled %.3fs\n",
+           rows.size(),
+           ticks_to_secs(interpreted_ticks),
+           ticks_to_secs(compiled_ticks));
+}
+
+}  // namespace unittest
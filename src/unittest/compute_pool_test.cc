@@ -0,0 +1,96 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "concurrency/parallel.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(ComputePoolTest, ParallelFor, 4) {
+    const size_t size = 100000;
+    std::vector<int> visits(size, 0);
+    parallel_for(0, size, 100, [&](size_t b, size_t e) {
+        EXPECT_LE(e - b, 100u);
+        for (size_t i = b; i < e; ++i) {
+            ++visits[i];
+        }
+    });
+    for (size_t i = 0; i < size; ++i) {
+        EXPECT_EQ(1, visits[i]);
+    }
+}
+
+TPTEST(ComputePoolTest, Exception, 4) {
+    EXPECT_THROW(parallel_for(0, 100000, 100, [](size_t b, size_t e) {
+                     if (b <= 5000 && 5000 < e) {
+                         throw std::runtime_error("5000");
+                     }
+                 }),
+                 std::runtime_error);
+
+    // The pool still works afterwards.
+    EXPECT_EQ(100000u * 99999u / 2,
+              parallel_reduce(0, 100000, 1000, static_cast<size_t>(0),
+                              [](size_t b, size_t e) {
+                                  size_t sum = 0;
+                                  for (size_t i = b; i < e; ++i) {
+                                      sum += i;
+                                  }
+                                  return sum;
+                              },
+                              [](size_t x, size_t y) { return x + y; }));
+}
+
+std::vector<std::pair<int, int> > make_unsorted(size_t size) {
+    std::vector<std::pair<int, int> > values(size);
+    for (size_t i = 0; i < size; ++i) {
+        // Lots of equal keys, so that stability matters.
+        values[i] = std::make_pair(random() % 1000, static_cast<int>(i));
+    }
+    return values;
+}
+
+bool first_lt(const std::pair<int, int> &l, const std::pair<int, int> &r) {
+    return l.first < r.first;
+}
+
+TPTEST(ComputePoolTest, ParallelSort, 4) {
+    for (size_t size : {0, 10, 5000, 100000, 100003}) {
+        std::vector<std::pair<int, int> > values = make_unsorted(size);
+        std::vector<std::pair<int, int> > expected = values;
+        std::stable_sort(expected.begin(), expected.end(), &first_lt);
+        parallel_sort(values.begin(), values.end(), &first_lt);
+        EXPECT_TRUE(expected == values);
+    }
+}
+
+// Compares sorting a big array on one thread with sorting it on the compute pool.
+TPTEST(ComputePoolTest, SortBenchmark, 4) {
+    const size_t size = 2000000;
+    std::vector<std::pair<int, int> > values = make_unsorted(size);
+
+    std::vector<std::pair<int, int> > serial = values;
+    ticks_t start = get_ticks();
+    std::stable_sort(serial.begin(), serial.end(), &first_lt);
+    const ticks_t serial_ticks = get_ticks() - start;
+
+    start = get_ticks();
+    parallel_sort(values.begin(), values.end(), &first_lt);
+    const ticks_t parallel_ticks = get_ticks() - start;
+
+    EXPECT_TRUE(serial == values);
+    printf("Sorting %zu elements: one thread %.3fs, compute pool (%d workers) %.3fs\n",
+           size, ticks_to_secs(serial_ticks),
+           linux_thread_pool_t::get_compute_pool()->num_workers(),
+           ticks_to_secs(parallel_ticks));
+}
+
+}  // namespace unittest
@@ -1,8 +1,13 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "arch/runtime/context_switching.hpp"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <stdexcept>
+#include <vector>
 
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "unittest/gtest.hpp"
 
@@ -89,6 +94,53 @@ TEST(ContextSwitchingTest, SwitchBetweenContexts) {
     original_context = NULL;
 }
 
+static NOINLINE void touch_stack(void) {
+    volatile char buffer[256 * KILOBYTE];
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        buffer[i] = 1;
+    }
+}
+
+static void use_deep_stack(void) {
+    touch_stack();
+    context_switch(artificial_stack_1_context, original_context);
+}
+
+static size_t count_resident_pages(void *begin, void *end) {
+    const size_t page_size = getpagesize();
+    const size_t size = static_cast<char *>(end) - static_cast<char *>(begin);
+    std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+    int res = mincore(begin, size, pages.data());
+    EXPECT_EQ(0, res);
+    size_t resident = 0;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        resident += pages[i] & 1;
+    }
+    return resident;
+}
+
+TEST(ContextSwitchingTest, FreeUnusedPages) {
+    scoped_ptr_t<coro_context_ref_t> orig_context_local(new coro_context_ref_t);
+    original_context = orig_context_local.get();
+    {
+        coro_stack_t a(&use_deep_stack, 1024*1024);
+        artificial_stack_1_context = &a.context;
+        const size_t pages_used = 256 * KILOBYTE / getpagesize();
+
+        // Nothing is committed before the stack is used.
+        EXPECT_GE(2u, count_resident_pages(a.get_stack_bound(), a.get_stack_base()));
+
+        context_switch(original_context, artificial_stack_1_context);
+        EXPECT_LE(pages_used,
+                  count_resident_pages(a.get_stack_bound(), a.get_stack_base()));
+
+        // Only the pages around the saved context are left.
+        a.free_unused_pages();
+        EXPECT_GE(4u, count_resident_pages(a.get_stack_bound(), a.get_stack_base()));
+    }
+    original_context = NULL;
+}
+
 __attribute__((noreturn)) static void throw_an_exception() {
     throw std::runtime_error("This is a test exception");
 }
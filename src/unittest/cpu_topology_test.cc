@@ -0,0 +1,136 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <pthread.h>
+#include <stdio.h>
+
+#include <functional>
+#include <set>
+#include <vector>
+
+#include "arch/runtime/cpu_topology.hpp"
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(CpuTopologyTest, PlacementOrder) {
+    const std::vector<cpu_info_t> order = get_cpu_placement_order();
+    if (order.empty()) {
+        // Containers and other platforms may not let us read the topology.
+        printf("could not read the CPU topology, skipping\n");
+        return;
+    }
+
+    std::set<int> cpus;
+    std::set<int> nodes;
+    for (const cpu_info_t &cpu : order) {
+        EXPECT_TRUE(cpus.insert(cpu.cpu).second);
+        nodes.insert(cpu.numa_node);
+    }
+    // The nodes are numbered densely, and dealt out in turn.
+    for (size_t i = 0; i < order.size() && i < nodes.size(); ++i) {
+        EXPECT_EQ(static_cast<int>(i), order[i].numa_node);
+    }
+    // No core gets a second thread before every core has one.
+    bool seen_sibling = false;
+    for (const cpu_info_t &cpu : order) {
+        if (cpu.sibling_rank > 0) {
+            seen_sibling = true;
+        } else {
+            EXPECT_FALSE(seen_sibling);
+        }
+    }
+}
+
+#ifdef _GNU_SOURCE
+
+void *run_pinned_function(void *arg) {
+    (*static_cast<std::function<void()> *>(arg))();
+    return NULL;
+}
+
+void run_pinned(int cpu, std::function<void()> fn) {
+    pthread_attr_t attr;
+    int res = pthread_attr_init(&attr);
+    guarantee_xerr(res == 0, res, "pthread_attr_init failed.");
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    res = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    guarantee_xerr(res == 0, res, "Could not set thread affinity");
+    pthread_t thread;
+    res = pthread_create(&thread, &attr, &run_pinned_function, &fn);
+    guarantee_xerr(res == 0, res, "Could not create thread");
+    res = pthread_join(thread, NULL);
+    guarantee_xerr(res == 0, res, "Could not join thread");
+    res = pthread_attr_destroy(&attr);
+    guarantee_xerr(res == 0, res, "pthread_attr_destroy failed.");
+}
+
+// Reads a buffer that was first touched on one NUMA node, from a CPU on the same node
+// and from one on another, which is what a thread-per-core server saves its threads
+// from doing.
+TEST(CpuTopologyTest, NumaLocalityBenchmark) {
+    const std::vector<cpu_info_t> order = get_cpu_placement_order();
+    if (order.empty()) {
+        printf("could not read the CPU topology, skipping\n");
+        return;
+    }
+
+    const cpu_info_t *owner = &order[0];
+    const cpu_info_t *local = NULL;
+    const cpu_info_t *remote = NULL;
+    for (const cpu_info_t &cpu : order) {
+        if (cpu.numa_node == owner->numa_node && cpu.core != owner->core
+            && local == NULL) {
+            local = &cpu;
+        } else if (cpu.numa_node != owner->numa_node && remote == NULL) {
+            remote = &cpu;
+        }
+    }
+    if (local == NULL) {
+        local = owner;
+    }
+
+    const size_t num_words = 8 * MEGABYTE;
+    const int passes = 4;
+    scoped_array_t<uint64_t> words;
+    run_pinned(owner->cpu, [&]() {
+        words.init(num_words);
+        for (size_t i = 0; i < num_words; ++i) {
+            words[i] = i;
+        }
+    });
+
+    auto measure = [&](const cpu_info_t *reader) -> double {
+        ticks_t elapsed = 0;
+        uint64_t sum = 0;
+        run_pinned(reader->cpu, [&]() {
+            const ticks_t start = get_ticks();
+            for (int pass = 0; pass < passes; ++pass) {
+                for (size_t i = 0; i < num_words; ++i) {
+                    sum += words[i];
+                }
+            }
+            elapsed = get_ticks() - start;
+        });
+        EXPECT_EQ(passes * (num_words * (num_words - 1) / 2), sum);
+        return static_cast<double>(passes * num_words * sizeof(uint64_t))
+            / GIGABYTE / ticks_to_secs(elapsed);
+    };
+
+    printf("read from the local node (cpu %d): %.2f GB/s\n",
+           local->cpu, measure(local));
+    if (remote != NULL) {
+        printf("read from a remote node (cpu %d): %.2f GB/s\n",
+               remote->cpu, measure(remote));
+    } else {
+        printf("only one NUMA node, no remote reads\n");
+    }
+}
+
+#endif  // _GNU_SOURCE
+
+}  // namespace unittest
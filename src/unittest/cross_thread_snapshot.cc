@@ -0,0 +1,114 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "clustering/administration/metadata.hpp"
+#include "concurrency/cross_thread_snapshot.hpp"
+#include "concurrency/cross_thread_watchable.hpp"
+#include "concurrency/pmap.hpp"
+#include "concurrency/watchable.hpp"
+#include "containers/clone_ptr.hpp"
+#include "containers/scoped.hpp"
+#include "time.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TPTEST_MULTITHREAD(CrossThreadSnapshot, ValuesReachEveryThread, 3) {
+    watchable_variable_t<int> watchable(0);
+    cross_thread_snapshot_t<int> snapshot(watchable.get_watchable());
+
+    // Every thread starts out with the initial value.
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        EXPECT_EQ(0, snapshot.get()->get());
+    });
+
+    counted_t<const cross_thread_snapshot_t<int>::snapshot_t> old = snapshot.get();
+    for (int value = 1; value < 100; ++value) {
+        watchable.set_value(value);
+        pmap(get_num_threads(), [&](int i) {
+            on_thread_t thread_switcher((threadnum_t(i)));
+            signal_timer_t timer;
+            timer.start(5000);
+            uint64_t last_version = snapshot.get()->get_version();
+            snapshot.run_until_satisfied([&](int v) {
+                // Versions never go backwards on a thread.
+                EXPECT_LE(last_version, snapshot.get()->get_version());
+                last_version = snapshot.get()->get_version();
+                return v == value;
+            }, &timer);
+            EXPECT_EQ(value, snapshot.get()->get());
+        });
+        EXPECT_LT(old->get_version(), snapshot.get()->get_version());
+    }
+
+    // A snapshot that's held on to keeps its value.
+    EXPECT_EQ(0, old->get());
+}
+
+static bool find_table(const namespaces_semilattice_metadata_t &metadata,
+                       const name_string_t &name, const database_id_t &db_id) {
+    const_metadata_searcher_t<namespace_semilattice_metadata_t> ns_searcher(
+        &metadata.namespaces);
+    namespace_predicate_t pred(&name, &db_id);
+    metadata_search_status_t status;
+    ns_searcher.find_uniq(pred, &status);
+    return status == METADATA_SUCCESS;
+}
+
+/* Compares looking a table up in a per-thread copy of the metadata, the way queries
+used to, with looking it up in a shared snapshot. */
+TPTEST(CrossThreadSnapshot, MetadataLookupBenchmark, 2) {
+    const int num_tables = 1000;
+    const int num_lookups = 1000;
+
+    const database_id_t db_id = generate_uuid();
+    std::vector<name_string_t> names;
+    namespaces_semilattice_metadata_t metadata;
+    for (int i = 0; i < num_tables; ++i) {
+        name_string_t name;
+        bool assigned = name.assign_value(strprintf("table_%d", i));
+        guarantee(assigned);
+        names.push_back(name);
+        metadata.namespaces.insert(std::make_pair(
+            generate_uuid(),
+            make_deletable(new_namespace(generate_uuid(), db_id, nil_uuid(), name,
+                                         "id"))));
+    }
+
+    watchable_variable_t<namespaces_semilattice_metadata_t> watchable(metadata);
+    cross_thread_watchable_variable_t<namespaces_semilattice_metadata_t> copied(
+        watchable.get_watchable(), threadnum_t(1));
+    cross_thread_snapshot_t<namespaces_semilattice_metadata_t> shared(
+        watchable.get_watchable());
+
+    on_thread_t thread_switcher((threadnum_t(1)));
+
+    ticks_t start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        namespaces_semilattice_metadata_t copy;
+        copied.apply_read([&](const namespaces_semilattice_metadata_t *md) {
+            copy = *md;
+        });
+        ASSERT_TRUE(find_table(copy, names[i % num_tables], db_id));
+    }
+    const ticks_t copy_ticks = get_ticks() - start;
+
+    start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        counted_t<const cross_thread_snapshot_t<namespaces_semilattice_metadata_t>
+                  ::snapshot_t> snapshot = shared.get();
+        ASSERT_TRUE(find_table(snapshot->get(), names[i % num_tables], db_id));
+    }
+    const ticks_t snapshot_ticks = get_ticks() - start;
+
+    printf("%d tables: copy and look up %" PRIu64 " ns, "
+           "snapshot and look up %" PRIu64 " ns\n",
+           num_tables, copy_ticks / num_lookups, snapshot_ticks / num_lookups);
+}
+
+}  // namespace unittest
@@ -0,0 +1,97 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "containers/archive/string_stream.hpp"
+#include "containers/archive/varint.hpp"
+#include "protob/datum_shim.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+// Reads a `BINARY_DATUM` payload back, the way a client would.
+void read_datum_payload(std::string &&payload, int64_t offset,
+                        int32_t *type_out, std::vector<ql::datum_t> *data_out,
+                        ql::datum_t *backtrace_out, ql::datum_t *profile_out) {
+    string_read_stream_t stream(std::move(payload), offset);
+    ASSERT_EQ(static_cast<int64_t>(sizeof(*type_out)),
+              force_read(&stream, type_out, sizeof(*type_out)));
+    uint64_t count;
+    ASSERT_EQ(archive_result_t::SUCCESS, deserialize_varint_uint64(&stream, &count));
+    data_out->resize(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  ql::datum_deserialize(&stream, &(*data_out)[i]));
+    }
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, backtrace_out));
+    ASSERT_EQ(archive_result_t::SUCCESS, ql::datum_deserialize(&stream, profile_out));
+    char c;
+    ASSERT_EQ(0, stream.read(&c, 1));
+}
+
+TEST(DatumShim, WriteRows) {
+    std::vector<ql::datum_t> rows;
+    rows.push_back(ql::datum_t(1.5));
+    rows.push_back(ql::datum_t("row"));
+    rows.push_back(ql::datum_t(std::vector<ql::datum_t>(3, ql::datum_t::boolean(true)),
+                               ql::configured_limits_t::unlimited));
+
+    Response r;
+    r.set_token(1);
+    r.set_type(Response::SUCCESS_SEQUENCE);
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        it->write_to_protobuf(r.add_response(), ql::use_json_t::SERIALIZED);
+        EXPECT_EQ(Datum::R_SERIALIZED, r.response(r.response_size() - 1).type());
+    }
+    ql::datum_t(1.0).write_to_protobuf(r.mutable_profile(), ql::use_json_t::SERIALIZED);
+
+    // The payload is appended to whatever is in the buffer already.
+    std::string out = "header";
+    datum_shim::write_datum_pb(r, &out);
+    EXPECT_EQ("header", out.substr(0, 6));
+
+    int32_t type;
+    std::vector<ql::datum_t> data;
+    ql::datum_t backtrace, profile;
+    read_datum_payload(std::move(out), 6, &type, &data, &backtrace, &profile);
+    EXPECT_EQ(Response::SUCCESS_SEQUENCE, type);
+    EXPECT_EQ(rows, data);
+    EXPECT_EQ(ql::datum_t::null(), backtrace);
+    EXPECT_EQ(ql::datum_t(1.0), profile);
+}
+
+TEST(DatumShim, WriteError) {
+    Response r;
+    r.set_token(1);
+    r.set_type(Response::RUNTIME_ERROR);
+    Datum *msg = r.add_response();
+    msg->set_type(Datum::R_STR);
+    msg->set_r_str("Table `t` does not exist.");
+    Frame *frame = r.mutable_backtrace()->add_frames();
+    frame->set_type(Frame::POS);
+    frame->set_pos(0);
+    frame = r.mutable_backtrace()->add_frames();
+    frame->set_type(Frame::OPT);
+    frame->set_opt("index");
+
+    std::string out;
+    datum_shim::write_datum_pb(r, &out);
+
+    int32_t type;
+    std::vector<ql::datum_t> data;
+    ql::datum_t backtrace, profile;
+    read_datum_payload(std::move(out), 0, &type, &data, &backtrace, &profile);
+    EXPECT_EQ(Response::RUNTIME_ERROR, type);
+    ASSERT_EQ(1u, data.size());
+    EXPECT_EQ(ql::datum_t("Table `t` does not exist."), data[0]);
+    ASSERT_EQ(ql::datum_t::R_ARRAY, backtrace.get_type());
+    ASSERT_EQ(2u, backtrace.arr_size());
+    EXPECT_EQ(ql::datum_t(0.0), backtrace.get(0));
+    EXPECT_EQ(ql::datum_t("index"), backtrace.get(1));
+    EXPECT_EQ(ql::datum_t::null(), profile);
+}
+
+}  // namespace unittest
@@ -205,4 +205,75 @@ TEST(DatumTest, OffsetScaling) {
     }
 }
 
+ql::datum_t make_nested_test_datum(size_t num_elements) {
+    std::vector<ql::datum_t> array;
+    for (size_t i = 0; i < num_elements; ++i) {
+        array.push_back(ql::datum_t(std::map<datum_string_t, ql::datum_t>
+            {std::make_pair(datum_string_t("id"), ql::datum_t(static_cast<double>(i))),
+             std::make_pair(datum_string_t("name"),
+                            ql::datum_t(datum_string_t(std::string(10, 'A'))))}));
+    }
+    return ql::datum_t(std::map<datum_string_t, ql::datum_t>
+        {std::make_pair(datum_string_t("a"), ql::datum_t::null()),
+         std::make_pair(datum_string_t("array"),
+                        ql::datum_t(std::move(array),
+                                    ql::configured_limits_t::unlimited))});
+}
+
+size_t actual_serialized_size(const ql::datum_t &datum) {
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, datum);
+    return wm.size();
+}
+
+TEST(DatumTest, SerializedSize) {
+    for (size_t num_elements = 0; num_elements < 300; num_elements += 37) {
+        ql::datum_t datum = make_nested_test_datum(num_elements);
+        // The first call computes the size, the second one uses the cached value.
+        const size_t sz = ql::datum_serialized_size(
+            datum, ql::check_datum_serialization_errors_t::NO);
+        ASSERT_EQ(sz, ql::datum_serialized_size(
+            datum, ql::check_datum_serialization_errors_t::NO));
+        ASSERT_EQ(actual_serialized_size(datum), sz);
+        // The overload used by batching gives the same size.
+        ASSERT_EQ(sz, ql::datum_serialized_size(datum));
+    }
+}
+
+TEST(DatumTest, SerializedSizeForBatching) {
+    ql::datum_t small_datum = make_nested_test_datum(5);
+    ASSERT_EQ(actual_serialized_size(make_nested_test_datum(5)),
+              ql::datum_serialized_size(small_datum));
+
+    // Batching relies on the size being exact, even for documents whose first
+    // elements don't look like the rest.
+    std::vector<ql::datum_t> array;
+    for (size_t i = 0; i < 1000; ++i) {
+        array.push_back(i < 100
+                        ? ql::datum_t(static_cast<double>(i))
+                        : make_nested_test_datum(10));
+    }
+    ql::datum_t large_datum(std::move(array), ql::configured_limits_t::unlimited);
+    ASSERT_EQ(actual_serialized_size(large_datum),
+              ql::datum_serialized_size(large_datum));
+}
+
+TEST(DatumTest, WriteJson) {
+    std::vector<ql::datum_t> array;
+    array.push_back(ql::datum_t::null());
+    array.push_back(ql::datum_t::boolean(true));
+    array.push_back(ql::datum_t(-1.25e-7));
+    array.push_back(ql::datum_t(datum_string_t(std::string("quote\" slash\\ \x01\t\xc3\xa9"))));
+    array.push_back(ql::datum_t::binary(datum_string_t(std::string("\x00\xff", 2))));
+    array.push_back(ql::datum_t(std::map<datum_string_t, ql::datum_t>()));
+    array.push_back(ql::datum_t(std::map<datum_string_t, ql::datum_t>
+        {std::make_pair(datum_string_t("a\nb"), ql::datum_t(3.0)),
+         std::make_pair(datum_string_t("c"), make_nested_test_datum(3))}));
+    ql::datum_t datum(std::move(array), ql::configured_limits_t::unlimited);
+
+    std::string json;
+    datum.write_json(&json);
+    ASSERT_EQ(datum.as_json().PrintUnformatted(), json);
+}
+
 }  // namespace unittest
@@ -0,0 +1,66 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <functional>
+
+#include "arch/runtime/starter.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/timing.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+const int round_trips = 5000;
+
+// Bounces a coroutine between two threads, keeping thread zero busy for a while after
+// each round trip, so that thread one goes idle between the coroutine's visits.
+// Reports the round trips' throughput, and naps at the end, so that both threads go to
+// sleep at least once.
+void run_ping_pong(const char *mode, event_queue_stats_t *stats_out) {
+    ticks_t elapsed = 0;
+    for (int i = 0; i < round_trips; ++i) {
+        const ticks_t start = get_ticks();
+        {
+            on_thread_t th((threadnum_t(1)));
+        }
+        const ticks_t end = get_ticks();
+        elapsed += end - start;
+        while (get_ticks() < end + 50 * THOUSAND) { }
+    }
+    for (int i = 0; i < 10; ++i) {
+        nap(1);
+    }
+    printf("%s: %.0f round trips between threads per second\n",
+           mode, round_trips / ticks_to_secs(elapsed));
+    for (int i = 0; i < 2; ++i) {
+        on_thread_t th((threadnum_t(i)));
+        stats_out[i] = linux_thread_pool_t::get_thread()->queue.get_stats();
+    }
+}
+
+TEST(EventQueueTest, BusyPoll) {
+    event_queue_stats_t sleeping[2];
+    ::run_in_thread_pool(std::bind(&run_ping_pong, "sleeping", sleeping), 2);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_LT(0, sleeping[i].iterations);
+        EXPECT_LT(0, sleeping[i].sleeps);
+        EXPECT_EQ(0, sleeping[i].busy_poll_hits);
+        EXPECT_EQ(0, sleeping[i].busy_poll_ns);
+        EXPECT_LE(sleeping[i].event_batches, sleeping[i].events);
+    }
+
+    event_queue_stats_t polling[2];
+    ::run_in_thread_pool(std::bind(&run_ping_pong, "busy polling", polling), 2,
+                         false, 100 * THOUSAND);
+    // How many of the coroutine's visits are caught by busy polling depends on the
+    // scheduling of the machine, but with a budget of 100ms some are.
+    EXPECT_LT(0, polling[0].busy_poll_hits + polling[1].busy_poll_hits);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_LT(0, polling[i].iterations);
+        EXPECT_LE(polling[i].event_batches, polling[i].events);
+    }
+}
+
+}  // namespace unittest
@@ -0,0 +1,67 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "rdb_protocol/index_selection.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/pb_utils.hpp"
+
+namespace unittest {
+
+std::vector<ql::index_condition_t> conditions_of(ql::r::reql_t &&predicate) {
+    ql::protob_t<const Term> term = std::move(predicate).release_counted();
+    return ql::find_index_conditions(*term);
+}
+
+TEST(IndexSelection, ObjectPredicate) {
+    std::vector<ql::index_condition_t> conditions = conditions_of(
+        ql::r::object(ql::r::optarg("status", std::string("open")),
+                      ql::r::optarg("owner", ql::r::object())));
+    // Nested objects are matched recursively, so they can't be looked up.
+    ASSERT_EQ(1u, conditions.size());
+    EXPECT_EQ("status", conditions[0].field);
+    EXPECT_TRUE(conditions[0].is_equality);
+    EXPECT_EQ(ql::datum_t("open"), conditions[0].left_bound);
+}
+
+TEST(IndexSelection, FunctionPredicate) {
+    const ql::pb::dummy_var_t x = ql::pb::dummy_var_t::IGNORED;
+    std::vector<ql::index_condition_t> conditions = conditions_of(
+        ql::r::fun(x,
+                   (ql::r::expr(10.0) < ql::r::var(x)["score"])
+                   && (ql::r::var(x)["score"] <= ql::r::expr(20.0))
+                   && (ql::r::var(x)["id"] == ql::r::expr(3.0))));
+    // Equalities come first.
+    ASSERT_EQ(2u, conditions.size());
+    EXPECT_EQ("id", conditions[0].field);
+    EXPECT_TRUE(conditions[0].is_equality);
+    EXPECT_EQ("score", conditions[1].field);
+    EXPECT_FALSE(conditions[1].is_equality);
+    EXPECT_EQ(ql::datum_t(10.0), conditions[1].left_bound);
+    EXPECT_TRUE(conditions[1].left_open);
+    EXPECT_EQ(ql::datum_t(20.0), conditions[1].right_bound);
+    EXPECT_FALSE(conditions[1].right_open);
+}
+
+TEST(IndexSelection, UnusablePredicates) {
+    const ql::pb::dummy_var_t x = ql::pb::dummy_var_t::IGNORED;
+    // One-sided ranges could match rows that aren't in the index.
+    EXPECT_TRUE(conditions_of(
+        ql::r::fun(x, ql::r::var(x)["score"] > ql::r::expr(10.0))).empty());
+    // So could ranges whose ends have different types.
+    EXPECT_TRUE(conditions_of(
+        ql::r::fun(x, (ql::r::var(x)["score"] > ql::r::expr(10.0))
+                      && (ql::r::var(x)["score"] < ql::r::expr(std::string("a")))))
+        .empty());
+    // Empty ranges are left to the scan.
+    EXPECT_TRUE(conditions_of(
+        ql::r::fun(x, (ql::r::var(x)["score"] > ql::r::expr(10.0))
+                      && (ql::r::var(x)["score"] < ql::r::expr(10.0)))).empty());
+    // Only conjunctions narrow down the rows.
+    EXPECT_TRUE(conditions_of(
+        ql::r::fun(x, !(ql::r::var(x)["id"] == ql::r::expr(3.0)))).empty());
+    // `null` is never indexed.
+    EXPECT_TRUE(conditions_of(
+        ql::r::fun(x, ql::r::var(x)["id"] == ql::r::null())).empty());
+}
+
+}  // namespace unittest
@@ -0,0 +1,172 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+
+#include "protob/json_shim.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/ql2.pb.h"
+#include "rdb_protocol/ql2_extensions.pb.h"
+#include "rdb_protocol/term.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TEST(JsonShim, ParseQuery) {
+    Query q;
+    ASSERT_TRUE(json_shim::parse_json_pb(
+        &q, 7, "[1, [15, [[14, [\"db\"]], \"table\"], {\"use_outdated\": true}],"
+               " {\"profile\": false}]"));
+    EXPECT_EQ(7, q.token());
+    EXPECT_EQ(Query::START, q.type());
+    EXPECT_TRUE(q.accepts_r_json());
+
+    const Term &table = q.query();
+    EXPECT_EQ(Term::TABLE, table.type());
+    ASSERT_EQ(2, table.args_size());
+    EXPECT_EQ(Term::DB, table.args(0).type());
+    EXPECT_EQ("table", table.args(1).datum().r_str());
+    ASSERT_EQ(1, table.optargs_size());
+    EXPECT_EQ("use_outdated", table.optargs(0).key());
+    EXPECT_TRUE(table.optargs(0).val().datum().r_bool());
+
+    ASSERT_EQ(1, q.global_optargs_size());
+    EXPECT_EQ("profile", q.global_optargs(0).key());
+}
+
+TEST(JsonShim, ParseStrings) {
+    Query q;
+    ASSERT_TRUE(json_shim::parse_json_pb(
+        &q, 0, "[1, \"a\\\"\\n\\u00e9\\ud83d\\ude00\"]"));
+    EXPECT_EQ("a\"\n\xc3\xa9\xf0\x9f\x98\x80", q.query().datum().r_str());
+
+    // NULL characters and unpaired surrogates are rejected.
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, \"\\u0000\"]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, \"\\ud83d\"]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, \"\\ude00\"]"));
+}
+
+TEST(JsonShim, CollapseLiterals) {
+    Query q;
+    ASSERT_TRUE(json_shim::parse_json_pb(
+        &q, 0, "[1, [56, [[15, [\"t\"]],"
+               " {\"id\": 1, \"tags\": [2, [\"a\", \"b\"]], \"sub\": {\"x\": null}}]]]"));
+    const Term &doc = q.query().args(1);
+    ASSERT_EQ(Term::DATUM, doc.type());
+    ASSERT_EQ(Datum::R_OBJECT, doc.datum().type());
+    ASSERT_EQ(3, doc.datum().r_object_size());
+    EXPECT_EQ("tags", doc.datum().r_object(1).key());
+    EXPECT_EQ(Datum::R_ARRAY, doc.datum().r_object(1).val().type());
+    EXPECT_EQ(2, doc.datum().r_object(1).val().r_array_size());
+    EXPECT_EQ(Datum::R_OBJECT, doc.datum().r_object(2).val().type());
+    // Collapsed terms are marked, so that their arrays get checked against the
+    // query's array limit, and other literals aren't.
+    EXPECT_TRUE(doc.GetExtension(ql2::extension::collapsed_literal));
+    EXPECT_FALSE(q.query().args(0).args(0).GetExtension(
+                     ql2::extension::collapsed_literal));
+
+    // Anything that isn't a literal has to be evaluated.
+    ASSERT_TRUE(json_shim::parse_json_pb(
+        &q, 0, "[1, {\"a\": 1, \"b\": [10, [1]]}]"));
+    EXPECT_EQ(Term::MAKE_OBJ, q.query().type());
+    ASSERT_TRUE(json_shim::parse_json_pb(&q, 0, "[1, [2, [1], {\"x\": 1}]]"));
+    EXPECT_EQ(Term::MAKE_ARRAY, q.query().type());
+
+    // So do pseudotypes and objects with duplicate keys.
+    ASSERT_TRUE(json_shim::parse_json_pb(
+        &q, 0, "[1, {\"$reql_type$\": \"TIME\", \"epoch_time\": 0, \"timezone\": \"Z\"}]"));
+    EXPECT_EQ(Term::MAKE_OBJ, q.query().type());
+    ASSERT_TRUE(json_shim::parse_json_pb(&q, 0, "[1, {\"a\": 1, \"a\": 2}]"));
+    EXPECT_EQ(Term::MAKE_OBJ, q.query().type());
+}
+
+// Compiles and evaluates the term of `q`.
+static ql::datum_t eval_query(const ql::protob_t<Query> &q) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    ql::compile_env_t compile_env((ql::var_visibility_t()));
+    counted_t<const ql::term_t> term =
+        ql::compile_term(&compile_env, q.make_child(q->mutable_query()));
+    ql::scope_env_t scope_env(&env, ql::var_scope_t());
+    return term->eval(&scope_env)->as_datum();
+}
+
+// Compiles and evaluates the term of a query in the JSON wire format.
+static ql::datum_t eval_json_query(const std::string &json) {
+    ql::protob_t<Query> q = ql::make_counted_query();
+    guarantee(json_shim::parse_json_pb(q.get(), 0, json.c_str()));
+    return eval_query(q);
+}
+
+static std::string make_array_json(size_t size) {
+    std::string json = "[2, [";
+    for (size_t i = 0; i < size; ++i) {
+        json += (i == 0 ? "0" : ", 0");
+    }
+    return json + "]]";
+}
+
+TPTEST(JsonShim, CollapsedArraysKeepSizeLimit) {
+    const size_t limit = ql::configured_limits_t().array_size_limit();
+    EXPECT_EQ(limit, eval_json_query("[1, " + make_array_json(limit) + "]").arr_size());
+    EXPECT_THROW(eval_json_query("[1, " + make_array_json(limit + 1) + "]"),
+                 ql::exc_t);
+    // Also when the array is nested in a collapsed object.
+    EXPECT_THROW(eval_json_query("[1, {\"a\": " + make_array_json(limit + 1) + "}]"),
+                 ql::exc_t);
+}
+
+TPTEST(JsonShim, ClientDatumArraysAreNotLimited) {
+    // Arrays that a client sends as `DATUM` terms itself never went through
+    // `make_array`, so they aren't held to the array limit.
+    const size_t limit = ql::configured_limits_t().array_size_limit();
+    ql::protob_t<Query> q = ql::make_counted_query();
+    q->set_type(Query::START);
+    Term *t = q->mutable_query();
+    t->set_type(Term::DATUM);
+    Datum *d = t->mutable_datum();
+    d->set_type(Datum::R_ARRAY);
+    for (size_t i = 0; i < limit + 1; ++i) {
+        Datum *elem = d->add_r_array();
+        elem->set_type(Datum::R_NUM);
+        elem->set_r_num(0);
+    }
+    EXPECT_EQ(limit + 1, eval_query(q).arr_size());
+}
+
+TEST(JsonShim, MalformedQueries) {
+    Query q;
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, ""));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, [2, [1, 2]]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, [2, [1, 2]]] trailing"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1.5, 1]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, 0x10]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, {\"a\" 1}]"));
+    EXPECT_FALSE(json_shim::parse_json_pb(&q, 0, "[1, tru]"));
+}
+
+// Measures how fast we parse a bulk `insert` of literal documents.
+TEST(JsonShim, InsertBenchmark) {
+    const std::string doc =
+        "{\"id\": 12345, \"name\": \"Jane Q. Public\", \"score\": 1.5,"
+        " \"active\": true, \"tags\": [2, [\"a\", \"b\", \"c\"]],"
+        " \"address\": {\"street\": \"123 Main St.\", \"zip\": \"94105\"}}";
+    std::string query = "[1, [56, [[15, [\"table\"]], [2, [";
+    for (int i = 0; i < 1000; ++i) {
+        query += (i == 0 ? "" : ", ") + doc;
+    }
+    query += "]]]]]";
+
+    const int rounds = 100;
+    const ticks_t start = get_ticks();
+    for (int i = 0; i < rounds; ++i) {
+        Query q;
+        ASSERT_TRUE(json_shim::parse_json_pb(&q, i, query.c_str()));
+        ASSERT_EQ(Term::DATUM, q.query().args(1).type());
+    }
+    const double secs = ticks_to_secs(get_ticks() - start);
+    printf("Parsed %d inserts of 1000 documents (%zu bytes each) in %.3fs: %.1f MB/s\n",
+           rounds, query.size(), secs, rounds * query.size() / secs / MEGABYTE);
+}
+
+}  // namespace unittest
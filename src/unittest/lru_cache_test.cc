@@ -65,4 +65,19 @@ TEST(LRUCacheTest, Find) {
     EXPECT_EQ(10, cache.rbegin()->first);
 }
 
+TEST(LRUCacheTest, Erase) {
+    lru_cache_t<int, int> cache(10);
+    for (int i = 0; i < 10; i++) cache[i] = i;
+    EXPECT_EQ(1u, cache.erase(4));
+    EXPECT_EQ(0u, cache.erase(4));
+    EXPECT_EQ(9u, cache.size());
+    EXPECT_EQ(cache.end(), cache.find(4));
+    // The erased entry's slot is free, so nothing gets evicted.
+    cache[10] = 10;
+    EXPECT_EQ(0, cache.find(0)->second);
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.end(), cache.find(10));
+}
+
 } // namespace unittest
@@ -0,0 +1,126 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/pmap.hpp"
+#include "do_on_thread.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+const int NUM_ROUND_TRIPS = 100000;
+
+// Hops back and forth between threads 0 and 1, one message at a time, which is
+// the case the polling before going to sleep is for.
+TPTEST(MessageHubTest, PingPongLatency, 2) {
+    const ticks_t start = get_ticks();
+    for (int i = 0; i < NUM_ROUND_TRIPS; ++i) {
+        on_thread_t thread_switcher(threadnum_t(1));
+    }
+    const ticks_t elapsed = get_ticks() - start;
+    printf("%d round trips between two threads: %.3fs, %.0fns each\n",
+           NUM_ROUND_TRIPS, ticks_to_secs(elapsed),
+           static_cast<double>(elapsed) / NUM_ROUND_TRIPS);
+}
+
+// Has many coroutines hop between the threads at once, so that the messages pile up
+// in the incoming stacks.
+TPTEST(MessageHubTest, PingPongThroughput, 2) {
+    const int num_coroutines = 100;
+    const ticks_t start = get_ticks();
+    pmap(num_coroutines, [](int) {
+        for (int i = 0; i < NUM_ROUND_TRIPS / 100; ++i) {
+            on_thread_t thread_switcher(threadnum_t(1));
+        }
+    });
+    const ticks_t elapsed = get_ticks() - start;
+    printf("%d round trips by %d coroutines between two threads: %.3fs\n",
+           num_coroutines * (NUM_ROUND_TRIPS / 100), num_coroutines,
+           ticks_to_secs(elapsed));
+}
+
+// Ordered messages from one thread must arrive in the order they were sent, even
+// though they go through a stack.
+TPTEST(MessageHubTest, OrderedMessages, 2) {
+    const int num_messages = 10000;
+    std::vector<int> received;
+    cond_t done;
+    {
+        on_thread_t thread_switcher(threadnum_t(1));
+        for (int i = 0; i < num_messages; ++i) {
+            do_on_thread(threadnum_t(0), [&received, &done, i]() {
+                received.push_back(i);
+                if (i == num_messages - 1) {
+                    done.pulse();
+                }
+            });
+        }
+    }
+    done.wait();
+    ASSERT_EQ(static_cast<size_t>(num_messages), received.size());
+    for (int i = 0; i < num_messages; ++i) {
+        EXPECT_EQ(i, received[i]);
+    }
+}
+
+// Coroutines inherit the scheduling class of the coroutine that spawned them, and keep
+// it when they move between threads.
+TPTEST(MessageHubTest, SchedClassPropagation, 2) {
+    EXPECT_EQ(sched_class_t::BATCH, coro_t::self()->get_sched_class());
+    {
+        with_sched_class_t sched_class(sched_class_t::BACKGROUND);
+        EXPECT_EQ(SCHED_BACKGROUND_PRIORITY, coro_t::self()->get_priority());
+
+        cond_t done;
+        sched_class_t spawned_class = sched_class_t::BATCH;
+        sched_class_t moved_class = sched_class_t::BATCH;
+        coro_t::spawn_sometime([&]() {
+            spawned_class = coro_t::self()->get_sched_class();
+            on_thread_t thread_switcher(threadnum_t(1));
+            moved_class = coro_t::self()->get_sched_class();
+            done.pulse();
+        });
+        done.wait();
+        EXPECT_EQ(sched_class_t::BACKGROUND, spawned_class);
+        EXPECT_EQ(sched_class_t::BACKGROUND, moved_class);
+    }
+    EXPECT_EQ(sched_class_t::BATCH, coro_t::self()->get_sched_class());
+    EXPECT_EQ(MESSAGE_SCHEDULER_DEFAULT_PRIORITY, coro_t::self()->get_priority());
+}
+
+// When interactive and batch coroutines are waiting to run at the same time, the
+// interactive ones mostly go first.
+TPTEST(MessageHubTest, SchedClassPriority, 1) {
+    const int num_each = 200;
+    std::vector<sched_class_t> order;
+    cond_t done;
+    for (int i = 0; i < num_each; ++i) {
+        for (sched_class_t sched_class : { sched_class_t::BATCH,
+                                           sched_class_t::INTERACTIVE }) {
+            with_sched_class_t with_class(sched_class);
+            coro_t::spawn_sometime([&]() {
+                order.push_back(coro_t::self()->get_sched_class());
+                if (order.size() == 2 * num_each) {
+                    done.pulse();
+                }
+            });
+        }
+    }
+    done.wait();
+
+    double interactive_position = 0, batch_position = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        (order[i] == sched_class_t::INTERACTIVE
+         ? interactive_position : batch_position) += i;
+    }
+    EXPECT_LT(interactive_position / num_each, batch_position / num_each);
+}
+
+}  // namespace unittest
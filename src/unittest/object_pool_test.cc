@@ -0,0 +1,204 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/pmap.hpp"
+#include "containers/archive/archive.hpp"
+#include "containers/object_pool.hpp"
+#include "do_on_thread.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(ObjectPoolTest, ReusesFreedBlocks) {
+    std::vector<void *> ptrs;
+    for (int i = 0; i < 100; ++i) {
+        ptrs.push_back(object_pool_allocate(100));
+        memset(ptrs.back(), i, 100);
+    }
+    for (void *ptr : ptrs) {
+        object_pool_deallocate(ptr);
+    }
+    ptrs.clear();
+
+    const object_pool_stats_t before = get_object_pool_stats();
+    for (int i = 0; i < 100; ++i) {
+        ptrs.push_back(object_pool_allocate(100));
+    }
+    const object_pool_stats_t after = get_object_pool_stats();
+    EXPECT_EQ(before.heap_allocations, after.heap_allocations);
+    EXPECT_EQ(before.pool_allocations + 100, after.pool_allocations);
+    for (void *ptr : ptrs) {
+        object_pool_deallocate(ptr);
+    }
+}
+
+TPTEST(ObjectPoolTest, LargeObjectsComeFromHeap) {
+    const object_pool_stats_t before = get_object_pool_stats();
+    void *ptr = object_pool_allocate(64 * KILOBYTE);
+    memset(ptr, 0, 64 * KILOBYTE);
+    object_pool_deallocate(ptr);
+    const object_pool_stats_t after = get_object_pool_stats();
+    // Neither taken from nor kept in the pool.
+    EXPECT_EQ(before.heap_allocations, after.heap_allocations);
+    EXPECT_EQ(before.pool_allocations, after.pool_allocations);
+}
+
+TPTEST(ObjectPoolTest, CrossThreadFree, 2) {
+    const size_t size = 3000;
+    std::vector<void *> held;
+    std::vector<void *> remote;
+    {
+        on_thread_t thread_switcher((threadnum_t(0)));
+        // Empty this thread's free list for the size, so that the next blocks it
+        // gets must be the ones that come back from the other thread.
+        for (;;) {
+            const int64_t heap_allocations = get_object_pool_stats().heap_allocations;
+            held.push_back(object_pool_allocate(size));
+            if (get_object_pool_stats().heap_allocations != heap_allocations) {
+                break;
+            }
+        }
+        for (int i = 0; i < 50; ++i) {
+            remote.push_back(object_pool_allocate(size));
+        }
+    }
+    {
+        on_thread_t thread_switcher((threadnum_t(1)));
+        const int64_t remote_frees = get_object_pool_stats().remote_frees;
+        for (void *ptr : remote) {
+            object_pool_deallocate(ptr);
+        }
+        EXPECT_EQ(remote_frees + 50, get_object_pool_stats().remote_frees);
+    }
+    {
+        on_thread_t thread_switcher((threadnum_t(0)));
+        const object_pool_stats_t before = get_object_pool_stats();
+        for (int i = 0; i < 50; ++i) {
+            held.push_back(object_pool_allocate(size));
+        }
+        const object_pool_stats_t after = get_object_pool_stats();
+        EXPECT_EQ(before.heap_allocations, after.heap_allocations);
+        EXPECT_EQ(before.pool_allocations + 50, after.pool_allocations);
+        for (void *ptr : held) {
+            object_pool_deallocate(ptr);
+        }
+    }
+}
+
+/* Counts the allocations that cross-thread round trips make, as a stand-in for the
+messages that a query sends between threads. */
+TPTEST(ObjectPoolTest, RoundTripAllocations, 2) {
+    auto round_trip = []() {
+        cond_t done;
+        do_on_thread(threadnum_t(1), [&]() {
+            do_on_thread(threadnum_t(0), [&]() { done.pulse(); });
+        });
+        done.wait();
+    };
+
+    on_thread_t thread_switcher((threadnum_t(0)));
+    for (int i = 0; i < 100; ++i) {
+        round_trip();
+    }
+
+    const int round_trips = 10000;
+    const object_pool_stats_t before = get_object_pool_stats();
+    for (int i = 0; i < round_trips; ++i) {
+        round_trip();
+    }
+    const object_pool_stats_t after = get_object_pool_stats();
+
+    const int64_t allocations = (after.pool_allocations - before.pool_allocations)
+        + (after.heap_allocations - before.heap_allocations);
+    const int64_t heap_allocations = after.heap_allocations - before.heap_allocations;
+    printf("%d round trips: %" PRIi64 " allocations, %" PRIi64 " from the heap\n",
+           round_trips, allocations, heap_allocations);
+    EXPECT_GE(allocations, round_trips);
+    // Once the pool is warm, hardly anything should need the heap.
+    EXPECT_LT(heap_allocations, round_trips / 10);
+}
+
+/* Counts the pooled allocations that a query makes, per query.  Like a read, each
+query is evaluated on another thread than the one it came in on, and its result is
+serialized on the way back, as a response is. */
+TPTEST(ObjectPoolTest, QueryAllocations, 2) {
+    std::vector<ql::datum_t> rows;
+    for (int i = 0; i < 100; ++i) {
+        rows.push_back(ql::datum_t(static_cast<double>(i)));
+    }
+    const ql::datum_t array(std::move(rows), ql::configured_limits_t::unlimited);
+    const ql::pb::dummy_var_t x = ql::pb::dummy_var_t::IGNORED;
+    ql::protob_t<const Term> query =
+        ql::r::expr(array)
+            .filter(ql::r::fun(x, ql::r::var(x) >= ql::r::expr(50.0)))
+            .coerce_to(ql::r::expr(std::string("ARRAY")))
+            .release_counted();
+
+    on_thread_t thread_switcher((threadnum_t(0)));
+    auto run_query = [&]() {
+        ql::datum_t result;
+        {
+            on_thread_t query_thread((threadnum_t(1)));
+            ql::compile_env_t compile_env((ql::var_visibility_t()));
+            counted_t<const ql::term_t> term = ql::compile_term(&compile_env, query);
+            cond_t interruptor;
+            ql::env_t env(&interruptor, reql_version_t::LATEST);
+            ql::scope_env_t scope_env(&env, ql::var_scope_t());
+            result = term->eval(&scope_env)->as_datum();
+        }
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, result);
+        EXPECT_EQ(50u, result.arr_size());
+    };
+    for (int i = 0; i < 100; ++i) {
+        run_query();
+    }
+
+    // The stats are per thread, so add up both threads'.
+    auto all_stats = []() {
+        object_pool_stats_t stats[2];
+        pmap(2, [&](int i) {
+            on_thread_t stats_thread((threadnum_t(i)));
+            stats[i] = get_object_pool_stats();
+        });
+        object_pool_stats_t total;
+        for (int i = 0; i < 2; ++i) {
+            total.pool_allocations += stats[i].pool_allocations;
+            total.heap_allocations += stats[i].heap_allocations;
+            total.remote_frees += stats[i].remote_frees;
+        }
+        return total;
+    };
+
+    const int queries = 1000;
+    const object_pool_stats_t before = all_stats();
+    for (int i = 0; i < queries; ++i) {
+        run_query();
+    }
+    const object_pool_stats_t after = all_stats();
+
+    const double pool_allocations = after.pool_allocations - before.pool_allocations;
+    const double heap_allocations = after.heap_allocations - before.heap_allocations;
+    const double remote_frees = after.remote_frees - before.remote_frees;
+    printf("Per query: %.2f pooled allocations served from the pool, %.2f from the "
+           "heap, %.2f freed on another thread\n",
+           pool_allocations / queries, heap_allocations / queries,
+           remote_frees / queries);
+    // At least the response's serialization buffer is pooled, and once the pools
+    // are warm, hardly anything should need the heap.
+    EXPECT_GE(pool_allocations, queries);
+    EXPECT_LT(heap_allocations, pool_allocations / 10);
+}
+
+}  // namespace unittest
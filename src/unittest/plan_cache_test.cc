@@ -0,0 +1,129 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "unittest/gtest.hpp"
+
+#include "protob/json_shim.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/term.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// Compiles `query` through `cache` and evaluates it.
+ql::datum_t eval_cached(ql::plan_cache_t *cache,
+                        const ql::protob_t<const Term> &query,
+                        counted_t<const ql::term_t> *plan_out) {
+    cond_t interruptor;
+    ql::env_t env(&interruptor, reql_version_t::LATEST);
+    std::vector<ql::datum_t> params;
+    *plan_out = cache->compile(query, &params);
+    env.set_query_params(std::move(params));
+    ql::scope_env_t scope_env(&env, ql::var_scope_t());
+    return (*plan_out)->eval(&scope_env)->as_datum();
+}
+
+TPTEST(PlanCacheTest, SameShapeDifferentValues) {
+    perfmon_collection_t stats_collection;
+    ql::plan_cache_stats_t stats(&stats_collection);
+    ql::plan_cache_t cache(&stats);
+
+    counted_t<const ql::term_t> first, second;
+    EXPECT_EQ(ql::datum_t(ql::datum_t::construct_boolean_t(), true),
+              eval_cached(&cache,
+                          ((ql::r::expr(1.0) + ql::r::expr(2.0)) < ql::r::expr(4.0))
+                              .release_counted(),
+                          &first));
+    EXPECT_EQ(ql::datum_t(ql::datum_t::construct_boolean_t(), false),
+              eval_cached(&cache,
+                          ((ql::r::expr(3.0) + ql::r::expr(2.0)) < ql::r::expr(4.0))
+                              .release_counted(),
+                          &second));
+    // The second query reused the first one's compiled tree with its own values.
+    EXPECT_EQ(first.get(), second.get());
+}
+
+TPTEST(PlanCacheTest, LiteralsThatArentParameters) {
+    perfmon_collection_t stats_collection;
+    ql::plan_cache_stats_t stats(&stats_collection);
+    ql::plan_cache_t cache(&stats);
+
+    std::vector<ql::datum_t> items;
+    items.push_back(ql::datum_t(10.0));
+    items.push_back(ql::datum_t(20.0));
+    const ql::datum_t array(std::move(items), ql::configured_limits_t::unlimited);
+
+    // The index of `nth()` may be a parameter, but the array it's applied to may not.
+    counted_t<const ql::term_t> first, second;
+    EXPECT_EQ(ql::datum_t(20.0),
+              eval_cached(&cache,
+                          ql::r::expr(array).nth(ql::r::expr(1.0)).release_counted(),
+                          &first));
+    EXPECT_EQ(ql::datum_t(10.0),
+              eval_cached(&cache,
+                          ql::r::expr(array).nth(ql::r::expr(0.0)).release_counted(),
+                          &second));
+    EXPECT_EQ(first.get(), second.get());
+
+    std::vector<ql::datum_t> other_items;
+    other_items.push_back(ql::datum_t(30.0));
+    const ql::datum_t other_array(std::move(other_items),
+                                  ql::configured_limits_t::unlimited);
+    EXPECT_EQ(ql::datum_t(30.0),
+              eval_cached(&cache,
+                          ql::r::expr(other_array).nth(ql::r::expr(0.0))
+                              .release_counted(),
+                          &second));
+    EXPECT_NE(first.get(), second.get());
+}
+
+TPTEST(PlanCacheTest, LiteralsInFunctions) {
+    perfmon_collection_t stats_collection;
+    ql::plan_cache_stats_t stats(&stats_collection);
+    ql::plan_cache_t cache(&stats);
+
+    std::vector<ql::datum_t> items;
+    items.push_back(ql::datum_t(30.0));
+    items.push_back(ql::datum_t(40.0));
+    const ql::datum_t array(std::move(items), ql::configured_limits_t::unlimited);
+
+    // The function body is compiled with its literals in it, so queries that differ
+    // only there can't share a plan.
+    const ql::pb::dummy_var_t x = ql::pb::dummy_var_t::IGNORED;
+    counted_t<const ql::term_t> first, second;
+    EXPECT_EQ(ql::datum_t(30.0),
+              eval_cached(&cache,
+                          ql::r::expr(array)
+                              .filter(ql::r::fun(x, ql::r::var(x) == ql::r::expr(30.0)))
+                              .nth(ql::r::expr(0.0))
+                              .release_counted(),
+                          &first));
+    EXPECT_EQ(ql::datum_t(40.0),
+              eval_cached(&cache,
+                          ql::r::expr(array)
+                              .filter(ql::r::fun(x, ql::r::var(x) == ql::r::expr(40.0)))
+                              .nth(ql::r::expr(0.0))
+                              .release_counted(),
+                          &second));
+    EXPECT_NE(first.get(), second.get());
+}
+
+TPTEST(PlanCacheTest, CollapsedLiteralsArentParameters) {
+    perfmon_collection_t stats_collection;
+    ql::plan_cache_stats_t stats(&stats_collection);
+    ql::plan_cache_t cache(&stats);
+
+    // The operands of `eq` may be parameters, but not arrays that the JSON parser
+    // collapsed, because those are checked against the array limit.
+    counted_t<const ql::term_t> first, second;
+    ql::protob_t<Query> q = ql::make_counted_query();
+    ASSERT_TRUE(json_shim::parse_json_pb(q.get(), 0, "[1, [17, [[2, [1]], [2, [1]]]]]"));
+    EXPECT_EQ(ql::datum_t::boolean(true),
+              eval_cached(&cache, q.make_child(q->mutable_query()), &first));
+    q = ql::make_counted_query();
+    ASSERT_TRUE(json_shim::parse_json_pb(q.get(), 0, "[1, [17, [[2, [1]], [2, [2]]]]]"));
+    EXPECT_EQ(ql::datum_t::boolean(false),
+              eval_cached(&cache, q.make_child(q->mutable_query()), &second));
+    EXPECT_NE(first.get(), second.get());
+}
+
+}  // namespace unittest
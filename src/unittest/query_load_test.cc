@@ -0,0 +1,35 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "containers/scoped.hpp"
+#include "protob/query_load.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST_MULTITHREAD(QueryLoad, AvoidsBusyThreads, 4) {
+    perfmon_collection_t stats;
+    query_load_balancer_t balancer(&stats);
+    ASSERT_EQ(3, get_num_db_threads());
+
+    // Keep a few queries running on thread 1.
+    std::vector<scoped_ptr_t<query_load_balancer_t::query_t> > queries;
+    {
+        on_thread_t thread_switcher(threadnum_t(1));
+        for (int i = 0; i < 16; ++i) {
+            queries.push_back(make_scoped<query_load_balancer_t::query_t>(&balancer));
+        }
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_NE(1, balancer.choose_thread().threadnum);
+    }
+
+    // The queries have to go away on the thread they were counted on.
+    on_thread_t thread_switcher(threadnum_t(1));
+    queries.clear();
+}
+
+}  // namespace unittest
@@ -419,7 +419,7 @@ bool test_rdb_env_t::instance_t::table_find(const name_string_t &name,
         namespace_interface_access_t table_access(
             it->second.get(), &fake_ref_tracker, get_thread_id());
         table_out->init(new real_table_t(nil_uuid(), table_access,
-            primary_keys.at(std::make_pair(db->id, name)), NULL));
+            primary_keys.at(std::make_pair(db->id, name)), NULL, NULL, NULL));
         return true;
     }
 }
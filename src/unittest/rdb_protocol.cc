@@ -175,6 +175,55 @@ TEST(RDBProtocol, OvershardedGetSet) {
     run_in_thread_pool_with_namespace_interface(&run_get_set_test, true);
 }
 
+/* `GetProjection` tests that point reads with a projection only return the requested
+fields */
+void run_get_projection_test(namespace_interface_t *nsi, order_source_t *osource) {
+    {
+        ql::datum_object_builder_t row;
+        row.overwrite("id", ql::datum_t("a"));
+        row.overwrite("x", ql::datum_t(1.0));
+        row.overwrite("y", ql::datum_t(2.0));
+        write_t write(
+                point_write_t(store_key_t("a"), std::move(row).to_datum()),
+                DURABILITY_REQUIREMENT_DEFAULT,
+                profile_bool_t::PROFILE,
+                ql::configured_limits_t());
+        write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_get_projection_test(rdb_protocol.cc-A)"), &interruptor);
+
+        if (point_write_response_t *maybe_point_write_response_t = boost::get<point_write_response_t>(&response.response)) {
+            ASSERT_EQ(maybe_point_write_response_t->result, point_write_result_t::STORED);
+        } else {
+            ADD_FAILURE() << "got wrong type of result back";
+        }
+    }
+
+    {
+        std::vector<std::string> projection;
+        projection.push_back("x");
+        projection.push_back("missing");
+        read_t read(point_read_t(store_key_t("a"), projection), profile_bool_t::PROFILE);
+        read_response_t response;
+
+        cond_t interruptor;
+        nsi->read(read, &response, osource->check_in("unittest::run_get_projection_test(rdb_protocol.cc-B)"), &interruptor);
+
+        if (point_read_response_t *maybe_point_read_response = boost::get<point_read_response_t>(&response.response)) {
+            ql::datum_object_builder_t expected;
+            expected.overwrite("x", ql::datum_t(1.0));
+            ASSERT_EQ(std::move(expected).to_datum(), maybe_point_read_response->data);
+        } else {
+            ADD_FAILURE() << "got wrong result back";
+        }
+    }
+}
+
+TEST(RDBProtocol, GetProjection) {
+    run_in_thread_pool_with_namespace_interface(&run_get_projection_test, false);
+}
+
 std::string create_sindex(namespace_interface_t *nsi,
                           order_source_t *osource) {
     std::string id = uuid_to_str(generate_uuid());
@@ -0,0 +1,181 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/read_cache.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+// A `point_read_cache_t` whose changes come from the test rather than from a
+// changefeed.
+class test_read_cache_t : public point_read_cache_t {
+public:
+    explicit test_read_cache_t(point_read_cache_stats_t *_stats)
+        : point_read_cache_t(NULL, generate_uuid(), "id", _stats),
+          subscriptions(0) { }
+
+    using point_read_cache_t::on_change;
+    using point_read_cache_t::on_stop;
+    using point_read_cache_t::on_ring;
+
+    int subscriptions;
+
+private:
+    bool subscribe_to_changes(signal_t *) {
+        ++subscriptions;
+        return true;
+    }
+};
+
+class read_cache_test_t {
+public:
+    read_cache_test_t() : stats(&collection, "test"), cache(&stats), reads(0) { }
+
+    // Reads the row for `pkey` through the cache, from a table where it's `value`.
+    ql::datum_t read(double pkey, double value) {
+        return cache.read(key(pkey), &non_interruptor, [&]() {
+                ++reads;
+                return ql::datum_t(value);
+            });
+    }
+
+    static store_key_t key(double pkey) {
+        return store_key_t(ql::datum_t(pkey).print_primary());
+    }
+
+    perfmon_collection_t collection;
+    point_read_cache_stats_t stats;
+    test_read_cache_t cache;
+    cond_t non_interruptor;
+    int reads;
+};
+
+TPTEST(ReadCacheTest, HitsAndMisses) {
+    read_cache_test_t test;
+    EXPECT_EQ(10, test.read(1, 10).as_num());
+    EXPECT_EQ(1, test.reads);
+    // Cached, so the table's new value doesn't show.
+    EXPECT_EQ(10, test.read(1, 11).as_num());
+    EXPECT_EQ(1, test.reads);
+    EXPECT_EQ(20, test.read(2, 20).as_num());
+    EXPECT_EQ(2, test.reads);
+    EXPECT_EQ(1, test.cache.subscriptions);
+}
+
+TPTEST(ReadCacheTest, CachedRowDoesNotFill) {
+    read_cache_test_t test;
+    EXPECT_FALSE(test.cache.cached_row(read_cache_test_t::key(1)).has());
+    // Looking a row up doesn't cache it.
+    EXPECT_FALSE(test.cache.cached_row(read_cache_test_t::key(1)).has());
+    test.read(1, 10);
+    EXPECT_EQ(10, test.cache.cached_row(read_cache_test_t::key(1)).as_num());
+    test.cache.on_change(ql::datum_t(1.0));
+    EXPECT_FALSE(test.cache.cached_row(read_cache_test_t::key(1)).has());
+    EXPECT_EQ(1, test.reads);
+}
+
+TPTEST(ReadCacheTest, WritesEvictRows) {
+    read_cache_test_t test;
+    test.read(1, 10);
+    test.read(2, 20);
+    test.cache.invalidate(std::vector<store_key_t>(1, read_cache_test_t::key(1)));
+    EXPECT_EQ(11, test.read(1, 11).as_num());
+    EXPECT_EQ(20, test.read(2, 21).as_num());
+    EXPECT_EQ(3, test.reads);
+}
+
+TPTEST(ReadCacheTest, ChangesEvictRows) {
+    read_cache_test_t test;
+    test.read(1, 10);
+    test.read(2, 20);
+    test.cache.on_change(ql::datum_t(1.0));
+    EXPECT_EQ(11, test.read(1, 11).as_num());
+    EXPECT_EQ(20, test.read(2, 21).as_num());
+    EXPECT_EQ(3, test.reads);
+}
+
+TPTEST(ReadCacheTest, StopDropsRowsAndResubscribes) {
+    read_cache_test_t test;
+    test.read(1, 10);
+    test.cache.on_stop();
+    EXPECT_EQ(11, test.read(1, 11).as_num());
+    EXPECT_EQ(2, test.reads);
+    EXPECT_EQ(2, test.cache.subscriptions);
+}
+
+TPTEST(ReadCacheTest, HotRowKeepsSubscription) {
+    read_cache_test_t test;
+    // Every write evicts the only cached row, but the subscription stays.
+    for (int i = 0; i < 100; ++i) {
+        test.cache.invalidate(std::vector<store_key_t>(1, read_cache_test_t::key(1)));
+        EXPECT_EQ(i, test.read(1, i).as_num());
+        coro_t::yield();
+    }
+    EXPECT_EQ(100, test.reads);
+    EXPECT_EQ(1, test.cache.subscriptions);
+}
+
+TPTEST(ReadCacheTest, IdleSubscriptionIsDropped) {
+    read_cache_test_t test;
+    test.read(1, 10);
+    // The new subscription survives the first ring, and a hit keeps it for another.
+    test.cache.on_ring();
+    EXPECT_EQ(10, test.read(1, 11).as_num());
+    test.cache.on_ring();
+    test.cache.on_ring();
+    // Reading again before the subscription has been dropped subscribes anew, and
+    // the new subscription stays.
+    EXPECT_EQ(12, test.read(1, 12).as_num());
+    EXPECT_EQ(2, test.cache.subscriptions);
+    coro_t::yield();
+    EXPECT_EQ(12, test.read(1, 13).as_num());
+    EXPECT_EQ(2, test.cache.subscriptions);
+    EXPECT_EQ(2, test.reads);
+}
+
+TPTEST(ReadCacheTest, ChangeDuringReadIsNotCached) {
+    read_cache_test_t test;
+    cond_t reading, finish_read, done;
+    coro_t::spawn_sometime([&]() {
+        test.cache.read(read_cache_test_t::key(1), &test.non_interruptor, [&]() {
+                reading.pulse();
+                finish_read.wait();
+                // The row as it was before the change.
+                return ql::datum_t(10.0);
+            });
+        done.pulse();
+    });
+    reading.wait();
+    test.cache.on_change(ql::datum_t(1.0));
+    finish_read.pulse();
+    done.wait();
+
+    // The stale row must not have been cached.
+    EXPECT_EQ(11, test.read(1, 11).as_num());
+    EXPECT_EQ(1, test.reads);
+}
+
+TPTEST(ReadCacheTest, LastConcurrentReadFillsRow) {
+    read_cache_test_t test;
+    cond_t first_reading, finish_first, first_done;
+    coro_t::spawn_sometime([&]() {
+        test.cache.read(read_cache_test_t::key(1), &test.non_interruptor, [&]() {
+                first_reading.pulse();
+                finish_first.wait();
+                return ql::datum_t(10.0);
+            });
+        first_done.pulse();
+    });
+    first_reading.wait();
+    // The second read takes over the placeholder, so the first one, which might
+    // have started before a write that the second one saw, doesn't fill it.
+    EXPECT_EQ(11, test.read(1, 11).as_num());
+    finish_first.pulse();
+    first_done.wait();
+    EXPECT_EQ(11, test.read(1, 12).as_num());
+    EXPECT_EQ(1, test.reads);
+}
+
+}  // namespace unittest
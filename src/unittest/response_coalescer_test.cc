@@ -0,0 +1,127 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "protob/response_coalescer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/tcp_conn_pair.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+const int NUM_SENDERS = 100;
+const int MESSAGES_PER_SENDER = 100;
+
+std::string make_response(int sender, int i) {
+    return strprintf("[%d:%d:%s]", sender, i, std::string(i % 40, 'x').c_str());
+}
+
+// Has `NUM_SENDERS` coroutines send their responses at once, the way the queries on
+// a busy connection would, with `send`.  Returns how long it took until the peer had
+// read all of them, and checks that each arrived whole.
+template <class send_t>
+ticks_t send_concurrently(tcp_conn_pair_t *conns, const send_t &send) {
+    size_t total_size = 0;
+    for (int sender = 0; sender < NUM_SENDERS; ++sender) {
+        for (int i = 0; i < MESSAGES_PER_SENDER; ++i) {
+            total_size += make_response(sender, i).size();
+        }
+    }
+
+    const ticks_t start = get_ticks();
+    int senders_running = NUM_SENDERS;
+    cond_t senders_done;
+    for (int sender = 0; sender < NUM_SENDERS; ++sender) {
+        coro_t::spawn_sometime([&, sender]() {
+            for (int i = 0; i < MESSAGES_PER_SENDER; ++i) {
+                send(make_response(sender, i));
+            }
+            if (--senders_running == 0) {
+                senders_done.pulse();
+            }
+        });
+    }
+
+    cond_t non_interruptor;
+    std::string received(total_size, '\0');
+    conns->server->read(&received[0], total_size, &non_interruptor);
+    const ticks_t elapsed = get_ticks() - start;
+    senders_done.wait();
+
+    // Responses from different senders may be interleaved, but each sender's arrive
+    // whole and in order.
+    std::vector<int> next(NUM_SENDERS, 0);
+    size_t pos = 0;
+    while (pos < received.size()) {
+        const size_t end = received.find(']', pos);
+        EXPECT_NE(std::string::npos, end);
+        if (end == std::string::npos) {
+            break;
+        }
+        int sender, i;
+        EXPECT_EQ(2, sscanf(received.c_str() + pos, "[%d:%d:", &sender, &i));
+        EXPECT_EQ(next[sender], i);
+        EXPECT_EQ(make_response(sender, i), received.substr(pos, end + 1 - pos));
+        next[sender] = i + 1;
+        pos = end + 1;
+    }
+    for (int sender = 0; sender < NUM_SENDERS; ++sender) {
+        EXPECT_EQ(MESSAGES_PER_SENDER, next[sender]);
+    }
+    return elapsed;
+}
+
+TPTEST(ResponseCoalescerTest, ConcurrentResponses) {
+    tcp_conn_pair_t conns;
+    response_coalescer_t responses(conns.client.get(), DEFAULT_RESPONSE_DELAY_US);
+    cond_t non_interruptor;
+    send_concurrently(&conns, [&](std::string &&message) {
+        responses.send(std::move(message), &non_interruptor);
+    });
+}
+
+TPTEST(ResponseCoalescerTest, WriteClosed) {
+    tcp_conn_pair_t conns;
+    response_coalescer_t responses(conns.client.get(), 0);
+    cond_t non_interruptor;
+    conns.client->shutdown_write();
+    EXPECT_THROW(responses.send("response", &non_interruptor),
+                 tcp_conn_write_closed_exc_t);
+}
+
+// Compares writing the responses of many concurrent queries one at a time, the way
+// the query server used to, with coalescing them, over the loopback interface.
+TPTEST(ResponseCoalescerTest, Benchmark) {
+    cond_t non_interruptor;
+
+    ticks_t one_at_a_time;
+    {
+        tcp_conn_pair_t conns;
+        new_mutex_t send_mutex;
+        one_at_a_time = send_concurrently(&conns, [&](std::string &&message) {
+            new_mutex_in_line_t send_line(&send_mutex);
+            send_line.acq_signal()->wait();
+            conns.client->write(message.data(), message.size(), &non_interruptor);
+        });
+    }
+
+    ticks_t coalesced;
+    {
+        tcp_conn_pair_t conns;
+        response_coalescer_t responses(conns.client.get(), DEFAULT_RESPONSE_DELAY_US);
+        coalesced = send_concurrently(&conns, [&](std::string &&message) {
+            responses.send(std::move(message), &non_interruptor);
+        });
+    }
+
+    printf("%d responses: one at a time %.3fs, coalesced %.3fs\n",
+           NUM_SENDERS * MESSAGES_PER_SENDER,
+           ticks_to_secs(one_at_a_time),
+           ticks_to_secs(coalesced));
+}
+
+}  // namespace unittest
@@ -0,0 +1,330 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/sampling_profiler.hpp"
+#include "arch/timing.hpp"
+#include "clustering/administration/http/profile_app.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+profiler_sample_t make_sample(const char *spawn_site,
+                              const std::vector<void *> &frames,
+                              uint64_t weight = 1) {
+    profiler_sample_t sample;
+    sample.kind = profile_kind_t::CPU;
+    sample.spawn_site = spawn_site;
+    sample.weight = weight;
+    sample.first_frame = 0;
+    sample.num_frames = frames.size();
+    for (size_t i = 0; i < frames.size(); ++i) {
+        sample.frames[i] = frames[i];
+    }
+    return sample;
+}
+
+// Splits folded stacks into their lines.
+std::vector<std::string> folded_lines(const std::string &folded) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    for (size_t end = folded.find('\n'); end != std::string::npos;
+         end = folded.find('\n', start)) {
+        lines.push_back(folded.substr(start, end - start));
+        start = end + 1;
+    }
+    EXPECT_EQ(folded.size(), start) << "the last line isn't terminated";
+    return lines;
+}
+
+uint64_t total_weight(const std::string &folded) {
+    uint64_t total = 0;
+    for (const std::string &line : folded_lines(folded)) {
+        total += strtoull(line.substr(line.rfind(' ') + 1).c_str(), NULL, 10);
+    }
+    return total;
+}
+
+// The name the profiler gives the frame at `addr`.
+std::string frame_name(void *addr) {
+    std::vector<profiler_sample_t> samples(1, make_sample(NULL, {addr}));
+    const std::string line = fold_profiler_samples(samples);
+    const std::string prefix = "[scheduler];";
+    EXPECT_EQ(prefix, line.substr(0, prefix.size()));
+    return line.substr(prefix.size(), line.rfind(' ') - prefix.size());
+}
+
+TEST(SamplingProfilerTest, FoldsStacks) {
+    int a, b, c;
+    void *const inner = &a;
+    void *const middle = &b;
+    void *const outer = &c;
+
+    std::vector<profiler_sample_t> samples;
+    samples.push_back(make_sample(NULL, {inner, middle, outer}));
+    samples.push_back(make_sample(NULL, {inner, middle, outer}));
+    samples.push_back(make_sample(NULL, {middle, outer}, 5));
+    // `first_frame` skips the innermost frames.
+    samples.push_back(make_sample(NULL, {inner, middle, outer}));
+    samples.back().first_frame = 1;
+
+    const std::vector<std::string> lines =
+        folded_lines(fold_profiler_samples(samples));
+    ASSERT_EQ(2u, lines.size());
+    // The frames go from the outermost in, and identical stacks are added up.
+    const std::string outer_stack =
+        "[scheduler];" + frame_name(outer) + ";" + frame_name(middle);
+    const std::string inner_stack = outer_stack + ";" + frame_name(inner);
+    EXPECT_EQ(inner_stack + " 2", lines[0] < lines[1] ? lines[1] : lines[0]);
+    EXPECT_EQ(outer_stack + " 6", lines[0] < lines[1] ? lines[0] : lines[1]);
+}
+
+TEST(SamplingProfilerTest, SpawnSites) {
+    int a;
+    std::vector<profiler_sample_t> samples;
+    samples.push_back(make_sample(
+        "static coro_t* coro_t::get_and_init_coro(Callable&&)"
+        " [with Callable = unittest::spin_t]", {&a}));
+    // Semicolons would split the spawn site into frames.
+    samples.push_back(make_sample(
+        "static coro_t* coro_t::get_and_init_coro(Callable&&)"
+        " [with Callable = f(int;int)]", {&a}));
+
+    const std::vector<std::string> lines =
+        folded_lines(fold_profiler_samples(samples));
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("f(int int);" + frame_name(&a) + " 1", lines[0]);
+    EXPECT_EQ("unittest::spin_t;" + frame_name(&a) + " 1", lines[1]);
+}
+
+TEST(SamplingProfilerTest, WalksFramePointers) {
+    // A stack with three frames, each made of the caller's frame pointer and the
+    // return address.
+    uintptr_t stack[16];
+    for (size_t i = 0; i < 16; ++i) {
+        stack[i] = 0;
+    }
+    stack[2] = reinterpret_cast<uintptr_t>(&stack[6]);
+    stack[3] = 0x1000;
+    stack[6] = reinterpret_cast<uintptr_t>(&stack[10]);
+    stack[7] = 0x2000;
+    stack[10] = 0;
+    stack[11] = 0x3000;
+    const uintptr_t lower = reinterpret_cast<uintptr_t>(&stack[0]);
+    const uintptr_t upper = reinterpret_cast<uintptr_t>(&stack[16]);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(&stack[2]);
+
+    void *frames[8];
+    ASSERT_EQ(3, walk_profiler_frames(start, lower, upper, frames, 8));
+    EXPECT_EQ(reinterpret_cast<void *>(0x1000), frames[0]);
+    EXPECT_EQ(reinterpret_cast<void *>(0x2000), frames[1]);
+    EXPECT_EQ(reinterpret_cast<void *>(0x3000), frames[2]);
+    EXPECT_EQ(2, walk_profiler_frames(start, lower, upper, frames, 2));
+
+    // Frames outside of the stack aren't read.
+    EXPECT_EQ(0, walk_profiler_frames(start, lower, start, frames, 8));
+    EXPECT_EQ(0, walk_profiler_frames(lower - 64, lower, upper, frames, 8));
+    EXPECT_EQ(0, walk_profiler_frames(start + 1, lower, upper, frames, 8));
+    stack[6] = upper + 64;
+    EXPECT_EQ(2, walk_profiler_frames(start, lower, upper, frames, 8));
+
+    // Nor does the walk go back down the stack.
+    stack[6] = start;
+    EXPECT_EQ(2, walk_profiler_frames(start, lower, upper, frames, 8));
+}
+
+// Keeps `thread` busy until `*stop` is set.
+struct spin_t {
+    spin_t(threadnum_t _thread, const bool *_stop, cond_t *_done)
+        : thread(_thread), stop(_stop), done(_done) { }
+    void operator()() {
+        {
+            on_thread_t thread_switcher(thread);
+            volatile uint64_t x = 0;
+            while (!__atomic_load_n(stop, __ATOMIC_RELAXED)) {
+                for (int i = 0; i < 100000; ++i) {
+                    x = x * 31 + i;
+                }
+                coro_t::yield();
+            }
+        }
+        done->pulse();
+    }
+    threadnum_t thread;
+    const bool *stop;
+    cond_t *done;
+};
+
+TPTEST(SamplingProfilerTest, CpuProfile, 2) {
+    if (!sampling_profiler_is_supported()) {
+        return;
+    }
+    bool stop = false;
+    std::vector<cond_t> done(get_num_threads());
+    for (int i = 0; i < get_num_threads(); ++i) {
+        coro_t::spawn_sometime(spin_t(threadnum_t(i), &stop, &done[i]));
+    }
+
+    // Profiles can be taken one after another.
+    for (int round = 0; round < 2; ++round) {
+        cond_t interruptor;
+        sampling_profile_t profile;
+        EXPECT_TRUE(take_sampling_profile(secs_to_ticks(0.2), 1000,
+                                          profile_kind_t::CPU, &interruptor,
+                                          &profile));
+        EXPECT_GT(total_weight(profile.folded_stacks), 0u);
+
+        // The samples were taken in the coroutines that were busy.
+        bool found_spin = false;
+        for (const std::string &line : folded_lines(profile.folded_stacks)) {
+            found_spin |= line.find("unittest::spin_t") == 0;
+        }
+        EXPECT_TRUE(found_spin);
+    }
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    for (int i = 0; i < get_num_threads(); ++i) {
+        done[i].wait();
+    }
+}
+
+TPTEST(SamplingProfilerTest, WaitProfile) {
+    if (!sampling_profiler_is_supported()) {
+        return;
+    }
+    cond_t interruptor, stop, done;
+    coro_t::spawn_sometime([&]() {
+        while (!stop.is_pulsed()) {
+            nap(1);
+        }
+        done.pulse();
+    });
+    sampling_profile_t profile;
+    EXPECT_TRUE(take_sampling_profile(secs_to_ticks(0.5), 100, profile_kind_t::WAIT,
+                                      &interruptor, &profile));
+    stop.pulse();
+    done.wait();
+    EXPECT_GT(total_weight(profile.folded_stacks), 0u);
+}
+
+TPTEST(SamplingProfilerTest, OneProfileAtATime) {
+    if (!sampling_profiler_is_supported()) {
+        return;
+    }
+    cond_t interruptor, done;
+    bool interrupted = false;
+    coro_t::spawn_now_dangerously([&]() {
+        sampling_profile_t profile;
+        try {
+            take_sampling_profile(secs_to_ticks(60), 100, profile_kind_t::CPU,
+                                  &interruptor, &profile);
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+        }
+        done.pulse();
+    });
+
+    cond_t non_interruptor;
+    sampling_profile_t profile;
+    EXPECT_FALSE(take_sampling_profile(secs_to_ticks(0.1), 100, profile_kind_t::CPU,
+                                       &non_interruptor, &profile));
+
+    interruptor.pulse();
+    done.wait();
+    EXPECT_TRUE(interrupted);
+    // Once it's over, the next one can start.
+    EXPECT_TRUE(take_sampling_profile(secs_to_ticks(0.1), 100, profile_kind_t::CPU,
+                                      &non_interruptor, &profile));
+}
+
+http_res_t get_profile(const std::string &path,
+                       const std::map<std::string, std::string> &query_params,
+                       http_method_t method = GET) {
+    http_req_t req(path);
+    req.method = method;
+    req.query_params = query_params;
+    http_res_t res;
+    cond_t interruptor;
+    profile_app_t app;
+    app.handle(req, &res, &interruptor);
+    return res;
+}
+
+TPTEST(SamplingProfilerTest, ProfileAppValidation) {
+    typedef std::map<std::string, std::string> params_t;
+    EXPECT_EQ(HTTP_METHOD_NOT_ALLOWED, get_profile("/cpu", params_t(), POST).code);
+    EXPECT_EQ(HTTP_NOT_FOUND, get_profile("/", params_t()).code);
+    EXPECT_EQ(HTTP_NOT_FOUND, get_profile("/heap", params_t()).code);
+    EXPECT_EQ(HTTP_NOT_FOUND, get_profile("/cpu/more", params_t()).code);
+
+    const char *bad_seconds[] = { "0", "61", "-1", "1.5", "x", "" };
+    for (const char *seconds : bad_seconds) {
+        EXPECT_EQ(HTTP_BAD_REQUEST,
+                  get_profile("/cpu", params_t{{"seconds", seconds}}).code)
+            << "seconds=" << seconds;
+    }
+    const char *bad_frequencies[] = { "0", "1001", "-1", "x", "" };
+    for (const char *frequency : bad_frequencies) {
+        EXPECT_EQ(HTTP_BAD_REQUEST,
+                  get_profile("/wait", params_t{{"frequency", frequency}}).code)
+            << "frequency=" << frequency;
+    }
+
+    if (sampling_profiler_is_supported()) {
+        http_res_t res =
+            get_profile("/cpu", params_t{{"seconds", "1"}, {"frequency", "1000"}});
+        EXPECT_EQ(HTTP_OK, res.code);
+        EXPECT_EQ(1u, res.header_lines.count("X-Dropped-Samples"));
+    }
+}
+
+// Runs the same CPU-bound work with and without a profile being taken at the default
+// frequency, and reports how much slower it was.
+TPTEST(SamplingProfilerTest, OverheadBenchmark) {
+    if (!sampling_profiler_is_supported()) {
+        return;
+    }
+    auto work = []() {
+        volatile uint64_t x = 0;
+        const ticks_t start = get_ticks();
+        for (int round = 0; round < 200; ++round) {
+            for (int i = 0; i < 1000000; ++i) {
+                x = x * 31 + i;
+            }
+            // Lets the profile start and stop.
+            coro_t::yield();
+        }
+        return ticks_to_secs(get_ticks() - start);
+    };
+
+    const double unprofiled_secs = work();
+
+    cond_t interruptor, done;
+    coro_t::spawn_sometime([&]() {
+        sampling_profile_t profile;
+        try {
+            take_sampling_profile(secs_to_ticks(60),
+                                  SAMPLING_PROFILER_DEFAULT_FREQUENCY,
+                                  profile_kind_t::CPU, &interruptor, &profile);
+        } catch (const interrupted_exc_t &) { }
+        done.pulse();
+    });
+    for (int i = 0; i < 10; ++i) {
+        coro_t::yield();
+    }
+    const double profiled_secs = work();
+    interruptor.pulse();
+    done.wait();
+
+    printf("CPU-bound work: %.3fs unprofiled, %.3fs profiled at %d Hz (%+.2f%%)\n",
+           unprofiled_secs, profiled_secs, SAMPLING_PROFILER_DEFAULT_FREQUENCY,
+           100 * (profiled_secs - unprofiled_secs) / unprofiled_secs);
+}
+
+}  // namespace unittest
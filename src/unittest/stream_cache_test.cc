@@ -0,0 +1,127 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/stream_cache.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static counted_t<ql::datum_stream_t> make_test_stream(size_t num_rows) {
+    std::vector<ql::datum_t> rows;
+    for (size_t i = 0; i < num_rows; ++i) {
+        rows.push_back(ql::datum_t(datum_string_t(
+            strprintf("%zu:%s", i, std::string(1000, 'x').c_str()))));
+    }
+    return make_counted<ql::array_datum_stream_t>(
+        ql::datum_t(std::move(rows), ql::configured_limits_t::unlimited),
+        ql::make_counted_backtrace());
+}
+
+// Lets the cache's background work run until the next batch of `token` is ready.
+// Returns false if it doesn't get ready.
+static bool wait_for_prefetch(ql::stream_cache_t *cache, int64_t token) {
+    for (int i = 0; i < 100; ++i) {
+        if (cache->has_prefetched_batch(token)) {
+            return true;
+        }
+        coro_t::yield();
+    }
+    return false;
+}
+
+// Reads the rest of the stream the way a client sending `CONTINUE`s would.
+static std::vector<std::string> read_stream(ql::stream_cache_t *cache, int64_t token,
+                                            int *num_batches_out) {
+    cond_t non_interruptor;
+    std::vector<std::string> rows;
+    *num_batches_out = 0;
+    for (;;) {
+        Response res;
+        EXPECT_TRUE(cache->serve(token, &res, &non_interruptor));
+        ++*num_batches_out;
+        for (int i = 0; i < res.response_size(); ++i) {
+            rows.push_back(res.response(i).r_str());
+        }
+        if (res.type() == Response::SUCCESS_SEQUENCE) {
+            EXPECT_FALSE(cache->contains(token));
+            return rows;
+        }
+        EXPECT_EQ(Response::SUCCESS_PARTIAL, res.type());
+        // The next batch is computed in the background, without waiting for the
+        // client to ask for it.
+        EXPECT_TRUE(wait_for_prefetch(cache, token));
+    }
+}
+
+TPTEST(StreamCache, PrefetchedBatches) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+
+    const size_t num_rows = 5000;
+    cache.insert(1, ql::use_json_t::NO, std::map<std::string, ql::wire_func_t>(),
+                 profile_bool_t::DONT_PROFILE, make_test_stream(num_rows));
+    int num_batches;
+    std::vector<std::string> rows = read_stream(&cache, 1, &num_batches);
+    // Every row arrives exactly once, in order, across several batches.
+    EXPECT_GT(num_batches, 2);
+    ASSERT_EQ(num_rows, rows.size());
+    for (size_t i = 0; i < num_rows; ++i) {
+        ASSERT_EQ(strprintf("%zu:", i), rows[i].substr(0, rows[i].find(':') + 1));
+    }
+}
+
+TPTEST(StreamCache, EraseDuringPrefetch) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    cond_t non_interruptor;
+
+    for (int64_t token = 0; token < 10; ++token) {
+        cache.insert(token, ql::use_json_t::NO,
+                     std::map<std::string, ql::wire_func_t>(),
+                     profile_bool_t::DONT_PROFILE, make_test_stream(5000));
+        Response res;
+        ASSERT_TRUE(cache.serve(token, &res, &non_interruptor));
+        ASSERT_EQ(Response::SUCCESS_PARTIAL, res.type());
+    }
+    // So that cursors whose next batch is ready get stopped too.
+    ASSERT_TRUE(wait_for_prefetch(&cache, 0));
+    // Stopping the cursors must not wait for, or leak, their prefetched batches.
+    for (int64_t token = 0; token < 10; ++token) {
+        cache.erase(token);
+        EXPECT_FALSE(cache.contains(token));
+    }
+}
+
+TPTEST(StreamCache, EraseDuringServe) {
+    rdb_context_t ctx;
+    ql::stream_cache_t cache(&ctx, ql::reject_cfeeds_t::NO);
+    cond_t non_interruptor;
+
+    cache.insert(1, ql::use_json_t::NO, std::map<std::string, ql::wire_func_t>(),
+                 profile_bool_t::DONT_PROFILE, make_test_stream(5000));
+    Response first;
+    ASSERT_TRUE(cache.serve(1, &first, &non_interruptor));
+    ASSERT_EQ(Response::SUCCESS_PARTIAL, first.type());
+
+    // A `STOP` arrives while the `CONTINUE` is waiting for its batch.
+    cond_t erased;
+    coro_t::spawn_sometime([&cache, &erased]() {
+            cache.erase(1);
+            erased.pulse();
+        });
+    Response res;
+    ASSERT_TRUE(cache.serve(1, &res, &non_interruptor));
+    EXPECT_EQ(Response::SUCCESS_SEQUENCE, res.type());
+    EXPECT_EQ(0, res.response_size());
+    EXPECT_FALSE(cache.contains(1));
+    erased.wait_lazily_unordered();
+}
+
+}  // namespace unittest
@@ -0,0 +1,42 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef UNITTEST_TCP_CONN_PAIR_HPP_
+#define UNITTEST_TCP_CONN_PAIR_HPP_
+
+#include <functional>
+#include <set>
+
+#include "arch/io/network.hpp"
+#include "arch/types.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/scoped.hpp"
+
+namespace unittest {
+
+// Accepts a single connection on the loopback interface.
+class tcp_conn_pair_t {
+public:
+    tcp_conn_pair_t()
+        : listener(std::set<ip_address_t>(), 0,
+                   std::bind(&tcp_conn_pair_t::on_connect, this, ph::_1)) {
+        cond_t non_interruptor;
+        client.init(new tcp_conn_t(ip_address_t("127.0.0.1"), listener.get_port(),
+                                   &non_interruptor));
+        connected.wait();
+    }
+
+    scoped_ptr_t<tcp_conn_t> client;
+    scoped_ptr_t<tcp_conn_t> server;
+
+private:
+    void on_connect(scoped_ptr_t<tcp_conn_descriptor_t> &nconn) {
+        nconn->make_overcomplicated(&server);
+        connected.pulse();
+    }
+
+    cond_t connected;
+    tcp_listener_t listener;
+};
+
+}  // namespace unittest
+
+#endif  // UNITTEST_TCP_CONN_PAIR_HPP_
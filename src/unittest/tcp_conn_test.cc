@@ -0,0 +1,84 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "arch/io/network.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/tcp_conn_pair.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+std::string make_message(int i) {
+    return strprintf("%d:%s;", i, std::string(i % 100, 'x').c_str());
+}
+
+TPTEST(TcpConnTest, PipelinedMessages) {
+    tcp_conn_pair_t conns;
+    cond_t non_interruptor;
+
+    // Lots of small buffered writes, which go out in batches.
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        std::string message = make_message(i);
+        conns.client->write_buffered(message.data(), message.size(), &non_interruptor);
+        expected += message;
+    }
+    conns.client->flush_buffer(&non_interruptor);
+
+    // Read them back one message at a time, through the peek buffer.
+    std::string received;
+    for (int i = 0; i < 10000; ++i) {
+        std::string message = make_message(i);
+        const_charslice slice = conns.server->peek(message.size(), &non_interruptor);
+        received.append(slice.beg, slice.end);
+        conns.server->pop(message.size(), &non_interruptor);
+    }
+    EXPECT_EQ(expected, received);
+}
+
+TPTEST(TcpConnTest, Writev) {
+    tcp_conn_pair_t conns;
+    cond_t non_interruptor;
+
+    // More buffers than go into a single `::writev()`.
+    std::vector<std::string> messages;
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        messages.push_back(make_message(i));
+        expected += messages.back();
+    }
+    std::vector<iovec> iov(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        iov[i].iov_base = const_cast<char *>(messages[i].data());
+        iov[i].iov_len = messages[i].size();
+    }
+    conns.client->writev(iov.data(), iov.size(), &non_interruptor);
+
+    std::string received(expected.size(), '\0');
+    conns.server->read(&received[0], received.size(), &non_interruptor);
+    EXPECT_EQ(expected, received);
+}
+
+TPTEST(TcpConnTest, MixedReads) {
+    tcp_conn_pair_t conns;
+    cond_t non_interruptor;
+
+    const std::string data = "0123456789abcdefghijklmnopqrstuvwxyz";
+    for (int i = 0; i < 100; ++i) {
+        conns.client->write(data.data(), data.size(), &non_interruptor);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        // Leave some data in the peek buffer, then read across its end.
+        const_charslice slice = conns.server->peek(10, &non_interruptor);
+        ASSERT_EQ(data.substr(0, 10), std::string(slice.beg, slice.end));
+        conns.server->pop(3, &non_interruptor);
+        char buf[33];
+        conns.server->read(buf, sizeof(buf), &non_interruptor);
+        ASSERT_EQ(data.substr(3), std::string(buf, sizeof(buf)));
+    }
+}
+
+}  // namespace unittest
@@ -1,7 +1,13 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "unittest/gtest.hpp"
 
+#include <stdio.h>
+
+#include <vector>
+
+#include "arch/timer.hpp"
 #include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/pmap.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "utils.hpp"
@@ -28,5 +34,101 @@ TPTEST(TimerTest, TestApproximateWaitTimes) {
     pmap(2, walk_wait_times);
 }
 
+class recording_callback_t : public timer_callback_t {
+public:
+    recording_callback_t(int64_t ms, int *remaining, cond_t *all_done)
+        : rings(0), added(get_ticks()), earliest(added + ms * MILLION),
+          remaining_(remaining), all_done_(all_done) { }
+
+    void on_timer() {
+        ++rings;
+        rang = get_ticks();
+        if (remaining_ != NULL && --*remaining_ == 0) {
+            all_done_->pulse();
+        }
+    }
+
+    int rings;
+    const ticks_t added;
+    const ticks_t earliest;
+    ticks_t rang;
+
+private:
+    int *remaining_;
+    cond_t *all_done_;
+};
+
+TPTEST(TimerTest, RingsOnTime) {
+    const std::vector<int64_t> delays_ms = { 1, 3, 5, 7, 20, 100, 1300, 1600 };
+    int remaining = delays_ms.size();
+    cond_t all_done;
+    std::vector<scoped_ptr_t<recording_callback_t> > callbacks;
+    std::vector<scoped_ptr_t<recording_callback_t> > canceled;
+    for (int64_t ms : delays_ms) {
+        callbacks.push_back(scoped_ptr_t<recording_callback_t>(
+            new recording_callback_t(ms, &remaining, &all_done)));
+        fire_timer_once(ms, callbacks.back().get());
+
+        // Timers that are canceled right away, and some that are canceled after the
+        // others have had a chance to move between the levels of the wheel.
+        canceled.push_back(scoped_ptr_t<recording_callback_t>(
+            new recording_callback_t(ms, NULL, NULL)));
+        cancel_timer(fire_timer_once(ms, canceled.back().get()));
+    }
+    recording_callback_t late(1700, NULL, NULL);
+    timer_token_t *late_token = fire_timer_once(1700, &late);
+
+    all_done.wait();
+    cancel_timer(late_token);
+
+    for (const auto &callback : callbacks) {
+        EXPECT_EQ(1, callback->rings);
+        // Timers never ring early, and at most a tick late, plus whatever it took the
+        // thread to get around to it.
+        EXPECT_LE(callback->earliest, callback->rang);
+        EXPECT_GT(callback->earliest + 100 * MILLION, callback->rang);
+    }
+    for (const auto &callback : canceled) {
+        EXPECT_EQ(0, callback->rings);
+    }
+    EXPECT_EQ(0, late.rings);
+}
+
+TPTEST(TimerTest, Repeating) {
+    int remaining = 5;
+    cond_t done;
+    recording_callback_t callback(10, &remaining, &done);
+    timer_token_t *token = add_timer(10, &callback);
+    done.wait();
+    cancel_timer(token);
+    EXPECT_LE(callback.added + 5 * 10 * MILLION, callback.rang);
+}
+
+// Adds and cancels lots of timers, the way query timeouts and batch deadlines come and
+// go, while many others are outstanding.
+TPTEST(TimerTest, ChurnBenchmark) {
+    const int num_outstanding = 100000;
+    const int num_churned = 1000000;
+    recording_callback_t callback(0, NULL, NULL);
+
+    std::vector<timer_token_t *> outstanding;
+    for (int i = 0; i < num_outstanding; ++i) {
+        outstanding.push_back(fire_timer_once(1000 + i % 100000, &callback));
+    }
+
+    const ticks_t start = get_ticks();
+    for (int i = 0; i < num_churned; ++i) {
+        cancel_timer(fire_timer_once(5 + i % 60000, &callback));
+    }
+    const ticks_t elapsed = get_ticks() - start;
+
+    for (timer_token_t *token : outstanding) {
+        cancel_timer(token);
+    }
+    EXPECT_EQ(0, callback.rings);
+    printf("%d timers added and canceled with %d outstanding: %.3fs, %.0fns each\n",
+           num_churned, num_outstanding, ticks_to_secs(elapsed),
+           static_cast<double>(elapsed) / num_churned);
+}
 
 }  // namespace unittest
@@ -196,6 +196,18 @@ with_priority_t::~with_priority_t() {
     coro_t::self()->set_priority(previous_priority);
 }
 
+with_sched_class_t::with_sched_class_t(sched_class_t sched_class) {
+    rassert(coro_t::self() != NULL);
+    previous_sched_class = coro_t::self()->get_sched_class();
+    previous_priority = coro_t::self()->get_priority();
+    coro_t::self()->set_sched_class(sched_class);
+}
+with_sched_class_t::~with_sched_class_t() {
+    rassert(coro_t::self() != NULL);
+    coro_t::self()->set_sched_class(previous_sched_class);
+    coro_t::self()->set_priority(previous_priority);
+}
+
 void *malloc_aligned(size_t size, size_t alignment) {
     void *ptr = NULL;
     int res = posix_memalign(&ptr, alignment, size);  // NOLINT(runtime/rethinkdb_fn)
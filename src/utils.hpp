@@ -10,6 +10,7 @@
 
 #include "errors.hpp"
 #include "debug.hpp"
+#include "arch/runtime/sched_class.hpp"
 #include "config/args.hpp"
 
 class printf_buffer_t;
@@ -106,6 +107,19 @@ private:
     int previous_priority;
 };
 
+/* `with_sched_class_t` puts the current coroutine in the scheduling class given in
+its constructor, which also sets its priority.  When it is destructed, it restores the
+coroutine's original class and priority. */
+
+class with_sched_class_t {
+public:
+    explicit with_sched_class_t(sched_class_t sched_class);
+    ~with_sched_class_t();
+private:
+    sched_class_t previous_sched_class;
+    int previous_priority;
+};
+
 
 template <class InputIterator, class UnaryPredicate>
 bool all_match_predicate(InputIterator begin, InputIterator end, UnaryPredicate f) {
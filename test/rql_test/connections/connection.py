@@ -5,7 +5,7 @@
 
 from __future__ import print_function
 
-import datetime, os, re, socket, sys, tempfile, threading, unittest
+import datetime, json, os, re, socket, sys, tempfile, threading, unittest
 
 sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), os.pardir, os.pardir, "common"))
 import driver, utils
@@ -18,6 +18,10 @@ try:
     import SocketServer
 except:
     import socketserver as SocketServer
+try:
+    from urllib2 import urlopen
+except ImportError:
+    from urllib.request import urlopen
 
 # -- import the rethinkdb driver
 
@@ -594,6 +598,52 @@ class TestGroupWithTimeKey(TestWithConnection):
         groups = r.table('times').group('time').coerce_to('array').run(c)
         self.assertEqual(groups, {dt1:[expected_row1], dt2:[expected_row2]})
 
+class TestCloseWithChangefeed(TestWithConnection):
+    def openConnections(self):
+        # The number of client connections the server counts, from its stats
+        stats = json.loads(urlopen('http://%s:%d/ajax/stat' % (sharedServerHost, sharedServer.http_port)).read().decode('utf-8'))
+        count = 0
+        for machine_id, machine_stats in stats.items():
+            if machine_id == 'machines':
+                continue
+            for thread_stats in machine_stats['query_language']['query_load'].values():
+                count += int(thread_stats['connections'])
+        return count
+    
+    def runTest(self):
+        if sharedServer is None:
+            self.skipTest('needs the stats of a server started by this test')
+            return
+        c = r.connect(host=sharedServerHost, port=sharedServerDriverPort)
+        
+        if 'feed' in r.db('test').table_list().run(c):
+            r.db('test').table_drop('feed').run(c)
+        r.db('test').table_create('feed').run(c)
+        connections = self.openConnections()
+        
+        feed_conn = r.connect(host=sharedServerHost, port=sharedServerDriverPort)
+        feed = r.table('feed').changes().run(feed_conn)
+        
+        # Wait for a change that never comes, then close the socket under it
+        def waitForChange():
+            try:
+                next(feed)
+            except Exception:
+                pass
+        waiter = threading.Thread(target=waitForChange)
+        waiter.daemon = True
+        waiter.start()
+        time.sleep(0.5)
+        self.assertEqual(self.openConnections(), connections + 1)
+        feed_conn.socket.shutdown(socket.SHUT_RDWR)
+        waiter.join(5)
+        
+        # The server should tear down the connection without a change to the table
+        deadline = time.time() + 10
+        while self.openConnections() != connections and time.time() < deadline:
+            time.sleep(0.1)
+        self.assertEqual(self.openConnections(), connections)
+        r.db('test').table_drop('feed').run(c)
 
 if __name__ == '__main__':
     print("Running py connection tests")
@@ -608,6 +658,7 @@ if __name__ == '__main__':
     suite.addTest(TestBatching())
     suite.addTest(TestGetIntersectingBatching())
     suite.addTest(TestGroupWithTimeKey())
+    suite.addTest(TestCloseWithChangefeed())
     suite.addTest(loader.loadTestsFromTestCase(TestShutdown))
     
     res = unittest.TextTestRunner(verbosity=2).run(suite)